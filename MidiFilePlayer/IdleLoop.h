@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file IdleLoop.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Tickless idle of the loop.
+ *        During a pass every module with work in the future reports its deadline with idle_due_at(),
+ *        idle_wait() at the end of the pass sleeps until the earliest one, at most IDLE_MAX_SLEEP_US.
+ *        The wait ends early when the pending function passed to idle_init() finds received data,
+ *        after an interrupt of a pin registered with idle_wake_pin() or when idle_wake() is called.
+ *        ESP32: the loop task blocks on a task notification, a one shot timer gives it at the deadline
+ *        and the UART callback of the sketch calls idle_wake(), the idle task of FreeRTOS halts the CPU meanwhile.
+ *        With IDLE_LIGHT_SLEEP power management enters light sleep while all tasks are blocked,
+ *        the UART and USB do not receive then, the first bytes after a sleep are lost. Only for units driven by the buttons.
+ *        Other boards halt the CPU with WFI (WFE on RP2040, sleep mode idle on AVR) until the next interrupt.
+ *        A MIDI byte is handled within IDLE_WAKE_BOUND_US plus one pass after its arrival,
+ *        usually the interrupt of the UART ends the wait right away.
+ *        Utilization (time not waiting) and wake-ups are counted per window of IDLE_STATS_MS.
+ */
+
+
+#ifndef IDLE_LOOP_H
+#define IDLE_LOOP_H
+
+
+#include <Arduino.h>
+
+
+#define IDLE_LOOP                       /* compiled in, switched by the idle console command */
+//#define IDLE_LIGHT_SLEEP              /* ESP32 only, requires CONFIG_PM_ENABLE, drops received bytes while asleep */
+
+#define IDLE_MIN_SLEEP_US       100U    /* shorter waits are spun */
+#define IDLE_MAX_SLEEP_US       20000U  /* the loop runs at least this often, covers timeouts without a deadline */
+#define IDLE_WAKE_BOUND_US      1100U   /* longest wait without a check of the pending function, one tick of the core (1.024 ms on AVR) */
+#define IDLE_STATS_MS           1000U   /* window of the utilization */
+
+
+struct idle_stats_s
+{
+    bool enabled;
+    uint16_t loadPermille;  /* time not waiting in the last window */
+    uint32_t loopsPerSec;
+    uint32_t wakeupsPerSec; /* returns from a wait, deadline, interrupt or tick of the core */
+    uint32_t lateMaxUs;     /* longest time woken after a deadline */
+    uint32_t sleepMaxUs;    /* longest single wait */
+};
+
+
+void idle_init(bool (*pending)(void));
+void idle_set_enabled(bool enable);
+bool idle_enabled(void);
+void idle_wake_pin(uint8_t pin);
+void idle_due_at(uint32_t dueUs);
+void idle_busy(void);
+void idle_wake(void);
+void idle_wait(void);
+void idle_get_stats(struct idle_stats_s *stats);
+
+
+#endif /* IDLE_LOOP_H */
@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file InputCapture.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Implementation of the input capture.
+ *        The loop encodes the records right into the block it fills, a block is handed over to cap_process() when the next record
+ *        does not fit. The count of the open record is patched while received bytes are added to it.
+ *        Blocks are handed over with the ready flag like in the recorder, the state is only set to idle by cap_process()
+ *        after the file has been closed.
+ */
+
+
+#include "InputCapture.h"
+
+#include <Arduino.h>
+
+
+#define CAP_VLQ_MAX         5U  /* bytes of a 32 bit time */
+
+
+struct cap_block_s
+{
+    uint8_t data[CAP_BLOCK_SIZE];
+    uint16_t used;
+    volatile bool ready; /* full, waiting for cap_process() */
+};
+
+
+static void (*capWakeup)(void) = NULL;
+
+static struct cap_block_s capBlocks[CAP_BLOCKS];
+static uint8_t capFillIdx = 0; /* loop side */
+static uint8_t capFlushIdx = 0; /* cap_process() side */
+static volatile enum cap_state_e capState = CAP_IDLE;
+
+static File capFile;
+static uint32_t capStartUs = 0;
+static uint32_t capLastUs = 0; /* time of the last record */
+static uint16_t capRunPos = 0; /* count of the open record in the block */
+static uint8_t capRunCount = 0; /* received bytes of the open record, 0 if there is none */
+static uint32_t capRunNextUs = 0; /* time a byte needs to be added to the open record */
+
+static uint32_t capBytes = 0;
+static uint32_t capButtons = 0;
+static uint32_t capRecords = 0;
+static uint32_t capDropped = 0;
+static uint32_t capHighWater = 0;
+static uint32_t capBlocksWritten = 0;
+static uint32_t capFileBytes = 0;
+static uint32_t capFlushLastUs = 0;
+static uint32_t capFlushMaxUs = 0;
+static uint64_t capFlushSumUs = 0;
+
+
+static void cap_put(struct cap_block_s *block, uint8_t b)
+{
+    block->data[block->used++] = b;
+}
+
+static void cap_put_vlq(struct cap_block_s *block, uint32_t value)
+{
+    uint8_t tmp[CAP_VLQ_MAX];
+    int n = 0;
+    tmp[n++] = value & 0x7FU;
+    while ((value >>= 7U) != 0)
+    {
+        tmp[n++] = 0x80U | (value & 0x7FU);
+    }
+    while (n > 0)
+    {
+        cap_put(block, tmp[--n]);
+    }
+}
+
+static void cap_count_waiting(void)
+{
+    uint32_t waiting = 0;
+    for (const struct cap_block_s &block : capBlocks)
+    {
+        waiting += block.used;
+    }
+    if (waiting > capHighWater)
+    {
+        capHighWater = waiting;
+    }
+}
+
+/**
+ * @brief Get the block with room for the next record, hands over the current block when it is full.
+ * @param need Bytes of the record at most
+ * @return Block, NULL if both blocks are waiting for the flash
+ */
+static struct cap_block_s *cap_block(uint16_t need)
+{
+    struct cap_block_s *block = &capBlocks[capFillIdx];
+    if (__atomic_load_n(&block->ready, __ATOMIC_ACQUIRE))
+    {
+        return NULL;
+    }
+    if (block->used + need <= CAP_BLOCK_SIZE)
+    {
+        return block;
+    }
+
+    __atomic_store_n(&block->ready, true, __ATOMIC_RELEASE);
+    capFillIdx = (capFillIdx + 1U) % CAP_BLOCKS;
+    capRunCount = 0;
+    if (capWakeup != NULL)
+    {
+        capWakeup();
+    }
+
+    block = &capBlocks[capFillIdx];
+    return __atomic_load_n(&block->ready, __ATOMIC_ACQUIRE) ? NULL : block;
+}
+
+/**
+ * @brief Start a record with its time, the open record is closed.
+ * @param us Time of the record, an earlier time than the last record is placed at that record
+ * @param payload Bytes which follow the time at most
+ * @return Block to add the rest of the record to, NULL if it has been dropped
+ */
+static struct cap_block_s *cap_record(uint32_t us, uint16_t payload)
+{
+    capRunCount = 0;
+    struct cap_block_s *block = cap_block(CAP_VLQ_MAX + payload);
+    if (block == NULL)
+    {
+        capDropped++;
+        return NULL;
+    }
+
+    int32_t diffUs = (int32_t)(us - capLastUs);
+    uint32_t deltaUs = (diffUs > 0) ? (uint32_t)diffUs : 0U;
+    capLastUs += deltaUs;
+    cap_put_vlq(block, deltaUs);
+    capRecords++;
+    return block;
+}
+
+/**
+ * @brief Set the function which lets cap_process() run soon, called when a block is ready.
+ * @param wakeup Function, NULL when cap_process() is polled
+ */
+void cap_init(void (*wakeup)(void))
+{
+    capWakeup = wakeup;
+}
+
+/**
+ * @brief Start a capture, called from the loop. The header is put into the first block.
+ * @param file File opened for writing, owned by the capture until it is finished
+ * @param nowUs Time of the start
+ * @return true if started, false if a capture is still being written
+ */
+bool cap_start(File &file, uint32_t nowUs)
+{
+    if (capState != CAP_IDLE || !file)
+    {
+        return false;
+    }
+
+    capFile = file;
+    capStartUs = nowUs;
+    capLastUs = nowUs;
+    capRunCount = 0;
+    capFillIdx = 0;
+    capFlushIdx = 0;
+    for (struct cap_block_s &block : capBlocks)
+    {
+        block.used = 0;
+        block.ready = false;
+    }
+
+    capBytes = 0;
+    capButtons = 0;
+    capRecords = 0;
+    capDropped = 0;
+    capHighWater = 0;
+    capBlocksWritten = 0;
+    capFileBytes = 0;
+    capFlushLastUs = 0;
+    capFlushMaxUs = 0;
+    capFlushSumUs = 0;
+
+    struct cap_block_s *block = &capBlocks[0];
+    cap_put(block, 'M');
+    cap_put(block, 'C');
+    cap_put(block, 'A');
+    cap_put(block, 'P');
+    cap_put(block, CAP_VERSION);
+    cap_put(block, 0x00U);
+    cap_put(block, 0x00U);
+    cap_put(block, 0x00U);
+
+    __atomic_store_n(&capState, CAP_RUNNING, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief Add a received byte, called from the loop for every byte read from the MIDI input.
+ *        A byte one byte time after the last one is added to its record.
+ * @param b Byte
+ * @param rxUs Reception time
+ */
+void cap_rx(uint8_t b, uint32_t rxUs)
+{
+    if (capState != CAP_RUNNING)
+    {
+        return;
+    }
+
+    struct cap_block_s *block = &capBlocks[capFillIdx];
+    if (capRunCount > 0 && capRunCount < CAP_RUN_MAX && rxUs == capRunNextUs && block->used < CAP_BLOCK_SIZE)
+    {
+        cap_put(block, b);
+        block->data[capRunPos] = ++capRunCount;
+    }
+    else
+    {
+        block = cap_record(rxUs, 2U);
+        if (block == NULL)
+        {
+            return;
+        }
+        capRunPos = block->used;
+        cap_put(block, 1U);
+        cap_put(block, b);
+        capRunCount = 1;
+        capRunNextUs = capLastUs;
+    }
+    capRunNextUs += CAP_BYTE_US;
+    capBytes++;
+    cap_count_waiting();
+}
+
+/**
+ * @brief Add a button event, called from the loop.
+ * @param button Button, 0 for A
+ * @param kind See cap_button_e
+ * @param us Time the event has been detected
+ */
+void cap_button(uint8_t button, uint8_t kind, uint32_t us)
+{
+    if (capState != CAP_RUNNING)
+    {
+        return;
+    }
+
+    struct cap_block_s *block = cap_record(us, 2U);
+    if (block == NULL)
+    {
+        return;
+    }
+    cap_put(block, 0x00U);
+    cap_put(block, (uint8_t)((kind << 4U) | (button & 0x0FU)));
+    capButtons++;
+    cap_count_waiting();
+}
+
+/**
+ * @brief Stop the capture, called from the loop. The remaining records are written and the file is closed by cap_process().
+ */
+void cap_stop(void)
+{
+    if (capState != CAP_RUNNING)
+    {
+        return;
+    }
+
+    struct cap_block_s *block = &capBlocks[capFillIdx];
+    if (!block->ready && block->used > 0)
+    {
+        __atomic_store_n(&block->ready, true, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&capState, CAP_STOPPING, __ATOMIC_RELEASE);
+    if (capWakeup != NULL)
+    {
+        capWakeup();
+    }
+}
+
+/**
+ * @brief Write ready blocks to the file and finish a stopped capture.
+ *        Called from a context of its own which may wait for the flash, or polled from the loop.
+ * @return true if something has been written
+ */
+bool cap_process(void)
+{
+    /* read before the blocks, so the last block of a stopped capture is seen as ready */
+    enum cap_state_e state = __atomic_load_n(&capState, __ATOMIC_ACQUIRE);
+    if (state == CAP_IDLE)
+    {
+        return false;
+    }
+
+    bool written = false;
+    while (__atomic_load_n(&capBlocks[capFlushIdx].ready, __ATOMIC_ACQUIRE))
+    {
+        struct cap_block_s *block = &capBlocks[capFlushIdx];
+
+        uint32_t startUs = micros();
+        capFile.write(block->data, block->used);
+        uint32_t flushUs = micros() - startUs;
+
+        capFileBytes += block->used;
+        capFlushLastUs = flushUs;
+        capFlushSumUs += flushUs;
+        if (flushUs > capFlushMaxUs)
+        {
+            capFlushMaxUs = flushUs;
+        }
+        capBlocksWritten++;
+
+        block->used = 0;
+        __atomic_store_n(&block->ready, false, __ATOMIC_RELEASE);
+        capFlushIdx = (capFlushIdx + 1U) % CAP_BLOCKS;
+        written = true;
+    }
+
+    if (state == CAP_STOPPING)
+    {
+        capFile.close();
+        __atomic_store_n(&capState, CAP_IDLE, __ATOMIC_RELEASE);
+        written = true;
+    }
+    return written;
+}
+
+/**
+ * @brief Get the state of the capture.
+ * @return State
+ */
+enum cap_state_e cap_state(void)
+{
+    return __atomic_load_n(&capState, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Get the statistics of the current or last capture.
+ * @param stats Filled with the current values
+ */
+void cap_get_stats(struct cap_stats_s *stats)
+{
+    stats->state = cap_state();
+    stats->bytes = capBytes;
+    stats->buttons = capButtons;
+    stats->records = capRecords;
+    stats->dropped = capDropped;
+    stats->highWater = capHighWater;
+    stats->blocks = capBlocksWritten;
+    stats->fileBytes = capFileBytes;
+    stats->flushLastUs = capFlushLastUs;
+    stats->flushMaxUs = capFlushMaxUs;
+    stats->flushAvgUs = (capBlocksWritten > 0) ? (uint32_t)(capFlushSumUs / capBlocksWritten) : 0U;
+    stats->lengthMs = (capLastUs - capStartUs) / 1000U;
+}
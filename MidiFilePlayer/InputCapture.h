@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file InputCapture.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Capture of the input of a session: every received MIDI byte with its reception time and the button events,
+ *        for a replay on the host (tools/midi_replay). Unlike the recorder (MidiRecorder.h) nothing is parsed or left out,
+ *        real time bytes, SysEx and bytes the parser drops are kept in the order they were received.
+ *        cap_rx() and cap_button() are called from the loop and encode into one of two RAM blocks,
+ *        a full block is written by cap_process() in a context of its own. When both blocks wait for the flash
+ *        further input is dropped and counted.
+ *
+ * File format (times are variable length quantities like in a MIDI file):
+ *   "MCAP" <version 1> <3 reserved bytes>
+ *   records: <time in us after the previous record> <count> <count received bytes>
+ *            <time in us after the previous record> 0 <button event: kind << 4 | button>
+ *   The bytes of a record are received back to back, each CAP_BYTE_US after the one before,
+ *   bytes with other times start a record of their own. A record is never earlier than the one before.
+ */
+
+
+#ifndef INPUT_CAPTURE_H
+#define INPUT_CAPTURE_H
+
+
+#include <stdint.h>
+
+#include <FS.h>
+
+
+#define INPUT_CAPTURE                   /* compiled in, started by the capture console command */
+
+#define CAP_BLOCK_SIZE      512U    /* bytes per RAM block, about 170 received bytes */
+#define CAP_BLOCKS          2U
+#define CAP_VERSION         1U
+#define CAP_HEADER_SIZE     8U
+#define CAP_RUN_MAX         127U    /* received bytes per record */
+#define CAP_BYTE_US         320U    /* 10 bits at 31250 baud */
+
+
+enum cap_state_e
+{
+    CAP_IDLE,
+    CAP_RUNNING,
+    CAP_STOPPING, /* remaining blocks are written, then the file is closed */
+};
+
+/* button events as the state machine gets them */
+enum cap_button_e
+{
+    CAP_BUTTON_PRESS,
+    CAP_BUTTON_LONG,
+    CAP_BUTTON_RELEASE,
+};
+
+struct cap_stats_s
+{
+    enum cap_state_e state;
+    uint32_t bytes; /* received bytes captured */
+    uint32_t buttons; /* button events captured */
+    uint32_t records;
+    uint32_t dropped; /* bytes and button events lost because both blocks were waiting for the flash */
+    uint32_t highWater; /* most bytes waiting in RAM at once */
+    uint32_t blocks; /* blocks written */
+    uint32_t fileBytes;
+    uint32_t flushLastUs; /* time to write a block */
+    uint32_t flushMaxUs;
+    uint32_t flushAvgUs;
+    uint32_t lengthMs; /* time from start to the last record */
+};
+
+
+void cap_init(void (*wakeup)(void));
+bool cap_start(File &file, uint32_t nowUs);
+void cap_rx(uint8_t b, uint32_t rxUs);
+void cap_button(uint8_t button, uint8_t kind, uint32_t us);
+void cap_stop(void);
+bool cap_process(void);
+enum cap_state_e cap_state(void);
+void cap_get_stats(struct cap_stats_s *stats);
+
+
+#endif /* INPUT_CAPTURE_H */
@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file LatencyProbe.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Implementation of the latency probe.
+ *        MidiOut numbers every message it queues and sends, the probe keeps the numbers of the queued messages
+ *        which belong to a received one in a small list until they are passed to the UART.
+ *        Everything runs in the loop.
+ */
+
+
+#include "LatencyProbe.h"
+
+
+#define LAT_SUB_COUNT       (1U << LAT_PROBE_SUB_BITS)
+#define LAT_PENDING_MASK    (LAT_PROBE_PENDING - 1U)
+
+
+struct lat_hist_s
+{
+    uint32_t bins[LAT_PROBE_BINS];
+    uint32_t count;
+    uint32_t minUs;
+    uint32_t maxUs;
+    uint64_t sumUs;
+};
+
+struct lat_pending_s
+{
+    uint16_t seq;
+    uint8_t type;
+    uint32_t rxUs;
+};
+
+
+static bool latEnabled = false;
+static struct lat_hist_s latHist[LAT_TYPE_COUNT][LAT_STAGE_COUNT];
+
+/* received message which is being dispatched */
+static bool latInActive = false;
+static uint8_t latInType = LAT_TYPE_OTHER;
+static uint32_t latInRxUs = 0;
+
+static struct lat_pending_s latPending[LAT_PROBE_PENDING];
+static uint8_t latPendingHead = 0;
+static uint8_t latPendingTail = 0;
+static uint32_t latUntracked = 0;
+
+static const char *latTypeNames[LAT_TYPE_COUNT] = {"note on", "note off", "control", "other"};
+static const char *latStageNames[LAT_STAGE_COUNT] = {"queued", "sent"};
+
+
+static uint8_t lat_bin(uint32_t us)
+{
+    if (us < LAT_SUB_COUNT)
+    {
+        return (uint8_t)us;
+    }
+    uint8_t msb = 31U - __builtin_clz(us);
+    uint32_t bin = LAT_SUB_COUNT * (msb - LAT_PROBE_SUB_BITS + 1U) + ((us >> (msb - LAT_PROBE_SUB_BITS)) & (LAT_SUB_COUNT - 1U));
+    return (bin < LAT_PROBE_BINS) ? (uint8_t)bin : (uint8_t)(LAT_PROBE_BINS - 1U);
+}
+
+static uint32_t lat_bin_upper(uint8_t bin)
+{
+    if (bin < LAT_SUB_COUNT)
+    {
+        return bin;
+    }
+    uint8_t msb = bin / LAT_SUB_COUNT + LAT_PROBE_SUB_BITS - 1U;
+    uint32_t lower = (LAT_SUB_COUNT + (bin % LAT_SUB_COUNT)) << (msb - LAT_PROBE_SUB_BITS);
+    return lower + (1UL << (msb - LAT_PROBE_SUB_BITS)) - 1U;
+}
+
+static void lat_add(uint8_t type, uint8_t stage, uint32_t us)
+{
+    struct lat_hist_s *h = &latHist[type][stage];
+    h->bins[lat_bin(us)]++;
+    if (h->count == 0 || us < h->minUs)
+    {
+        h->minUs = us;
+    }
+    if (us > h->maxUs)
+    {
+        h->maxUs = us;
+    }
+    h->sumUs += us;
+    h->count++;
+}
+
+/**
+ * @brief Switch the measurement on or off, switching on starts with empty histograms.
+ * @param enable true to measure
+ */
+void lat_probe_set_enabled(bool enable)
+{
+    if (enable && !latEnabled)
+    {
+        lat_probe_reset();
+    }
+    latEnabled = enable;
+    latInActive = false;
+}
+
+/**
+ * @brief Check if the measurement is on.
+ * @return true if measuring
+ */
+bool lat_probe_enabled(void)
+{
+    return latEnabled;
+}
+
+/**
+ * @brief Clear all histograms.
+ */
+void lat_probe_reset(void)
+{
+    memset(latHist, 0, sizeof(latHist));
+    latPendingHead = 0;
+    latPendingTail = 0;
+    latUntracked = 0;
+}
+
+/**
+ * @brief A channel message has been received and is about to be dispatched.
+ * @param msg Message, status byte first
+ * @param rxUs Reception time
+ */
+void lat_probe_in(const uint8_t *msg, uint32_t rxUs)
+{
+    if (!latEnabled)
+    {
+        return;
+    }
+
+    switch (msg[0] & 0xF0U)
+    {
+    case 0x90U:
+        latInType = (msg[2] > 0) ? LAT_TYPE_NOTE_ON : LAT_TYPE_NOTE_OFF;
+        break;
+    case 0x80U:
+        latInType = LAT_TYPE_NOTE_OFF;
+        break;
+    case 0xB0U:
+        latInType = LAT_TYPE_CONTROL;
+        break;
+    default:
+        latInType = LAT_TYPE_OTHER;
+        break;
+    }
+    latInRxUs = rxUs;
+    latInActive = true;
+}
+
+/**
+ * @brief Dispatching of received messages has finished, later output does not belong to them.
+ */
+void lat_probe_in_done(void)
+{
+    latInActive = false;
+}
+
+/**
+ * @brief Called by MidiOut when a message has been queued.
+ * @param seq Number of the message
+ */
+void lat_probe_queued(uint16_t seq)
+{
+    if (!latInActive)
+    {
+        return;
+    }
+    /* only the first message of a received one is measured */
+    latInActive = false;
+
+    lat_add(latInType, LAT_STAGE_QUEUED, micros() - latInRxUs);
+
+    if ((uint8_t)(latPendingHead - latPendingTail) >= LAT_PROBE_PENDING)
+    {
+        latUntracked++;
+        return;
+    }
+    struct lat_pending_s *p = &latPending[latPendingHead & LAT_PENDING_MASK];
+    p->seq = seq;
+    p->type = latInType;
+    p->rxUs = latInRxUs;
+    latPendingHead++;
+}
+
+/**
+ * @brief Called by MidiOut when a message has been passed to the UART.
+ * @param seq Number of the message
+ * @param bytesAhead Bytes to be sent until the message is complete, including the message
+ */
+void lat_probe_sent(uint16_t seq, uint16_t bytesAhead)
+{
+    /* the merger may send the queues of its sources in another order than they have been filled */
+    uint8_t i = latPendingTail;
+    while (i != latPendingHead && latPending[i & LAT_PENDING_MASK].seq != seq)
+    {
+        i++;
+    }
+    if (i == latPendingHead)
+    {
+        return;
+    }
+
+    const struct lat_pending_s *p = &latPending[i & LAT_PENDING_MASK];
+    uint32_t sentUs = micros() + (uint32_t)bytesAhead * LAT_PROBE_BYTE_US;
+    lat_add(p->type, LAT_STAGE_SENT, sentUs - p->rxUs);
+
+    /* close the gap, the older entries move up by one */
+    for (; i != latPendingTail; i--)
+    {
+        latPending[i & LAT_PENDING_MASK] = latPending[(uint8_t)(i - 1U) & LAT_PENDING_MASK];
+    }
+    latPendingTail++;
+}
+
+/**
+ * @brief Get the summary of one histogram.
+ * @param type Message type, see lat_type_e
+ * @param stage Stage, see lat_stage_e
+ * @param summary Filled with the values
+ */
+void lat_probe_get(uint8_t type, uint8_t stage, struct lat_summary_s *summary)
+{
+    const struct lat_hist_s *h = &latHist[type][stage];
+    summary->count = h->count;
+    summary->minUs = h->minUs;
+    summary->maxUs = h->maxUs;
+    summary->meanUs = (h->count > 0) ? (uint32_t)(h->sumUs / h->count) : 0U;
+    summary->p99Us = 0;
+
+    uint32_t need = (uint32_t)(((uint64_t)h->count * 99U + 99U) / 100U);
+    uint32_t sum = 0;
+    for (uint8_t bin = 0; bin < LAT_PROBE_BINS && h->count > 0; bin++)
+    {
+        sum += h->bins[bin];
+        if (sum >= need)
+        {
+            uint32_t upper = lat_bin_upper(bin);
+            summary->p99Us = (upper < h->maxUs) ? upper : h->maxUs;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Get the number of measured messages whose sent stage could not be followed.
+ * @return Messages
+ */
+uint32_t lat_probe_untracked(void)
+{
+    return latUntracked;
+}
+
+/**
+ * @brief Print a table of all histograms.
+ * @param port Output
+ */
+void lat_probe_print(Print *port)
+{
+    char line[96];
+    snprintf(line, sizeof(line), "%-9s %-7s %8s %8s %8s %8s %8s\n", "type", "stage", "count", "min", "mean", "p99", "max");
+    port->print(line);
+    for (uint8_t type = 0; type < LAT_TYPE_COUNT; type++)
+    {
+        for (uint8_t stage = 0; stage < LAT_STAGE_COUNT; stage++)
+        {
+            struct lat_summary_s s;
+            lat_probe_get(type, stage, &s);
+            if (s.count == 0)
+            {
+                continue;
+            }
+            snprintf(line, sizeof(line), "%-9s %-7s %8lu %8lu %8lu %8lu %8lu\n", latTypeNames[type], latStageNames[stage],
+                     (unsigned long)s.count, (unsigned long)s.minUs, (unsigned long)s.meanUs, (unsigned long)s.p99Us, (unsigned long)s.maxUs);
+            port->print(line);
+        }
+    }
+    if (latUntracked > 0)
+    {
+        snprintf(line, sizeof(line), "%lu messages not followed to the UART\n", (unsigned long)latUntracked);
+        port->print(line);
+    }
+}
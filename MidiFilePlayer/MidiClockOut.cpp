@@ -0,0 +1,463 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MidiClockOut.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Implementation of the MIDI clock and time code generator.
+ *        The clock runs on a fixed grid with a period in 1/256 us, so the tempo does not drift.
+ *        It keeps running while stopped, start and continue restart the grid with the first clock
+ *        sent right behind the transport byte. The position counts clocks since start.
+ *        Time code is sent as 25 fps quarter frames while running, a full frame message marks each locate.
+ *        Requests from the loop are passed through a small single producer / single consumer queue,
+ *        the timer side is the only one changing the transport state.
+ */
+
+
+#include "MidiClockOut.h"
+
+#include "MidiOut.h"
+
+#include <math.h>
+#include <stddef.h>
+
+
+#define OUT_PERIOD_SHIFT        TEMPO_TICK_BITS
+#define OUT_MAX_LATE_PERIODS    4U /* clocks missed beyond that are dropped */
+#define OUT_REQ_QUEUE_SIZE      4U /* power of two */
+
+#define MTC_QUARTER_FRAME_US    (1000000U / (CLOCK_OUT_MTC_FPS * 4U))
+#define MTC_RATE_25             1U
+#define MTC_FRAMES_PER_HOUR     (CLOCK_OUT_MTC_FPS * 60U * 60U)
+
+
+enum
+{
+    OUT_REQ_PLAY,
+    OUT_REQ_STOP,
+    OUT_REQ_REWIND,
+};
+
+
+static void (*outWakeup)(void) = NULL;
+
+static volatile bool clockEnabled = false;
+static volatile bool mtcEnabled = false;
+static volatile uint32_t clockPeriodQ8 = (uint32_t)((60000000ULL << OUT_PERIOD_SHIFT) / (120U * CLOCK_SYNC_PPQN));
+
+static volatile uint8_t reqQueue[OUT_REQ_QUEUE_SIZE];
+static volatile uint8_t reqHead = 0; /* written by the loop */
+static volatile uint8_t reqTail = 0; /* written by clock_out_process() */
+
+static volatile bool outRunning = false;
+static volatile uint32_t outPosition = 0;
+static bool clockArmed = false;
+static uint32_t nextClockUs = 0;
+static uint32_t nextClockFrac = 0;
+
+static uint32_t mtcQuarterFrames = 0; /* since song start */
+static uint32_t mtcLatched = 0; /* frame count sent by the current eight pieces */
+static uint8_t mtcPiece = 0;
+static uint32_t nextQuarterFrameUs = 0;
+
+static uint32_t statClocks = 0;
+static uint32_t statQuarterFrames = 0;
+static uint64_t statLateSq = 0;
+static uint32_t statLateMax = 0;
+static uint32_t statDropped = 0;
+
+
+static void out_request(uint8_t cmd)
+{
+    uint8_t head = reqHead;
+    if (((head + 1U) & (OUT_REQ_QUEUE_SIZE - 1U)) == reqTail)
+    {
+        return; /* requests are not processed, the output is not running */
+    }
+    reqQueue[head] = cmd;
+    reqHead = (head + 1U) & (OUT_REQ_QUEUE_SIZE - 1U);
+    if (outWakeup != NULL)
+    {
+        outWakeup();
+    }
+}
+
+static void out_time_code_split(uint32_t frames, uint8_t *hh, uint8_t *mm, uint8_t *ss, uint8_t *ff)
+{
+    frames %= 24U * MTC_FRAMES_PER_HOUR;
+    *ff = frames % CLOCK_OUT_MTC_FPS;
+    *ss = (frames / CLOCK_OUT_MTC_FPS) % 60U;
+    *mm = (frames / (CLOCK_OUT_MTC_FPS * 60U)) % 60U;
+    *hh = frames / MTC_FRAMES_PER_HOUR;
+}
+
+/**
+ * @brief Send a full frame message, slaves locate to it.
+ * @param frames Position in frames
+ */
+static void out_time_code_full(uint32_t frames)
+{
+    uint8_t hh, mm, ss, ff;
+    out_time_code_split(frames, &hh, &mm, &ss, &ff);
+
+    uint8_t msg[] = {0xF0, 0x7F, 0x7F, 0x01, 0x01, (uint8_t)((MTC_RATE_25 << 5U) | hh), mm, ss, ff, 0xF7};
+    midi_out_direct(msg, sizeof(msg));
+}
+
+static void out_time_code_quarter_frame(void)
+{
+    if (mtcPiece == 0)
+    {
+        mtcLatched = mtcQuarterFrames / 4U;
+    }
+
+    uint8_t hh, mm, ss, ff;
+    out_time_code_split(mtcLatched, &hh, &mm, &ss, &ff);
+
+    uint8_t value;
+    switch (mtcPiece)
+    {
+    case 0:
+        value = ff & 0x0FU;
+        break;
+    case 1:
+        value = ff >> 4U;
+        break;
+    case 2:
+        value = ss & 0x0FU;
+        break;
+    case 3:
+        value = ss >> 4U;
+        break;
+    case 4:
+        value = mm & 0x0FU;
+        break;
+    case 5:
+        value = mm >> 4U;
+        break;
+    case 6:
+        value = hh & 0x0FU;
+        break;
+    default:
+        value = ((hh >> 4U) & 0x01U) | (MTC_RATE_25 << 1U);
+        break;
+    }
+
+    uint8_t msg[] = {MIDI_MTC_QUARTER_FRAME, (uint8_t)((mtcPiece << 4U) | value)};
+    midi_out_direct(msg, sizeof(msg));
+
+    mtcPiece = (mtcPiece + 1U) & 0x07U;
+    mtcQuarterFrames++;
+    statQuarterFrames++;
+}
+
+/**
+ * @brief Begin running at the current position, the first clock and quarter frame are due right away.
+ * @param nowUs Current time
+ */
+static void out_run(uint32_t nowUs)
+{
+    outRunning = true;
+    nextClockUs = nowUs;
+    nextClockFrac = 0;
+    clockArmed = clockEnabled;
+    mtcPiece = 0;
+    nextQuarterFrameUs = nowUs;
+}
+
+static void out_transport(uint8_t cmd, uint32_t nowUs)
+{
+    switch (cmd)
+    {
+    case OUT_REQ_PLAY:
+        if (outRunning)
+        {
+            break;
+        }
+        if (mtcEnabled)
+        {
+            out_time_code_full(mtcQuarterFrames / 4U);
+        }
+        if (clockEnabled)
+        {
+            if (outPosition == 0)
+            {
+                uint8_t msg[] = {MIDI_RT_START};
+                midi_out_direct(msg, sizeof(msg));
+            }
+            else
+            {
+                uint16_t spp = outPosition / CLOCK_SYNC_CLOCKS_PER_SPP;
+                uint8_t msg[] = {MIDI_SONG_POSITION, (uint8_t)(spp & 0x7FU), (uint8_t)((spp >> 7U) & 0x7FU), MIDI_RT_CONTINUE};
+                midi_out_direct(msg, sizeof(msg));
+            }
+        }
+        out_run(nowUs);
+        break;
+
+    case OUT_REQ_STOP:
+        if (outRunning && clockEnabled)
+        {
+            uint8_t msg[] = {MIDI_RT_STOP};
+            midi_out_direct(msg, sizeof(msg));
+        }
+        outRunning = false;
+        break;
+
+    case OUT_REQ_REWIND:
+        outPosition = 0;
+        mtcQuarterFrames = 0;
+        if (mtcEnabled)
+        {
+            out_time_code_full(0);
+        }
+        if (clockEnabled)
+        {
+            if (outRunning)
+            {
+                uint8_t msg[] = {MIDI_RT_START};
+                midi_out_direct(msg, sizeof(msg));
+            }
+            else
+            {
+                uint8_t msg[] = {MIDI_SONG_POSITION, 0x00, 0x00};
+                midi_out_direct(msg, sizeof(msg));
+            }
+        }
+        if (outRunning)
+        {
+            out_run(nowUs);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void out_clock(uint32_t nowUs)
+{
+    uint32_t periodQ8 = clockPeriodQ8;
+    uint32_t lateUs = nowUs - nextClockUs;
+
+    if (lateUs > OUT_MAX_LATE_PERIODS * (periodQ8 >> OUT_PERIOD_SHIFT))
+    {
+        /* stalled for too long, bursting all missed clocks would only confuse the slaves */
+        statDropped += lateUs / (periodQ8 >> OUT_PERIOD_SHIFT);
+        nextClockUs = nowUs;
+        nextClockFrac = 0;
+        lateUs = 0;
+    }
+
+    uint8_t msg[] = {MIDI_RT_CLOCK};
+    midi_out_direct(msg, sizeof(msg));
+
+    if (outRunning)
+    {
+        outPosition++;
+    }
+
+    statClocks++;
+    statLateSq += (uint64_t)lateUs * lateUs;
+    if (lateUs > statLateMax)
+    {
+        statLateMax = lateUs;
+    }
+
+    nextClockFrac += periodQ8;
+    nextClockUs += nextClockFrac >> OUT_PERIOD_SHIFT;
+    nextClockFrac &= (1U << OUT_PERIOD_SHIFT) - 1U;
+}
+
+static uint32_t out_wait(uint32_t waitUs, uint32_t dueUs, uint32_t nowUs)
+{
+    int32_t diff = (int32_t)(dueUs - nowUs);
+    if (diff <= 0)
+    {
+        return 0;
+    }
+    return ((uint32_t)diff < waitUs) ? (uint32_t)diff : waitUs;
+}
+
+/**
+ * @brief Reset the output to stopped at position 0, both outputs are disabled.
+ * @param wakeup Function to trigger clock_out_process() early, called after each request. NULL when it is polled
+ */
+void clock_out_init(void (*wakeup)(void))
+{
+    outWakeup = wakeup;
+    clockEnabled = false;
+    mtcEnabled = false;
+    reqHead = 0;
+    reqTail = 0;
+    outRunning = false;
+    outPosition = 0;
+    clockArmed = false;
+    mtcQuarterFrames = 0;
+    mtcPiece = 0;
+
+    struct clock_out_stats_s stats;
+    clock_out_get_stats(&stats, true);
+}
+
+/**
+ * @brief Enable the clock and time code output.
+ * @param clock true to send clock, start, stop, continue and song position
+ * @param mtc true to send time code
+ */
+void clock_out_set_enabled(bool clock, bool mtc)
+{
+    clockEnabled = clock;
+    mtcEnabled = mtc;
+    if (outWakeup != NULL)
+    {
+        outWakeup();
+    }
+}
+
+bool clock_out_clock_enabled(void)
+{
+    return clockEnabled;
+}
+
+bool clock_out_mtc_enabled(void)
+{
+    return mtcEnabled;
+}
+
+/**
+ * @brief Set the clock tempo, it is applied from the next clock on.
+ * @param tempo Tempo in beats per minute
+ */
+void clock_out_set_tempo(tempo_q16_t tempo)
+{
+    clockPeriodQ8 = tempo_tick_q8(tempo_clamp(tempo), CLOCK_SYNC_PPQN);
+}
+
+/**
+ * @brief Request start (position 0) or continue (any other position).
+ */
+void clock_out_play(void)
+{
+    out_request(OUT_REQ_PLAY);
+}
+
+/**
+ * @brief Request stop, the position is kept.
+ */
+void clock_out_stop(void)
+{
+    out_request(OUT_REQ_STOP);
+}
+
+/**
+ * @brief Request a locate to position 0, a running transport is restarted.
+ */
+void clock_out_rewind(void)
+{
+    out_request(OUT_REQ_REWIND);
+}
+
+bool clock_out_running(void)
+{
+    return outRunning;
+}
+
+/**
+ * @brief Get the transport position.
+ * @return Clocks since start
+ */
+uint32_t clock_out_position(void)
+{
+    return outPosition;
+}
+
+/**
+ * @brief Send all due bytes.
+ * @param nowUs Current time
+ * @return Time until the next call in microseconds
+ */
+uint32_t clock_out_process(uint32_t nowUs)
+{
+    while (reqTail != reqHead)
+    {
+        out_transport(reqQueue[reqTail], nowUs);
+        reqTail = (reqTail + 1U) & (OUT_REQ_QUEUE_SIZE - 1U);
+    }
+
+    uint32_t waitUs = CLOCK_OUT_IDLE_US;
+
+    if (clockEnabled)
+    {
+        if (!clockArmed)
+        {
+            clockArmed = true;
+            nextClockUs = nowUs;
+            nextClockFrac = 0;
+        }
+        if ((int32_t)(nowUs - nextClockUs) >= 0)
+        {
+            out_clock(nowUs);
+        }
+        waitUs = out_wait(waitUs, nextClockUs, nowUs);
+    }
+    else
+    {
+        clockArmed = false;
+    }
+
+    if (mtcEnabled && outRunning)
+    {
+        if ((int32_t)(nowUs - nextQuarterFrameUs) >= 0)
+        {
+            out_time_code_quarter_frame();
+            nextQuarterFrameUs += MTC_QUARTER_FRAME_US;
+            if ((int32_t)(nowUs - nextQuarterFrameUs) > (int32_t)(OUT_MAX_LATE_PERIODS * MTC_QUARTER_FRAME_US))
+            {
+                nextQuarterFrameUs = nowUs + MTC_QUARTER_FRAME_US;
+            }
+        }
+        waitUs = out_wait(waitUs, nextQuarterFrameUs, nowUs);
+    }
+
+    return waitUs;
+}
+
+/**
+ * @brief Get the output statistics.
+ * @param stats Filled with the current values
+ * @param reset true to restart the statistics
+ */
+void clock_out_get_stats(struct clock_out_stats_s *stats, bool reset)
+{
+    stats->clocks = statClocks;
+    stats->quarterFrames = statQuarterFrames;
+    stats->lateRmsUs = statClocks ? (uint32_t)sqrtf((float)(statLateSq / statClocks)) : 0;
+    stats->lateMaxUs = statLateMax;
+    stats->dropped = statDropped;
+
+    if (reset)
+    {
+        statClocks = 0;
+        statQuarterFrames = 0;
+        statLateSq = 0;
+        statLateMax = 0;
+        statDropped = 0;
+    }
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MidiClockOut.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief MIDI clock and MIDI time code generator.
+ *        clock_out_process() is called from a timer at the time it returned,
+ *        it sends the due clock (24 PPQN) and quarter frame bytes through midi_out_direct(), so they pass queued channel data.
+ *        Transport changes are requested from the loop and sent by the next clock_out_process() call.
+ */
+
+
+#ifndef MIDI_CLOCK_OUT_H
+#define MIDI_CLOCK_OUT_H
+
+
+#include <stdint.h>
+
+#include "MidiClockSync.h"
+
+
+#define CLOCK_OUT_IDLE_US       20000U  /* call interval while nothing is due */
+#define CLOCK_OUT_MTC_FPS       25U
+#define MIDI_MTC_QUARTER_FRAME  0xF1U
+
+
+struct clock_out_stats_s
+{
+    uint32_t clocks;
+    uint32_t quarterFrames;
+    uint32_t lateRmsUs; /* clock sent after its due time */
+    uint32_t lateMaxUs;
+    uint32_t dropped; /* clocks skipped after a long stall */
+};
+
+
+void clock_out_init(void (*wakeup)(void));
+void clock_out_set_enabled(bool clock, bool mtc);
+bool clock_out_clock_enabled(void);
+bool clock_out_mtc_enabled(void);
+void clock_out_set_tempo(tempo_q16_t tempo);
+void clock_out_play(void);
+void clock_out_stop(void);
+void clock_out_rewind(void);
+bool clock_out_running(void);
+uint32_t clock_out_position(void);
+uint32_t clock_out_process(uint32_t nowUs);
+void clock_out_get_stats(struct clock_out_stats_s *stats, bool reset);
+
+
+#endif /* MIDI_CLOCK_OUT_H */
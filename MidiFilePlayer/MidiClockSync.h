@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MidiClockSync.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Slave to an external MIDI clock.
+ *        Received clock bytes are passed in with their reception time and tracked by an alpha-beta filter (second order PLL).
+ *        The filtered tick times and period are forwarded to the application, so jitter of the
+ *        incoming clock does not reach the output timing.
+ */
+
+
+#ifndef MIDI_CLOCK_SYNC_H
+#define MIDI_CLOCK_SYNC_H
+
+
+#include <stdint.h>
+
+#include "TempoFixed.h"
+
+
+#define CLOCK_SYNC_PPQN             24
+#define CLOCK_SYNC_CLOCKS_PER_SPP   6       /* song position pointer counts sixteenth notes */
+
+#define MIDI_RT_CLOCK               0xF8U
+#define MIDI_RT_START               0xFAU
+#define MIDI_RT_CONTINUE            0xFBU
+#define MIDI_RT_STOP                0xFCU
+#define MIDI_SONG_POSITION          0xF2U
+
+
+struct clock_sync_cb_s
+{
+    void (*tick)(uint32_t position, uint32_t tickUs, uint32_t periodQ8); /* filtered clock tick, period in 1/256 us */
+    void (*tempo)(tempo_q16_t tempo); /* once per beat while locked */
+    void (*transport)(uint8_t msg, uint32_t position); /* start, continue, stop or song position */
+    void (*lock)(bool locked);
+    void (*lost)(void); /* no clock received for a while */
+};
+
+struct clock_sync_stats_s
+{
+    bool locked;
+    tempo_q16_t tempo;
+    uint32_t clocks;
+    uint32_t phaseErrorRmsUs; /* received tick against filtered tick */
+    uint32_t phaseErrorMaxUs;
+    uint32_t jitterMaxUs; /* received interval against filtered period */
+    uint32_t relocks;
+};
+
+
+void clock_sync_init(const struct clock_sync_cb_s *cb);
+void clock_sync_set_enabled(bool enabled);
+bool clock_sync_enabled(void);
+void clock_sync_realtime(uint8_t msg, uint32_t rxUs);
+void clock_sync_song_position(uint16_t pos);
+void clock_sync_loop(uint32_t nowUs);
+bool clock_sync_active(void);
+bool clock_sync_locked(void);
+void clock_sync_get_stats(struct clock_sync_stats_s *stats, bool reset);
+
+
+#endif /* MIDI_CLOCK_SYNC_H */
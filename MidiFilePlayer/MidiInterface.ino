@@ -54,7 +54,7 @@
 
 
 #define FORMAT_LITTLEFS_IF_FAILED true
-#define BUFFER_SIZE (96 * 1024)
+#define MIDI_PATH_MAX       128     /* longest path of a MIDI file including the directories */
 
 
 // --- MIDI Controller Defines ---
@@ -74,17 +74,46 @@
 #define MIDI_FMT_INT
 #include <midi_interface.h> /* requires ML_SynthTools library from https://github.com/marcel-licence/ML_SynthTools */
 
+#include "IdleLoop.h"
+#include "LatencyProbe.h"
+#include "Log.h"
+#include "MidiClockOut.h"
+#include "MidiClockSync.h"
+#include "MidiOut.h"
+#include "MidiTelemetry.h"
+#include "MidiTransport.h"
+#include "PlayerLookahead.h"
+#include "SongPool.h"
+#include "StaticAlloc.h"
+
+
+#define MIDI_BYTE_US            320U /* 10 bits at 31250 baud */
+
+#if (MIDI_OUT_PORTS > 1 && !defined(COM_SERIAL_2)) || (MIDI_OUT_PORTS > 2 && !defined(COM_SERIAL_3)) || MIDI_OUT_PORTS > 3
+#error "MIDI_OUT_PORTS needs a serial port per synth in MidiTransport.h"
+#endif
+
+#if defined(CONFIG_IDF_TARGET_ESP32C3) || defined(CONFIG_IDF_TARGET_ESP32C6) || defined(CONFIG_IDF_TARGET_ESP32S3)
+#define MIDI_RX_TIMESTAMP_CALLBACK
+#endif
+
+static uint32_t midi_com_rx_time(void);
+
 static struct midi_port_s comPort;
+static MidiTeleRx comRx(COM_SERIAL, midi_com_rx_time); /* the parser reads through the traffic counters and the input capture */
+static volatile uint32_t comRxUs = 0;
 
 static uint8_t currentChannel = 0;
 
-static uint8_t raw[BUFFER_SIZE];
 static int maxFileCount = 0;
+static char playerPath[MIDI_PATH_MAX] = ""; /* file of the current song */
+static bool playerLoaded = false; /* the player points at valid song data, not at a released buffer */
 
 static bool contains_mt32(const char *str);
 static bool hasExtension(const char *filename, const char *extension);
-static bool parseMidiFiles(fs::FS &fs, const char *dirPath, const char *extension, String &foundFilePath);
-static bool findMidiFile(fs::FS &fs, const char *dirPath, const char *extension, int targetIndex, String &foundFilePath);
+static bool midi_path_join(char *path, size_t size, const char *dirPath, const char *name);
+static bool parseMidiFiles(fs::FS &fs, const char *dirPath, const char *extension);
+static bool findMidiFile(fs::FS &fs, const char *dirPath, const char *extension, int targetIndex, char *foundFilePath);
 
 
 /**
@@ -116,42 +145,82 @@ static bool contains_mt32(const char *str)
 /**
  * @brief Setup MIDI player with file.
  * @param filename Path to MIDI file
+ * @return true if successful, false otherwise
  */
-void midi_player_setup(const char *filename)
+bool midi_player_setup(const char *filename)
 {
+    static_alloc_exempt_begin();
     if (!LittleFS.begin(FORMAT_LITTLEFS_IF_FAILED))
     {
-        SHOW_SERIAL.println("LittleFS Mount Failed");
-        return;
+        static_alloc_exempt_end();
+        LOG_E("LittleFS Mount Failed");
+        return false;
     }
 
     fs::FS &fs = LittleFS;
 
-    SHOW_SERIAL.printf("Reading file: %s\r\n", filename);
+    LOG_I("Reading file: %s", filename);
 
     File file = fs.open(filename);
     if (!file || file.isDirectory())
     {
-        SHOW_SERIAL.println("- failed to open file for reading");
-        return;
+        static_alloc_exempt_end();
+        LOG_E("- failed to open file for reading");
+        return false;
     }
 
-    SHOW_SERIAL.println("- read from file:");
+    /* the player must not touch the previous song while its buffer is replaced, its last events go out first */
+    ml_midi_player_stop();
+    lookahead_flush();
+    playerLoaded = false;
+    uint32_t fileSize = file.size();
+    uint8_t *songData = song_pool_acquire(fileSize);
+    if (songData == NULL)
+    {
+        file.close();
+        static_alloc_exempt_end();
+        LOG_E("- song too large: %lu bytes, %lu available", (unsigned long)fileSize, (unsigned long)song_pool_available());
+        return false;
+    }
 
-    int bytesRead = file.read(raw, sizeof(raw));
-    SHOW_SERIAL.printf("read int %d bytes\n", bytesRead);
+    int bytesRead = file.read(songData, fileSize);
+    LOG_D("read int %d bytes", bytesRead);
     file.close();
+    static_alloc_exempt_end();
+
+    if (bytesRead != (int)fileSize)
+    {
+        song_pool_release();
+        LOG_E("- read error, %d of %lu bytes", bytesRead, (unsigned long)fileSize);
+        return false;
+    }
 
-    ml_midi_player_setup(raw, bytesRead);
+    /* the SysEx counters show the setup cost of this song */
+    midi_out_reset_sysex_stats();
+    ml_midi_player_setup(songData, bytesRead);
+    playerLoaded = true;
+    clock_out_rewind();
 
     if (contains_mt32(filename))
     {
-        SHOW_SERIAL.printf("use mt-32 sound variation!\n");
+        LOG_I("use mt-32 sound variation!");
         ml_midi_player_set_mt32_sound_variation();
     }
 
-    SHOW_SERIAL.printf("Filename: %s\n", filename);
-    SHOW_SERIAL.printf("Size: %u\n", bytesRead);
+    LOG_I("Filename: %s, size: %d", filename, bytesRead);
+    snprintf(playerPath, sizeof(playerPath), "%s", filename);
+
+    return true;
+}
+
+/**
+ * @brief Check if the player holds a song.
+ *        After a failed load the buffer of the previous song is released, the player must not be started or rewound.
+ * @return true if a song is loaded
+ */
+bool midi_player_loaded(void)
+{
+    return playerLoaded;
 }
 
 /**
@@ -166,20 +235,44 @@ static bool hasExtension(const char *filename, const char *extension)
     return ext && strcasecmp(ext, extension) == 0;
 }
 
+/**
+ * @brief Build the path of a directory entry without heap allocation.
+ * @param path Output buffer
+ * @param size Size of the output buffer
+ * @param dirPath Directory path
+ * @param name Name of the entry, a leading '/' is skipped
+ * @return true if successful, false if the path does not fit
+ */
+static bool midi_path_join(char *path, size_t size, const char *dirPath, const char *name)
+{
+    if (name[0] == '/')
+    {
+        name++;
+    }
+    size_t dirLen = strlen(dirPath);
+    const char *sep = (dirLen > 0 && dirPath[dirLen - 1] == '/') ? "" : "/";
+    int len = snprintf(path, size, "%s%s%s", dirPath, sep, name);
+    if (len < 0 || (size_t)len >= size)
+    {
+        LOG_E("Path too long: %s%s%s", dirPath, sep, name);
+        return false;
+    }
+    return true;
+}
+
 /**
  * @brief Parse MIDI files in directory.
  * @param fs Filesystem object
  * @param dirPath Directory path
  * @param extension File extension
- * @param foundFilePath Output file path
  * @return true if found, false otherwise
  */
-static bool parseMidiFiles(fs::FS &fs, const char *dirPath, const char *extension, String &foundFilePath)
+static bool parseMidiFiles(fs::FS &fs, const char *dirPath, const char *extension)
 {
     File root = fs.open(dirPath);
     if (!root || !root.isDirectory())
     {
-        SHOW_SERIAL.println("Invalid directory.");
+        LOG_E("Invalid directory.");
         return false;
     }
 
@@ -191,8 +284,8 @@ static bool parseMidiFiles(fs::FS &fs, const char *dirPath, const char *extensio
         if (file.isDirectory())
         {
             // Recursive search if subdirectory
-            String subPath = String(dirPath) + "" + file.name();
-            if (parseMidiFiles(fs, subPath.c_str(), extension, foundFilePath))
+            char subPath[MIDI_PATH_MAX];
+            if (midi_path_join(subPath, sizeof(subPath), dirPath, file.name()) && parseMidiFiles(fs, subPath, extension))
             {
                 file.close();
                 return true;
@@ -218,15 +311,15 @@ static bool parseMidiFiles(fs::FS &fs, const char *dirPath, const char *extensio
  * @param dirPath Directory path
  * @param extension File extension
  * @param targetIndex File index
- * @param foundFilePath Output file path
+ * @param foundFilePath Output file path, MIDI_PATH_MAX bytes
  * @return true if found, false otherwise
  */
-static bool findMidiFile(fs::FS &fs, const char *dirPath, const char *extension, int targetIndex, String &foundFilePath)
+static bool findMidiFile(fs::FS &fs, const char *dirPath, const char *extension, int targetIndex, char *foundFilePath)
 {
     File root = fs.open(dirPath);
     if (!root || !root.isDirectory())
     {
-        SHOW_SERIAL.println("Invalid directory.");
+        LOG_E("Invalid directory.");
         return false;
     }
 
@@ -239,8 +332,9 @@ static bool findMidiFile(fs::FS &fs, const char *dirPath, const char *extension,
         if (file.isDirectory())
         {
             // Recursive search if subdirectory
-            String subPath = String(dirPath) + "" + file.name();
-            if (findMidiFile(fs, subPath.c_str(), extension, targetIndex - currentIndex, foundFilePath))
+            char subPath[MIDI_PATH_MAX];
+            if (midi_path_join(subPath, sizeof(subPath), dirPath, file.name())
+                    && findMidiFile(fs, subPath, extension, targetIndex - currentIndex, foundFilePath))
             {
                 file.close();
                 return true;
@@ -252,9 +346,9 @@ static bool findMidiFile(fs::FS &fs, const char *dirPath, const char *extension,
             {
                 if (currentIndex == targetIndex)
                 {
-                    foundFilePath = String(dirPath) + "" + file.name();
+                    bool found = midi_path_join(foundFilePath, MIDI_PATH_MAX, dirPath, file.name());
                     file.close();
-                    return true;
+                    return found;
                 }
                 currentIndex++;
             }
@@ -266,43 +360,85 @@ static bool findMidiFile(fs::FS &fs, const char *dirPath, const char *extension,
     return false;
 }
 
+/**
+ * @brief Get the number of MIDI files, the file system is scanned once.
+ * @return Number of files, the valid indices are 0 .. count - 1
+ */
+int midi_player_file_count(void)
+{
+    /* the file system core allocates handles, the guard of StaticAlloc counts them apart */
+    static_alloc_exempt_begin();
+    if (maxFileCount == 0)
+    {
+        parseMidiFiles(LittleFS, "/", ".mid");
+    }
+    static_alloc_exempt_end();
+    return maxFileCount;
+}
+
 /**
  * @brief Setup MIDI player by file index.
+ *        An index below midi_player_file_count() which fails names a song which did not load (too large, read error).
  * @param fileIndex Index of MIDI file
  * @return true if successful, false otherwise
  */
 bool midi_player_setup(int fileIndex)
 {
-    String midiFile;
+    static char midiFile[MIDI_PATH_MAX];
 
     sendNRPN3707Volume(0, 96);
 
-    if (maxFileCount == 0)
-    {
-        parseMidiFiles(LittleFS, "/", ".mid", midiFile);
-    }
-    SHOW_SERIAL.printf("Files Found: %u", maxFileCount);
+    LOG_I("Files Found: %u", (unsigned)midi_player_file_count());
+
+    static_alloc_exempt_begin();
+    bool found = findMidiFile(LittleFS, "/", ".mid", fileIndex, midiFile);
+    static_alloc_exempt_end();
 
-    if (findMidiFile(LittleFS, "/", ".mid", fileIndex, midiFile))
+    if (found)
     {
-        SHOW_SERIAL.print("Selected MIDI file: ");
-        SHOW_SERIAL.println(midiFile);
+        LOG_I("Selected MIDI file: %s", midiFile);
 
-        midi_player_setup(midiFile.c_str());
-        return true;
+        return midi_player_setup(midiFile);
     }
     else
     {
-        SHOW_SERIAL.println("No more MIDI files found.");
+        LOG_W("No more MIDI files found.");
         return false;
     }
 }
 
+/**
+ * @brief Update the song index for a file written into the root directory, instead of a new scan.
+ *        LittleFS lists the entries of a directory sorted by name, the songs of a subdirectory at the place of its name.
+ * @param path Path of the file
+ * @param replaced true if the file existed before
+ * @return true if the new song comes before the current one, its index moved by one
+ */
+bool midi_player_song_added(const char *path, bool replaced)
+{
+    if (replaced || !hasExtension(path, ".mid"))
+    {
+        return false;
+    }
+    if (maxFileCount > 0)
+    {
+        maxFileCount++;
+    }
+
+    /* compared with the entry of the root directory which holds the current song */
+    const char *name = (path[0] == '/') ? &path[1] : path;
+    const char *current = (playerPath[0] == '/') ? &playerPath[1] : playerPath;
+    size_t len = strcspn(current, "/");
+    int cmp = strncmp(name, current, len);
+    return current[0] != 0 && (cmp < 0 || (cmp == 0 && strlen(name) < len));
+}
+
 /**
  * @brief Send GM Reset SysEx message.
  */
 void midi_player_send_gm_reset_msg(void)
 {
+    lookahead_flush();
     send_gm_reset_msg();
 }
 
@@ -313,7 +449,12 @@ void midi_player_send_gm_reset_msg(void)
  */
 void midi_player_send_data(uint8_t *msg, int len)
 {
-    COM_SERIAL.write(msg, len);
+    if (midi_render_active())
+    {
+        midi_render_data(msg, len);
+        return;
+    }
+    lookahead_write(msg, (uint16_t)len);
 }
 
 /**
@@ -332,7 +473,7 @@ void sendRPN(uint8_t channel, uint16_t rpn, uint8_t value)
     uint8_t status = 0xB0U | (channel & 0x0FU); // Control Change on channel
     uint8_t msg[] = {status, MIDI_CC_RPN_MSB, (uint8_t)((rpn >> 8U) & 0xFFU), MIDI_CC_RPN_LSB, (uint8_t)(rpn & 0xFFU), 0x06U, value};
 
-    COM_SERIAL.write(msg, sizeof(msg));
+    midi_out_write(MIDI_OUT_SRC_LIVE, msg, sizeof(msg));
 }
 
 /**
@@ -351,7 +492,7 @@ void sendNRPN(uint8_t channel, uint16_t nrpn, uint8_t value)
     uint8_t status = 0xB0 | (channel & 0x0F); // Control Change on channel
     uint8_t msg[] = {status, MIDI_CC_NRPN_MSB, (uint8_t)((nrpn >> 8U) & 0xFF), MIDI_CC_NRPN_LSB, (uint8_t)(nrpn & 0xFFU), MIDI_CC_DATA_ENTRY_MSB, value};
 
-    COM_SERIAL.write(msg, sizeof(msg));
+    midi_out_write(MIDI_OUT_SRC_LIVE, msg, sizeof(msg));
 }
 
 /**
@@ -393,7 +534,7 @@ void send_data_set_gs_sysex(uint16_t parameterAddr, uint8_t value)
         SYSEX_END
     };
 
-    COM_SERIAL.write(sysex_msg, sizeof(sysex_msg));
+    midi_out_write(MIDI_OUT_SRC_LIVE, sysex_msg, sizeof(sysex_msg));
 }
 
 /**
@@ -417,7 +558,7 @@ void sendNRPN3707Volume(uint8_t channel, uint8_t value)
 void send_gm_reset_msg(void)
 {
     uint8_t gm_reset_msg[] = {0xF0, 0x7E, 0x7F, 0x09, 0x01, 0xF7};
-    COM_SERIAL.write(gm_reset_msg, sizeof(gm_reset_msg));
+    midi_out_write(MIDI_OUT_SRC_PLAYER, gm_reset_msg, sizeof(gm_reset_msg));
 }
 
 /**
@@ -430,7 +571,7 @@ void App_NoteOn(uint8_t ch, uint8_t note, uint8_t vel)
 {
     currentChannel = ch;
     uint8_t midiMsg[] = {(uint8_t)(ch | 0x90U), note, vel};
-    COM_SERIAL.write(midiMsg, sizeof(midiMsg));
+    midi_out_write(MIDI_OUT_SRC_LIVE, midiMsg, sizeof(midiMsg));
 }
 
 /**
@@ -441,7 +582,7 @@ void App_NoteOn(uint8_t ch, uint8_t note, uint8_t vel)
 void App_NoteOff(uint8_t ch, uint8_t note)
 {
     uint8_t midiMsg[] = {(uint8_t)(ch | 0x80U), note, 0U};
-    COM_SERIAL.write(midiMsg, sizeof(midiMsg));
+    midi_out_write(MIDI_OUT_SRC_LIVE, midiMsg, sizeof(midiMsg));
 }
 
 /**
@@ -452,7 +593,7 @@ void App_NoteOff(uint8_t ch, uint8_t note)
 void App_PitchBend(uint8_t ch, uint16_t amount)
 {
     uint8_t midiMsg[] = {(uint8_t)(ch | 0xE0U), (uint8_t)(amount & 0x7FU), (uint8_t)((amount >> 7) & 0x7FU)};
-    COM_SERIAL.write(midiMsg, sizeof(midiMsg));
+    midi_out_write(MIDI_OUT_SRC_LIVE, midiMsg, sizeof(midiMsg));
 }
 
 /**
@@ -463,7 +604,7 @@ void App_PitchBend(uint8_t ch, uint16_t amount)
 void App_ProgramChange(uint8_t ch, uint8_t program)
 {
     uint8_t midiMsg[] = {(uint8_t)(ch | 0xC0U), program};
-    COM_SERIAL.write(midiMsg, sizeof(midiMsg));
+    midi_out_write(MIDI_OUT_SRC_LIVE, midiMsg, sizeof(midiMsg));
 }
 
 /**
@@ -475,7 +616,7 @@ void App_ProgramChange(uint8_t ch, uint8_t program)
 void midi_send_cc(uint8_t ch, uint8_t data0, uint8_t data1)
 {
     uint8_t midiMsg[] = {(uint8_t)(ch | 0xB0U), data0, data1};
-    COM_SERIAL.write(midiMsg, sizeof(midiMsg));
+    midi_out_write(MIDI_OUT_SRC_LIVE, midiMsg, sizeof(midiMsg));
 }
 
 /**
@@ -517,7 +658,8 @@ void AppBtnB(uint8_t param)
     {
         if (param == 7)
         {
-            COM_SERIAL.write(0xFF);
+            uint8_t msg[] = {0xFF};
+            midi_out_direct(msg, sizeof(msg));
         }
         else
         {
@@ -550,9 +692,10 @@ void AppBtnB(uint8_t param, uint8_t value)
  */
 void App_Rewind(uint8_t param, uint8_t value)
 {
-    if (value >= 64)
+    if (value >= 64 && playerLoaded)
     {
         ml_midi_player_rewind();
+        clock_out_rewind();
     }
 }
 
@@ -576,7 +719,7 @@ void App_Stop(uint8_t param, uint8_t value)
  */
 void App_Play(uint8_t param, uint8_t value)
 {
-    if (value >= 64)
+    if (value >= 64 && playerLoaded)
     {
         ml_midi_player_play();
     }
@@ -589,8 +732,9 @@ void App_Play(uint8_t param, uint8_t value)
  */
 void App_SetTempo(uint8_t param, uint8_t value)
 {
-    float tempo = floatFromU7(value) * (240.0f - 60.0f) + 60.0f;
-    ml_midi_player_set_tempo(tempo);
+    tempo_q16_t tempo = tempo_from_u7(value, TEMPO_Q16(60), TEMPO_Q16(240));
+    app_set_tempo(tempo);
+    ml_midi_player_set_tempo(tempo_to_float(tempo)); /* the player library takes float, once per change */
 }
 
 /**
@@ -807,16 +951,72 @@ struct midiControllerMapping edirolMapping[] =
     { 0x1, 0x12, "S9", NULL, SAM2695_Set_MasterKeyShift, 65},
 };
 
+#ifdef MIDI_RX_TIMESTAMP_CALLBACK
+/**
+ * @brief Called from the UART task for every received byte, keeps the reception time of the latest byte
+ *        and ends the wait of the loop.
+ */
+static void midi_com_rx_cb(void)
+{
+    comRxUs = micros();
+    idle_wake();
+}
+#endif
+
+/**
+ * @brief Estimate the reception time of the byte which has just been read from COM_SERIAL.
+ * @return Time in microseconds
+ */
+static uint32_t midi_com_rx_time(void)
+{
+#ifdef MIDI_RX_TIMESTAMP_CALLBACK
+    /* all bytes still waiting in the buffer have been received after the current one */
+    return comRxUs - (uint32_t)MidiCom::available(COM_SERIAL) * MIDI_BYTE_US;
+#else
+    return micros();
+#endif
+}
+
+/**
+ * @brief Handle received real time messages like clock, start, continue and stop.
+ * @param msg Message byte
+ */
+void App_RealTime(uint8_t msg)
+{
+    clock_sync_realtime(msg, midi_com_rx_time());
+}
+
+/**
+ * @brief Handle received song position pointer.
+ * @param pos Position in sixteenth notes
+ */
+void App_SongPosition(uint16_t pos)
+{
+    clock_sync_song_position(pos);
+}
+
+/**
+ * @brief Called for every received channel message before it is dispatched, starts the latency measurement.
+ * @param msg Message, status byte first
+ */
+void App_RawMsg(uint8_t *msg)
+{
+    if (lat_probe_enabled() && msg[0] >= 0x80U && msg[0] < 0xF0U)
+    {
+        lat_probe_in(msg, midi_com_rx_time());
+    }
+}
+
 struct midiMapping_s midiMapping =
 {
-    .rawMsg = NULL,
+    .rawMsg = App_RawMsg,
     .noteOn = App_NoteOn,
     .noteOff = App_NoteOff,
     .pitchBend = App_PitchBend,
     .modWheel = NULL,
     .programChange = App_ProgramChange,
-    .rttMsg = NULL,
-    .songPos = NULL,
+    .rttMsg = App_RealTime,
+    .songPos = App_SongPosition,
     .controlMapping = edirolMapping,
     .mapSize = sizeof(edirolMapping) / sizeof(edirolMapping[0]),
 };
@@ -826,7 +1026,23 @@ struct midiMapping_s midiMapping =
  */
 void midi_com_setup(void)
 {
-    comPort.serial = &COM_SERIAL;
+    comPort.serial = &comRx;
+    midi_out_init(&COM_SERIAL, COM_SERIAL_TX_FIFO);
+#if MIDI_OUT_PORTS > 1
+    /* further synths only receive, see MidiOut.h */
+    COM_SERIAL_2.begin(MIDI_SERIAL_BAUD_RATE, SERIAL_8N1, -1, COM_SERIAL_2_TX_PIN);
+    midi_out_set_port(1, &COM_SERIAL_2, COM_SERIAL_TX_FIFO);
+#endif
+#if MIDI_OUT_PORTS > 2
+    COM_SERIAL_3.begin(MIDI_SERIAL_BAUD_RATE, SERIAL_8N1, -1, COM_SERIAL_3_TX_PIN);
+    midi_out_set_port(2, &COM_SERIAL_3, COM_SERIAL_TX_FIFO);
+#endif
+
+#ifdef MIDI_RX_TIMESTAMP_CALLBACK
+    /* one event per byte for precise clock timestamps */
+    COM_SERIAL.setRxFIFOFull(1);
+    COM_SERIAL.onReceive(midi_com_rx_cb);
+#endif
 }
 
 /**
@@ -834,5 +1050,152 @@ void midi_com_setup(void)
  */
 void midi_com_loop(void)
 {
-    Midi_CheckMidiPort(&comPort, 0);
+    /* most loops find nothing received, that check is bound to the serial type instead of a virtual call */
+    int received = MidiCom::available(COM_SERIAL);
+    if (received > 0)
+    {
+        midi_tele_rx_waiting((uint16_t)received);
+        Midi_CheckMidiPort(&comPort, 0);
+    }
+    lat_probe_in_done();
+    uint32_t nowUs = micros();
+    clock_sync_loop(nowUs);
+    midi_tele_loop(nowUs);
+}
+
+/**
+ * @brief Console command: latency [on|off|reset]
+ *        Switches the through latency measurement and prints min, mean, p99 and max per message type in us.
+ * @param args Command arguments
+ */
+void Console_Latency(const char *args)
+{
+    if (strcmp(args, "on") == 0)
+    {
+        lat_probe_set_enabled(true);
+    }
+    else if (strcmp(args, "off") == 0)
+    {
+        lat_probe_set_enabled(false);
+    }
+    else if (strcmp(args, "reset") == 0)
+    {
+        lat_probe_reset();
+    }
+
+    SHOW_SERIAL.printf("through latency %s, reception to queued and to the last byte sent [us]\n", lat_probe_enabled() ? "on" : "off");
+    lat_probe_print(&SHOW_SERIAL);
+}
+
+/**
+ * @brief Console command: traffic [reset]
+ *        Prints bytes, rates against the line, messages, running status, SysEx, errors and queue high-water
+ *        of the received stream and of every synth port, then the channel messages per channel.
+ * @param args Command arguments
+ */
+void Console_Traffic(const char *args)
+{
+    if (strcmp(args, "reset") == 0)
+    {
+        midi_tele_reset();
+    }
+    midi_tele_print(&SHOW_SERIAL);
+}
+
+/**
+ * @brief Console command: merge [prio|fair|channel|voice|reset]
+ *        Selects the scheduling of the output merger and the spreading over the synths,
+ *        prints bytes, messages and waiting time per source, bytes and voices per synth
+ *        and the transmission time of SysEx messages with the pauses given to the synth.
+ * @param args Command arguments
+ */
+void Console_Merge(const char *args)
+{
+    if (strcmp(args, "prio") == 0)
+    {
+        midi_out_set_fair(false);
+    }
+    else if (strcmp(args, "fair") == 0)
+    {
+        midi_out_set_fair(true);
+    }
+    else if (strcmp(args, "channel") == 0)
+    {
+        midi_out_set_route(MIDI_OUT_ROUTE_CHANNEL);
+    }
+    else if (strcmp(args, "voice") == 0)
+    {
+        midi_out_set_route(MIDI_OUT_ROUTE_VOICE);
+    }
+    else if (strcmp(args, "reset") == 0)
+    {
+        midi_out_reset_stats();
+    }
+
+    static const char *srcNames[MIDI_OUT_SRC_COUNT] = {"live", "ui", "player"};
+    SHOW_SERIAL.printf("output merger %s, %u bytes queued\n", midi_out_fair() ? "round robin" : "priority", midi_out_pending());
+    SHOW_SERIAL.printf("%-7s %9s %9s %8s %10s %12s %12s %11s\n", "source", "messages", "bytes", "dropped", "high-water", "wait avg us", "wait max us", "blocked us");
+    for (uint8_t src = 0; src < MIDI_OUT_SRC_COUNT; src++)
+    {
+        struct midi_out_stats_s stats;
+        midi_out_get_stats(src, &stats);
+        SHOW_SERIAL.printf("%-7s %9lu %9lu %8lu %10u %12lu %12lu %11lu\n", srcNames[src], (unsigned long)stats.messages, (unsigned long)stats.bytes,
+                           (unsigned long)stats.dropped, stats.highWater, (unsigned long)stats.waitAvgUs, (unsigned long)stats.waitMaxUs,
+                           (unsigned long)stats.blockedUs);
+    }
+
+    SHOW_SERIAL.printf("%u synth ports, spread by %s\n", midi_out_ports(), (midi_out_route() == MIDI_OUT_ROUTE_VOICE) ? "voice" : "channel");
+    for (uint8_t port = 0; port < midi_out_ports(); port++)
+    {
+        struct midi_out_port_stats_s stats;
+        midi_out_get_port_stats(port, &stats);
+        SHOW_SERIAL.printf("  port %u: %lu messages, %lu bytes, %u queued, %u voices (peak %u)\n", port, (unsigned long)stats.messages,
+                           (unsigned long)stats.bytes, stats.pending, stats.voices, stats.voicesPeak);
+    }
+
+    struct midi_out_sysex_stats_s sysex;
+    midi_out_get_sysex_stats(&sysex);
+    SHOW_SERIAL.printf("sysex %lu messages, %lu bytes, %lu ms sending (max %lu, last %lu), %lu ms pause\n", (unsigned long)sysex.count,
+                       (unsigned long)sysex.bytes, (unsigned long)(sysex.totalUs / 1000U), (unsigned long)(sysex.maxUs / 1000U),
+                       (unsigned long)(sysex.lastUs / 1000U), (unsigned long)(sysex.pauseUs / 1000U));
+    SHOW_SERIAL.printf("system common during sysex: %lu deferred, %lu dropped\n", (unsigned long)sysex.deferred, (unsigned long)sysex.deferDropped);
+}
+
+/**
+ * @brief Console command: lookahead [ms [mean|end]|reset]
+ *        Sets the lookahead window of the file player and the alignment of bursts,
+ *        prints the estimated onset error of the player events since the last reset.
+ * @param args Command arguments
+ */
+void Console_Lookahead(const char *args)
+{
+    struct lookahead_stats_s stats;
+    lookahead_get_stats(&stats);
+
+    unsigned int windowMs;
+    char align[8] = "";
+    if (strcmp(args, "reset") == 0)
+    {
+        lookahead_reset_stats();
+    }
+    else if (sscanf(args, "%u %7s", &windowMs, align) >= 1)
+    {
+        if (strcmp(align, "mean") == 0)
+        {
+            stats.align = LOOKAHEAD_ALIGN_MEAN;
+        }
+        else if (strcmp(align, "end") == 0)
+        {
+            stats.align = LOOKAHEAD_ALIGN_END;
+        }
+        lookahead_set((uint16_t)windowMs, stats.align);
+        lookahead_reset_stats();
+    }
+
+    lookahead_get_stats(&stats);
+    SHOW_SERIAL.printf("player lookahead %u ms, bursts aligned at their %s, %u bytes waiting at most, %lu sent early (buffer full)\n",
+                       stats.windowMs, (stats.align == LOOKAHEAD_ALIGN_END) ? "end" : "mean", stats.highWater, (unsigned long)stats.overflows);
+    SHOW_SERIAL.printf("onset error of %lu messages: mean %ld us, mean absolute %lu us, late %lu us, early %lu us at most\n",
+                       (unsigned long)stats.messages, (long)stats.errorMeanUs, (unsigned long)stats.errorAbsUs,
+                       (unsigned long)stats.lateMaxUs, (unsigned long)stats.earlyMaxUs);
 }
@@ -0,0 +1,1233 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MidiOut.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Implementation of the MIDI output merger.
+ *        Each queue is a byte ring holding records of <length> <number> <queued time> <message>,
+ *        a record never wraps around so it can be written with a single call.
+ *        Every port has a queue per source and the state of its line (long message on its way, pause of the synth),
+ *        a complete message is routed to one port or copied to all of them before it is queued.
+ *        The queues are only used from loop(), direct writes may come from a timer task,
+ *        the serial driver serializes the write calls.
+ *        Messages are numbered in the order they are queued, so the latency probe can follow a message through the merger,
+ *        the copies of a message share its number.
+ *        A long message stays in its queue until its last chunk has been passed on. System common bytes written
+ *        by the timer while a long message is on its way are kept in a single slot and follow it.
+ *        The timer may run on the other core, so the state of the line is a single word changed with atomic compare and exchange:
+ *        the loop marks a long message only while the timer is not writing, the timer writes or defers its message only
+ *        while the line is in the state it has seen.
+ *        All bytes passed to a UART are counted by the telemetry (MidiTelemetry.h), the direct writes apart.
+ */
+
+
+#include "MidiOut.h"
+
+#include "LatencyProbe.h"
+#include "Log.h"
+#include "MidiTelemetry.h"
+
+
+#define OUT_HDR_SIZE        8U      /* length (2), number (2), queued time (4) */
+#define OUT_WRAP_MARKER     0xFFFFU /* rest of the ring is unused, next record starts at 0 */
+#define OUT_DEFER_MAX       10U     /* full frame time code, the longest message of the clock output */
+#define OUT_PORT_ALL        0xFFU   /* route of a message copied to all ports */
+
+/* state of the line shared with midi_out_direct() */
+#define OUT_LINE_STREAM     0x01U   /* long message on its way */
+#define OUT_LINE_DEFER      0x02U   /* system common message waiting in deferMsg */
+#define OUT_LINE_DIRECT     0x04U   /* timer writing a system common message */
+
+
+struct out_queue_s
+{
+    uint8_t *buf;
+    uint16_t size;
+    uint16_t head; /* next byte to write */
+    uint16_t tail; /* next byte to send */
+    uint16_t used;
+    uint16_t wire; /* message bytes not yet passed to the UART */
+
+    uint32_t messages;
+    uint32_t bytes;
+    uint16_t highWater;
+    uint64_t waitSumUs;
+    uint32_t waitMaxUs;
+    uint32_t blockedUs;
+};
+
+struct out_src_s
+{
+    uint8_t status; /* running status of the source, 0 if none */
+    uint8_t part[MIDI_OUT_PART_MAX]; /* message assembled by midi_out_stream() */
+    uint16_t partLen;
+    uint16_t partNeed; /* complete length, 0 for SysEx */
+    uint32_t dropped;
+};
+
+struct out_port_s
+{
+    midi_com_port_t *port;
+    int fifoSize; /* free space of the idle TX FIFO, 0 for unpaced writes */
+    uint8_t lastSrc;
+
+    /* long message passed to the UART in chunks */
+    uint8_t streamSrc;
+    uint16_t streamOff;
+    uint32_t streamStartUs;
+    uint8_t line; /* OUT_LINE_* bits, shared with midi_out_direct() */
+
+    /* system common message of the timer waiting for the end of a long message */
+    uint8_t deferMsg[OUT_DEFER_MAX];
+    uint8_t deferLen;
+
+    /* pause given to the synth after a SysEx */
+    bool paused;
+    uint32_t pauseEndUs;
+
+    struct out_queue_s queue[MIDI_OUT_SRC_COUNT];
+
+    /* sounding notes of the chip behind the port, one bit per note */
+    uint8_t notes[16][16];
+    uint16_t voices;
+    uint16_t voicesPeak;
+    uint32_t messages;
+    uint32_t bytes;
+};
+
+
+static const uint16_t outQueueSize[MIDI_OUT_SRC_COUNT] = {MIDI_OUT_QUEUE_LIVE, MIDI_OUT_QUEUE_UI, MIDI_OUT_QUEUE_PLAYER};
+
+static uint8_t outBuf[MIDI_OUT_PORTS][MIDI_OUT_QUEUE_SIZE];
+static struct out_port_s outPorts[MIDI_OUT_PORTS];
+static uint8_t outPortCount = 0;
+static struct out_src_s outSrc[MIDI_OUT_SRC_COUNT];
+
+static bool outFair = false;
+static uint8_t outRoute = MIDI_OUT_ROUTE_CHANNEL;
+static uint8_t outNextPort = 0;
+static uint16_t outSeq = 0;
+
+static struct midi_out_sysex_stats_s outSysex;
+
+
+/**
+ * @brief Get the length of a message from its status byte.
+ * @param status Status byte
+ * @return Length including the status byte, 0 for SysEx
+ */
+static uint16_t out_msg_len(uint8_t status)
+{
+    switch (status & 0xF0U)
+    {
+    case 0xC0U:
+    case 0xD0U:
+        return 2U;
+    case 0xF0U:
+        break;
+    default:
+        return 3U;
+    }
+
+    switch (status)
+    {
+    case 0xF0U:
+        return 0U;
+    case 0xF1U:
+    case 0xF3U:
+        return 2U;
+    case 0xF2U:
+        return 3U;
+    default:
+        return 1U;
+    }
+}
+
+static uint16_t out_get16(const uint8_t *p)
+{
+    return p[0] | ((uint16_t)p[1] << 8U);
+}
+
+static uint32_t out_get32(const uint8_t *p)
+{
+    return p[0] | ((uint32_t)p[1] << 8U) | ((uint32_t)p[2] << 16U) | ((uint32_t)p[3] << 24U);
+}
+
+/**
+ * @brief Get the space which has to be skipped at the end of the ring to store a message in one piece.
+ * @param q Queue
+ * @param len Length of message
+ * @return Bytes to skip
+ */
+static uint16_t out_wrap_gap(const struct out_queue_s *q, uint16_t len)
+{
+    return ((uint16_t)(q->size - q->head) < len + OUT_HDR_SIZE) ? (uint16_t)(q->size - q->head) : 0U;
+}
+
+static void out_put(struct out_queue_s *q, const uint8_t *msg, uint16_t len, uint16_t seq)
+{
+    uint16_t gap = out_wrap_gap(q, len);
+    if (gap > 0)
+    {
+        if (gap >= 2U)
+        {
+            q->buf[q->head] = OUT_WRAP_MARKER & 0xFFU;
+            q->buf[q->head + 1U] = OUT_WRAP_MARKER >> 8U;
+        }
+        q->used += gap;
+        q->head = 0;
+    }
+
+    uint8_t *rec = &q->buf[q->head];
+    uint32_t nowUs = micros();
+    rec[0] = len & 0xFFU;
+    rec[1] = len >> 8U;
+    rec[2] = seq & 0xFFU;
+    rec[3] = seq >> 8U;
+    rec[4] = nowUs & 0xFFU;
+    rec[5] = (nowUs >> 8U) & 0xFFU;
+    rec[6] = (nowUs >> 16U) & 0xFFU;
+    rec[7] = nowUs >> 24U;
+    memcpy(&rec[OUT_HDR_SIZE], msg, len);
+    q->head = (q->head + len + OUT_HDR_SIZE) % q->size;
+    q->used += len + OUT_HDR_SIZE;
+    q->wire += len;
+    if (q->used > q->highWater)
+    {
+        q->highWater = q->used;
+    }
+}
+
+static void out_skip(struct out_queue_s *q, uint16_t n)
+{
+    q->tail = (q->tail + n) % q->size;
+    q->used -= n;
+    if (q->used == 0)
+    {
+        /* start over to keep messages away from the end of the ring */
+        q->head = 0;
+        q->tail = 0;
+    }
+}
+
+/**
+ * @brief Get the oldest record of a queue, the unused end of the ring is skipped.
+ * @param q Queue, must not be empty
+ * @return Pointer to the record
+ */
+static const uint8_t *out_oldest(struct out_queue_s *q)
+{
+    if ((uint16_t)(q->size - q->tail) < 2U || out_get16(&q->buf[q->tail]) == OUT_WRAP_MARKER)
+    {
+        out_skip(q, q->size - q->tail);
+    }
+    return &q->buf[q->tail];
+}
+
+/**
+ * @brief Pass bytes of the loop to the UART of a port, they are counted by the telemetry.
+ * @param p Port
+ * @param data Bytes
+ * @param len Number of bytes
+ */
+static void out_port_write(struct out_port_s *p, const uint8_t *data, uint16_t len)
+{
+    MidiCom::write(*p->port, data, len);
+#ifdef MIDI_TELEMETRY
+    midi_tele_tx((uint8_t)(p - outPorts), data, len);
+#endif
+}
+
+/**
+ * @brief Get the bytes waiting in the UART of a port.
+ *        A port without FIFO size writes unpaced, its write() blocks until the bytes are out.
+ * @param p Port
+ * @return Bytes not sent yet
+ */
+static uint16_t out_backlog(const struct out_port_s *p)
+{
+    if (p->fifoSize <= 0)
+    {
+        return 0;
+    }
+    int free = MidiCom::availableForWrite(*p->port);
+    return (free < p->fifoSize) ? (uint16_t)(p->fifoSize - free) : 0U;
+}
+
+static uint16_t out_port_pending(const struct out_port_s *p)
+{
+    uint16_t used = 0;
+    for (uint8_t i = 0; i < MIDI_OUT_SRC_COUNT; i++)
+    {
+        used += p->queue[i].used;
+    }
+    return used;
+}
+
+/**
+ * @brief Check for a GM or GS reset, the synth needs more time afterwards.
+ * @param msg SysEx message
+ * @param len Length of message
+ * @return true if the message is a reset
+ */
+static bool out_is_reset(const uint8_t *msg, uint16_t len)
+{
+    if (len >= 6U && msg[1] == 0x7EU && msg[3] == 0x09U)
+    {
+        return true;
+    }
+    return len >= 11U && msg[1] == 0x41U && msg[3] == 0x42U && msg[4] == 0x12U && msg[5] == 0x40U && msg[6] == 0x00U && msg[7] == 0x7FU;
+}
+
+/**
+ * @brief Follow the notes sounding on the chip behind a port, counted when a message is queued for it.
+ *        The sustain pedal is not followed, a released note is no longer counted.
+ * @param p Port
+ * @param msg Message starting with its status byte
+ * @param len Length of message
+ */
+static void out_track_notes(struct out_port_s *p, const uint8_t *msg, uint16_t len)
+{
+    uint8_t type = msg[0] & 0xF0U;
+    uint8_t ch = msg[0] & 0x0FU;
+
+    if ((type == 0x90U || type == 0x80U) && len >= 3U)
+    {
+        uint8_t bit = 1U << (msg[1] & 7U);
+        uint8_t *slot = &p->notes[ch][(msg[1] >> 3U) & 0x0FU];
+        if (type == 0x90U && msg[2] > 0U)
+        {
+            if (!(*slot & bit))
+            {
+                *slot |= bit;
+                p->voices++;
+                if (p->voices > p->voicesPeak)
+                {
+                    p->voicesPeak = p->voices;
+                }
+            }
+        }
+        else if (*slot & bit)
+        {
+            *slot &= ~bit;
+            p->voices--;
+        }
+        return;
+    }
+
+    bool allOff = (type == 0xB0U && len >= 3U && (msg[1] == 120U || msg[1] == 123U));
+    bool reset = (msg[0] == 0xF0U && out_is_reset(msg, len));
+    if (!allOff && !reset)
+    {
+        return;
+    }
+    for (uint8_t c = 0; c < 16U; c++)
+    {
+        if (reset || c == ch)
+        {
+            memset(p->notes[c], 0, sizeof(p->notes[c]));
+        }
+    }
+    p->voices = 0;
+    for (uint8_t c = 0; c < 16U; c++)
+    {
+        for (uint8_t i = 0; i < 16U; i++)
+        {
+            p->voices += __builtin_popcount(p->notes[c][i]);
+        }
+    }
+}
+
+/**
+ * @brief Select the port of a message.
+ *        System messages (GM / GS reset, GS master key shift and other SysEx) and the controllers which select
+ *        and set RPN / NRPN parameters (master volume 0x3707 is one of them) go to all ports.
+ *        By channel every port plays a fixed set of channels. By voice a note goes to the port with the least
+ *        sounding notes, its note off and key pressure follow it, the other channel messages go to all ports
+ *        so every chip has the same channel setup.
+ * @param msg Message starting with its status byte
+ * @param len Length of message
+ * @return Index of the port or OUT_PORT_ALL
+ */
+static uint8_t out_route(const uint8_t *msg, uint16_t len)
+{
+    if (outPortCount < 2U)
+    {
+        return 0U;
+    }
+
+    uint8_t type = msg[0] & 0xF0U;
+    uint8_t ch = msg[0] & 0x0FU;
+    if (type == 0xF0U)
+    {
+        return OUT_PORT_ALL;
+    }
+    if (type == 0xB0U && len >= 3U)
+    {
+        switch (msg[1])
+        {
+        case 6U:    /* data entry */
+        case 38U:
+        case 98U:   /* NRPN */
+        case 99U:
+        case 100U:  /* RPN */
+        case 101U:
+            return OUT_PORT_ALL;
+        default:
+            break;
+        }
+    }
+    if (outRoute == MIDI_OUT_ROUTE_CHANNEL)
+    {
+        return ch % outPortCount;
+    }
+
+    if ((type != 0x80U && type != 0x90U && type != 0xA0U) || len < 3U)
+    {
+        return OUT_PORT_ALL;
+    }
+    uint8_t bit = 1U << (msg[1] & 7U);
+    uint8_t slot = (msg[1] >> 3U) & 0x0FU;
+    for (uint8_t i = 0; i < outPortCount; i++)
+    {
+        if (outPorts[i].notes[ch][slot] & bit)
+        {
+            /* sounding there, a repeated note replaces itself instead of taking a second voice */
+            return i;
+        }
+    }
+    if (type != 0x90U || msg[2] == 0U)
+    {
+        /* not sounding anywhere */
+        return OUT_PORT_ALL;
+    }
+
+    uint8_t pick = outNextPort;
+    for (uint8_t i = 1; i < outPortCount; i++)
+    {
+        uint8_t n = (uint8_t)((outNextPort + i) % outPortCount);
+        if (outPorts[n].voices < outPorts[pick].voices)
+        {
+            pick = n;
+        }
+    }
+    outNextPort = (uint8_t)((pick + 1U) % outPortCount);
+    return pick;
+}
+
+/**
+ * @brief Account for a message which has been passed to the UART completely.
+ * @param p Port
+ * @param q Queue of the source
+ * @param msg Message
+ * @param len Length of message
+ * @param seq Number of the message
+ * @param bytesAhead Bytes to be sent until the message is complete, including the last part of it
+ * @param startUs Time the first byte has been passed to the UART
+ */
+static void out_msg_done(struct out_port_s *p, struct out_queue_s *q, const uint8_t *msg, uint16_t len, uint16_t seq, uint16_t bytesAhead,
+                         uint32_t startUs)
+{
+    q->messages++;
+    q->bytes += len;
+    p->messages++;
+    p->bytes += len;
+#ifdef LATENCY_PROBE
+    lat_probe_sent(seq, bytesAhead);
+#else
+    (void)seq;
+#endif
+
+    if (msg[0] != 0xF0U)
+    {
+        return;
+    }
+
+    uint32_t nowUs = micros();
+    uint32_t endUs = nowUs + (uint32_t)bytesAhead * MIDI_OUT_BYTE_US;
+    uint32_t sendUs = endUs - startUs;
+    uint32_t gapUs = out_is_reset(msg, len) ? MIDI_OUT_RESET_GAP_US : MIDI_OUT_SYSEX_GAP_US;
+
+    outSysex.count++;
+    outSysex.bytes += len;
+    outSysex.lastUs = sendUs;
+    outSysex.totalUs += sendUs;
+    outSysex.pauseUs += gapUs;
+    if (sendUs > outSysex.maxUs)
+    {
+        outSysex.maxUs = sendUs;
+    }
+
+    p->pauseEndUs = endUs + gapUs;
+    p->paused = true;
+    LOG_D("sysex %u bytes, %lu us, pause %lu us", len, (unsigned long)sendUs, (unsigned long)gapUs);
+}
+
+/**
+ * @brief Mark a long message on the line, waits for a direct write of the timer on the other core to finish.
+ * @param p Port
+ */
+static void out_stream_begin(struct out_port_s *p)
+{
+    uint8_t state = __atomic_load_n(&p->line, __ATOMIC_ACQUIRE);
+    while ((state & OUT_LINE_STREAM) == 0)
+    {
+        state &= (uint8_t)~OUT_LINE_DIRECT;
+        if (__atomic_compare_exchange_n(&p->line, &state, (uint8_t)(state | OUT_LINE_STREAM), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief End a long message, a system common message deferred meanwhile is written before the line is free again.
+ * @param p Port
+ */
+static void out_stream_end(struct out_port_s *p)
+{
+    p->streamSrc = MIDI_OUT_SRC_COUNT;
+    p->streamOff = 0;
+
+    uint8_t state = __atomic_load_n(&p->line, __ATOMIC_ACQUIRE);
+    while ((state & OUT_LINE_STREAM) != 0)
+    {
+        if ((state & OUT_LINE_DEFER) != 0)
+        {
+            /* the line stays marked, so no message of the timer overtakes the deferred one */
+            out_port_write(p, p->deferMsg, p->deferLen);
+            __atomic_store_n(&p->line, OUT_LINE_STREAM, __ATOMIC_RELEASE);
+            state = OUT_LINE_STREAM;
+        }
+        else if (__atomic_compare_exchange_n(&p->line, &state, 0U, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Pass the oldest message of a queue to the UART, a long message in chunks.
+ *        Every part is passed on with a single write, so no other write can end up inside of it.
+ * @param p Port
+ * @param src Source, must not be empty
+ * @param backlog Bytes waiting in the UART
+ */
+static void out_send(struct out_port_s *p, uint8_t src, uint16_t backlog)
+{
+    struct out_queue_s *q = &p->queue[src];
+    const uint8_t *rec = out_oldest(q);
+    const uint8_t *msg = &rec[OUT_HDR_SIZE];
+    uint16_t len = out_get16(rec);
+
+    if (p->streamOff == 0)
+    {
+        p->streamStartUs = micros();
+        uint32_t waitUs = p->streamStartUs - out_get32(&rec[4]);
+        q->waitSumUs += waitUs;
+        if (waitUs > q->waitMaxUs)
+        {
+            q->waitMaxUs = waitUs;
+        }
+    }
+
+    uint16_t n = len - p->streamOff;
+    if (n > MIDI_OUT_CHUNK)
+    {
+        n = MIDI_OUT_CHUNK;
+        p->streamSrc = src;
+        out_stream_begin(p);
+    }
+    out_port_write(p, &msg[p->streamOff], n);
+    q->wire -= n;
+    p->streamOff += n;
+    if (p->streamOff < len)
+    {
+        return;
+    }
+
+    out_msg_done(p, q, msg, len, out_get16(&rec[2]), backlog + n, p->streamStartUs);
+    out_skip(q, len + OUT_HDR_SIZE);
+    out_stream_end(p);
+}
+
+/**
+ * @brief Wait for the end of a pause, only used when the loop is blocked anyway.
+ * @param p Port
+ */
+static void out_wait_pause(struct out_port_s *p)
+{
+    if (p->paused)
+    {
+        int32_t leftUs = (int32_t)(p->pauseEndUs - micros());
+        if (leftUs > 0)
+        {
+            delayMicroseconds((unsigned int)leftUs);
+        }
+        p->paused = false;
+    }
+}
+
+/**
+ * @brief Wait until the UART has room for the next part, so real time bytes of the timer still get through.
+ * @param p Port
+ * @return Bytes waiting in the UART
+ */
+static uint16_t out_wait_backlog(const struct out_port_s *p)
+{
+    uint16_t backlog = out_backlog(p);
+    while (backlog > MIDI_OUT_MAX_BACKLOG)
+    {
+        delayMicroseconds(MIDI_OUT_BYTE_US);
+        backlog = out_backlog(p);
+    }
+    return backlog;
+}
+
+/**
+ * @brief Pass on the next part of a queue while the loop waits.
+ * @param p Port
+ * @param src Source to make room in, a long message of another source is finished first
+ */
+static void out_send_blocking(struct out_port_s *p, uint8_t src)
+{
+    out_wait_pause(p);
+    uint16_t backlog = out_wait_backlog(p);
+    if (p->streamSrc != MIDI_OUT_SRC_COUNT)
+    {
+        src = p->streamSrc;
+    }
+    out_send(p, src, backlog);
+    p->lastSrc = src;
+}
+
+/**
+ * @brief Pick the queue of a port to send from next.
+ * @param p Port
+ * @return Index of the source, MIDI_OUT_SRC_COUNT if all queues are empty
+ */
+static uint8_t out_pick(struct out_port_s *p)
+{
+    uint8_t pick = MIDI_OUT_SRC_COUNT;
+    if (p->streamSrc != MIDI_OUT_SRC_COUNT)
+    {
+        return p->streamSrc;
+    }
+
+    for (uint8_t i = 0; i < MIDI_OUT_SRC_COUNT; i++)
+    {
+        uint8_t src = outFair ? (uint8_t)((p->lastSrc + 1U + i) % MIDI_OUT_SRC_COUNT) : i;
+        struct out_queue_s *q = &p->queue[src];
+        if (q->used == 0)
+        {
+            continue;
+        }
+        if (pick == MIDI_OUT_SRC_COUNT)
+        {
+            pick = src;
+            if (outFair)
+            {
+                break;
+            }
+        }
+        else if (p->lastSrc == pick && micros() - out_get32(&out_oldest(q)[4]) > MIDI_OUT_MAX_WAIT_US)
+        {
+            /* a source waiting too long takes turns with the busy one of higher priority, so it does not starve */
+            pick = src;
+            break;
+        }
+    }
+    return pick;
+}
+
+/**
+ * @brief Queue a complete message for one port, the message is sent right away when the UART is idle.
+ * @param p Port
+ * @param src Source
+ * @param msg Message starting with its status byte
+ * @param len Length of message
+ * @param seq Number of the message
+ */
+static void out_port_queue(struct out_port_s *p, uint8_t src, const uint8_t *msg, uint16_t len, uint16_t seq)
+{
+    struct out_queue_s *q = &p->queue[src];
+    out_track_notes(p, msg, len);
+
+    if (out_port_pending(p) == 0 && !p->paused && len <= MIDI_OUT_CHUNK)
+    {
+        /* nothing to merge with, an idle UART takes the message right away */
+        uint16_t backlog = out_backlog(p);
+        if (backlog <= MIDI_OUT_MAX_BACKLOG)
+        {
+            out_port_write(p, msg, len);
+            out_msg_done(p, q, msg, len, seq, backlog + len, (msg[0] == 0xF0U) ? micros() : 0U);
+            return;
+        }
+    }
+
+    if (len + OUT_HDR_SIZE > q->size)
+    {
+        /* too long for the queue, sent in chunks after everything queued before while the loop waits */
+        uint32_t blockStartUs = micros();
+        for (uint8_t i = 0; i < MIDI_OUT_SRC_COUNT; i++)
+        {
+            while (p->queue[i].used > 0)
+            {
+                out_send_blocking(p, i);
+            }
+        }
+        out_wait_pause(p);
+
+        uint32_t startUs = micros();
+        out_stream_begin(p);
+        uint16_t n = 0;
+        uint16_t backlog = 0;
+        for (uint16_t off = 0; off < len; off += n)
+        {
+            backlog = out_wait_backlog(p);
+            n = len - off;
+            if (n > MIDI_OUT_CHUNK)
+            {
+                n = MIDI_OUT_CHUNK;
+            }
+            out_port_write(p, &msg[off], n);
+        }
+        out_msg_done(p, q, msg, len, seq, backlog + n, startUs);
+        out_stream_end(p);
+        q->blockedUs += micros() - blockStartUs;
+        return;
+    }
+
+    if (q->used + out_wrap_gap(q, len) + len + OUT_HDR_SIZE > q->size)
+    {
+        /* the source writes faster than the line takes it */
+        uint32_t blockStartUs = micros();
+        while (q->used + out_wrap_gap(q, len) + len + OUT_HDR_SIZE > q->size)
+        {
+            out_send_blocking(p, src);
+        }
+        q->blockedUs += micros() - blockStartUs;
+    }
+    out_put(q, msg, len, seq);
+#ifdef MIDI_TELEMETRY
+    midi_tele_tx_queued((uint8_t)(p - outPorts), out_port_pending(p));
+#endif
+}
+
+/**
+ * @brief Queue a complete message for its port or for all of them, see out_route().
+ * @param src Source
+ * @param msg Message starting with its status byte
+ * @param len Length of message
+ */
+static void out_queue_msg(uint8_t src, const uint8_t *msg, uint16_t len)
+{
+    if (outPortCount == 0)
+    {
+        return;
+    }
+
+    uint16_t seq = outSeq++;
+#ifdef LATENCY_PROBE
+    lat_probe_queued(seq);
+#endif
+
+    uint8_t route = out_route(msg, len);
+    for (uint8_t i = 0; i < outPortCount; i++)
+    {
+        if (route == OUT_PORT_ALL || route == i)
+        {
+            out_port_queue(&outPorts[i], src, msg, len, seq);
+        }
+    }
+
+    midi_out_loop();
+}
+
+/**
+ * @brief Set the serial port of the first synth and empty all queues, further ports are removed.
+ * @param port Serial port, availableForWrite() must return the free space of the FIFO
+ * @param fifoSize Free space of the idle TX FIFO (COM_SERIAL_TX_FIFO), 0 to write unpaced
+ */
+void midi_out_init(midi_com_port_t *port, int fifoSize)
+{
+    outSeq = 0;
+    outNextPort = 0;
+    outPortCount = 0;
+    for (uint8_t i = 0; i < MIDI_OUT_SRC_COUNT; i++)
+    {
+        struct out_src_s *s = &outSrc[i];
+        s->status = 0;
+        s->partLen = 0;
+    }
+    for (uint8_t i = 0; i < MIDI_OUT_PORTS; i++)
+    {
+        midi_out_set_port(i, NULL, 0);
+    }
+    midi_out_set_port(0, port, fifoSize);
+    midi_out_reset_stats();
+}
+
+/**
+ * @brief Set the serial port of a further synth, its queues are emptied.
+ *        Ports are numbered from 0 without gaps, the messages are spread over all ports set.
+ * @param index Port number, less than MIDI_OUT_PORTS
+ * @param port Serial port, NULL to remove the port and all above it
+ * @param fifoSize Free space of the idle TX FIFO (COM_SERIAL_TX_FIFO), 0 to write unpaced
+ */
+void midi_out_set_port(uint8_t index, midi_com_port_t *port, int fifoSize)
+{
+    if (index >= MIDI_OUT_PORTS || index > outPortCount)
+    {
+        return;
+    }
+
+    struct out_port_s *p = &outPorts[index];
+    p->port = port;
+    p->fifoSize = fifoSize;
+    p->lastSrc = 0;
+    p->streamSrc = MIDI_OUT_SRC_COUNT;
+    p->streamOff = 0;
+    p->line = 0;
+    p->paused = false;
+    memset(p->notes, 0, sizeof(p->notes));
+    p->voices = 0;
+
+    uint16_t off = 0;
+    for (uint8_t i = 0; i < MIDI_OUT_SRC_COUNT; i++)
+    {
+        struct out_queue_s *q = &p->queue[i];
+        q->buf = &outBuf[index][off];
+        q->size = outQueueSize[i];
+        q->head = 0;
+        q->tail = 0;
+        q->used = 0;
+        q->wire = 0;
+        off += outQueueSize[i];
+    }
+
+    outPortCount = (port != NULL) ? index + 1U : index;
+}
+
+/**
+ * @brief Get the number of ports set.
+ * @return Ports the messages are spread over
+ */
+uint8_t midi_out_ports(void)
+{
+    return outPortCount;
+}
+
+/**
+ * @brief Select how the messages are spread over the ports.
+ * @param route See midi_out_route_e
+ */
+void midi_out_set_route(uint8_t route)
+{
+    if (route < MIDI_OUT_ROUTE_COUNT)
+    {
+        outRoute = route;
+    }
+}
+
+/**
+ * @brief Get how the messages are spread over the ports.
+ * @return See midi_out_route_e
+ */
+uint8_t midi_out_route(void)
+{
+    return outRoute;
+}
+
+/**
+ * @brief Queue complete MIDI messages of a source.
+ *        Data starting with a data byte continues the running status of the source.
+ * @param src Source, see midi_out_src_e
+ * @param msg Pointer to message
+ * @param len Length of message
+ */
+void midi_out_write(uint8_t src, const uint8_t *msg, uint16_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+    if (msg[0] < 0x80U)
+    {
+        midi_out_stream(src, msg, len);
+        return;
+    }
+
+    outSrc[src].status = (msg[0] < 0xF0U) ? msg[0] : 0U;
+    out_queue_msg(src, msg, len);
+}
+
+/**
+ * @brief Queue bytes of a source which may split or join messages.
+ *        Real time bytes are written directly, bytes which do not belong to a message are dropped.
+ * @param src Source, see midi_out_src_e
+ * @param data Pointer to data
+ * @param len Length of data
+ */
+void midi_out_stream(uint8_t src, const uint8_t *data, uint16_t len)
+{
+    struct out_src_s *s = &outSrc[src];
+
+    for (uint16_t i = 0; i < len; i++)
+    {
+        uint8_t b = data[i];
+
+        if (b >= 0xF8U)
+        {
+            midi_out_direct(&b, 1);
+            continue;
+        }
+
+        if (b & 0x80U)
+        {
+            if (b == 0xF7U && s->partLen > 0 && s->part[0] == 0xF0U)
+            {
+                s->part[s->partLen++] = b;
+                out_queue_msg(src, s->part, s->partLen);
+                s->partLen = 0;
+                continue;
+            }
+            /* an unfinished message is cut off by the new status */
+            s->dropped += s->partLen;
+            if (b == 0xF7U)
+            {
+                s->dropped++;
+                s->partLen = 0;
+                s->status = 0;
+                continue;
+            }
+            s->part[0] = b;
+            s->partLen = 1;
+            s->partNeed = out_msg_len(b);
+            s->status = (b < 0xF0U) ? b : 0U;
+        }
+        else if (s->partLen == 0)
+        {
+            if (s->status == 0)
+            {
+                s->dropped++;
+                continue;
+            }
+            s->part[0] = s->status;
+            s->part[1] = b;
+            s->partLen = 2;
+            s->partNeed = out_msg_len(s->status);
+        }
+        else if (s->partLen < MIDI_OUT_PART_MAX - 1U)
+        {
+            s->part[s->partLen++] = b;
+        }
+        else
+        {
+            /* SysEx too long to be assembled, the rest is dropped up to the next status byte */
+            s->dropped += s->partLen + 1U;
+            s->partLen = 0;
+            s->status = 0;
+            continue;
+        }
+
+        if (s->partNeed > 0 && s->partLen == s->partNeed)
+        {
+            out_queue_msg(src, s->part, s->partLen);
+            s->partLen = 0;
+        }
+    }
+}
+
+static void out_direct_write(struct out_port_s *p, uint8_t index, const uint8_t *msg, uint16_t len)
+{
+    MidiCom::write(*p->port, msg, len);
+#ifdef MIDI_TELEMETRY
+    midi_tele_tx_direct(index, msg, len);
+#else
+    (void)index;
+#endif
+}
+
+/**
+ * @brief Write real time or system common bytes ahead of the queued data, to all ports.
+ *        Can be called from a timer task.
+ * @param msg Pointer to message
+ * @param len Length of message
+ */
+void midi_out_direct(const uint8_t *msg, uint16_t len)
+{
+    for (uint8_t i = 0; i < outPortCount; i++)
+    {
+        struct out_port_s *p = &outPorts[i];
+        if (msg[0] >= 0xF8U)
+        {
+            /* real time bytes may be sent inside of a SysEx */
+            out_direct_write(p, i, msg, len);
+            continue;
+        }
+
+        uint8_t state = __atomic_load_n(&p->line, __ATOMIC_ACQUIRE);
+        for (;;)
+        {
+            if ((state & OUT_LINE_STREAM) != 0)
+            {
+                /* system common would end a SysEx on the line, it follows the long message */
+                if ((state & OUT_LINE_DEFER) != 0 || len > OUT_DEFER_MAX)
+                {
+                    outSysex.deferDropped++;
+                    break;
+                }
+                /* the slot is only read by the loop after the flag has been set */
+                memcpy(p->deferMsg, msg, len);
+                p->deferLen = (uint8_t)len;
+                if (__atomic_compare_exchange_n(&p->line, &state, (uint8_t)(state | OUT_LINE_DEFER), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+                {
+                    outSysex.deferred++;
+                    break;
+                }
+            }
+            else if (__atomic_compare_exchange_n(&p->line, &state, (uint8_t)(state | OUT_LINE_DIRECT), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            {
+                /* the loop waits with the next long message until the write is done */
+                out_direct_write(p, i, msg, len);
+                __atomic_fetch_and(&p->line, (uint8_t)~OUT_LINE_DIRECT, __ATOMIC_RELEASE);
+                break;
+            }
+            /* the state changed meanwhile, decided again with the new one */
+        }
+    }
+}
+
+/**
+ * @brief Pass queued messages to the UARTs while their backlog is short.
+ */
+void midi_out_loop(void)
+{
+    for (uint8_t i = 0; i < outPortCount; i++)
+    {
+        struct out_port_s *p = &outPorts[i];
+        for (;;)
+        {
+            if (p->paused)
+            {
+                if ((int32_t)(micros() - p->pauseEndUs) < 0)
+                {
+                    break;
+                }
+                p->paused = false;
+            }
+            uint16_t backlog = out_backlog(p);
+            if (backlog > MIDI_OUT_MAX_BACKLOG)
+            {
+                break;
+            }
+            uint8_t src = out_pick(p);
+            if (src == MIDI_OUT_SRC_COUNT)
+            {
+                break;
+            }
+            out_send(p, src, backlog);
+            p->lastSrc = src;
+        }
+    }
+}
+
+/**
+ * @brief Get the number of queued bytes of all sources and ports.
+ * @return Bytes including the record headers
+ */
+uint16_t midi_out_pending(void)
+{
+    uint16_t used = 0;
+    for (uint8_t i = 0; i < outPortCount; i++)
+    {
+        used += out_port_pending(&outPorts[i]);
+    }
+    return used;
+}
+
+/**
+ * @brief Estimate the time until everything queued so far has left the UART.
+ *        Counts the message bytes queued by all sources, the backlog of the UART and the rest of a pause given to the synth,
+ *        a source which plans ahead, like the file player, adds its own bytes to get the time its message is on the wire.
+ *        With several ports the busiest one is taken.
+ * @return Time in microseconds, 0 if the line is free
+ */
+uint32_t midi_out_busy_us(void)
+{
+    uint32_t busyUs = 0;
+    for (uint8_t i = 0; i < outPortCount; i++)
+    {
+        const struct out_port_s *p = &outPorts[i];
+        uint32_t lineUs = (uint32_t)out_backlog(p) * MIDI_OUT_BYTE_US;
+        if (p->paused)
+        {
+            int32_t pauseUs = (int32_t)(p->pauseEndUs - micros());
+            if (pauseUs > (int32_t)lineUs)
+            {
+                lineUs = (uint32_t)pauseUs;
+            }
+        }
+        uint32_t wire = 0;
+        for (uint8_t j = 0; j < MIDI_OUT_SRC_COUNT; j++)
+        {
+            wire += p->queue[j].wire;
+        }
+        lineUs += wire * MIDI_OUT_BYTE_US;
+        if (lineUs > busyUs)
+        {
+            busyUs = lineUs;
+        }
+    }
+    return busyUs;
+}
+
+/**
+ * @brief Select the scheduling between the sources.
+ * @param fair true for round robin, false for priority
+ */
+void midi_out_set_fair(bool fair)
+{
+    outFair = fair;
+}
+
+/**
+ * @brief Get the scheduling between the sources.
+ * @return true for round robin, false for priority
+ */
+bool midi_out_fair(void)
+{
+    return outFair;
+}
+
+/**
+ * @brief Check if a source should hold back more data, because its queue is half full or the synth is given a pause.
+ *        A source which can wait, like the file player, avoids blocking the loop on a full queue this way.
+ * @param src Source, see midi_out_src_e
+ * @return true to hold back
+ */
+bool midi_out_hold(uint8_t src)
+{
+    for (uint8_t i = 0; i < outPortCount; i++)
+    {
+        const struct out_port_s *p = &outPorts[i];
+        if (p->paused || p->queue[src].used > p->queue[src].size / 2U)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Get the counters of a source, summed over all ports.
+ * @param src Source, see midi_out_src_e
+ * @param stats Filled with the counters
+ */
+void midi_out_get_stats(uint8_t src, struct midi_out_stats_s *stats)
+{
+    uint64_t waitSumUs = 0;
+    memset(stats, 0, sizeof(*stats));
+    stats->dropped = outSrc[src].dropped;
+    for (uint8_t i = 0; i < outPortCount; i++)
+    {
+        const struct out_queue_s *q = &outPorts[i].queue[src];
+        stats->messages += q->messages;
+        stats->bytes += q->bytes;
+        stats->blockedUs += q->blockedUs;
+        waitSumUs += q->waitSumUs;
+        if (q->highWater > stats->highWater)
+        {
+            stats->highWater = q->highWater;
+        }
+        if (q->waitMaxUs > stats->waitMaxUs)
+        {
+            stats->waitMaxUs = q->waitMaxUs;
+        }
+    }
+    stats->waitAvgUs = (stats->messages > 0) ? (uint32_t)(waitSumUs / stats->messages) : 0U;
+}
+
+/**
+ * @brief Get the counters of a port.
+ * @param index Port number
+ * @param stats Filled with the counters
+ */
+void midi_out_get_port_stats(uint8_t index, struct midi_out_port_stats_s *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    if (index >= outPortCount)
+    {
+        return;
+    }
+    const struct out_port_s *p = &outPorts[index];
+    stats->messages = p->messages;
+    stats->bytes = p->bytes;
+    stats->pending = out_port_pending(p);
+    stats->voices = p->voices;
+    stats->voicesPeak = p->voicesPeak;
+}
+
+/**
+ * @brief Get the SysEx counters of all ports.
+ * @param stats Filled with the counters
+ */
+void midi_out_get_sysex_stats(struct midi_out_sysex_stats_s *stats)
+{
+    *stats = outSysex;
+}
+
+/**
+ * @brief Clear the counters of all sources and ports.
+ */
+void midi_out_reset_stats(void)
+{
+    for (uint8_t i = 0; i < MIDI_OUT_SRC_COUNT; i++)
+    {
+        outSrc[i].dropped = 0;
+    }
+    for (uint8_t i = 0; i < MIDI_OUT_PORTS; i++)
+    {
+        struct out_port_s *p = &outPorts[i];
+        p->messages = 0;
+        p->bytes = 0;
+        p->voicesPeak = p->voices;
+        for (uint8_t j = 0; j < MIDI_OUT_SRC_COUNT; j++)
+        {
+            struct out_queue_s *q = &p->queue[j];
+            q->messages = 0;
+            q->bytes = 0;
+            q->highWater = q->used;
+            q->waitSumUs = 0;
+            q->waitMaxUs = 0;
+            q->blockedUs = 0;
+        }
+    }
+    midi_out_reset_sysex_stats();
+}
+
+/**
+ * @brief Clear the SysEx counters, e.g. when a song is loaded to see the cost of its setup.
+ */
+void midi_out_reset_sysex_stats(void)
+{
+    memset(&outSysex, 0, sizeof(outSysex));
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MidiOut.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Output merger in front of the serial MIDI TX.
+ *        Each source (live input, user interface, file player) has a queue of its own holding complete messages,
+ *        a message is passed to the UART with a single write, so messages of different sources never interleave.
+ *        Messages are passed on only while a few bytes are left in the UART FIFO, the next one is picked by priority
+ *        (live first, a source waiting longer than MIDI_OUT_MAX_WAIT_US takes turns with it) or round robin.
+ *        A port without a reported FIFO (COM_SERIAL_TX_FIFO 0, SoftwareSerial) gets every message right away, unpaced.
+ *        Every queued message starts with its status byte, running status of a source is expanded when it is written,
+ *        so it can not leak into the messages of another source.
+ *        Messages longer than MIDI_OUT_CHUNK (SysEx) are passed on in chunks of that size, nothing else is sent
+ *        until they are complete but real time bytes get through in between. Afterwards the synth gets a pause
+ *        to process the SysEx, a longer one after a GM / GS reset.
+ *        Real time and system common bytes are written directly, so they have to wait for that short backlog only
+ *        and never end up inside a queued message.
+ *        The UART is accessed through MidiCom (MidiTransport.h), the calls are bound to the serial type of the board.
+ *        With MIDI_OUT_PORTS above 1 the messages are spread over several UARTs, each with a SAM2695 behind it
+ *        and a queue per source of its own (midi_out_set_port()). By channel every chip plays a fixed set of channels,
+ *        by voice a note goes to the chip with the least sounding notes. SysEx (GM / GS reset, GS master key shift)
+ *        and the RPN / NRPN controllers (master volume 0x3707) are copied to all chips, by voice all channel messages
+ *        which are not notes as well. Polyphony and bandwidth grow with the number of chips.
+ */
+
+
+#ifndef MIDI_OUT_H
+#define MIDI_OUT_H
+
+
+#include <Arduino.h>
+
+#include "MidiTransport.h"
+
+
+#define MIDI_OUT_QUEUE_LIVE     256U
+#define MIDI_OUT_QUEUE_UI       256U
+#define MIDI_OUT_QUEUE_PLAYER   1024U
+#define MIDI_OUT_QUEUE_SIZE     (MIDI_OUT_QUEUE_LIVE + MIDI_OUT_QUEUE_UI + MIDI_OUT_QUEUE_PLAYER) /* per port */
+#ifndef MIDI_OUT_PORTS
+#define MIDI_OUT_PORTS          1U      /* UARTs with a synth behind, the extra ones are set in MidiTransport.h */
+#endif
+#define MIDI_OUT_MAX_BACKLOG    2       /* bytes in the UART FIFO before queued data is held back, the loop has to return within that time plus one message to keep the line busy */
+#define MIDI_OUT_MAX_WAIT_US    20000U  /* a lower priority source waiting longer alternates with the busy one */
+#define MIDI_OUT_PART_MAX       64U     /* longest message assembled from single bytes by MidiOutPort */
+#define MIDI_OUT_CHUNK          4U      /* bytes of a long message passed to the UART at once, real time bytes wait at most for that plus the backlog */
+#define MIDI_OUT_SYSEX_GAP_US   2000U   /* pause after a SysEx before the next queued message */
+#define MIDI_OUT_RESET_GAP_US   50000U  /* pause after a GM or GS reset */
+#define MIDI_OUT_BYTE_US        320U    /* 10 bits at 31250 baud */
+
+
+/* sources in the order of their priority */
+enum midi_out_src_e
+{
+    MIDI_OUT_SRC_LIVE,      /* received MIDI and controller mapping */
+    MIDI_OUT_SRC_UI,        /* synth library calls of the modes and the sequencer */
+    MIDI_OUT_SRC_PLAYER,    /* MIDI file player */
+    MIDI_OUT_SRC_COUNT,
+};
+
+/* spreading of the messages over the ports */
+enum midi_out_route_e
+{
+    MIDI_OUT_ROUTE_CHANNEL, /* channel modulo the number of ports */
+    MIDI_OUT_ROUTE_VOICE,   /* each note to the port with the least sounding notes */
+    MIDI_OUT_ROUTE_COUNT,
+};
+
+struct midi_out_stats_s
+{
+    uint32_t messages;
+    uint32_t bytes;
+    uint32_t dropped;       /* bytes which did not form a complete message */
+    uint16_t highWater;     /* queued bytes including the record headers */
+    uint32_t waitAvgUs;     /* from queued to passed to the UART */
+    uint32_t waitMaxUs;
+    uint32_t blockedUs;     /* loop blocked because the queue was full or the message too long for it */
+};
+
+struct midi_out_port_stats_s
+{
+    uint32_t messages;
+    uint32_t bytes;
+    uint16_t pending;       /* queued bytes including the record headers */
+    uint16_t voices;        /* notes sounding on the chip, without the sustain pedal */
+    uint16_t voicesPeak;
+};
+
+struct midi_out_sysex_stats_s
+{
+    uint32_t count;
+    uint32_t bytes;
+    uint32_t lastUs;        /* from the first byte passed to the UART to the last byte on the line */
+    uint32_t maxUs;
+    uint32_t totalUs;
+    uint32_t pauseUs;       /* pauses given to the synth afterwards */
+    uint32_t deferred;      /* system common messages of the timer held back until a SysEx was complete */
+    uint32_t deferDropped;
+};
+
+
+void midi_out_init(midi_com_port_t *port, int fifoSize);
+void midi_out_set_port(uint8_t index, midi_com_port_t *port, int fifoSize);
+uint8_t midi_out_ports(void);
+void midi_out_set_route(uint8_t route);
+uint8_t midi_out_route(void);
+void midi_out_write(uint8_t src, const uint8_t *msg, uint16_t len);
+void midi_out_stream(uint8_t src, const uint8_t *data, uint16_t len);
+void midi_out_direct(const uint8_t *msg, uint16_t len);
+void midi_out_loop(void);
+uint16_t midi_out_pending(void);
+uint32_t midi_out_busy_us(void);
+void midi_out_set_fair(bool fair);
+bool midi_out_fair(void);
+bool midi_out_hold(uint8_t src);
+void midi_out_get_stats(uint8_t src, struct midi_out_stats_s *stats);
+void midi_out_get_port_stats(uint8_t index, struct midi_out_port_stats_s *stats);
+void midi_out_get_sysex_stats(struct midi_out_sysex_stats_s *stats);
+void midi_out_reset_stats(void);
+void midi_out_reset_sysex_stats(void);
+
+
+/**
+ * @brief Output of one source for code which writes bytes instead of messages, like the SAM2695Synth library.
+ *        The bytes are assembled to complete messages before they are queued.
+ */
+class MidiOutPort final : public Print
+{
+public:
+    explicit MidiOutPort(uint8_t src) : outSrc(src) {}
+
+    /* the UART is started by the sketch */
+    template<typename... Args> void begin(Args... args) {}
+
+    size_t write(uint8_t b) override
+    {
+        midi_out_stream(outSrc, &b, 1);
+        return 1;
+    }
+
+    size_t write(const uint8_t *buf, size_t len) override
+    {
+        midi_out_stream(outSrc, buf, (uint16_t)len);
+        return len;
+    }
+
+private:
+    uint8_t outSrc;
+};
+
+
+#endif /* MIDI_OUT_H */
@@ -12,12 +12,12 @@ MidiPlayerMode::MidiPlayerMode()
 
 void MidiPlayerMode::onEnter()
 {
-    Serial.println("enter MidiPlayerMode");
+    LOG_I("enter MidiPlayerMode");
 }
 
 void MidiPlayerMode::onExit()
 {
-    Serial.println("exit MidiPlayerMode");
+    LOG_I("exit MidiPlayerMode");
 }
 
 void app_play_next_song(void);
@@ -36,48 +36,48 @@ bool MidiPlayerMode::handleEvent(StateMachine *machine, Event *event)
     {
     case EventType::APressed:
         {
-            Serial.println("MidiPlayerMode Button A Pressed");
+            LOG_D("MidiPlayerMode Button A Pressed");
             app_play_next_song();
             return true;
         };
     case EventType::BPressed:
         {
-            Serial.println("MidiPlayerMode Button B Pressed");
+            LOG_D("MidiPlayerMode Button B Pressed");
             app_play_prev_song();
             return true;
         };
     case EventType::CPressed:
         {
-            Serial.println("MidiPlayerMode Button C Pressed");
+            LOG_D("MidiPlayerMode Button C Pressed");
             app_play_pause_song();
             return true;
         };
     case EventType::DPressed:
         {
-            Serial.println("MidiPlayerMode Button D Pressed");
+            LOG_D("MidiPlayerMode Button D Pressed");
             app_rewind_song();
             return true;
         };
     case EventType::ALongPressed:
         {
-            Serial.println("MidiPlayerMode Button A Long Pressed");
+            LOG_D("MidiPlayerMode Button A Long Pressed");
             return true;
         };
     case EventType::BLongPressed:
         {
-            Serial.println("MidiPlayerMode Button B Long Pressed");
+            LOG_D("MidiPlayerMode Button B Long Pressed");
             synth.increaseVelocity();
             return true;
         };
     case EventType::CLongPressed:
         {
-            Serial.println("MidiPlayerMode Button C Long Pressed");
+            LOG_D("MidiPlayerMode Button C Long Pressed");
             synth.decreaseVelocity();
             return true;
         };
     case EventType::DLongPressed:
         {
-            Serial.println("MidiPlayerMode Button D Long Pressed");
+            LOG_D("MidiPlayerMode Button D Long Pressed");
             //next mode index
             int index = 2;
             State *nextState = StateManager::getInstance()->getState(index);
@@ -10,31 +10,12 @@
 #include "Event.h"
 #include "StateMachine.h"
 #include "SAM2695Synth.h"
+#include "MidiOut.h"
+#include "Log.h"
 
 
-#ifdef __AVR__
-#include <SoftwareSerial.h>
-extern SAM2695Synth<SoftwareSerial> synth;
-#endif
-
-#if defined(ARDUINO_ARCH_RP2040) || defined(ARDUINO_ARCH_RP2350) ||  defined(ARDUINO_XIAO_RA4M1)
-#include <SoftwareSerial.h>
-extern SAM2695Synth<SoftwareSerial> synth;
-#endif
-
-#if  defined(CONFIG_IDF_TARGET_ESP32C3) || defined(CONFIG_IDF_TARGET_ESP32C6) || defined(CONFIG_IDF_TARGET_ESP32S3)
-extern SAM2695Synth<HardwareSerial> synth;
-#endif
-
-#ifdef SEEED_XIAO_M0
-extern SAM2695Synth<Uart> synth;
-#elif defined(ARDUINO_SAMD_VARIANT_COMPLIANCE)
-extern SAM2695Synth<Uart> synth;
-#endif
-
-#if defined(NRF52840_XXAA)
-extern SAM2695Synth<Uart> synth;
-#endif
+//the synth writes through the output merger, see MidiOut.h
+extern SAM2695Synth<MidiOutPort> synth;
 
 // MidiPlayerMode Mode 1 (default)
 // MidiPlayerMode is a derived class from State that represents a specific state in the state machine.
@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MidiRender.ino
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Offline render of the MIDI player output.
+ *        The player is driven by a virtual clock as fast as possible, every byte passed to
+ *        midi_player_send_data is written with its timestamp to a trace file instead of the synth.
+ *        The trace can be compared with tools/midi_trace on a PC.
+ *
+ * Trace file format (all values are variable length quantities like in a MIDI file):
+ *   "MTRC" <version 1> <3 reserved bytes>
+ *   records: <delta time in us> <length> <bytes>
+ */
+
+
+#include <Arduino.h>
+
+#include <FS.h>
+#include <LittleFS.h>
+
+#include <ml_midi_player.h> /* requires ML_SynthTools_Lib library from https://github.com/marcel-licence/ML_SynthTools_Lib */
+
+
+#define RENDER_STEP_MS          1 /* virtual time advanced per player loop, same resolution as the real loop */
+#define RENDER_MAX_SONG_MS      (60UL * 60UL * 1000UL) /* stop rendering after one hour of song time */
+#define RENDER_BUFFER_SIZE      512
+#define RENDER_DEFAULT_TRACE    "/render.trc"
+#define RENDER_TRACE_VERSION    1
+
+
+static File renderFile;
+static bool renderActive = false;
+static bool renderDone = false;
+static uint32_t renderTimeMs = 0;
+static uint32_t renderLastEventMs = 0;
+static uint32_t renderBytes = 0;
+static uint32_t renderEvents = 0;
+static uint8_t renderBuffer[RENDER_BUFFER_SIZE];
+static uint16_t renderBufferLen = 0;
+
+
+static void render_flush(void)
+{
+    if (renderBufferLen > 0)
+    {
+        renderFile.write(renderBuffer, renderBufferLen);
+        renderBufferLen = 0;
+    }
+}
+
+static void render_put(uint8_t b)
+{
+    if (renderBufferLen == RENDER_BUFFER_SIZE)
+    {
+        render_flush();
+    }
+    renderBuffer[renderBufferLen++] = b;
+}
+
+static void render_put_vlq(uint32_t value)
+{
+    uint8_t tmp[5];
+    int n = 0;
+    tmp[n++] = value & 0x7FU;
+    while ((value >>= 7U) != 0)
+    {
+        tmp[n++] = 0x80U | (value & 0x7FU);
+    }
+    while (n > 0)
+    {
+        render_put(tmp[--n]);
+    }
+}
+
+/**
+ * @brief Check if the player output is currently rendered to a trace.
+ * @return true if rendering, false if the output goes to the synth
+ */
+bool midi_render_active(void)
+{
+    return renderActive;
+}
+
+/**
+ * @brief Append a message emitted by the player to the trace.
+ * @param msg Pointer to message
+ * @param len Length of message
+ */
+void midi_render_data(const uint8_t *msg, int len)
+{
+    render_put_vlq((renderTimeMs - renderLastEventMs) * 1000UL);
+    render_put_vlq(len);
+    for (int i = 0; i < len; i++)
+    {
+        render_put(msg[i]);
+    }
+    renderLastEventMs = renderTimeMs;
+    renderBytes += len;
+    renderEvents++;
+}
+
+/**
+ * @brief Called instead of the auto play logic when the song ends during rendering.
+ */
+void midi_render_song_end(void)
+{
+    renderDone = true;
+}
+
+/**
+ * @brief Render a song offline into a trace file.
+ *        The function blocks until the song is done, MIDI input is not processed meanwhile.
+ * @param songPath Path to MIDI file
+ * @param tracePath Path of the trace file to create
+ * @return true if successful, false otherwise
+ */
+bool midi_render_song(const char *songPath, const char *tracePath)
+{
+    if (!midi_player_setup(songPath))
+    {
+        return false;
+    }
+
+    renderFile = LittleFS.open(tracePath, "w");
+    if (!renderFile)
+    {
+        SHOW_SERIAL.printf("cannot create %s\n", tracePath);
+        return false;
+    }
+
+    const uint8_t header[] = {'M', 'T', 'R', 'C', RENDER_TRACE_VERSION, 0, 0, 0};
+    renderFile.write(header, sizeof(header));
+
+    renderActive = true;
+    renderDone = false;
+    renderTimeMs = 0;
+    renderLastEventMs = 0;
+    renderBytes = 0;
+    renderEvents = 0;
+    renderBufferLen = 0;
+
+    ml_midi_player_rewind();
+    ml_midi_player_play();
+
+    uint32_t startUs = micros();
+    uint32_t lastYieldMs = millis();
+
+    while (!renderDone && renderTimeMs < RENDER_MAX_SONG_MS)
+    {
+        renderTimeMs += RENDER_STEP_MS;
+        ml_midi_player_loop(RENDER_STEP_MS);
+
+        if (millis() - lastYieldMs >= 100)
+        {
+            /* give the idle task a chance, avoids watchdog warnings on long songs */
+            lastYieldMs = millis();
+            delay(1);
+        }
+    }
+
+    uint32_t cpuUs = micros() - startUs;
+
+    ml_midi_player_stop();
+    renderActive = false;
+    render_flush();
+    renderFile.close();
+
+    SHOW_SERIAL.printf("rendered %s to %s\n", songPath, tracePath);
+    SHOW_SERIAL.printf("  %lu events, %lu bytes, song time %lu ms%s\n", (unsigned long)renderEvents, (unsigned long)renderBytes,
+                       (unsigned long)renderTimeMs, renderDone ? "" : " (limit reached)");
+    SHOW_SERIAL.printf("  cpu time %lu us, %lu.%02lu song seconds per cpu second\n", (unsigned long)cpuUs,
+                       (unsigned long)((uint64_t)renderTimeMs * 1000ULL / (cpuUs + 1U)),
+                       (unsigned long)(((uint64_t)renderTimeMs * 100000ULL / (cpuUs + 1U)) % 100U));
+
+    return true;
+}
+
+/**
+ * @brief Console command: render <song.mid> [trace.trc]
+ * @param args Command arguments
+ */
+void Console_Render(const char *args)
+{
+    char song[64];
+    char trace[64];
+
+    int n = sscanf(args, "%63s %63s", song, trace);
+    if (n < 1)
+    {
+        SHOW_SERIAL.println("usage: render <song.mid> [trace.trc]");
+        return;
+    }
+    if (n < 2)
+    {
+        strcpy(trace, RENDER_DEFAULT_TRACE);
+    }
+
+    midi_render_song(song, trace);
+}
+
+/**
+ * @brief Console command: dump <file>
+ *        Prints the file as "HEX <bytes>" lines, tools/midi_trace unhex converts a captured log back to binary.
+ * @param args Command arguments
+ */
+void Console_Dump(const char *args)
+{
+    File file = LittleFS.open(args, "r");
+    if (!file || file.isDirectory())
+    {
+        SHOW_SERIAL.printf("cannot open %s\n", args);
+        return;
+    }
+
+    uint8_t buf[32];
+    int n;
+    while ((n = file.read(buf, sizeof(buf))) > 0)
+    {
+        SHOW_SERIAL.print("HEX ");
+        for (int i = 0; i < n; i++)
+        {
+            SHOW_SERIAL.printf("%02x", buf[i]);
+        }
+        SHOW_SERIAL.println();
+    }
+    SHOW_SERIAL.println("HEX END");
+    file.close();
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MidiTelemetry.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Traffic counters of the MIDI streams: the received stream (read through MidiTeleRx) and the stream of every synth port
+ *        (the UART writes of MidiOut). Each stream runs its bytes through a small parser and counts messages per type and channel,
+ *        running status, SysEx, real time and system common messages, data bytes without a status and messages cut by a status byte.
+ *        midi_tele_loop() turns the byte counts into rates per second and over 10 s with their peaks.
+ *        The queue high-water is the most bytes seen waiting: in the UART when the loop reads (received), in the merger (sent).
+ *        A full line shows as a rate near MIDI_TELE_LINE_BPS, a stalled loop as received bytes waiting.
+ *        The counters are compiled in with MIDI_TELEMETRY and always count, a byte costs a few compares and increments.
+ *        The direct writes of the timer (midi_out_direct()) have counters of their own, they do not pass the parser.
+ *        While an input capture runs (InputCapture.h) MidiTeleRx passes the received bytes to it as well.
+ */
+
+
+#ifndef MIDI_TELEMETRY_H
+#define MIDI_TELEMETRY_H
+
+
+#include <Arduino.h>
+
+#include "InputCapture.h"
+#include "MidiOut.h"
+#include "MidiTransport.h"
+
+
+#define MIDI_TELEMETRY                  /* compiled in, printed by the traffic console command */
+
+#define MIDI_TELE_STREAMS       (1U + MIDI_OUT_PORTS)   /* received stream, then one per synth port */
+#define MIDI_TELE_STREAM_RX     0U
+#define MIDI_TELE_WINDOW_S      10U     /* long rate window */
+#define MIDI_TELE_LINE_BPS      3125U   /* bytes per second at 31250 baud */
+
+
+enum midi_tele_dir_e
+{
+    MIDI_TELE_RX,
+    MIDI_TELE_TX, /* all synth ports */
+    MIDI_TELE_DIRS,
+};
+
+/* channel messages, in the order of their status */
+enum midi_tele_type_e
+{
+    MIDI_TELE_NOTE_OFF, /* including note on with velocity 0 */
+    MIDI_TELE_NOTE_ON,
+    MIDI_TELE_POLY_PRESSURE,
+    MIDI_TELE_CONTROL,
+    MIDI_TELE_PROGRAM,
+    MIDI_TELE_CHANNEL_PRESSURE,
+    MIDI_TELE_PITCH_BEND,
+    MIDI_TELE_TYPES,
+};
+
+struct midi_tele_stats_s
+{
+    uint32_t bytes;
+    uint32_t channelMsgs;
+    uint32_t runningUsed; /* channel messages without their status byte */
+    uint32_t runningRepeated; /* channel messages which repeated the running status, it could have been left out */
+    uint32_t sysexMsgs;
+    uint32_t sysexBytes;
+    uint32_t realtime;
+    uint32_t common; /* system common messages */
+    uint32_t stray; /* data bytes without a status, end of SysEx without its start */
+    uint32_t cut; /* messages ended by a status byte before they were complete */
+    uint16_t rateBps; /* last second */
+    uint16_t peakBps;
+    uint16_t rateWindowBps; /* mean over the last MIDI_TELE_WINDOW_S seconds */
+    uint16_t peakWindowBps;
+    uint16_t queueHighWater; /* received: bytes waiting in the UART, sent: bytes waiting in the merger */
+};
+
+
+void midi_tele_rx(uint8_t b);
+void midi_tele_rx_waiting(uint16_t bytes);
+void midi_tele_tx(uint8_t port, const uint8_t *data, uint16_t len);
+void midi_tele_tx_direct(uint8_t port, const uint8_t *msg, uint16_t len);
+void midi_tele_tx_queued(uint8_t port, uint16_t bytes);
+void midi_tele_loop(uint32_t nowUs);
+void midi_tele_get(uint8_t stream, struct midi_tele_stats_s *stats);
+uint32_t midi_tele_messages(uint8_t dir, uint8_t type, uint8_t channel);
+uint32_t midi_tele_seconds(void);
+void midi_tele_reset(void);
+void midi_tele_print(Print *port);
+
+
+/**
+ * @brief Received stream for the MIDI parser, every byte read is counted on its way and captured while a capture runs.
+ *        Reads go to the serial type of the synth (MidiCom), the parser calls this Stream through its pointer as before.
+ */
+class MidiTeleRx final : public Stream
+{
+public:
+    /**
+     * @param port Serial port of the MIDI input
+     * @param rxTime Returns the reception time of the byte which has just been read, for the capture
+     */
+    MidiTeleRx(midi_com_port_t &port, uint32_t (*rxTime)(void)) : rxPort(port), rxTimeUs(rxTime) {}
+
+    int available(void) override
+    {
+        return MidiCom::available(rxPort);
+    }
+
+    int read(void) override
+    {
+        int b = MidiCom::read(rxPort);
+        if (b >= 0)
+        {
+            midi_tele_rx((uint8_t)b);
+#ifdef INPUT_CAPTURE
+            if (cap_state() == CAP_RUNNING)
+            {
+                cap_rx((uint8_t)b, rxTimeUs());
+            }
+#endif
+        }
+        return b;
+    }
+
+    int peek(void) override
+    {
+        return rxPort.peek();
+    }
+
+    size_t write(uint8_t b) override
+    {
+        return rxPort.write(b);
+    }
+
+    size_t write(const uint8_t *buf, size_t len) override
+    {
+        return rxPort.write(buf, len);
+    }
+
+private:
+    midi_com_port_t &rxPort;
+    uint32_t (*rxTimeUs)(void);
+};
+
+
+#endif /* MIDI_TELEMETRY_H */
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MidiTransport.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Serial port of the synth selected at compile time.
+ *        COM_SERIAL is chosen per board in this file only, midi_com_port_t is its exact type.
+ *        MidiCom reads and writes it with qualified calls, so the byte paths of the output merger and the input
+ *        call the serial driver of the core directly instead of going through the virtual functions of Stream.
+ *        A qualified call of a function the port type does not override reaches Print or Stream instead, so
+ *        SoftwareSerial has a specialization of its own.
+ *        The host build (tools/host) has no board, there MidiCom is MidiTransport<Stream> and the calls stay virtual,
+ *        so every tool can pass a port model of its own.
+ *        COM_SERIAL_TX_FIFO is the free space availableForWrite() reports for an idle port, the output merger paces
+ *        its writes by it. It is 0 where availableForWrite() is not implemented, then the merger writes unpaced.
+ */
+
+
+#ifndef MIDI_TRANSPORT_H
+#define MIDI_TRANSPORT_H
+
+
+#include <Arduino.h>
+
+
+#if defined(ARDUINO_HOST)
+/* COM_SERIAL is defined by the host tool, the port models have the TX FIFO of the ESP32 */
+#ifndef COM_SERIAL_TX_FIFO
+#define COM_SERIAL_TX_FIFO 128
+#endif
+typedef Stream midi_com_port_t;
+#else
+
+#if defined(__AVR__) || defined(ARDUINO_ARCH_RP2040) || defined(ARDUINO_ARCH_RP2350) || defined(ARDUINO_XIAO_RA4M1)
+    #include <SoftwareSerial.h>
+    extern SoftwareSerial SSerial; /* the sketch sets the pins */
+    #define COM_SERIAL SSerial
+    #define COM_SERIAL_TX_FIFO 0 /* SoftwareSerial does not report its free space, the writes are not paced */
+#elif defined(CONFIG_IDF_TARGET_ESP32C3) || defined(CONFIG_IDF_TARGET_ESP32C6) || defined(CONFIG_IDF_TARGET_ESP32S3)
+    #define COM_SERIAL Serial0
+    #define COM_SERIAL_TX_FIFO 128 /* UART hardware FIFO, no TX ring buffer is installed */
+    #if defined(CONFIG_IDF_TARGET_ESP32S3)
+        /* further synths for MIDI_OUT_PORTS (MidiOut.h), only their TX pin is used */
+        #define COM_SERIAL_2 Serial1
+        #define COM_SERIAL_2_TX_PIN 7  /* D8 */
+        #define COM_SERIAL_3 Serial2
+        #define COM_SERIAL_3_TX_PIN 8  /* D9 */
+    #endif
+#elif defined(SEEED_XIAO_M0) || defined(ARDUINO_SAMD_VARIANT_COMPLIANCE)
+    #define COM_SERIAL Serial1
+    #define COM_SERIAL_TX_FIFO (SERIAL_BUFFER_SIZE - 1) /* TX ring of Uart, one entry stays unused */
+#elif defined(NRF52840_XXAA)
+    #define COM_SERIAL Serial1
+    #define COM_SERIAL_TX_FIFO 0 /* the free space of the TX buffer is not reported */
+#else
+    #error "no serial port of the synth defined for this board"
+#endif
+
+typedef decltype(COM_SERIAL) midi_com_port_t;
+#endif
+
+
+/**
+ * @brief Byte access to a serial port of a known type.
+ *        The qualified calls are bound at compile time, a port of exactly this type must be passed.
+ */
+template <class Port>
+struct MidiTransport
+{
+    static inline int available(Port &port)
+    {
+        return port.Port::available();
+    }
+
+    static inline int read(Port &port)
+    {
+        return port.Port::read();
+    }
+
+    static inline int availableForWrite(Port &port)
+    {
+        return port.Port::availableForWrite();
+    }
+
+    static inline size_t write(Port &port, const uint8_t *buf, size_t len)
+    {
+        return port.Port::write(buf, len);
+    }
+};
+
+/**
+ * @brief Byte access to any Stream through its virtual functions, used by the host build.
+ */
+template <>
+struct MidiTransport<Stream>
+{
+    static inline int available(Stream &port)
+    {
+        return port.available();
+    }
+
+    static inline int read(Stream &port)
+    {
+        return port.read();
+    }
+
+    static inline int availableForWrite(Stream &port)
+    {
+        return port.availableForWrite();
+    }
+
+    static inline size_t write(Stream &port, const uint8_t *buf, size_t len)
+    {
+        return port.write(buf, len);
+    }
+};
+
+#if !defined(ARDUINO_HOST) && (defined(__AVR__) || defined(ARDUINO_ARCH_RP2040) || defined(ARDUINO_ARCH_RP2350) || defined(ARDUINO_XIAO_RA4M1))
+/**
+ * @brief Byte access to SoftwareSerial.
+ *        SoftwareSerial does not implement availableForWrite() on every core, the qualified call would reach Print
+ *        and return 0. A write of the AVR version blocks until the byte is out, so the port is reported as free.
+ */
+template <>
+struct MidiTransport<SoftwareSerial>
+{
+    static inline int available(SoftwareSerial &port)
+    {
+        return port.available();
+    }
+
+    static inline int read(SoftwareSerial &port)
+    {
+        return port.read();
+    }
+
+    static inline int availableForWrite(SoftwareSerial &port)
+    {
+        (void)port;
+        return 1;
+    }
+
+    static inline size_t write(SoftwareSerial &port, const uint8_t *buf, size_t len)
+    {
+        return port.write(buf, len);
+    }
+};
+#endif
+
+typedef MidiTransport<midi_com_port_t> MidiCom;
+
+
+#endif /* MIDI_TRANSPORT_H */
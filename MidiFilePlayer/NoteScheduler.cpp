@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file NoteScheduler.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Implementation of the note off scheduler.
+ *        The heap is an array, the children of entry i are 2i + 1 and 2i + 2, entry 0 is released first.
+ *        Release times are compared as signed differences, so the wrap of micros() does not matter.
+ */
+
+
+#include "NoteScheduler.h"
+
+#include <stddef.h>
+
+
+struct note_sched_entry_s
+{
+    uint32_t offUs;
+    uint8_t channel;
+    uint8_t note;
+};
+
+
+static note_sched_cb schedNoteOn = NULL;
+static note_sched_cb schedNoteOff = NULL;
+
+static struct note_sched_entry_s schedHeap[NOTE_SCHED_MAX];
+static uint8_t schedCount = 0;
+
+static struct note_sched_stats_s schedStats;
+
+
+static inline bool sched_before(const struct note_sched_entry_s *a, const struct note_sched_entry_s *b)
+{
+    return (int32_t)(a->offUs - b->offUs) < 0;
+}
+
+static void sched_swap(uint8_t a, uint8_t b)
+{
+    struct note_sched_entry_s tmp = schedHeap[a];
+    schedHeap[a] = schedHeap[b];
+    schedHeap[b] = tmp;
+}
+
+static void sched_sift_up(uint8_t idx)
+{
+    while (idx > 0)
+    {
+        uint8_t parent = (idx - 1U) / 2U;
+        if (!sched_before(&schedHeap[idx], &schedHeap[parent]))
+        {
+            break;
+        }
+        sched_swap(idx, parent);
+        idx = parent;
+    }
+}
+
+static void sched_sift_down(uint8_t idx)
+{
+    for (;;)
+    {
+        uint8_t first = idx;
+        uint8_t left = 2U * idx + 1U;
+        uint8_t right = left + 1U;
+        if (left < schedCount && sched_before(&schedHeap[left], &schedHeap[first]))
+        {
+            first = left;
+        }
+        if (right < schedCount && sched_before(&schedHeap[right], &schedHeap[first]))
+        {
+            first = right;
+        }
+        if (first == idx)
+        {
+            break;
+        }
+        sched_swap(idx, first);
+        idx = first;
+    }
+}
+
+static void sched_pop(uint32_t nowUs)
+{
+    struct note_sched_entry_s e = schedHeap[0];
+    schedCount--;
+    if (schedCount > 0)
+    {
+        schedHeap[0] = schedHeap[schedCount];
+        sched_sift_down(0);
+    }
+
+    int32_t late = (int32_t)(nowUs - e.offUs);
+    if (late > 0 && (uint32_t)late > schedStats.lateMaxUs)
+    {
+        schedStats.lateMaxUs = (uint32_t)late;
+    }
+    schedNoteOff(e.channel, e.note, 0);
+}
+
+/**
+ * @brief Initialize the scheduler, nothing is pending.
+ * @param noteOn Called to start a note
+ * @param noteOff Called to stop a note
+ */
+void note_sched_init(note_sched_cb noteOn, note_sched_cb noteOff)
+{
+    schedNoteOn = noteOn;
+    schedNoteOff = noteOff;
+    schedCount = 0;
+    schedStats = {};
+}
+
+/**
+ * @brief Start a note and schedule its note off.
+ * @param channel MIDI channel 0 - 15
+ * @param note Key
+ * @param velocity Velocity of the note on
+ * @param lengthMs Time until the note off, at most NOTE_SCHED_MAX_MS
+ * @param nowUs Current time in microseconds
+ */
+void note_sched_play(uint8_t channel, uint8_t note, uint8_t velocity, uint32_t lengthMs, uint32_t nowUs)
+{
+    if (schedNoteOn == NULL)
+    {
+        return;
+    }
+    if (lengthMs > NOTE_SCHED_MAX_MS)
+    {
+        lengthMs = NOTE_SCHED_MAX_MS;
+    }
+    uint32_t offUs = nowUs + lengthMs * 1000U;
+
+    uint8_t idx = 0;
+    while (idx < schedCount && (schedHeap[idx].channel != channel || schedHeap[idx].note != note))
+    {
+        idx++;
+    }
+
+    if (idx < schedCount)
+    {
+        /* retriggered, the new length counts */
+        schedHeap[idx].offUs = offUs;
+        sched_sift_up(idx);
+        sched_sift_down(idx);
+    }
+    else
+    {
+        if (schedCount >= NOTE_SCHED_MAX)
+        {
+            sched_pop(nowUs);
+            schedStats.stolen++;
+        }
+        idx = schedCount++;
+        schedHeap[idx] = {offUs, channel, note};
+        sched_sift_up(idx);
+    }
+
+    if (schedCount > schedStats.peak)
+    {
+        schedStats.peak = schedCount;
+    }
+    schedStats.played++;
+    schedNoteOn(channel, note, velocity);
+}
+
+/**
+ * @brief Bring the note offs of a channel forward, notes ending earlier keep their time.
+ * @param channel MIDI channel 0 - 15
+ * @param afterMs Time from now until the notes are released, 0 releases them with the next note_sched_loop()
+ * @param nowUs Current time in microseconds
+ */
+void note_sched_release(uint8_t channel, uint32_t afterMs, uint32_t nowUs)
+{
+    struct note_sched_entry_s limit = {nowUs + afterMs * 1000U, channel, 0};
+
+    /* sifting up only swaps with entries at lower indices, which have been visited already */
+    for (uint8_t idx = 0; idx < schedCount; idx++)
+    {
+        if (schedHeap[idx].channel == channel && sched_before(&limit, &schedHeap[idx]))
+        {
+            schedHeap[idx].offUs = limit.offUs;
+            sched_sift_up(idx);
+        }
+    }
+}
+
+/**
+ * @brief Send all note offs which are due.
+ * @param nowUs Current time in microseconds
+ */
+void note_sched_loop(uint32_t nowUs)
+{
+    while (schedCount > 0 && (int32_t)(nowUs - schedHeap[0].offUs) >= 0)
+    {
+        sched_pop(nowUs);
+    }
+}
+
+/**
+ * @brief Release time of the next note off, a loop which sleeps has to call note_sched_loop() then.
+ * @param dueUs Receives the time in microseconds
+ * @return false if no note off is pending
+ */
+bool note_sched_next_us(uint32_t *dueUs)
+{
+    if (schedCount == 0)
+    {
+        return false;
+    }
+    *dueUs = schedHeap[0].offUs;
+    return true;
+}
+
+/**
+ * @brief Get the counters of the scheduler.
+ * @param stats Filled with the counters
+ */
+void note_sched_get_stats(struct note_sched_stats_s *stats)
+{
+    *stats = schedStats;
+    stats->pending = schedCount;
+}
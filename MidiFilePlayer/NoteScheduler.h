@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file NoteScheduler.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Notes with a length: note_sched_play() starts a note and its note off is sent by note_sched_loop() when it is due.
+ *        Pending note offs are kept in a min-heap of fixed size ordered by release time,
+ *        note_sched_loop() returns after one compare when nothing is due.
+ *        A note which is played again while pending keeps a single entry, the new length replaces the old one.
+ *        When the heap is full the note ending first is released early to make room.
+ */
+
+
+#ifndef NOTE_SCHEDULER_H
+#define NOTE_SCHEDULER_H
+
+
+#include <stdint.h>
+
+
+#define NOTE_SCHED_MAX          32U         /* pending note offs */
+#define NOTE_SCHED_MAX_MS       60000U      /* longer notes are cut to this length */
+
+
+typedef void (*note_sched_cb)(uint8_t channel, uint8_t note, uint8_t velocity);
+
+struct note_sched_stats_s
+{
+    uint8_t pending;
+    uint8_t peak;       /* most note offs pending at the same time */
+    uint32_t played;
+    uint32_t stolen;    /* released early because the heap was full */
+    uint32_t lateMaxUs; /* longest delay of a note off after its release time */
+};
+
+
+void note_sched_init(note_sched_cb noteOn, note_sched_cb noteOff);
+void note_sched_play(uint8_t channel, uint8_t note, uint8_t velocity, uint32_t lengthMs, uint32_t nowUs);
+void note_sched_release(uint8_t channel, uint32_t afterMs, uint32_t nowUs);
+void note_sched_loop(uint32_t nowUs);
+bool note_sched_next_us(uint32_t *dueUs);
+void note_sched_get_stats(struct note_sched_stats_s *stats);
+
+
+#endif /* NOTE_SCHEDULER_H */
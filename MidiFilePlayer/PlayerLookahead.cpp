@@ -0,0 +1,379 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file PlayerLookahead.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Implementation of the lookahead of the file player.
+ *        Events are kept in a byte ring as length (1), song time (4) and message, so a record may wrap.
+ *        Song time plus the offset gives the time on the clock, times are compared as signed differences.
+ */
+
+
+#include <Arduino.h>
+
+#include "MidiOut.h"
+#include "PlayerLookahead.h"
+
+
+#define LA_HDR_SIZE         5U
+#define LA_STEP_US          1000U   /* the player counts in milliseconds */
+#define LA_CATCH_UP_MS      100U    /* after a blocked loop the player is advanced in one call, its events are late anyway */
+
+
+struct la_burst_s
+{
+    uint32_t songUs;
+    uint16_t bytes;
+    uint16_t leadUs;    /* arrival of the burst after its first byte, depends on the alignment */
+};
+
+
+static void (*laAdvance)(uint32_t elapsedMs) = NULL;
+static uint32_t laWindowUs = LOOKAHEAD_MS * 1000U;
+static uint8_t laAlign = LOOKAHEAD_ALIGN_MEAN;
+static uint32_t laSongUs = 0;   /* song time the player has been advanced to */
+static uint32_t laOffsetUs = 0; /* clock minus song time, grows while the merger holds the player */
+static uint32_t laLastUs = 0;
+static bool laAdvancing = false;
+
+static uint8_t laBuf[LOOKAHEAD_BUF_SIZE];
+static uint16_t laHead = 0;
+static uint16_t laTail = 0;
+static uint16_t laUsed = 0;
+
+static uint16_t laHighWater = 0;
+static uint32_t laMessages = 0;
+static int64_t laErrorSumUs = 0;
+static uint64_t laErrorAbsSumUs = 0;
+static uint32_t laLateMaxUs = 0;
+static uint32_t laEarlyMaxUs = 0;
+static uint32_t laOverflows = 0;
+
+
+static uint8_t la_byte(uint16_t off)
+{
+    return laBuf[(laTail + off) % LOOKAHEAD_BUF_SIZE];
+}
+
+static uint32_t la_song_us(uint16_t off)
+{
+    return (uint32_t)la_byte(off + 1U) | ((uint32_t)la_byte(off + 2U) << 8U) | ((uint32_t)la_byte(off + 3U) << 16U) | ((uint32_t)la_byte(off + 4U) << 24U);
+}
+
+static void la_put(uint8_t b)
+{
+    laBuf[laHead] = b;
+    laHead = (laHead + 1U) % LOOKAHEAD_BUF_SIZE;
+}
+
+/**
+ * @brief Get the oldest burst, all waiting events with the same song time.
+ * @param burst Filled with time, bytes and lead
+ * @return Number of messages, 0 if nothing waits
+ */
+static uint16_t la_burst(struct la_burst_s *burst)
+{
+    uint16_t count = 0;
+    uint32_t arrivalSum = 0;
+    burst->bytes = 0;
+    for (uint16_t off = 0; off < laUsed; off += LA_HDR_SIZE + la_byte(off))
+    {
+        uint32_t songUs = la_song_us(off);
+        if (count == 0)
+        {
+            burst->songUs = songUs;
+        }
+        else if (songUs != burst->songUs)
+        {
+            break;
+        }
+        count++;
+        burst->bytes += la_byte(off);
+        arrivalSum += burst->bytes;
+    }
+    if (count > 0)
+    {
+        uint32_t bytes = (laAlign == LOOKAHEAD_ALIGN_END) ? burst->bytes : (arrivalSum + count / 2U) / count;
+        burst->leadUs = (uint16_t)(bytes * MIDI_OUT_BYTE_US);
+    }
+    return count;
+}
+
+/**
+ * @brief Count the onset error of a message.
+ * @param dueUs Time of the event
+ * @param arrivalUs Estimated time its last byte reaches the synth
+ */
+static void la_count(uint32_t dueUs, uint32_t arrivalUs)
+{
+    int32_t errorUs = (int32_t)(arrivalUs - dueUs);
+    laMessages++;
+    laErrorSumUs += errorUs;
+    if (errorUs >= 0)
+    {
+        laErrorAbsSumUs += (uint32_t)errorUs;
+        if ((uint32_t)errorUs > laLateMaxUs)
+        {
+            laLateMaxUs = (uint32_t)errorUs;
+        }
+    }
+    else
+    {
+        laErrorAbsSumUs += (uint32_t)-errorUs;
+        if ((uint32_t)-errorUs > laEarlyMaxUs)
+        {
+            laEarlyMaxUs = (uint32_t)-errorUs;
+        }
+    }
+}
+
+/**
+ * @brief Pass the oldest burst to the output merger.
+ */
+static void la_send_burst(void)
+{
+    struct la_burst_s burst;
+    uint16_t count = la_burst(&burst);
+    uint32_t dueUs = burst.songUs + laOffsetUs;
+    uint32_t arrivalUs = micros() + midi_out_busy_us();
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        uint8_t msg[LOOKAHEAD_MSG_MAX];
+        uint8_t len = la_byte(0);
+        for (uint8_t j = 0; j < len; j++)
+        {
+            msg[j] = la_byte(LA_HDR_SIZE + j);
+        }
+        laTail = (laTail + LA_HDR_SIZE + len) % LOOKAHEAD_BUF_SIZE;
+        laUsed -= LA_HDR_SIZE + len;
+
+        arrivalUs += len * MIDI_OUT_BYTE_US;
+        la_count(dueUs, arrivalUs);
+        midi_out_write(MIDI_OUT_SRC_PLAYER, msg, len);
+    }
+    if (laUsed == 0)
+    {
+        laHead = 0;
+        laTail = 0;
+    }
+}
+
+/**
+ * @brief Set the player and start the song time at the current time.
+ * @param advance Advances the player by the given time, its events are passed to lookahead_write()
+ */
+void lookahead_init(void (*advance)(uint32_t elapsedMs))
+{
+    laAdvance = advance;
+    laLastUs = micros();
+    laOffsetUs = laLastUs;
+    laSongUs = 0;
+    laHead = 0;
+    laTail = 0;
+    laUsed = 0;
+    lookahead_reset_stats();
+}
+
+/**
+ * @brief Set the window and the alignment of bursts.
+ * @param windowMs Time the player runs ahead of the clock, 0 to send every event when the player reaches it
+ * @param align See lookahead_align_e
+ */
+void lookahead_set(uint16_t windowMs, uint8_t align)
+{
+    if (windowMs > LOOKAHEAD_MS_MAX)
+    {
+        windowMs = LOOKAHEAD_MS_MAX;
+    }
+    laWindowUs = windowMs * 1000U;
+    if (align < LOOKAHEAD_ALIGN_COUNT)
+    {
+        laAlign = align;
+    }
+    if (windowMs == 0)
+    {
+        lookahead_flush();
+    }
+}
+
+/**
+ * @brief Advance the player up to the window ahead of the clock and send bursts which are due, called by the loop.
+ * @param nowUs Current time in microseconds
+ * @param hold true while the merger holds the player (midi_out_hold()), the song time stands still
+ */
+void lookahead_loop(uint32_t nowUs, bool hold)
+{
+    uint32_t elapsedUs = nowUs - laLastUs;
+    laLastUs = nowUs;
+
+    if (hold)
+    {
+        laOffsetUs += elapsedUs;
+    }
+    else if (laAdvance != NULL)
+    {
+        laAdvancing = true;
+        uint32_t behindMs = (nowUs - (laOffsetUs + laSongUs)) / 1000U;
+        if ((int32_t)(nowUs - (laOffsetUs + laSongUs)) > 0 && behindMs > LA_CATCH_UP_MS)
+        {
+            laSongUs += behindMs * 1000U;
+            laAdvance(behindMs);
+        }
+        while ((int32_t)(nowUs + laWindowUs - (laOffsetUs + laSongUs + LA_STEP_US)) >= 0)
+        {
+            laSongUs += LA_STEP_US;
+            laAdvance(1);
+            if (midi_out_hold(MIDI_OUT_SRC_PLAYER))
+            {
+                /* a SysEx of the song is sent, the synth gets its pause first */
+                break;
+            }
+        }
+        laAdvancing = false;
+    }
+
+    struct la_burst_s burst;
+    while (la_burst(&burst) > 0)
+    {
+        uint32_t dueUs = burst.songUs + laOffsetUs;
+        if ((int32_t)(nowUs + midi_out_busy_us() + burst.leadUs - dueUs) < 0)
+        {
+            break;
+        }
+        la_send_burst();
+    }
+}
+
+/**
+ * @brief Queue an event of the player, events written while it is not advanced are due right away.
+ * @param msg Message
+ * @param len Length of message
+ */
+void lookahead_write(const uint8_t *msg, uint16_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+    uint32_t songUs = laAdvancing ? laSongUs : micros() - laOffsetUs;
+
+    if (laWindowUs == 0 || len > LOOKAHEAD_MSG_MAX)
+    {
+        /* not planned, the waiting events stay in front of it */
+        lookahead_flush();
+        la_count(songUs + laOffsetUs, micros() + midi_out_busy_us() + len * MIDI_OUT_BYTE_US);
+        midi_out_write(MIDI_OUT_SRC_PLAYER, msg, len);
+        return;
+    }
+
+    while (laUsed + LA_HDR_SIZE + len > LOOKAHEAD_BUF_SIZE)
+    {
+        la_send_burst();
+        laOverflows++;
+    }
+    la_put((uint8_t)len);
+    la_put(songUs & 0xFFU);
+    la_put((songUs >> 8U) & 0xFFU);
+    la_put((songUs >> 16U) & 0xFFU);
+    la_put(songUs >> 24U);
+    for (uint16_t i = 0; i < len; i++)
+    {
+        la_put(msg[i]);
+    }
+    laUsed += LA_HDR_SIZE + len;
+    if (laUsed > laHighWater)
+    {
+        laHighWater = laUsed;
+    }
+}
+
+/**
+ * @brief Send all waiting events now, before a reset, a new song or a message which is not planned.
+ */
+void lookahead_flush(void)
+{
+    while (laUsed > 0)
+    {
+        la_send_burst();
+    }
+}
+
+/**
+ * @brief Get the time at which events written now are due, the song time of the current step on the clock.
+ * @return Time in microseconds
+ */
+uint32_t lookahead_due_us(void)
+{
+    return (laAdvancing ? laSongUs : micros() - laOffsetUs) + laOffsetUs;
+}
+
+/**
+ * @brief Get the time up to which the player has been advanced, its later events are not known yet.
+ * @return Time in microseconds
+ */
+uint32_t lookahead_horizon_us(void)
+{
+    return laOffsetUs + laSongUs;
+}
+
+/**
+ * @brief Get the time the oldest burst has to be sent, for the idle of the loop.
+ * @param dueUs Time in microseconds
+ * @return false if no event waits
+ */
+bool lookahead_next_us(uint32_t *dueUs)
+{
+    struct la_burst_s burst;
+    if (la_burst(&burst) == 0)
+    {
+        return false;
+    }
+    *dueUs = burst.songUs + laOffsetUs - burst.leadUs - midi_out_busy_us();
+    return true;
+}
+
+/**
+ * @brief Get settings and onset error since the last reset.
+ * @param stats Filled with the values
+ */
+void lookahead_get_stats(struct lookahead_stats_s *stats)
+{
+    stats->windowMs = (uint16_t)(laWindowUs / 1000U);
+    stats->align = laAlign;
+    stats->highWater = laHighWater;
+    stats->messages = laMessages;
+    stats->errorMeanUs = laMessages ? (int32_t)(laErrorSumUs / (int64_t)laMessages) : 0;
+    stats->errorAbsUs = laMessages ? (uint32_t)(laErrorAbsSumUs / laMessages) : 0U;
+    stats->lateMaxUs = laLateMaxUs;
+    stats->earlyMaxUs = laEarlyMaxUs;
+    stats->overflows = laOverflows;
+}
+
+void lookahead_reset_stats(void)
+{
+    laHighWater = laUsed;
+    laMessages = 0;
+    laErrorSumUs = 0;
+    laErrorAbsSumUs = 0;
+    laLateMaxUs = 0;
+    laEarlyMaxUs = 0;
+    laOverflows = 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file PlayerLookahead.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Lookahead of the file player which takes the time on the wire into account.
+ *        At 31250 baud a chord of eight notes needs 7.7 ms, sent when the player reaches it the last note
+ *        arrives that much late. The player is advanced up to the window ahead of the clock, one millisecond per step,
+ *        its events are kept with the time of their step. Events of the same time form a burst, it is passed
+ *        to the output merger as soon as the estimated arrival at the synth reaches its time:
+ *        the wire time of everything queued before (midi_out_busy_us()) plus the bytes of the burst.
+ *        LOOKAHEAD_ALIGN_MEAN puts the mean arrival of the burst at its time, LOOKAHEAD_ALIGN_END its last byte.
+ *        While the merger holds the player the song time stands still, the waiting events move with it.
+ *        A window of 0 passes every event on when the player reaches it, like without the lookahead.
+ *        The estimated arrival minus the time of the event is counted as onset error for both.
+ *        With several synth ports the busiest one is taken and a burst is estimated as if it went out on one line.
+ */
+
+
+#ifndef PLAYER_LOOKAHEAD_H
+#define PLAYER_LOOKAHEAD_H
+
+
+#include <stdint.h>
+
+
+#define LOOKAHEAD_MS            10U     /* default window */
+#define LOOKAHEAD_MS_MAX        100U
+#define LOOKAHEAD_BUF_SIZE      1024U   /* events waiting for their time, a full buffer sends the oldest burst early */
+#define LOOKAHEAD_MSG_MAX       64U     /* longer messages (SysEx) are sent right away after the waiting events */
+
+
+enum lookahead_align_e
+{
+    LOOKAHEAD_ALIGN_MEAN,   /* early and late notes of a burst balance */
+    LOOKAHEAD_ALIGN_END,    /* no note of a burst is late while the line is free */
+    LOOKAHEAD_ALIGN_COUNT,
+};
+
+struct lookahead_stats_s
+{
+    uint16_t windowMs;
+    uint8_t align;
+    uint16_t highWater;     /* bytes waiting */
+    uint32_t messages;
+    int32_t errorMeanUs;    /* estimated arrival minus time of the event, negative is early */
+    uint32_t errorAbsUs;    /* mean of the absolute error */
+    uint32_t lateMaxUs;
+    uint32_t earlyMaxUs;
+    uint32_t overflows;     /* bursts sent early because the buffer was full */
+};
+
+
+void lookahead_init(void (*advance)(uint32_t elapsedMs));
+void lookahead_set(uint16_t windowMs, uint8_t align);
+void lookahead_loop(uint32_t nowUs, bool hold);
+void lookahead_write(const uint8_t *msg, uint16_t len);
+void lookahead_flush(void);
+uint32_t lookahead_due_us(void);
+uint32_t lookahead_horizon_us(void);
+bool lookahead_next_us(uint32_t *dueUs);
+void lookahead_get_stats(struct lookahead_stats_s *stats);
+void lookahead_reset_stats(void);
+
+
+#endif /* PLAYER_LOOKAHEAD_H */
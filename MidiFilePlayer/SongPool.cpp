@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file SongPool.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Implementation of the song buffer.
+ *        On cores other than ESP32 there is no heap information, the buffer is taken with malloc() without a reserve check.
+ */
+
+
+#include "SongPool.h"
+
+#include <Arduino.h>
+#include <stdlib.h>
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <esp_heap_caps.h>
+#endif
+
+
+#ifdef STATIC_ALLOC_MODE
+static uint8_t songPoolArena[SONG_POOL_STATIC_SIZE];
+#endif
+
+static uint8_t *songBuffer = NULL;
+static uint32_t songCapacity = 0;
+static uint32_t songSize = 0;
+static enum song_pool_source_e songSource = SONG_POOL_NONE;
+static uint32_t songRejected = 0;
+
+
+static bool song_pool_has_psram(void)
+{
+#if defined(ARDUINO_ARCH_ESP32)
+    return psramFound();
+#else
+    return false;
+#endif
+}
+
+#ifndef STATIC_ALLOC_MODE
+
+/* largest internal buffer which keeps SONG_POOL_HEAP_RESERVE free, the current buffer counts as free */
+static uint32_t song_pool_internal_available(void)
+{
+#if defined(ARDUINO_ARCH_ESP32)
+    uint32_t own = (songSource == SONG_POOL_INTERNAL) ? songCapacity : 0U;
+    uint32_t freeBytes = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT) + own;
+    uint32_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (own > largest)
+    {
+        largest = own;
+    }
+    if (freeBytes <= SONG_POOL_HEAP_RESERVE)
+    {
+        return 0;
+    }
+    return (largest < freeBytes - SONG_POOL_HEAP_RESERVE) ? largest : (freeBytes - SONG_POOL_HEAP_RESERVE);
+#else
+    return songCapacity;
+#endif
+}
+
+static uint8_t *song_pool_alloc(uint32_t size, enum song_pool_source_e *source)
+{
+#if defined(ARDUINO_ARCH_ESP32)
+    if (song_pool_has_psram())
+    {
+        uint8_t *buf = (uint8_t *)heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (buf != NULL)
+        {
+            *source = SONG_POOL_PSRAM;
+            return buf;
+        }
+    }
+    if (size > song_pool_internal_available())
+    {
+        return NULL;
+    }
+    *source = SONG_POOL_INTERNAL;
+    return (uint8_t *)heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+#else
+    *source = SONG_POOL_INTERNAL;
+    return (uint8_t *)malloc(size);
+#endif
+}
+
+#endif
+
+/**
+ * @brief Get a buffer for a song, the data of the previous song becomes invalid.
+ *        The player must not access the previous song data any more, also when NULL is returned.
+ * @param size Size of the song in bytes
+ * @return Buffer of at least size bytes, NULL if the song does not fit
+ */
+uint8_t *song_pool_acquire(uint32_t size)
+{
+    songSize = 0;
+
+#ifdef STATIC_ALLOC_MODE
+    songBuffer = songPoolArena;
+    songCapacity = sizeof(songPoolArena);
+    songSource = SONG_POOL_STATIC;
+#else
+    uint32_t need = (size + SONG_POOL_GRANULE - 1U) / SONG_POOL_GRANULE * SONG_POOL_GRANULE;
+    if (need == 0)
+    {
+        need = SONG_POOL_GRANULE;
+    }
+
+    /* keep the buffer for a song of a similar size, a much smaller song gives memory back */
+    if (songBuffer == NULL || need > songCapacity || songCapacity > 2U * need)
+    {
+        song_pool_release();
+        songBuffer = song_pool_alloc(need, &songSource);
+        songCapacity = (songBuffer != NULL) ? need : 0U;
+        if (songBuffer == NULL)
+        {
+            songSource = SONG_POOL_NONE;
+        }
+    }
+#endif
+
+    if (songBuffer == NULL || size > songCapacity)
+    {
+        songRejected++;
+        return NULL;
+    }
+    songSize = size;
+    return songBuffer;
+}
+
+/**
+ * @brief Give the buffer back, the data becomes invalid.
+ */
+void song_pool_release(void)
+{
+#ifndef STATIC_ALLOC_MODE
+    free(songBuffer);
+    songBuffer = NULL;
+    songCapacity = 0;
+    songSource = SONG_POOL_NONE;
+#endif
+    songSize = 0;
+}
+
+/**
+ * @brief Get the size of the largest song which can be loaded now.
+ * @return Bytes
+ */
+uint32_t song_pool_available(void)
+{
+#ifdef STATIC_ALLOC_MODE
+    return SONG_POOL_STATIC_SIZE;
+#else
+#if defined(ARDUINO_ARCH_ESP32)
+    if (song_pool_has_psram())
+    {
+        uint32_t own = (songSource == SONG_POOL_PSRAM) ? songCapacity : 0U;
+        uint32_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        return (own > largest) ? own : largest;
+    }
+#endif
+    return song_pool_internal_available();
+#endif
+}
+
+/**
+ * @brief Get the state of the song buffer.
+ * @param stats Filled with the current values
+ */
+void song_pool_get_stats(struct song_pool_stats_s *stats)
+{
+    stats->songSize = songSize;
+    stats->capacity = songCapacity;
+    stats->source = songSource;
+    stats->available = song_pool_available();
+    stats->rejected = songRejected;
+}
+
+/**
+ * @brief Get a printable name of a buffer source.
+ * @param source Source
+ * @return Name
+ */
+const char *song_pool_source_name(enum song_pool_source_e source)
+{
+    switch (source)
+    {
+    case SONG_POOL_STATIC:
+        return "static";
+    case SONG_POOL_INTERNAL:
+        return "heap";
+    case SONG_POOL_PSRAM:
+        return "psram";
+    default:
+        break;
+    }
+    return "none";
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file SongPool.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Buffer for the data of the current song, sized per song.
+ *        The buffer is taken from PSRAM when the board has it (ESP32-S3), otherwise from the heap,
+ *        keeping SONG_POOL_HEAP_RESERVE bytes free for the rest of the system. Sizes are rounded up to SONG_POOL_GRANULE,
+ *        so the buffer is kept for songs of a similar size.
+ *        With STATIC_ALLOC_MODE the buffer is a static arena of SONG_POOL_STATIC_SIZE bytes instead.
+ *        A song which does not fit is reported and not played, it is never cut off.
+ */
+
+
+#ifndef SONG_POOL_H
+#define SONG_POOL_H
+
+
+#include <stdint.h>
+
+#include "StaticAlloc.h"
+
+
+#define SONG_POOL_STATIC_SIZE   (96U * 1024U)   /* arena of the static allocation mode */
+#define SONG_POOL_HEAP_RESERVE  (16U * 1024U)   /* internal heap left free after taking a song buffer */
+#define SONG_POOL_GRANULE       4096U
+
+
+enum song_pool_source_e
+{
+    SONG_POOL_NONE,
+    SONG_POOL_STATIC,
+    SONG_POOL_INTERNAL,
+    SONG_POOL_PSRAM,
+};
+
+struct song_pool_stats_s
+{
+    uint32_t songSize; /* bytes used by the current song */
+    uint32_t capacity; /* size of the buffer */
+    enum song_pool_source_e source;
+    uint32_t available; /* largest song which can be loaded now */
+    uint32_t rejected; /* songs which did not fit */
+};
+
+
+uint8_t *song_pool_acquire(uint32_t size);
+void song_pool_release(void);
+uint32_t song_pool_available(void);
+void song_pool_get_stats(struct song_pool_stats_s *stats);
+const char *song_pool_source_name(enum song_pool_source_e source);
+
+
+#endif /* SONG_POOL_H */
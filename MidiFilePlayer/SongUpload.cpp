@@ -0,0 +1,575 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file SongUpload.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Implementation of the song upload.
+ *        The loop fills the blocks, upload_process() empties them. Like in the recorder the ready flag of a block
+ *        passes it between both sides, the state is only set to done or failed by upload_process() after the file has been closed.
+ *        The needed quiet time is the longest write seen so far, it decays by an eighth per write, so a single slow erase
+ *        does not hold back the rest of the upload.
+ */
+
+
+#include "SongUpload.h"
+
+#include <Arduino.h>
+
+
+#define UPLOAD_CRC16_INIT   0xFFFFU
+
+
+enum upload_rx_e
+{
+    UPLOAD_RX_SYNC,
+    UPLOAD_RX_SEQ,
+    UPLOAD_RX_LEN_LO,
+    UPLOAD_RX_LEN_HI,
+    UPLOAD_RX_PAYLOAD,
+    UPLOAD_RX_CRC_LO,
+    UPLOAD_RX_CRC_HI,
+};
+
+struct upload_block_s
+{
+    uint8_t data[UPLOAD_BLOCK_SIZE];
+    uint16_t count;
+    bool last; /* completes the file, it is closed after the write */
+    volatile bool ready; /* full, waiting for upload_process() */
+};
+
+
+static void (*upWakeup)(void) = NULL;
+
+static struct upload_block_s upBlocks[UPLOAD_BLOCKS];
+static uint8_t upFillIdx = 0; /* loop side */
+static uint8_t upFlushIdx = 0; /* upload_process() side */
+static volatile enum upload_state_e upState = UPLOAD_IDLE;
+static volatile enum upload_error_e upError = UPLOAD_ERR_NONE;
+static volatile bool upAbort = false;
+static File upFile;
+
+/* frame parser, loop side */
+static uint8_t upRxState = UPLOAD_RX_SYNC;
+static uint8_t upRxSeq = 0;
+static uint16_t upRxLen = 0;
+static uint16_t upRxPos = 0;
+static uint16_t upRxCrc = 0;
+static uint16_t upRxCrcIn = 0;
+static uint8_t upFrame[UPLOAD_FRAME_MAX];
+static uint8_t upSeq = 0; /* next expected frame */
+static uint32_t upSize = 0;
+static uint32_t upCrcExpected = 0;
+static uint32_t upCrc = 0;
+static uint32_t upReceived = 0;
+static uint32_t upStartUs = 0;
+static uint32_t upLastFrameUs = 0;
+static uint32_t upFrames = 0;
+static uint32_t upNaks = 0;
+static uint32_t upSkipped = 0;
+
+/* writer side */
+static uint32_t upWritten = 0;
+static uint32_t upEndUs = 0;
+static uint32_t upBlocksWritten = 0;
+static uint32_t upWriteLastUs = 0;
+static uint32_t upWriteMaxUs = 0;
+static uint64_t upWriteSumUs = 0;
+static uint32_t upWriteEstUs = UPLOAD_WRITE_US;
+static bool upWaiting = false;
+static uint32_t upWaitSinceUs = 0;
+static uint64_t upDeferredUs = 0;
+static uint32_t upForced = 0;
+
+
+/**
+ * @brief Update a CRC-16/CCITT (polynomial 0x1021, not reflected), start with 0xFFFF.
+ * @param crc Current value
+ * @param data Data
+ * @param len Length of data
+ * @return New value
+ */
+uint16_t upload_crc16(uint16_t crc, const uint8_t *data, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8U;
+        for (uint8_t bit = 0; bit < 8U; bit++)
+        {
+            crc = (crc & 0x8000U) ? (uint16_t)((crc << 1U) ^ 0x1021U) : (uint16_t)(crc << 1U);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief Update a CRC-32 (IEEE 802.3, like zip), start with 0.
+ * @param crc Current value
+ * @param data Data
+ * @param len Length of data
+ * @return New value
+ */
+uint32_t upload_crc32(uint32_t crc, const uint8_t *data, uint32_t len)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8U; bit++)
+        {
+            crc = (crc & 1U) ? ((crc >> 1U) ^ 0xEDB88320U) : (crc >> 1U);
+        }
+    }
+    return ~crc;
+}
+
+/* a frame fits into the block being filled or the next one is free */
+static bool upload_room(void)
+{
+    const struct upload_block_s *fill = &upBlocks[upFillIdx];
+    if (__atomic_load_n(&fill->ready, __ATOMIC_ACQUIRE))
+    {
+        return false;
+    }
+    if (UPLOAD_BLOCK_SIZE - fill->count >= UPLOAD_FRAME_MAX)
+    {
+        return true;
+    }
+    return !__atomic_load_n(&upBlocks[(upFillIdx + 1U) % UPLOAD_BLOCKS].ready, __ATOMIC_ACQUIRE);
+}
+
+static void upload_block_ready(struct upload_block_s *block, bool last)
+{
+    block->last = last;
+    __atomic_store_n(&block->ready, true, __ATOMIC_RELEASE);
+    upFillIdx = (upFillIdx + 1U) % UPLOAD_BLOCKS;
+    if (upWakeup != NULL)
+    {
+        upWakeup();
+    }
+}
+
+/* copy an accepted payload into the blocks, upload_room() has been checked before the frame */
+static void upload_commit(const uint8_t *data, uint16_t len)
+{
+    upCrc = upload_crc32(upCrc, data, len);
+    upReceived += len;
+    while (len > 0)
+    {
+        struct upload_block_s *block = &upBlocks[upFillIdx];
+        uint16_t n = UPLOAD_BLOCK_SIZE - block->count;
+        if (n > len)
+        {
+            n = len;
+        }
+        memcpy(&block->data[block->count], data, n);
+        block->count += n;
+        data += n;
+        len -= n;
+
+        bool last = (len == 0 && upReceived == upSize);
+        if (block->count == UPLOAD_BLOCK_SIZE || last)
+        {
+            upload_block_ready(block, last);
+        }
+    }
+}
+
+static void upload_frame_end(Print &reply, uint32_t nowUs)
+{
+    if (upRxCrcIn != upRxCrc || upRxSeq != upSeq)
+    {
+        /* the sender continues with the expected frame */
+        upNaks++;
+        reply.printf("nak %u\n", upSeq);
+        return;
+    }
+    if (upRxLen > upSize - upReceived)
+    {
+        upNaks++;
+        upError = UPLOAD_ERR_ABORT;
+        upload_abort();
+        return;
+    }
+
+    upload_commit(upFrame, upRxLen);
+    upSeq++;
+    upFrames++;
+    upLastFrameUs = nowUs;
+    reply.printf("ack %u\n", upRxSeq);
+
+    if (upReceived == upSize)
+    {
+        __atomic_store_n(&upState, UPLOAD_WRITING, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * @brief Set the function which lets upload_process() run soon, called when a block is ready.
+ * @param wakeup Function, NULL when upload_process() is polled
+ */
+void upload_init(void (*wakeup)(void))
+{
+    upWakeup = wakeup;
+}
+
+/**
+ * @brief Start an upload, called from the loop.
+ * @param file File opened for writing, owned by the upload until it is done or failed
+ * @param size Size of the file in bytes
+ * @param crc CRC-32 of the file
+ * @param nowUs Time of the start
+ * @return true if started, false if an upload runs or the file is not open
+ */
+bool upload_start(File &file, uint32_t size, uint32_t crc, uint32_t nowUs)
+{
+    if (upState != UPLOAD_IDLE || !file || size == 0)
+    {
+        return false;
+    }
+
+    upFile = file;
+    upFillIdx = 0;
+    upFlushIdx = 0;
+    for (struct upload_block_s &block : upBlocks)
+    {
+        block.count = 0;
+        block.last = false;
+        block.ready = false;
+    }
+
+    upRxState = UPLOAD_RX_SYNC;
+    upSeq = 0;
+    upSize = size;
+    upCrcExpected = crc;
+    upCrc = 0;
+    upReceived = 0;
+    upStartUs = nowUs;
+    upLastFrameUs = nowUs;
+    upFrames = 0;
+    upNaks = 0;
+    upSkipped = 0;
+
+    upWritten = 0;
+    upEndUs = nowUs;
+    upBlocksWritten = 0;
+    upWriteLastUs = 0;
+    upWriteMaxUs = 0;
+    upWriteSumUs = 0;
+    upWaiting = false;
+    upDeferredUs = 0;
+    upForced = 0;
+
+    upAbort = false;
+    upError = UPLOAD_ERR_NONE;
+    __atomic_store_n(&upState, UPLOAD_RECEIVING, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief Parse received frames and reply to them, called from the loop while the upload receives.
+ *        Bytes are only read while a frame has room in the blocks, the rest stays in the serial buffer.
+ * @param in Serial port of the sender
+ * @param reply Port for the ack and nak lines
+ * @param nowUs Current time
+ * @return Number of bytes read
+ */
+uint32_t upload_receive(Stream &in, Print &reply, uint32_t nowUs)
+{
+    if (upState != UPLOAD_RECEIVING)
+    {
+        return 0;
+    }
+    if (!upload_room())
+    {
+        /* waiting for the flash is no timeout */
+        upLastFrameUs = nowUs;
+        return 0;
+    }
+
+    uint32_t count = 0;
+    while (upState == UPLOAD_RECEIVING && (upRxState != UPLOAD_RX_SYNC || upload_room()) && in.available() > 0)
+    {
+        uint8_t b = (uint8_t)in.read();
+        count++;
+
+        switch (upRxState)
+        {
+        case UPLOAD_RX_SYNC:
+            if (b == UPLOAD_SYNC)
+            {
+                upRxState = UPLOAD_RX_SEQ;
+            }
+            else
+            {
+                upSkipped++;
+            }
+            break;
+        case UPLOAD_RX_SEQ:
+            upRxSeq = b;
+            upRxCrc = upload_crc16(UPLOAD_CRC16_INIT, &b, 1);
+            upRxState = UPLOAD_RX_LEN_LO;
+            break;
+        case UPLOAD_RX_LEN_LO:
+            upRxLen = b;
+            upRxCrc = upload_crc16(upRxCrc, &b, 1);
+            upRxState = UPLOAD_RX_LEN_HI;
+            break;
+        case UPLOAD_RX_LEN_HI:
+            upRxLen |= (uint16_t)b << 8U;
+            upRxCrc = upload_crc16(upRxCrc, &b, 1);
+            upRxPos = 0;
+            if (upRxLen == 0 || upRxLen > UPLOAD_FRAME_MAX)
+            {
+                /* no frame, the sync byte was data */
+                upSkipped += 4U;
+                upRxState = UPLOAD_RX_SYNC;
+            }
+            else
+            {
+                upRxState = UPLOAD_RX_PAYLOAD;
+            }
+            break;
+        case UPLOAD_RX_PAYLOAD:
+            upFrame[upRxPos++] = b;
+            if (upRxPos == upRxLen)
+            {
+                upRxCrc = upload_crc16(upRxCrc, upFrame, upRxLen);
+                upRxState = UPLOAD_RX_CRC_LO;
+            }
+            break;
+        case UPLOAD_RX_CRC_LO:
+            upRxCrcIn = b;
+            upRxState = UPLOAD_RX_CRC_HI;
+            break;
+        case UPLOAD_RX_CRC_HI:
+            upRxCrcIn |= (uint16_t)b << 8U;
+            upRxState = UPLOAD_RX_SYNC;
+            upload_frame_end(reply, nowUs);
+            break;
+        default:
+            upRxState = UPLOAD_RX_SYNC;
+            break;
+        }
+    }
+
+    if (upState == UPLOAD_RECEIVING && nowUs - upLastFrameUs > UPLOAD_TIMEOUT_MS * 1000U)
+    {
+        upError = UPLOAD_ERR_TIMEOUT;
+        upload_abort();
+    }
+    return count;
+}
+
+/**
+ * @brief Write the next ready block if the quiet time covers the write, closes the file after the last one.
+ *        Called from a context of its own below the loop, or polled from the loop.
+ * @param quietUntilUs Time up to which the loop has nothing due
+ * @return true if something has been written
+ */
+bool upload_process(uint32_t quietUntilUs)
+{
+    enum upload_state_e state = __atomic_load_n(&upState, __ATOMIC_ACQUIRE);
+    if (state != UPLOAD_RECEIVING && state != UPLOAD_WRITING)
+    {
+        return false;
+    }
+
+    if (upAbort)
+    {
+        upFile.close();
+        if (upError == UPLOAD_ERR_NONE)
+        {
+            upError = UPLOAD_ERR_ABORT;
+        }
+        upEndUs = micros();
+        __atomic_store_n(&upState, UPLOAD_FAILED, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    struct upload_block_s *block = &upBlocks[upFlushIdx];
+    if (!__atomic_load_n(&block->ready, __ATOMIC_ACQUIRE))
+    {
+        return false;
+    }
+
+    uint32_t startUs = micros();
+    if (!upWaiting)
+    {
+        upWaiting = true;
+        upWaitSinceUs = startUs;
+    }
+    if ((int32_t)(quietUntilUs - startUs) < (int32_t)upWriteEstUs)
+    {
+        if (startUs - upWaitSinceUs < UPLOAD_STARVE_MS * 1000U)
+        {
+            return false;
+        }
+        upForced++;
+    }
+    upWaiting = false;
+    upDeferredUs += startUs - upWaitSinceUs;
+
+    bool ok = upFile.write(block->data, block->count) == block->count;
+    bool last = block->last;
+    if (last || !ok)
+    {
+        upFile.close();
+    }
+    uint32_t writeUs = micros() - startUs;
+
+    upWriteLastUs = writeUs;
+    upWriteSumUs += writeUs;
+    if (writeUs > upWriteMaxUs)
+    {
+        upWriteMaxUs = writeUs;
+    }
+    upWriteEstUs -= upWriteEstUs / 8U;
+    if (writeUs > upWriteEstUs)
+    {
+        upWriteEstUs = writeUs;
+    }
+    upBlocksWritten++;
+    if (ok)
+    {
+        upWritten += block->count;
+    }
+
+    block->count = 0;
+    block->last = false;
+    __atomic_store_n(&block->ready, false, __ATOMIC_RELEASE);
+    upFlushIdx = (upFlushIdx + 1U) % UPLOAD_BLOCKS;
+
+    if (!ok || last)
+    {
+        if (!ok)
+        {
+            upError = UPLOAD_ERR_WRITE;
+        }
+        else if (upCrc != upCrcExpected)
+        {
+            upError = UPLOAD_ERR_CRC;
+        }
+        upEndUs = micros();
+        __atomic_store_n(&upState, (upError == UPLOAD_ERR_NONE) ? UPLOAD_DONE : UPLOAD_FAILED, __ATOMIC_RELEASE);
+    }
+    return true;
+}
+
+/**
+ * @brief Check if upload_process() has something to do.
+ * @return true if a block waits or the upload is aborted
+ */
+bool upload_write_pending(void)
+{
+    enum upload_state_e state = __atomic_load_n(&upState, __ATOMIC_ACQUIRE);
+    if (state != UPLOAD_RECEIVING && state != UPLOAD_WRITING)
+    {
+        return false;
+    }
+    return upAbort || __atomic_load_n(&upBlocks[upFlushIdx].ready, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Abort the upload, the file is closed by upload_process().
+ */
+void upload_abort(void)
+{
+    enum upload_state_e state = upState;
+    if (state != UPLOAD_RECEIVING && state != UPLOAD_WRITING)
+    {
+        return;
+    }
+    upAbort = true;
+    if (upWakeup != NULL)
+    {
+        upWakeup();
+    }
+}
+
+/**
+ * @brief Return to idle after the loop has taken over the done or failed upload.
+ */
+void upload_finish(void)
+{
+    enum upload_state_e state = upState;
+    if (state == UPLOAD_DONE || state == UPLOAD_FAILED)
+    {
+        __atomic_store_n(&upState, UPLOAD_IDLE, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * @brief Get the state of the upload.
+ * @return State
+ */
+enum upload_state_e upload_state(void)
+{
+    return __atomic_load_n(&upState, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Get the statistics of the current or last upload.
+ * @param stats Filled with the current values
+ */
+void upload_get_stats(struct upload_stats_s *stats)
+{
+    stats->state = upload_state();
+    stats->error = upError;
+    stats->size = upSize;
+    stats->received = upReceived;
+    stats->written = upWritten;
+    stats->frames = upFrames;
+    stats->naks = upNaks;
+    stats->skipped = upSkipped;
+    bool running = (stats->state == UPLOAD_RECEIVING || stats->state == UPLOAD_WRITING);
+    stats->elapsedMs = ((running ? (uint32_t)micros() : upEndUs) - upStartUs) / 1000U;
+    stats->bytesPerSec = (stats->elapsedMs > 0) ? (uint32_t)((uint64_t)upWritten * 1000U / stats->elapsedMs) : 0U;
+    stats->blocks = upBlocksWritten;
+    stats->writeLastUs = upWriteLastUs;
+    stats->writeAvgUs = (upBlocksWritten > 0) ? (uint32_t)(upWriteSumUs / upBlocksWritten) : 0U;
+    stats->writeMaxUs = upWriteMaxUs;
+    stats->writeEstUs = upWriteEstUs;
+    stats->deferredMs = (uint32_t)(upDeferredUs / 1000U);
+    stats->forced = upForced;
+}
+
+/**
+ * @brief Get a printable name of an error.
+ * @param error Error
+ * @return Name
+ */
+const char *upload_error_name(enum upload_error_e error)
+{
+    switch (error)
+    {
+    case UPLOAD_ERR_TIMEOUT:
+        return "timeout";
+    case UPLOAD_ERR_CRC:
+        return "crc mismatch";
+    case UPLOAD_ERR_WRITE:
+        return "write error";
+    case UPLOAD_ERR_ABORT:
+        return "aborted";
+    default:
+        break;
+    }
+    return "none";
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file SongUpload.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Upload of a file over the USB serial into LittleFS while a song plays.
+ *        The sender transmits frames: sync (0xA5), sequence number (1), payload length (2, little endian),
+ *        payload of at most UPLOAD_FRAME_MAX bytes and a CRC-16/CCITT (2) over sequence number, length and payload.
+ *        Each frame is answered with a line "ack <seq>", a bad or unexpected frame with "nak <expected seq>",
+ *        the sender continues from there. The CRC-32 of the whole file is given at the start and checked at the end.
+ *        upload_receive() is called from the loop and only copies the payload into one of two RAM blocks.
+ *        While no block has room for another frame, received bytes stay in the serial buffer and USB holds the sender back.
+ *        A full block is written by upload_process() in one piece, so LittleFS gets whole erase blocks.
+ *        A block write stalls the CPU for the erase of the flash, it is only started when nothing is due
+ *        until its measured duration has passed (quiet time, given by the loop). A block waiting longer than
+ *        UPLOAD_STARVE_MS is written anyway and counted as forced.
+ */
+
+
+#ifndef SONG_UPLOAD_H
+#define SONG_UPLOAD_H
+
+
+#include <stdint.h>
+
+#include <FS.h>
+
+
+#define UPLOAD_SYNC             0xA5U
+#define UPLOAD_FRAME_MAX        256U    /* payload of a frame */
+#define UPLOAD_BLOCK_SIZE       4096U   /* erase block of LittleFS, each write is one block */
+#define UPLOAD_BLOCKS           2U
+#define UPLOAD_TIMEOUT_MS       3000U   /* no frame while there is room, the upload is aborted */
+#define UPLOAD_STARVE_MS        1000U   /* a block waiting longer for a quiet time is written anyway */
+#define UPLOAD_WRITE_US         40000U  /* assumed time of a block write until one has been measured */
+#define UPLOAD_LOOKAHEAD_MS     100U    /* window of the player lookahead during an upload, the quiet time has to cover a block write (erase of about 50 ms) */
+
+
+enum upload_state_e
+{
+    UPLOAD_IDLE,
+    UPLOAD_RECEIVING,
+    UPLOAD_WRITING, /* all data received, the remaining blocks are written */
+    UPLOAD_DONE, /* file closed, upload_finish() returns to idle */
+    UPLOAD_FAILED,
+};
+
+enum upload_error_e
+{
+    UPLOAD_ERR_NONE,
+    UPLOAD_ERR_TIMEOUT,
+    UPLOAD_ERR_CRC, /* CRC-32 of the file does not match */
+    UPLOAD_ERR_WRITE,
+    UPLOAD_ERR_ABORT,
+};
+
+struct upload_stats_s
+{
+    enum upload_state_e state;
+    enum upload_error_e error;
+    uint32_t size; /* expected file size */
+    uint32_t received; /* payload bytes accepted */
+    uint32_t written; /* bytes written to the file */
+    uint32_t frames;
+    uint32_t naks; /* frames rejected for CRC, length or sequence */
+    uint32_t skipped; /* bytes outside of frames */
+    uint32_t elapsedMs; /* from the start to the end of the last write */
+    uint32_t bytesPerSec;
+    uint32_t blocks; /* block writes */
+    uint32_t writeLastUs;
+    uint32_t writeAvgUs;
+    uint32_t writeMaxUs;
+    uint32_t writeEstUs; /* quiet time required for the next write */
+    uint32_t deferredMs; /* time blocks waited for a quiet time */
+    uint32_t forced; /* blocks written without a quiet time */
+};
+
+
+void upload_init(void (*wakeup)(void));
+bool upload_start(File &file, uint32_t size, uint32_t crc, uint32_t nowUs);
+uint32_t upload_receive(Stream &in, Print &reply, uint32_t nowUs);
+bool upload_process(uint32_t quietUntilUs);
+bool upload_write_pending(void);
+void upload_abort(void);
+void upload_finish(void);
+enum upload_state_e upload_state(void);
+void upload_get_stats(struct upload_stats_s *stats);
+const char *upload_error_name(enum upload_error_e error);
+uint16_t upload_crc16(uint16_t crc, const uint8_t *data, uint32_t len);
+uint32_t upload_crc32(uint32_t crc, const uint8_t *data, uint32_t len);
+
+
+#endif /* SONG_UPLOAD_H */
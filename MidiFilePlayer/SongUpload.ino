@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file SongUpload.ino
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Song upload of the file player, started by the console command upload (SongUpload.h).
+ *        The file is received into UPLOAD_TEMP_FILE and renamed when its CRC-32 matches, an existing file is replaced.
+ *        The song index is updated in place, there is no new scan of the file system.
+ *        On ESP32 the blocks are written by a task below the loop on its core, so it only runs while the loop waits.
+ *        Other cores write from the loop before it waits. The loop passes the time up to which nothing is due (app_quiet_until_us()),
+ *        during the upload the player lookahead plans UPLOAD_LOOKAHEAD_MS ahead, so a quiet time can cover a block write.
+ *        The onset statistics of the lookahead restart with an upload and show its effect on the playback.
+ */
+
+
+#include <Arduino.h>
+
+#include <FS.h>
+#include <LittleFS.h>
+
+#include "IdleLoop.h"
+#include "Log.h"
+#include "PlayerLookahead.h"
+#include "SongUpload.h"
+#include "StaticAlloc.h"
+
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#define SONG_UPLOAD_TASK
+#endif
+
+#define UPLOAD_TEMP_FILE        "/upload.tmp"
+#define UPLOAD_PATH_MAX         32
+#define UPLOAD_FS_RESERVE       (2U * UPLOAD_BLOCK_SIZE)    /* kept free for the metadata of LittleFS */
+#define UPLOAD_TASK_NAME        "song_upload"
+#define UPLOAD_TASK_STACK       3072U   /* bytes */
+#define UPLOAD_TASK_PRIO        0U      /* below the loop */
+
+
+static bool uploadFsReady = false;
+static char uploadPath[UPLOAD_PATH_MAX] = "";
+static uint16_t uploadWindowMs = LOOKAHEAD_MS; /* lookahead before the upload */
+static uint8_t uploadAlign = LOOKAHEAD_ALIGN_MEAN;
+static volatile uint32_t uploadQuietUntilUs = 0;
+
+#ifdef SONG_UPLOAD_TASK
+static StaticTask_t uploadTaskBuffer;
+static StackType_t uploadTaskStack[UPLOAD_TASK_STACK];
+static TaskHandle_t uploadTask = NULL;
+
+
+/**
+ * @brief Task writing the received blocks, woken by the loop before it waits.
+ * @param arg Unused
+ */
+static void song_upload_task(void *arg)
+{
+    (void)arg;
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (upload_process(uploadQuietUntilUs))
+        {
+        }
+    }
+}
+#endif
+
+/**
+ * @brief Mount the file system, remove a file left by an interrupted upload and start the writer task.
+ */
+void song_upload_setup(void)
+{
+    static_alloc_exempt_begin();
+    uploadFsReady = LittleFS.begin(FORMAT_LITTLEFS_IF_FAILED);
+    if (uploadFsReady && LittleFS.exists(UPLOAD_TEMP_FILE))
+    {
+        LittleFS.remove(UPLOAD_TEMP_FILE);
+    }
+    static_alloc_exempt_end();
+
+#ifdef SONG_UPLOAD_TASK
+    /* setup() runs in the task of the loop */
+    uploadTask = xTaskCreateStaticPinnedToCore(song_upload_task, UPLOAD_TASK_NAME, UPLOAD_TASK_STACK, NULL, UPLOAD_TASK_PRIO,
+                                               uploadTaskStack, &uploadTaskBuffer, xPortGetCoreID());
+#endif
+    /* the writer is woken by song_upload_idle() with the quiet time of the loop, not when a block is ready */
+    upload_init(NULL);
+}
+
+/**
+ * @brief Pass received bytes to the upload, called by the console.
+ * @return true while the upload receives, the bytes are frames and no commands
+ */
+bool song_upload_receive(void)
+{
+    if (upload_state() != UPLOAD_RECEIVING)
+    {
+        return false;
+    }
+    upload_receive(SHOW_SERIAL, SHOW_SERIAL, micros());
+    return true;
+}
+
+/**
+ * @brief Check if received bytes wait for room in the upload, they do not end the wait of the loop.
+ * @return true if the upload does not take bytes now
+ */
+bool song_upload_blocked(void)
+{
+    return upload_state() == UPLOAD_RECEIVING && upload_write_pending();
+}
+
+/**
+ * @brief Let a waiting block be written, called by app_idle() before the loop waits.
+ * @param quietUntilUs Time up to which nothing is due
+ */
+void song_upload_idle(uint32_t quietUntilUs)
+{
+    if (!upload_write_pending())
+    {
+        return;
+    }
+#ifdef SONG_UPLOAD_TASK
+    /* the task is below the loop, a loop which does not wait never lets it run */
+    if (idle_enabled())
+    {
+        uploadQuietUntilUs = quietUntilUs;
+        xTaskNotifyGive(uploadTask);
+        return;
+    }
+#endif
+    while (upload_process(quietUntilUs))
+    {
+    }
+}
+
+/**
+ * @brief Take over a finished upload: rename the file, update the song index and report the result to the sender.
+ */
+void song_upload_loop(void)
+{
+    enum upload_state_e state = upload_state();
+    if (state != UPLOAD_DONE && state != UPLOAD_FAILED)
+    {
+        return;
+    }
+
+    struct upload_stats_s stats;
+    upload_get_stats(&stats);
+
+    static_alloc_exempt_begin();
+    bool ok = (state == UPLOAD_DONE);
+    bool replaced = false;
+    if (ok)
+    {
+        /* the current song plays from RAM, its file can be replaced */
+        replaced = LittleFS.exists(uploadPath);
+        if (replaced)
+        {
+            LittleFS.remove(uploadPath);
+        }
+        ok = LittleFS.rename(UPLOAD_TEMP_FILE, uploadPath);
+    }
+    else
+    {
+        LittleFS.remove(UPLOAD_TEMP_FILE);
+    }
+    static_alloc_exempt_end();
+
+    if (ok)
+    {
+        if (midi_player_song_added(uploadPath, replaced))
+        {
+            app_song_inserted();
+        }
+        SHOW_SERIAL.printf("upload done %s %lu\n", uploadPath, (unsigned long)stats.written);
+        LOG_I("upload of %s: %lu bytes in %lu ms, %lu bytes/s", uploadPath, (unsigned long)stats.written,
+              (unsigned long)stats.elapsedMs, (unsigned long)stats.bytesPerSec);
+    }
+    else
+    {
+        const char *reason = (state == UPLOAD_FAILED) ? upload_error_name(stats.error) : "rename";
+        SHOW_SERIAL.printf("upload failed %s\n", reason);
+        LOG_E("upload of %s failed: %s", uploadPath, reason);
+    }
+
+    lookahead_set(uploadWindowMs, uploadAlign);
+    upload_finish();
+}
+
+/**
+ * @brief Start an upload.
+ * @param args Name in the root directory, size in bytes and CRC-32 in hex
+ */
+static void song_upload_start(const char *args)
+{
+    char name[UPLOAD_PATH_MAX];
+    unsigned long size = 0;
+    unsigned long crc = 0;
+    if (sscanf(args, "%30s %lu %lx", name, &size, &crc) != 3 || size == 0)
+    {
+        SHOW_SERIAL.printf("upload failed usage\n");
+        return;
+    }
+    const char *base = (name[0] == '/') ? &name[1] : name;
+    if (base[0] == 0 || strchr(base, '/') != NULL || strcmp(base, &UPLOAD_TEMP_FILE[1]) == 0)
+    {
+        SHOW_SERIAL.printf("upload failed name\n");
+        return;
+    }
+    if (!uploadFsReady || upload_state() != UPLOAD_IDLE)
+    {
+        SHOW_SERIAL.printf("upload failed busy\n");
+        return;
+    }
+    uint32_t freeBytes = LittleFS.totalBytes() - LittleFS.usedBytes();
+    if (size + UPLOAD_FS_RESERVE > freeBytes)
+    {
+        SHOW_SERIAL.printf("upload failed space %lu\n", (unsigned long)freeBytes);
+        return;
+    }
+
+    static_alloc_exempt_begin();
+    File file = LittleFS.open(UPLOAD_TEMP_FILE, "w");
+    static_alloc_exempt_end();
+    if (!file || !upload_start(file, size, crc, micros()))
+    {
+        SHOW_SERIAL.printf("upload failed open\n");
+        return;
+    }
+    snprintf(uploadPath, sizeof(uploadPath), "/%s", base);
+
+    struct lookahead_stats_s la;
+    lookahead_get_stats(&la);
+    uploadWindowMs = la.windowMs;
+    uploadAlign = la.align;
+    if (la.windowMs < UPLOAD_LOOKAHEAD_MS)
+    {
+        lookahead_set(UPLOAD_LOOKAHEAD_MS, la.align);
+    }
+    lookahead_reset_stats();
+
+    SHOW_SERIAL.printf("upload ready %u\n", UPLOAD_FRAME_MAX);
+}
+
+/**
+ * @brief Console command: upload [<name> <size> <crc32>|abort]
+ *        Starts receiving a file, aborts the upload or prints the statistics of the current or last upload.
+ * @param args Command arguments
+ */
+void Console_Upload(const char *args)
+{
+    if (strcmp(args, "abort") == 0)
+    {
+        upload_abort();
+    }
+    else if (args[0] != 0)
+    {
+        song_upload_start(args);
+        return;
+    }
+
+    static const char *stateNames[] = {"idle", "receiving", "writing", "done", "failed"};
+    struct upload_stats_s stats;
+    upload_get_stats(&stats);
+
+    SHOW_SERIAL.printf("upload %s, %s: %lu of %lu bytes written, %lu.%03lu s, %lu bytes/s%s%s\n", stateNames[stats.state],
+                       uploadPath[0] ? uploadPath : "-", (unsigned long)stats.written, (unsigned long)stats.size,
+                       (unsigned long)(stats.elapsedMs / 1000U), (unsigned long)(stats.elapsedMs % 1000U), (unsigned long)stats.bytesPerSec,
+                       (stats.error != UPLOAD_ERR_NONE) ? ", " : "", (stats.error != UPLOAD_ERR_NONE) ? upload_error_name(stats.error) : "");
+    SHOW_SERIAL.printf("  %lu frames, %lu rejected, %lu bytes outside of frames\n",
+                       (unsigned long)stats.frames, (unsigned long)stats.naks, (unsigned long)stats.skipped);
+    SHOW_SERIAL.printf("  %lu block writes, last %lu us, avg %lu us, max %lu us, %lu us quiet needed, waited %lu ms, %lu forced\n",
+                       (unsigned long)stats.blocks, (unsigned long)stats.writeLastUs, (unsigned long)stats.writeAvgUs,
+                       (unsigned long)stats.writeMaxUs, (unsigned long)stats.writeEstUs, (unsigned long)stats.deferredMs,
+                       (unsigned long)stats.forced);
+
+    struct lookahead_stats_s la;
+    lookahead_get_stats(&la);
+    SHOW_SERIAL.printf("  playback since the start: onset error mean absolute %lu us, late %lu us at most, %lu bursts sent early\n",
+                       (unsigned long)la.errorAbsUs, (unsigned long)la.lateMaxUs, (unsigned long)la.overflows);
+}
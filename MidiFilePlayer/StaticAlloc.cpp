@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file StaticAlloc.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Implementation of the heap guard of the static allocation mode.
+ */
+
+
+#include "StaticAlloc.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+
+static volatile bool allocLocked = false;
+static volatile uint8_t allocExemptDepth = 0;
+static volatile uint32_t allocCount = 0;
+static volatile uint32_t allocExemptCount = 0;
+static int32_t allocHeapBlocksLocked = 0;
+static int32_t allocHeapBlocksMax = 0;
+static uint32_t allocLastCheckMs = 0;
+
+
+#if defined(STATIC_ALLOC_MODE) && defined(ARDUINO_ARCH_ESP32)
+
+static void static_alloc_count(void)
+{
+    if (!allocLocked)
+    {
+        return;
+    }
+    allocCount++;
+    if (allocExemptDepth > 0)
+    {
+        allocExemptCount++;
+        return;
+    }
+#ifdef STATIC_ALLOC_ASSERT
+    assert(!"heap allocation after setup()");
+#endif
+}
+
+void *operator new(size_t size)
+{
+    static_alloc_count();
+    void *ptr = malloc(size);
+    if (ptr == NULL)
+    {
+        abort();
+    }
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    static_alloc_count();
+    void *ptr = malloc(size);
+    if (ptr == NULL)
+    {
+        abort();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t size) noexcept
+{
+    (void)size;
+    free(ptr);
+}
+
+void operator delete[](void *ptr, size_t size) noexcept
+{
+    (void)size;
+    free(ptr);
+}
+
+#endif
+
+static int32_t static_alloc_heap_blocks(void)
+{
+#if defined(ARDUINO_ARCH_ESP32)
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_DEFAULT);
+    return (int32_t)info.allocated_blocks;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Arm the guard, called at the end of setup().
+ */
+void static_alloc_lock(void)
+{
+    allocHeapBlocksLocked = static_alloc_heap_blocks();
+    allocHeapBlocksMax = 0;
+    allocCount = 0;
+    allocExemptCount = 0;
+    allocLocked = true;
+}
+
+/**
+ * @brief Start a section which may allocate, e.g. opening a file, sections can be nested.
+ */
+void static_alloc_exempt_begin(void)
+{
+    allocExemptDepth++;
+}
+
+/**
+ * @brief End a section started by static_alloc_exempt_begin().
+ */
+void static_alloc_exempt_end(void)
+{
+    if (allocExemptDepth > 0)
+    {
+        allocExemptDepth--;
+    }
+}
+
+/**
+ * @brief Poll the heap for blocks kept since static_alloc_lock(), called from the loop.
+ *        Walking the heap takes a while, so it is done every STATIC_ALLOC_CHECK_MS only.
+ *        The result is counted only, caches of the core may keep blocks without a fault of the sketch.
+ * @param nowMs Current time in milliseconds
+ */
+void static_alloc_check(uint32_t nowMs)
+{
+#ifdef STATIC_ALLOC_MODE
+    if (!allocLocked || allocExemptDepth > 0 || (nowMs - allocLastCheckMs) < STATIC_ALLOC_CHECK_MS)
+    {
+        return;
+    }
+    allocLastCheckMs = nowMs;
+
+    int32_t blocks = static_alloc_heap_blocks() - allocHeapBlocksLocked;
+    if (blocks > allocHeapBlocksMax)
+    {
+        allocHeapBlocksMax = blocks;
+    }
+#else
+    (void)nowMs;
+#endif
+}
+
+/**
+ * @brief Get the counters of the guard.
+ * @param stats Filled with the current values
+ */
+void static_alloc_get_stats(struct static_alloc_stats_s *stats)
+{
+    stats->locked = allocLocked;
+    stats->allocs = allocCount;
+    stats->exempt = allocExemptCount;
+    stats->heapBlocks = allocHeapBlocksMax;
+}
+
+/**
+ * @brief Get the free heap memory, all values are 0 on cores without heap information.
+ * @param heap Filled with the current values
+ */
+void static_alloc_get_heap(struct static_alloc_heap_s *heap)
+{
+#if defined(ARDUINO_ARCH_ESP32)
+    heap->freeBytes = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    heap->largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    heap->minFree = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    heap->psramFree = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    heap->psramLargest = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+#else
+    *heap = {};
+#endif
+}
+
+/**
+ * @brief Get the stack high-water mark of a task.
+ * @param task Name of the task, NULL for the calling task
+ * @return Bytes of the stack never used so far, -1 if unknown
+ */
+int32_t static_alloc_stack_free(const char *task)
+{
+#if defined(ARDUINO_ARCH_ESP32)
+    TaskHandle_t handle = (task != NULL) ? xTaskGetHandle(task) : NULL;
+    if (task != NULL && handle == NULL)
+    {
+        return -1;
+    }
+    return (int32_t)uxTaskGetStackHighWaterMark(handle); /* ESP-IDF counts in bytes */
+#else
+    (void)task;
+    return -1;
+#endif
+}
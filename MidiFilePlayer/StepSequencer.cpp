@@ -0,0 +1,514 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file StepSequencer.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Implementation of the pattern based step sequencer.
+ *        All tracks are driven by one tick counter derived from the time passed to seq_loop().
+ *        The earliest pending step or note off of all tracks is cached,
+ *        the tracks are only visited when that tick has been reached.
+ */
+
+
+#include "StepSequencer.h"
+
+#include <stddef.h>
+
+
+#define SEQ_MAX_ELAPSED_US      1000000L /* longer stalls are cut, the missed steps are skipped anyway */
+
+
+struct seq_track_s
+{
+    uint8_t firstPattern;
+    uint8_t pattern;
+    uint8_t step;
+    bool active;
+    bool sounding;
+    uint8_t channel; /* channel and notes of the step which is currently sounding */
+    uint8_t notes[SEQ_STEP_NOTES];
+    uint32_t nextStepTick;
+    uint32_t offTick;
+};
+
+
+static const struct seq_pattern_s *seqPool = NULL;
+static uint8_t seqPoolSize = 0;
+static seq_note_cb seqNoteOn = NULL;
+static seq_note_cb seqNoteOff = NULL;
+
+static struct seq_track_s seqTracks[SEQ_MAX_TRACKS];
+
+static tempo_q16_t seqTempo = TEMPO_DEFAULT;
+static uint32_t seqTickQ8 = 0; /* tick length in 1/256 us */
+static bool seqClockSynced = false; /* tick length from an external clock */
+static uint32_t seqTick = 0;
+static uint32_t seqClockQ8 = 0; /* time accumulated since the last tick */
+static uint32_t seqLastUs = 0;
+static bool seqClockRunning = false;
+static bool seqClockHold = false; /* stopped by an external transport */
+
+static uint8_t seqMeterStepTicks = SEQ_PPQN;
+static uint8_t seqMeterBarSteps = 4;
+
+static bool seqEventPending = false;
+static uint32_t seqNextEventTick = 0;
+
+
+static inline bool seq_tick_reached(uint32_t tick)
+{
+    return (int32_t)(seqTick - tick) >= 0;
+}
+
+static uint8_t seq_step_ticks(const struct seq_pattern_s *pattern)
+{
+    return (pattern->stepTicks == SEQ_STEP_METER) ? seqMeterStepTicks : pattern->stepTicks;
+}
+
+static uint8_t seq_pattern_steps(const struct seq_pattern_s *pattern)
+{
+    return (pattern->stepTicks == SEQ_STEP_METER) ? seqMeterBarSteps : pattern->stepCount;
+}
+
+static void seq_track_release(struct seq_track_s *track)
+{
+    if (!track->sounding)
+    {
+        return;
+    }
+    for (uint8_t n = 0; n < SEQ_STEP_NOTES; n++)
+    {
+        if (track->notes[n] != SEQ_NOTE_NONE)
+        {
+            seqNoteOff(track->channel, track->notes[n], 0);
+        }
+    }
+    track->sounding = false;
+}
+
+static void seq_track_advance(struct seq_track_s *track)
+{
+    const struct seq_pattern_s *pattern = &seqPool[track->pattern];
+
+    track->nextStepTick += seq_step_ticks(pattern);
+    track->step++;
+    if (track->step >= seq_pattern_steps(pattern))
+    {
+        track->step = 0;
+        if (pattern->next < seqPoolSize)
+        {
+            track->pattern = pattern->next;
+        }
+    }
+}
+
+static void seq_track_play_step(struct seq_track_s *track)
+{
+    const struct seq_pattern_s *pattern = &seqPool[track->pattern];
+    const struct seq_step_s *step = &pattern->steps[track->step % pattern->stepCount];
+
+    seq_track_release(track);
+
+    if (step->gate > 0)
+    {
+        track->channel = pattern->channel;
+        for (uint8_t n = 0; n < SEQ_STEP_NOTES; n++)
+        {
+            track->notes[n] = step->note[n];
+            if (step->note[n] != SEQ_NOTE_NONE)
+            {
+                seqNoteOn(pattern->channel, step->note[n], step->velocity);
+            }
+        }
+        track->sounding = true;
+        track->offTick = track->nextStepTick + step->gate;
+    }
+
+    seq_track_advance(track);
+
+    /* steps missed by a late loop are skipped to stay on the grid */
+    while (seq_tick_reached(track->nextStepTick))
+    {
+        seq_track_advance(track);
+    }
+}
+
+static void seq_update_next_event(void)
+{
+    seqEventPending = false;
+
+    for (uint8_t i = 0; i < SEQ_MAX_TRACKS; i++)
+    {
+        const struct seq_track_s *track = &seqTracks[i];
+        if (!track->active)
+        {
+            continue;
+        }
+
+        uint32_t due = track->nextStepTick;
+        if (track->sounding && (int32_t)(track->offTick - due) < 0)
+        {
+            due = track->offTick;
+        }
+        if (!seqEventPending || (int32_t)(due - seqNextEventTick) < 0)
+        {
+            seqNextEventTick = due;
+            seqEventPending = true;
+        }
+    }
+}
+
+/**
+ * @brief Initialize the sequencer, all tracks are stopped.
+ * @param pool Pattern pool, must stay valid
+ * @param poolSize Number of patterns in the pool
+ * @param noteOn Called to start a note
+ * @param noteOff Called to stop a note
+ */
+void seq_init(const struct seq_pattern_s *pool, uint8_t poolSize, seq_note_cb noteOn, seq_note_cb noteOff)
+{
+    seqPool = pool;
+    seqPoolSize = poolSize;
+    seqNoteOn = noteOn;
+    seqNoteOff = noteOff;
+    seqTickQ8 = tempo_tick_q8(seqTempo, SEQ_PPQN);
+
+    for (uint8_t i = 0; i < SEQ_MAX_TRACKS; i++)
+    {
+        seqTracks[i] = {};
+    }
+    seqEventPending = false;
+}
+
+/**
+ * @brief Assign the first pattern of a track.
+ * @param track Track index
+ * @param pattern Pattern pool index
+ * @return true if successful, false if track or pattern do not exist
+ */
+bool seq_track_setup(uint8_t track, uint8_t pattern)
+{
+    if (track >= SEQ_MAX_TRACKS || pattern >= seqPoolSize)
+    {
+        return false;
+    }
+    seq_track_stop(track);
+    seqTracks[track].firstPattern = pattern;
+    return true;
+}
+
+/**
+ * @brief Start a track with its first pattern on the next beat of the shared clock.
+ * @param track Track index
+ */
+void seq_track_start(uint8_t track)
+{
+    if (track >= SEQ_MAX_TRACKS || seqPool == NULL)
+    {
+        return;
+    }
+
+    struct seq_track_s *t = &seqTracks[track];
+    seq_track_release(t);
+    t->pattern = t->firstPattern;
+    t->step = 0;
+    t->nextStepTick = (seqTick + SEQ_PPQN - 1U) / SEQ_PPQN * SEQ_PPQN;
+    t->active = true;
+
+    seq_update_next_event();
+}
+
+/**
+ * @brief Stop a track, sounding notes are released immediately.
+ * @param track Track index
+ */
+void seq_track_stop(uint8_t track)
+{
+    if (track >= SEQ_MAX_TRACKS)
+    {
+        return;
+    }
+
+    seq_track_release(&seqTracks[track]);
+    seqTracks[track].active = false;
+
+    seq_update_next_event();
+}
+
+/**
+ * @brief Start a stopped track or stop a running one.
+ * @param track Track index
+ */
+void seq_track_toggle(uint8_t track)
+{
+    if (seq_track_active(track))
+    {
+        seq_track_stop(track);
+    }
+    else
+    {
+        seq_track_start(track);
+    }
+}
+
+/**
+ * @brief Check if a track is playing.
+ * @param track Track index
+ * @return true if playing, false otherwise
+ */
+bool seq_track_active(uint8_t track)
+{
+    return (track < SEQ_MAX_TRACKS) && seqTracks[track].active;
+}
+
+/**
+ * @brief Move the beat grid of a running track to a beat heard at the given time.
+ *        The shared clock is shifted by less than half a tick so a tick starts exactly on the beat,
+ *        the track keeps its step and plays its next step one step length after the beat.
+ *        Nothing changes while the clock follows an external clock.
+ * @param track Track index
+ * @param beatUs Time of the beat in microseconds, in the past or up to the current time
+ */
+void seq_track_align(uint8_t track, uint32_t beatUs)
+{
+    if (!seq_track_active(track) || !seqClockRunning || seqClockSynced || seqTickQ8 == 0)
+    {
+        return;
+    }
+
+    /* a beat after the last seq_loop() call moves the clock forward to the beat first */
+    if ((int32_t)(beatUs - seqLastUs) > 0)
+    {
+        seqClockQ8 += (beatUs - seqLastUs) << TEMPO_TICK_BITS;
+        seqLastUs = beatUs;
+        seqTick += seqClockQ8 / seqTickQ8;
+        seqClockQ8 %= seqTickQ8;
+    }
+
+    /* tick nearest to the beat on the current grid */
+    int64_t sinceQ8 = (int64_t)(seqLastUs - beatUs) << TEMPO_TICK_BITS;
+    int64_t beatQ8 = (int64_t)seqClockQ8 - sinceQ8 + seqTickQ8 / 2U;
+    int32_t beatTicks = (int32_t)((beatQ8 >= 0) ? (beatQ8 / seqTickQ8) : -((-beatQ8 + seqTickQ8 - 1) / seqTickQ8));
+    uint32_t beatTick = seqTick + (uint32_t)beatTicks;
+
+    seqTick = beatTick + (uint32_t)(sinceQ8 / seqTickQ8);
+    seqClockQ8 = (uint32_t)(sinceQ8 % seqTickQ8);
+
+    struct seq_track_s *t = &seqTracks[track];
+    uint8_t stepTicks = seq_step_ticks(&seqPool[t->pattern]);
+    t->nextStepTick = beatTick;
+    while (seq_tick_reached(t->nextStepTick))
+    {
+        t->nextStepTick += stepTicks;
+    }
+
+    seq_update_next_event();
+}
+
+/**
+ * @brief Set the tempo of the shared clock.
+ * @param tempo Quarter notes per minute
+ */
+void seq_set_tempo(tempo_q16_t tempo)
+{
+    if (tempo > 0 && tempo != seqTempo)
+    {
+        seqTempo = tempo;
+        if (!seqClockSynced)
+        {
+            seqTickQ8 = tempo_tick_q8(tempo, SEQ_PPQN);
+        }
+    }
+}
+
+/**
+ * @brief Set the meter used by patterns with SEQ_STEP_METER.
+ *        Such a pattern plays beatsPerBar * stepsPerBeat steps, its step data is repeated to fill the bar.
+ * @param beatsPerBar Beats of one bar
+ * @param stepsPerBeat Steps of one beat, 1 for quarter notes, 2 for eighth notes, ...
+ */
+void seq_set_meter(uint8_t beatsPerBar, uint8_t stepsPerBeat)
+{
+    if (beatsPerBar == 0 || stepsPerBeat == 0 || stepsPerBeat > SEQ_PPQN)
+    {
+        return;
+    }
+    seqMeterStepTicks = SEQ_PPQN / stepsPerBeat;
+    seqMeterBarSteps = beatsPerBar * stepsPerBeat;
+}
+
+/**
+ * @brief Get the current position of the shared clock.
+ * @return Ticks since start, SEQ_PPQN per quarter note
+ */
+uint32_t seq_tick(void)
+{
+    return seqTick;
+}
+
+/**
+ * @brief Move the shared clock to a new position, playing tracks restart with their first pattern on the next beat.
+ * @param tick New position in ticks
+ */
+void seq_set_position(uint32_t tick)
+{
+    seqTick = tick;
+    seqClockQ8 = 0;
+
+    for (uint8_t i = 0; i < SEQ_MAX_TRACKS; i++)
+    {
+        if (seqTracks[i].active)
+        {
+            seq_track_start(i);
+        }
+    }
+    seq_update_next_event();
+}
+
+/**
+ * @brief Align the shared clock to a tick of an external clock.
+ *        Replaces the tempo set by seq_set_tempo() until seq_clock_resume() is called.
+ * @param tick Position of the tick
+ * @param tickUs Time of the tick in microseconds
+ * @param periodQ8 Length of a tick in 1/256 microseconds
+ */
+void seq_clock_sync(uint32_t tick, uint32_t tickUs, uint32_t periodQ8)
+{
+    if (periodQ8 == 0)
+    {
+        return;
+    }
+    seqClockHold = false;
+    seqClockSynced = true;
+    seqTickQ8 = periodQ8;
+    seqTick = tick;
+    seqLastUs = tickUs;
+    seqClockQ8 = 0;
+    seqClockRunning = true;
+}
+
+/**
+ * @brief Halt the shared clock, sounding notes are released.
+ */
+void seq_clock_hold(void)
+{
+    seqClockHold = true;
+    for (uint8_t i = 0; i < SEQ_MAX_TRACKS; i++)
+    {
+        seq_track_release(&seqTracks[i]);
+    }
+}
+
+/**
+ * @brief Let the shared clock run on its own again after hold or external sync.
+ */
+void seq_clock_resume(void)
+{
+    seqClockHold = false;
+    seqClockRunning = false;
+    seqClockSynced = false;
+    seqTickQ8 = tempo_tick_q8(seqTempo, SEQ_PPQN);
+}
+
+/**
+ * @brief Advance the shared clock and play all steps which became due.
+ * @param nowUs Current time in microseconds
+ */
+void seq_loop(uint32_t nowUs)
+{
+    if (seqClockHold)
+    {
+        return;
+    }
+
+    if (!seqClockRunning)
+    {
+        seqLastUs = nowUs;
+        seqClockRunning = true;
+        return;
+    }
+
+    int32_t elapsed = (int32_t)(nowUs - seqLastUs);
+    if (elapsed < 0)
+    {
+        /* synchronized tick is slightly ahead */
+        return;
+    }
+    if (elapsed > SEQ_MAX_ELAPSED_US)
+    {
+        elapsed = SEQ_MAX_ELAPSED_US;
+    }
+    seqClockQ8 += (uint32_t)elapsed << TEMPO_TICK_BITS;
+    seqLastUs = nowUs;
+
+    if (seqClockQ8 >= seqTickQ8)
+    {
+        uint32_t ticks = seqClockQ8 / seqTickQ8;
+        seqClockQ8 -= ticks * seqTickQ8;
+        seqTick += ticks;
+    }
+
+    if (!seqEventPending || !seq_tick_reached(seqNextEventTick))
+    {
+        return;
+    }
+
+    for (uint8_t i = 0; i < SEQ_MAX_TRACKS; i++)
+    {
+        struct seq_track_s *track = &seqTracks[i];
+        if (!track->active)
+        {
+            continue;
+        }
+        if (track->sounding && seq_tick_reached(track->offTick))
+        {
+            seq_track_release(track);
+        }
+        if (seq_tick_reached(track->nextStepTick))
+        {
+            seq_track_play_step(track);
+        }
+    }
+
+    seq_update_next_event();
+}
+
+/**
+ * @brief Time of the earliest pending step or note off at the current tick length, a loop which sleeps has to call seq_loop() then.
+ *        With an external clock the time is an estimate, the next clock realigns the ticks anyway.
+ * @param dueUs Receives the time in microseconds
+ * @return false if nothing is pending or the clock is halted
+ */
+bool seq_next_us(uint32_t *dueUs)
+{
+    if (!seqEventPending || seqClockHold || !seqClockRunning || seqTickQ8 == 0)
+    {
+        return false;
+    }
+    if (seq_tick_reached(seqNextEventTick))
+    {
+        *dueUs = seqLastUs;
+        return true;
+    }
+
+    uint64_t remainQ8 = (uint64_t)(seqNextEventTick - seqTick) * seqTickQ8 - seqClockQ8;
+    *dueUs = seqLastUs + (uint32_t)((remainQ8 + (1U << TEMPO_TICK_BITS) - 1U) >> TEMPO_TICK_BITS);
+    return true;
+}
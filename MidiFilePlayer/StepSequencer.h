@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file StepSequencer.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Pattern based step sequencer running on one shared PPQN clock.
+ *        Patterns live in a constant pool, each track plays one pattern at a time and follows its chain.
+ *        seq_loop() returns after a few compares when no step or note off is due,
+ *        so the number of tracks does not add to the cost of an idle loop.
+ *        The clock runs from the tempo set by seq_set_tempo() or follows an external clock through seq_clock_sync().
+ *        Tick lengths are kept in 1/256 us, so fractional tempos do not drift.
+ */
+
+
+#ifndef STEP_SEQUENCER_H
+#define STEP_SEQUENCER_H
+
+
+#include <stdint.h>
+
+#include "TempoFixed.h"
+
+
+#define SEQ_PPQN                24      /* clock ticks per quarter note */
+#define SEQ_MAX_TRACKS          8
+#define SEQ_STEP_NOTES          4       /* notes per step, unused entries are SEQ_NOTE_NONE */
+#define SEQ_NOTE_NONE           0
+#define SEQ_STEP_METER          0       /* stepTicks value: step length and pattern length follow the meter */
+#define SEQ_CHAIN_LOOP          0xFFU   /* next value: repeat the pattern */
+
+
+struct seq_step_s
+{
+    uint8_t note[SEQ_STEP_NOTES];
+    uint8_t velocity;
+    uint8_t gate; /* note length in ticks, 0 is a rest */
+};
+
+struct seq_pattern_s
+{
+    uint8_t channel;
+    uint8_t stepCount;
+    uint8_t stepTicks; /* length of one step in ticks or SEQ_STEP_METER */
+    uint8_t next; /* pattern pool index played after this one or SEQ_CHAIN_LOOP */
+    const struct seq_step_s *steps;
+};
+
+typedef void (*seq_note_cb)(uint8_t channel, uint8_t note, uint8_t velocity);
+
+
+void seq_init(const struct seq_pattern_s *pool, uint8_t poolSize, seq_note_cb noteOn, seq_note_cb noteOff);
+bool seq_track_setup(uint8_t track, uint8_t pattern);
+void seq_track_start(uint8_t track);
+void seq_track_stop(uint8_t track);
+void seq_track_toggle(uint8_t track);
+bool seq_track_active(uint8_t track);
+void seq_track_align(uint8_t track, uint32_t beatUs);
+void seq_set_tempo(tempo_q16_t tempo);
+void seq_set_meter(uint8_t beatsPerBar, uint8_t stepsPerBeat);
+uint32_t seq_tick(void);
+void seq_set_position(uint32_t tick);
+void seq_clock_sync(uint32_t tick, uint32_t tickUs, uint32_t periodQ8);
+void seq_clock_hold(void);
+void seq_clock_resume(void);
+void seq_loop(uint32_t nowUs);
+bool seq_next_us(uint32_t *dueUs);
+
+
+#endif /* STEP_SEQUENCER_H */
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file TapTempo.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Implementation of the rolling tap tempo estimator.
+ *        Sorting at most TAP_TEMPO_HISTORY values per tap is cheap enough, so the median is taken from a sorted copy.
+ */
+
+
+#include "TapTempo.h"
+
+
+static uint32_t tapIntervals[TAP_TEMPO_HISTORY];
+static uint8_t tapHead = 0;
+static uint8_t tapIntervalCount = 0;
+static uint32_t tapLastUs = 0;
+static bool tapStarted = false;
+static uint32_t tapOutlierUs = 0; /* last rejected interval */
+static uint8_t tapOutlierCount = 0;
+
+
+static bool tap_near(uint32_t intervalUs, uint32_t refUs)
+{
+    uint32_t diff = (intervalUs > refUs) ? (intervalUs - refUs) : (refUs - intervalUs);
+    return diff <= refUs / TAP_TEMPO_TOLERANCE;
+}
+
+static void tap_push(uint32_t intervalUs)
+{
+    tapIntervals[tapHead] = intervalUs;
+    tapHead = (tapHead + 1U) % TAP_TEMPO_HISTORY;
+    if (tapIntervalCount < TAP_TEMPO_HISTORY)
+    {
+        tapIntervalCount++;
+    }
+}
+
+static void tap_clear(void)
+{
+    tapHead = 0;
+    tapIntervalCount = 0;
+    tapOutlierCount = 0;
+}
+
+static uint32_t tap_median(void)
+{
+    uint32_t sorted[TAP_TEMPO_HISTORY];
+
+    for (uint8_t i = 0; i < tapIntervalCount; i++)
+    {
+        uint32_t value = tapIntervals[i];
+        uint8_t j = i;
+        while (j > 0 && sorted[j - 1U] > value)
+        {
+            sorted[j] = sorted[j - 1U];
+            j--;
+        }
+        sorted[j] = value;
+    }
+
+    uint8_t mid = tapIntervalCount / 2U;
+    if ((tapIntervalCount & 1U) == 0)
+    {
+        return (sorted[mid - 1U] + sorted[mid]) / 2U;
+    }
+    return sorted[mid];
+}
+
+/**
+ * @brief Forget all taps, the next tap starts a new sequence.
+ */
+void tap_tempo_reset(void)
+{
+    tap_clear();
+    tapStarted = false;
+}
+
+/**
+ * @brief Add a tap.
+ * @param tapUs Time of the tap in microseconds, taken when the button was detected
+ * @return Tempo estimate of all accepted intervals, 0 if there is no new estimate (first tap, bounce or outlier)
+ */
+tempo_q16_t tap_tempo_tap(uint32_t tapUs)
+{
+    uint32_t intervalUs = tapUs - tapLastUs;
+
+    if (!tapStarted || intervalUs > TAP_TEMPO_TIMEOUT_US)
+    {
+        tap_clear();
+        tapStarted = true;
+        tapLastUs = tapUs;
+        return 0;
+    }
+    if (intervalUs < TAP_TEMPO_MIN_US)
+    {
+        return 0;
+    }
+    tapLastUs = tapUs;
+
+    if (tapIntervalCount >= 2U && !tap_near(intervalUs, tap_median()))
+    {
+        /* a single sloppy tap is dropped, a steady new tempo replaces the history */
+        if (tapOutlierCount > 0 && tap_near(intervalUs, tapOutlierUs))
+        {
+            tapOutlierCount++;
+        }
+        else
+        {
+            tapOutlierCount = 1;
+        }
+        if (tapOutlierCount < TAP_TEMPO_RESTART)
+        {
+            tapOutlierUs = intervalUs;
+            return 0;
+        }
+        uint32_t previousUs = tapOutlierUs;
+        tap_clear();
+        tap_push(previousUs);
+    }
+    tapOutlierCount = 0;
+    tap_push(intervalUs);
+
+    uint32_t median = tap_median();
+    uint32_t sumUs = 0;
+    uint8_t beats = 0;
+    for (uint8_t i = 0; i < tapIntervalCount; i++)
+    {
+        if (tap_near(tapIntervals[i], median))
+        {
+            sumUs += tapIntervals[i];
+            beats++;
+        }
+    }
+    return tempo_from_interval_us(sumUs, beats);
+}
+
+/**
+ * @brief Get the number of taps of the current sequence which went into the estimate.
+ * @return Taps, 0 before the first tap
+ */
+uint8_t tap_tempo_count(void)
+{
+    return tapStarted ? (uint8_t)(tapIntervalCount + 1U) : 0U;
+}
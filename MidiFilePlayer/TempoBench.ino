@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file TempoBench.ino
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief On target benchmark of the tempo math.
+ *        Each case runs the float calculation used before TempoFixed and the fixed point one
+ *        and prints the cycles per call and the largest difference of the results.
+ */
+
+
+#include <Arduino.h>
+
+#include "TempoFixed.h"
+
+
+#if defined(ARDUINO_ARCH_ESP32)
+#define BENCH_CYCLES()      ESP.getCycleCount()
+#else
+#define BENCH_CYCLES()      (micros() * (F_CPU / 1000000UL))
+#endif
+
+#define BENCH_ROUNDS        1000U
+
+
+struct tempo_bench_s
+{
+    const char *name;
+    uint32_t (*floatCalc)(uint32_t in); /* results are tick lengths in 1/256 us or tempos in 1/65536 bpm */
+    uint32_t (*fixedCalc)(uint32_t in);
+    uint32_t (*input)(uint32_t i);
+};
+
+
+static uint32_t __attribute__((noinline)) bench_u7_float(uint32_t value)
+{
+    float bpm = (float)value / 127.0f * (240.0f - 60.0f) + 60.0f;
+    return (uint32_t)(60000000.0f * 256.0f / (bpm * 24.0f));
+}
+
+static uint32_t __attribute__((noinline)) bench_u7_fixed(uint32_t value)
+{
+    return tempo_tick_q8(tempo_from_u7(value, TEMPO_Q16(60), TEMPO_Q16(240)), 24);
+}
+
+static uint32_t bench_u7_input(uint32_t i)
+{
+    return i & 0x7FU;
+}
+
+static uint32_t __attribute__((noinline)) bench_tap_float(uint32_t intervalUs)
+{
+    float bpm = 3.0f * 60000000.0f / (float)intervalUs;
+    return (uint32_t)(60000000.0f * 256.0f / (bpm * 24.0f));
+}
+
+static uint32_t __attribute__((noinline)) bench_tap_fixed(uint32_t intervalUs)
+{
+    return tempo_tick_q8(tempo_from_interval_us(intervalUs, 3), 24);
+}
+
+static uint32_t bench_tap_input(uint32_t i)
+{
+    return 750000U + i * 997U;
+}
+
+static uint32_t __attribute__((noinline)) bench_period_float(uint32_t periodQ8)
+{
+    float bpm = 60000000.0f / ((float)periodQ8 / 256.0f * 24.0f);
+    return (uint32_t)(bpm * 65536.0f);
+}
+
+static uint32_t __attribute__((noinline)) bench_period_fixed(uint32_t periodQ8)
+{
+    return tempo_from_tick_q8(periodQ8, 24);
+}
+
+static uint32_t bench_period_input(uint32_t i)
+{
+    return (10000U << 8U) + i * 4093U;
+}
+
+static const struct tempo_bench_s tempoBenchCases[] =
+{
+    { "controller", bench_u7_float, bench_u7_fixed, bench_u7_input },
+    { "tap", bench_tap_float, bench_tap_fixed, bench_tap_input },
+    { "clock_in", bench_period_float, bench_period_fixed, bench_period_input },
+};
+
+
+static uint32_t bench_cycles(uint32_t (*calc)(uint32_t in), uint32_t (*input)(uint32_t i))
+{
+    volatile uint32_t sink = 0;
+    uint32_t start = BENCH_CYCLES();
+    for (uint32_t i = 0; i < BENCH_ROUNDS; i++)
+    {
+        sink += calc(input(i));
+    }
+    return (BENCH_CYCLES() - start) / BENCH_ROUNDS;
+}
+
+/**
+ * @brief Console command: bench tempo
+ *        Prints cycles per tempo recalculation with float and fixed point math.
+ * @param args Command arguments
+ */
+void Console_Bench(const char *args)
+{
+    if (strcmp(args, "tempo") != 0)
+    {
+        SHOW_SERIAL.println("usage: bench tempo");
+        return;
+    }
+
+    SHOW_SERIAL.printf("%-12s %8s %8s %8s\n", "case", "float", "fixed", "max diff");
+    for (const struct tempo_bench_s &c : tempoBenchCases)
+    {
+        uint32_t maxDiff = 0;
+        for (uint32_t i = 0; i < BENCH_ROUNDS; i++)
+        {
+            uint32_t diff = (uint32_t)abs((int32_t)(c.floatCalc(c.input(i)) - c.fixedCalc(c.input(i))));
+            if (diff > maxDiff)
+            {
+                maxDiff = diff;
+            }
+        }
+
+        uint32_t floatCycles = bench_cycles(c.floatCalc, c.input);
+        uint32_t fixedCycles = bench_cycles(c.fixedCalc, c.input);
+        SHOW_SERIAL.printf("%-12s %8lu %8lu %8lu\n", c.name, (unsigned long)floatCycles, (unsigned long)fixedCycles, (unsigned long)maxDiff);
+    }
+    SHOW_SERIAL.println("cycles per call, results in 1/256 us or 1/65536 bpm");
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file TempoFixed.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Implementation of the fixed point tempo math.
+ *        tick = 60000000 us * 2^8 * 2^16 / (tempo * ppqn), the dividend needs 50 bits,
+ *        so tempo <-> tick conversions use one 64 bit division. They are called on tempo changes only,
+ *        the per tick path adds the Q24.8 tick length.
+ */
+
+
+#include "TempoFixed.h"
+
+
+#define TEMPO_US_PER_MINUTE     60000000ULL
+
+
+/**
+ * @brief Convert an integer tempo.
+ * @param bpm Beats per minute
+ * @return Tempo
+ */
+tempo_q16_t tempo_from_bpm(uint16_t bpm)
+{
+    return (tempo_q16_t)bpm << TEMPO_FRAC_BITS;
+}
+
+/**
+ * @brief Round a tempo to integer beats per minute.
+ * @param tempo Tempo
+ * @return Beats per minute
+ */
+uint16_t tempo_to_bpm(tempo_q16_t tempo)
+{
+    return (uint16_t)((tempo + (1UL << (TEMPO_FRAC_BITS - 1U))) >> TEMPO_FRAC_BITS);
+}
+
+/**
+ * @brief Get a tempo in 1/100 beats per minute, used for printing.
+ * @param tempo Tempo up to 655 bpm
+ * @return Beats per minute * 100
+ */
+uint32_t tempo_to_centi_bpm(tempo_q16_t tempo)
+{
+    return (tempo * 100UL + (1UL << (TEMPO_FRAC_BITS - 1U))) >> TEMPO_FRAC_BITS;
+}
+
+/**
+ * @brief Convert a tempo for libraries which take a float, not to be used in a per event path.
+ * @param tempo Tempo
+ * @return Beats per minute
+ */
+float tempo_to_float(tempo_q16_t tempo)
+{
+    return (float)tempo * (1.0f / (float)(1UL << TEMPO_FRAC_BITS));
+}
+
+/**
+ * @brief Limit a tempo to TEMPO_MIN .. TEMPO_MAX.
+ * @param tempo Tempo
+ * @return Limited tempo
+ */
+tempo_q16_t tempo_clamp(tempo_q16_t tempo)
+{
+    if (tempo < TEMPO_MIN)
+    {
+        return TEMPO_MIN;
+    }
+    if (tempo > TEMPO_MAX)
+    {
+        return TEMPO_MAX;
+    }
+    return tempo;
+}
+
+/**
+ * @brief Map a 7 bit controller value linearly to a tempo range.
+ * @param value Controller value 0..127
+ * @param min Tempo at 0
+ * @param max Tempo at 127, max - min must stay below 260 bpm
+ * @return Tempo
+ */
+tempo_q16_t tempo_from_u7(uint8_t value, tempo_q16_t min, tempo_q16_t max)
+{
+    if (value > 127U)
+    {
+        value = 127U;
+    }
+    return min + ((max - min) * (uint32_t)value + 63U) / 127U;
+}
+
+/**
+ * @brief Calculate the tempo of a measured time interval.
+ * @param intervalUs Length of the interval in microseconds
+ * @param beats Beats within the interval
+ * @return Tempo limited to TEMPO_MIN .. TEMPO_MAX, 0 for an empty interval
+ */
+tempo_q16_t tempo_from_interval_us(uint32_t intervalUs, uint8_t beats)
+{
+    if (intervalUs == 0 || beats == 0)
+    {
+        return 0;
+    }
+    /* a short interval would not fit into the Q16.16 result */
+    uint64_t tempo = ((TEMPO_US_PER_MINUTE * beats) << TEMPO_FRAC_BITS) / intervalUs;
+    if (tempo > TEMPO_MAX)
+    {
+        return TEMPO_MAX;
+    }
+    if (tempo < TEMPO_MIN)
+    {
+        return TEMPO_MIN;
+    }
+    return (tempo_q16_t)tempo;
+}
+
+/**
+ * @brief Calculate the length of a clock tick.
+ * @param tempo Tempo
+ * @param ppqn Ticks per quarter note
+ * @return Microseconds with TEMPO_TICK_BITS fraction bits, 0 for tempo 0
+ */
+uint32_t tempo_tick_q8(tempo_q16_t tempo, uint16_t ppqn)
+{
+    uint64_t div = (uint64_t)tempo * ppqn;
+    if (div == 0)
+    {
+        return 0;
+    }
+    return (uint32_t)(((TEMPO_US_PER_MINUTE << (TEMPO_FRAC_BITS + TEMPO_TICK_BITS)) + div / 2U) / div);
+}
+
+/**
+ * @brief Calculate the tempo of a clock tick length.
+ * @param tickQ8 Microseconds with TEMPO_TICK_BITS fraction bits
+ * @param ppqn Ticks per quarter note
+ * @return Tempo, 0 for tick length 0
+ */
+tempo_q16_t tempo_from_tick_q8(uint32_t tickQ8, uint16_t ppqn)
+{
+    uint64_t div = (uint64_t)tickQ8 * ppqn;
+    if (div == 0)
+    {
+        return 0;
+    }
+    return (tempo_q16_t)(((TEMPO_US_PER_MINUTE << (TEMPO_FRAC_BITS + TEMPO_TICK_BITS)) + div / 2U) / div);
+}
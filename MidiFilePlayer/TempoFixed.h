@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file TempoFixed.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Fixed point tempo and tick time math.
+ *        A tempo is kept as beats per minute in Q16.16, tick lengths as microseconds in Q24.8.
+ *        The conversions use integer operations only, so the targets without FPU
+ *        (ESP32-C3, AVR, SAMD) do not need soft float for a tempo change or per tick.
+ */
+
+
+#ifndef TEMPO_FIXED_H
+#define TEMPO_FIXED_H
+
+
+#include <stdint.h>
+
+
+typedef uint32_t tempo_q16_t; /* beats per minute, 16 fraction bits */
+
+#define TEMPO_FRAC_BITS     16U
+#define TEMPO_TICK_BITS     8U      /* fraction bits of a tick length in microseconds */
+#define TEMPO_Q16(bpm)      ((tempo_q16_t)((bpm) * 65536.0 + 0.5)) /* for constants only */
+#define TEMPO_MIN           TEMPO_Q16(20)
+#define TEMPO_MAX           TEMPO_Q16(250)
+#define TEMPO_DEFAULT       TEMPO_Q16(120)
+
+
+tempo_q16_t tempo_from_bpm(uint16_t bpm);
+uint16_t tempo_to_bpm(tempo_q16_t tempo);
+uint32_t tempo_to_centi_bpm(tempo_q16_t tempo);
+float tempo_to_float(tempo_q16_t tempo);
+tempo_q16_t tempo_clamp(tempo_q16_t tempo);
+tempo_q16_t tempo_from_u7(uint8_t value, tempo_q16_t min, tempo_q16_t max);
+tempo_q16_t tempo_from_interval_us(uint32_t intervalUs, uint8_t beats);
+uint32_t tempo_tick_q8(tempo_q16_t tempo, uint16_t ppqn);
+tempo_q16_t tempo_from_tick_q8(uint32_t tickQ8, uint16_t ppqn);
+
+
+#endif /* TEMPO_FIXED_H */
@@ -10,16 +10,16 @@ TrackMode::TrackMode()
 
 void TrackMode::onEnter()
 {
-    Serial.println("enter TrackMode");
+    LOG_I("enter TrackMode");
 }
 
 void TrackMode::onExit()
 {
-    Serial.println("exit TrackMode");
-    channel_1_on_off_flag = false;
-    channel_2_on_off_flag = false;
-    channel_3_on_off_flag = false;
-    channel_4_on_off_flag = false;
+    LOG_I("exit TrackMode");
+    seq_track_stop(TRACK_CHORD_1);
+    seq_track_stop(TRACK_CHORD_2);
+    seq_track_stop(TRACK_MELODY_1);
+    seq_track_stop(TRACK_MELODY_2);
 }
 
 bool TrackMode::handleEvent(StateMachine* machine, Event* event)
@@ -30,41 +30,41 @@ bool TrackMode::handleEvent(StateMachine* machine, Event* event)
 
     switch (event->getType()){
         case EventType::APressed:{
-            Serial.println("TrackMode Button A Pressed");
-            channel_1_on_off_flag = !channel_1_on_off_flag;
+            LOG_D("TrackMode Button A Pressed");
+            seq_track_toggle(TRACK_CHORD_1);
             return true;
         };
         case EventType::BPressed:{
-            Serial.println("TrackMode Button B Pressed");
-            channel_2_on_off_flag = !channel_2_on_off_flag;
+            LOG_D("TrackMode Button B Pressed");
+            seq_track_toggle(TRACK_CHORD_2);
             return true;
         };
         case EventType::CPressed:{
-            Serial.println("TrackMode Button C Pressed");
-            channel_3_on_off_flag = !channel_3_on_off_flag;
+            LOG_D("TrackMode Button C Pressed");
+            seq_track_toggle(TRACK_MELODY_1);
             return true;
         };
         case EventType::DPressed:{
-            Serial.println("TrackMode Button D Pressed");
-            channel_4_on_off_flag = !channel_4_on_off_flag;
+            LOG_D("TrackMode Button D Pressed");
+            seq_track_toggle(TRACK_MELODY_2);
             return true;
         };
         case EventType::ALongPressed:{
-            Serial.println("TrackMode Button A Long Pressed");
+            LOG_D("TrackMode Button A Long Pressed");
             return true;
         };
         case EventType::BLongPressed:{
-            Serial.println("TrackMode Button B Long Pressed");
+            LOG_D("TrackMode Button B Long Pressed");
             synth.decreaseVelocity();
             return true;
         };
         case EventType::CLongPressed:{
-            Serial.println("TrackMode Button C Long Pressed");
+            LOG_D("TrackMode Button C Long Pressed");
             synth.increaseVelocity();
             return true;
         };
         case EventType::DLongPressed:{
-            Serial.println("TrackMode Button D Long Pressed");
+            LOG_D("TrackMode Button D Long Pressed");
             if (entryFlag == false)
                 return false;
             int index = 1;
@@ -1,155 +1,75 @@
-musicData track1[] = 
-{
+/*
+ * Pattern pool of the step sequencer (see StepSequencer.h).
+ * Step lengths and gate lengths are given in clock ticks, SEQ_PPQN ticks make one quarter note.
+ */
+
+#include "StepSequencer.h"
 
-    {
-        CHANNEL_5,
-        {
-            {64, true},
-            {67, true},
-            {71, true},
-            {74, true},
-        },
-        VELOCITY_DEFAULT,
-        0,
-        1000
-    },
-    {
-        CHANNEL_5,
-        {
-            {65, true},
-            {69, true},
-            {72, true},
-            {76, true},
-        },
-        VELOCITY_DEFAULT,
-        1,
-        1000
-    },
-    {
-        CHANNEL_5,
-        {
-            {62, true},
-            {65, true},
-            {69, true},
-            {72, true},
-        },
-        VELOCITY_DEFAULT,
-        2,
-        1000
-    },
-    {
-        CHANNEL_5,
-        {
-            {60, true},
-            {64, true},
-            {67, true},
-            {71, true},
-        },
-        VELOCITY_DEFAULT,
-        3,
-        1000
-    }
-};
 
-musicData track2[] = 
+// Step length in ticks of a period in ms at BPM_DEFAULT, rounded to the nearest tick
+#define MUSIC_TICKS(ms)     (((ms) * SEQ_PPQN * BPM_DEFAULT + 30000U) / 60000U)
+
+
+// Indices of the patterns in seqPatternPool
+enum
 {
-    {
-        CHANNEL_2,
-        {
-            {48, true},  // Changed note 64 -> 48
-            {52, true},  // Changed note 67 -> 52
-            {55, true},  // Changed note 71 -> 55
-            {59, true},  // Changed note 74 -> 59
-        },
-        VELOCITY_DEFAULT,
-        0,
-        1000
-    },
-    {
-        CHANNEL_2,
-        {
-            {50, true},  // Changed note 65 -> 50
-            {53, true},  // Changed note 69 -> 53
-            {57, true},  // Changed note 72 -> 57
-            {62, true},  // Changed note 76 -> 62
-        },
-        VELOCITY_DEFAULT,
-        1,
-        1000
-    },
-    {
-        CHANNEL_2,
-        {
-            {45, true},  // Changed note 62 -> 45
-            {50, true},  // Changed note 65 -> 50
-            {55, true},  // Changed note 69 -> 55
-            {59, true},  // Changed note 72 -> 59
-        },
-        VELOCITY_DEFAULT,
-        2,
-        1000
-    },
-    {
-        CHANNEL_2,
-        {
-            {43, true},  // Changed note 60 -> 43
-            {48, true},  // Changed note 64 -> 48
-            {52, true},  // Changed note 67 -> 52
-            {55, true},  // Changed note 71 -> 55
-        },
-        VELOCITY_DEFAULT,
-        3,
-        1000
-    }
+    PATTERN_CHORD_1,
+    PATTERN_CHORD_2,
+    PATTERN_MELODY_1_A,
+    PATTERN_MELODY_1_B,
+    PATTERN_MELODY_2,
+    PATTERN_DRUM,
 };
 
+// Bass drum and closed hi-hat, repeated every BPM_DEFAULT + BPM_STEP ms
+static const struct seq_step_s chord1Steps[] =
+{
+    {{NOTE_C2, NOTE_FS2}, VELOCITY_DEFAULT, 3},
+};
 
+// Closed hi-hat, repeated every BPM_DEFAULT - BPM_STEP ms
+static const struct seq_step_s chord2Steps[] =
+{
+    {{NOTE_FS2}, VELOCITY_DEFAULT, 3},
+};
 
-//Example of multi-track chord data definition
-const musicData channel_1_chord =
+// Chord progression on channel 5, a chord every 1000 ms, split into two chained patterns
+static const struct seq_step_s melody1StepsA[] =
 {
-    CHANNEL_9,
-    {
-        {NOTE_C2, true},
-        {NOTE_FS2, true},
-    },
-    VELOCITY_DEFAULT ,
-    0,
-    BPM_DEFAULT + BPM_STEP,
+    {{64, 67, 71, 74}, VELOCITY_DEFAULT, 44},
+    {{65, 69, 72, 76}, VELOCITY_DEFAULT, 44},
 };
 
-const musicData channel_2_chord =
+static const struct seq_step_s melody1StepsB[] =
 {
-    CHANNEL_9,
-    {
-        {NOTE_FS2, true},
-    },
-    VELOCITY_DEFAULT ,
-    1,
-    BPM_DEFAULT - BPM_STEP,
+    {{62, 65, 69, 72}, VELOCITY_DEFAULT, 44},
+    {{60, 64, 67, 71}, VELOCITY_DEFAULT, 44},
 };
 
-const musicData channel_3_chord =
+// Lower chord progression on channel 2, a chord every 1000 ms
+static const struct seq_step_s melody2Steps[] =
 {
-    CHANNEL_9,
-    {
-        {NOTE_D2, true},
-        {NOTE_FS2, true},
-    },
-    VELOCITY_DEFAULT ,
-    2,
-    BPM_DEFAULT - BPM_STEP,
+    {{48, 52, 55, 59}, VELOCITY_DEFAULT, 44},
+    {{50, 53, 57, 62}, VELOCITY_DEFAULT, 44},
+    {{45, 50, 55, 59}, VELOCITY_DEFAULT, 44},
+    {{43, 48, 52, 55}, VELOCITY_DEFAULT, 44},
 };
 
-const musicData channel_4_chord =
+// Drum beat, the step length follows noteType and the pattern fills a bar of beatsPerBar
+static const struct seq_step_s drumSteps[] =
 {
-    CHANNEL_9,
-    {
-        {NOTE_FS2, true},
-    },
-    VELOCITY_DEFAULT ,
-    3,
-    BPM_DEFAULT + BPM_STEP,
+    {{NOTE_C2, NOTE_FS2}, VELOCITY_DEFAULT, 4},
+    {{NOTE_FS2}, VELOCITY_DEFAULT, 4},
+    {{NOTE_D2, NOTE_FS2}, VELOCITY_DEFAULT, 4},
+    {{NOTE_FS2}, VELOCITY_DEFAULT, 4},
 };
-musicData track3[] = {channel_1_chord,channel_2_chord,channel_3_chord,channel_4_chord};
 
+static const struct seq_pattern_s seqPatternPool[] =
+{
+    {CHANNEL_9, sizeof(chord1Steps) / sizeof(chord1Steps[0]), MUSIC_TICKS(BPM_DEFAULT + BPM_STEP), SEQ_CHAIN_LOOP, chord1Steps},
+    {CHANNEL_9, sizeof(chord2Steps) / sizeof(chord2Steps[0]), MUSIC_TICKS(BPM_DEFAULT - BPM_STEP), SEQ_CHAIN_LOOP, chord2Steps},
+    {CHANNEL_5, sizeof(melody1StepsA) / sizeof(melody1StepsA[0]), MUSIC_TICKS(1000), PATTERN_MELODY_1_B, melody1StepsA},
+    {CHANNEL_5, sizeof(melody1StepsB) / sizeof(melody1StepsB[0]), MUSIC_TICKS(1000), PATTERN_MELODY_1_A, melody1StepsB},
+    {CHANNEL_2, sizeof(melody2Steps) / sizeof(melody2Steps[0]), MUSIC_TICKS(1000), SEQ_CHAIN_LOOP, melody2Steps},
+    {CHANNEL_9, sizeof(drumSteps) / sizeof(drumSteps[0]), SEQ_STEP_METER, SEQ_CHAIN_LOOP, drumSteps},
+};
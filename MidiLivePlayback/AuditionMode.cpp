@@ -4,16 +4,12 @@
 
 #include "AuditionMode.h"
 
+#define AUDITION_NOTE_MS        1000    /* length of a note started by a button */
+#define AUDITION_RELEASE_MS     50      /* a note still sounding ends this long after the button is released */
+
 bool entryFlag = true;
-bool channel_1_on_off_flag = false;
-bool channel_2_on_off_flag = false;
-bool channel_3_on_off_flag = false;
-bool channel_4_on_off_flag = false;
-bool drum_on_off_flag = false;
 
-unsigned long btnPressStartTime  = 0;
-uint8_t buttonPressCount = 0;
-bool isRecording = false;
+uint32_t btnEventUs = 0;
 uint8_t randomNote = 0;
 
 AuditionMode::AuditionMode()
@@ -23,13 +19,14 @@ AuditionMode::AuditionMode()
 
 void AuditionMode::onEnter()
 {
-    Serial.println("enter AuditionMode");
+    LOG_I("enter AuditionMode");
 }
 
 void AuditionMode::onExit()
 {
-    Serial.println("exit AuditionMode");
-    drum_on_off_flag = false;
+    LOG_I("exit AuditionMode");
+    seq_track_stop(TRACK_DRUM);
+    note_sched_release(CHANNEL_0, 0, micros());
 }
 
 bool AuditionMode::handleEvent(StateMachine* machine, Event* event)
@@ -40,7 +37,7 @@ bool AuditionMode::handleEvent(StateMachine* machine, Event* event)
 
     switch(event->getType()){
         case EventType::APressed:{
-            Serial.println("AuditionMode Button A Pressed");
+            LOG_D("AuditionMode Button A Pressed");
             static uint8_t instrument = unit_synth_instrument_t::GrandPiano_1;
             instrument++;
             if(instrument>Gunshot)
@@ -48,44 +45,42 @@ bool AuditionMode::handleEvent(StateMachine* machine, Event* event)
                 instrument = GrandPiano_1;
             }
             synth.setInstrument(0,CHANNEL_0,instrument);
-            synth.setNoteOn(CHANNEL_0,NOTE_C4,VELOCITY_MAX);
-            
-            // synth.setNoteOff(CHANNEL_0,NOTE_C4,VELOCITY_MAX);
+            note_sched_play(CHANNEL_0, NOTE_C4, VELOCITY_MAX, AUDITION_NOTE_MS, micros());
             return true;
         };
         case EventType::BPressed:{
-            Serial.println("AuditionMode Button B Pressed");
+            LOG_D("AuditionMode Button B Pressed");
             synth.decreasePitch();
-            synth.setNoteOn(CHANNEL_0, synth.getPitch(), VELOCITY_MAX);
+            note_sched_play(CHANNEL_0, synth.getPitch(), VELOCITY_MAX, AUDITION_NOTE_MS, micros());
             return true;
         };
         case EventType::CPressed:{
-            Serial.println("AuditionMode Button C Pressed");
+            LOG_D("AuditionMode Button C Pressed");
             synth.increasePitch();
-            synth.setNoteOn(CHANNEL_0, synth.getPitch(), VELOCITY_MAX);
+            note_sched_play(CHANNEL_0, synth.getPitch(), VELOCITY_MAX, AUDITION_NOTE_MS, micros());
             return true;
         };
         case EventType::DPressed:{
-            Serial.println("AuditionMode Button D Pressed");
-            drum_on_off_flag = !drum_on_off_flag;
+            LOG_D("AuditionMode Button D Pressed");
+            seq_track_toggle(TRACK_DRUM);
             return true;
         };
         case EventType::ALongPressed:{
-            Serial.println("AuditionMode Button A Long Pressed");
+            LOG_D("AuditionMode Button A Long Pressed");
             return true;
         };
         case EventType::BLongPressed:{
-            Serial.println("AuditionMode Button B Long Pressed");
+            LOG_D("AuditionMode Button B Long Pressed");
             synth.increaseVelocity();
             return true;
         };
         case EventType::CLongPressed:{
-            Serial.println("AuditionMode Button C Long Pressed");
+            LOG_D("AuditionMode Button C Long Pressed");
             synth.decreaseVelocity();
             return true;
         };
         case EventType::DLongPressed:{
-            Serial.println("AuditionMode Button D Long Pressed");
+            LOG_D("AuditionMode Button D Long Pressed");
             //next mode index
             int index = 2;
             State* nextState = StateManager::getInstance()->getState(index);
@@ -98,9 +93,7 @@ bool AuditionMode::handleEvent(StateMachine* machine, Event* event)
             return true;
         }
         case EventType::BtnReleased:{
-            delay(50);
-            synth.setAllNotesOff(CHANNEL_0);
-            
+            note_sched_release(CHANNEL_0, AUDITION_RELEASE_MS, micros());
             entryFlag = true;
         }
         default:
@@ -10,44 +10,33 @@
 #include "Event.h"
 #include "StateMachine.h"
 #include "SAM2695Synth.h"
+#include "MidiOut.h"
+#include "NoteScheduler.h"
+#include "StepSequencer.h"
+#include "TapTempo.h"
+#include "Log.h"
 
-// The maximum recording interval is set to 2s
-#define MaxTimeLimit 2000 
 
+//the synth writes through the output merger, see MidiOut.h
+extern SAM2695Synth<MidiOutPort> synth;
+extern bool entryFlag;
 
-#ifdef __AVR__
-	#include <SoftwareSerial.h>
-	extern SAM2695Synth<SoftwareSerial> synth;
-#endif
-
-#if defined(ARDUINO_ARCH_RP2040) || defined(ARDUINO_ARCH_RP2350) ||  defined(ARDUINO_XIAO_RA4M1) 
-	#include <SoftwareSerial.h>
-	extern SAM2695Synth<SoftwareSerial> synth;
-#endif
-
-#if  defined(CONFIG_IDF_TARGET_ESP32C3) || defined(CONFIG_IDF_TARGET_ESP32C6) || defined(CONFIG_IDF_TARGET_ESP32S3)
-	extern SAM2695Synth<HardwareSerial> synth;
-#endif
-
-#ifdef SEEED_XIAO_M0
-	extern SAM2695Synth<Uart> synth;
-#elif defined(ARDUINO_SAMD_VARIANT_COMPLIANCE)
-	extern SAM2695Synth<Uart> synth;
-#endif
+// Step sequencer tracks, the patterns are assigned in setup()
+enum
+{
+	TRACK_CHORD_1,
+	TRACK_CHORD_2,
+	TRACK_MELODY_1,
+	TRACK_MELODY_2,
+	TRACK_DRUM,
+};
 
-#if defined(NRF52840_XXAA)
-	extern SAM2695Synth<Uart> synth;
-#endif
-extern bool entryFlag;
-extern bool channel_1_on_off_flag;
-extern bool channel_2_on_off_flag;
-extern bool channel_3_on_off_flag;
-extern bool channel_4_on_off_flag;
-extern bool drum_on_off_flag;
+// Tempo of the application, passed on to the synth, the sequencer and the clock output
+void app_set_tempo(tempo_q16_t tempo);
+tempo_q16_t app_get_tempo(void);
 
-extern unsigned long btnPressStartTime;
-extern uint8_t buttonPressCount;
-extern bool isRecording;
+// Time in microseconds at which the button of the event being handled was detected
+extern uint32_t btnEventUs;
 
 // AuditionMode Mode 1 (default)
 // AuditionMode is a derived class from State that represents a specific state in the state machine.
@@ -11,13 +11,14 @@ BpmMode::BpmMode()
 
 void BpmMode::onEnter()
 {
-    Serial.println("enter BpmMode");
+    LOG_I("enter BpmMode");
+    tap_tempo_reset();
 }
 
 void BpmMode::onExit()
 {
-    Serial.println("exit BpmMode");
-    drum_on_off_flag = false;
+    LOG_I("exit BpmMode");
+    seq_track_stop(TRACK_DRUM);
 }
 
 bool BpmMode::handleEvent(StateMachine* machine, Event* event)
@@ -28,63 +29,48 @@ bool BpmMode::handleEvent(StateMachine* machine, Event* event)
 
     switch (event->getType()){
         case EventType::APressed:{
-            Serial.println("BpmMode Button A  Pressed");
-            //first press
-            if (!isRecording){
-                btnPressStartTime = millis(); //record the start time
-                buttonPressCount = 1;
-                isRecording = true;
-            }
-            else{
-                if (millis() - btnPressStartTime <= MaxTimeLimit){
-                    buttonPressCount++;
-                }
-                else{
-                    isRecording = false;
-                    buttonPressCount = 0;
-                }
-            }
-            if (buttonPressCount == 4){
-                //calculate the bpm
-                int bpm = BASIC_TIME / (millis() - btnPressStartTime);
-                synth.setBpm(bpm);
-                Serial.println("BPM: " + String(bpm));
-                isRecording = false;
-                btnPressStartTime = 0;
+            LOG_D("BpmMode Button A  Pressed");
+            //every tap from the second on refines the tempo, the drum beat follows the last tap
+            tempo_q16_t tempo = tap_tempo_tap(btnEventUs);
+            if (tempo > 0){
+                app_set_tempo(tempo);
+                seq_track_align(TRACK_DRUM, btnEventUs);
+                uint32_t centiBpm = tempo_to_centi_bpm(app_get_tempo());
+                LOG_I("BPM: %lu.%02lu taps: %u", (unsigned long)(centiBpm / 100U), (unsigned long)(centiBpm % 100U), (unsigned)tap_tempo_count());
             }
             return true;
         };
         case EventType::BPressed:{
-            Serial.println("BpmMode Button B  Pressed");
-            synth.increaseBpm();
+            LOG_D("BpmMode Button B  Pressed");
+            app_set_tempo(app_get_tempo() + tempo_from_bpm(BPM_STEP));
             return true;
         };
         case EventType::CPressed:{
-            Serial.println("BpmMode Button C  Pressed");
-            synth.decreaseBpm();
+            LOG_D("BpmMode Button C  Pressed");
+            app_set_tempo(app_get_tempo() - tempo_from_bpm(BPM_STEP));
             return true;
         };
         case EventType::DPressed:{
-            Serial.println("BpmMode Button D  Pressed");
-            drum_on_off_flag = !drum_on_off_flag;
+            LOG_D("BpmMode Button D  Pressed");
+            seq_track_toggle(TRACK_DRUM);
             return true;
         };
         case EventType::ALongPressed:{
-            Serial.println("BpmMode Button A Long Pressed");
+            LOG_D("BpmMode Button A Long Pressed");
             return true;
         };
         case EventType::BLongPressed:{
-            Serial.println("BpmMode Button B Long Pressed");
+            LOG_D("BpmMode Button B Long Pressed");
             synth.increaseVelocity();
             return true;
         };
         case EventType::CLongPressed:{
-            Serial.println("BpmMode Button C Long Pressed");
+            LOG_D("BpmMode Button C Long Pressed");
             synth.decreaseVelocity();
             return true;
         };
         case EventType::DLongPressed:{
-            Serial.println("BpmMode Button D Long Pressed");
+            LOG_D("BpmMode Button D Long Pressed");
             if (entryFlag == false){
                 return false;
             }
@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file IdleLoop.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Implementation of the tickless idle.
+ *        Deadlines are compared as signed differences, so the wrap of micros() does not matter.
+ *        Cores which are only woken by their tick (WFI, AVR) sleep when at least one tick is left,
+ *        shorter waits are spun, so a deadline is never missed by a tick.
+ */
+
+
+#include "IdleLoop.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#ifdef IDLE_LIGHT_SLEEP
+#if !CONFIG_PM_ENABLE
+#error "IDLE_LIGHT_SLEEP requires power management (CONFIG_PM_ENABLE)"
+#endif
+#include <driver/gpio.h>
+#include <driver/uart.h>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#endif
+#define IDLE_WAIT_NOTIFY
+#elif defined(ARDUINO_ARCH_RP2040) || defined(ARDUINO_ARCH_RP2350)
+#include <pico/time.h>
+#define IDLE_WAIT_WFE
+#elif defined(__AVR__)
+#include <avr/sleep.h>
+#define IDLE_WAIT_AVR
+#elif defined(ARDUINO_HOST)
+#define IDLE_WAIT_HOST
+#elif defined(__arm__)
+#define IDLE_WAIT_WFI
+#endif
+
+#if defined(IDLE_WAIT_WFI) || defined(IDLE_WAIT_AVR)
+#define IDLE_WAIT_MIN_US        IDLE_WAKE_BOUND_US  /* woken by the tick only, a shorter wait would overshoot */
+#else
+#define IDLE_WAIT_MIN_US        IDLE_MIN_SLEEP_US
+#endif
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+
+static bool (*idlePending)(void) = NULL;
+static bool idleEnabled = true;
+static bool idleBusy = false;
+static bool idleDueSet = false;
+static uint32_t idleDueUs = 0;
+static volatile bool idleWakeRequest = false;
+
+static uint32_t idleWindowUs = 0;
+static uint32_t idleSleptUs = 0;
+static uint32_t idleLoops = 0;
+static uint32_t idleWakeups = 0;
+static uint32_t idleLateMaxUs = 0;
+static uint32_t idleSleepMaxUs = 0;
+static struct idle_stats_s idleStats;
+
+#ifdef IDLE_WAIT_NOTIFY
+static TaskHandle_t idleTask = NULL;
+static esp_timer_handle_t idleTimer = NULL;
+
+
+static void idle_timer_cb(void *arg)
+{
+    (void)arg;
+    xTaskNotifyGive(idleTask);
+}
+#endif
+
+
+#if defined(IDLE_LOOP) && !defined(IDLE_WAIT_HOST)
+static void IRAM_ATTR idle_pin_isr(void)
+{
+    idleWakeRequest = true;
+#ifdef IDLE_WAIT_NOTIFY
+    if (idleTask != NULL)
+    {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(idleTask, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+#endif
+}
+#endif
+
+/**
+ * @brief Halt until an interrupt or at most the given time.
+ * @param us Longest wait in microseconds
+ */
+static void idle_platform_wait(uint32_t us)
+{
+#if defined(IDLE_WAIT_NOTIFY)
+    esp_timer_start_once(idleTimer, us);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    esp_timer_stop(idleTimer);
+#elif defined(IDLE_WAIT_WFE)
+    best_effort_wfe_or_timeout(make_timeout_time_us(us));
+#elif defined(IDLE_WAIT_AVR)
+    (void)us;
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_enable();
+    sleep_cpu();
+    sleep_disable();
+#elif defined(IDLE_WAIT_HOST)
+    host_wait_for_interrupt(us);
+#elif defined(IDLE_WAIT_WFI)
+    (void)us;
+    __WFI();
+#else
+    (void)us;
+#endif
+}
+
+/**
+ * @brief Prepare the waits, called once from setup() by the task running the loop.
+ * @param pending Returns true if received data waits to be handled, NULL if there is none to check
+ */
+void idle_init(bool (*pending)(void))
+{
+    idlePending = pending;
+    idleWindowUs = micros();
+    idleSleptUs = 0;
+    idleLoops = 0;
+    idleWakeups = 0;
+    idleLateMaxUs = 0;
+    idleSleepMaxUs = 0;
+
+#ifdef IDLE_WAIT_NOTIFY
+    idleTask = xTaskGetCurrentTaskHandle();
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = idle_timer_cb;
+    timerArgs.name = "idle";
+    esp_timer_create(&timerArgs, &idleTimer);
+#ifdef IDLE_LIGHT_SLEEP
+    esp_pm_config_t pm = {};
+    pm.max_freq_mhz = getCpuFrequencyMhz();
+    pm.min_freq_mhz = getXtalFrequencyMhz();
+    pm.light_sleep_enable = true;
+    esp_pm_configure(&pm);
+    /* the synth serial (UART0) wakes the chip, the bytes of the wake-up are lost */
+    uart_set_wakeup_threshold(UART_NUM_0, 3);
+    esp_sleep_enable_uart_wakeup(UART_NUM_0);
+    esp_sleep_enable_gpio_wakeup();
+#endif
+#endif
+}
+
+/**
+ * @brief Switch the waits on or off, switched off the loop runs flat out like before and is only counted.
+ * @param enable true to wait
+ */
+void idle_set_enabled(bool enable)
+{
+    idleEnabled = enable;
+}
+
+bool idle_enabled(void)
+{
+    return idleEnabled;
+}
+
+/**
+ * @brief A falling edge of the pin ends a wait, used for the buttons.
+ *        Pins without an interrupt are still seen by the next pass, at the latest after IDLE_MAX_SLEEP_US.
+ * @param pin Arduino pin number
+ */
+void idle_wake_pin(uint8_t pin)
+{
+#if defined(IDLE_LOOP) && !defined(IDLE_WAIT_HOST)
+    int irq = digitalPinToInterrupt(pin);
+#ifdef NOT_AN_INTERRUPT
+    if (irq == NOT_AN_INTERRUPT)
+    {
+        return;
+    }
+#endif
+    attachInterrupt(irq, idle_pin_isr, FALLING);
+#if defined(IDLE_WAIT_NOTIFY) && defined(IDLE_LIGHT_SLEEP)
+    gpio_wakeup_enable((gpio_num_t)pin, GPIO_INTR_LOW_LEVEL);
+#endif
+#else
+    (void)pin;
+#endif
+}
+
+/**
+ * @brief Report a deadline of the current pass, the earliest one of all is kept.
+ * @param dueUs Time in microseconds at which the loop has to run again
+ */
+void idle_due_at(uint32_t dueUs)
+{
+    if (!idleDueSet || (int32_t)(dueUs - idleDueUs) < 0)
+    {
+        idleDueUs = dueUs;
+        idleDueSet = true;
+    }
+}
+
+/**
+ * @brief Work is left for the next pass, idle_wait() does not wait this time.
+ */
+void idle_busy(void)
+{
+    idleBusy = true;
+}
+
+/**
+ * @brief End the current or the next wait, called from another task like the UART callback.
+ */
+void idle_wake(void)
+{
+    idleWakeRequest = true;
+#ifdef IDLE_WAIT_NOTIFY
+    if (idleTask != NULL)
+    {
+        xTaskNotifyGive(idleTask);
+    }
+#endif
+}
+
+/**
+ * @brief End of a pass of the loop, waits until the earliest deadline, an interrupt or received data.
+ */
+void idle_wait(void)
+{
+    uint32_t nowUs = micros();
+    idleLoops++;
+
+#ifdef IDLE_LOOP
+    if (idleEnabled && !idleBusy)
+    {
+        uint32_t dueUs = nowUs + IDLE_MAX_SLEEP_US;
+        if (idleDueSet && (int32_t)(idleDueUs - dueUs) < 0)
+        {
+            dueUs = idleDueUs;
+        }
+
+#ifdef IDLE_WAIT_NOTIFY
+        /* notifications given during the pass have been handled by it */
+        ulTaskNotifyTake(pdTRUE, 0);
+#endif
+
+        uint32_t startUs = nowUs;
+        while ((int32_t)(dueUs - nowUs) >= (int32_t)IDLE_WAIT_MIN_US && !idleWakeRequest
+                && (idlePending == NULL || !idlePending()))
+        {
+            uint32_t us = dueUs - nowUs;
+#ifndef IDLE_WAIT_NOTIFY
+            /* an interrupt right before the halt is only noticed after the next one */
+            if (us > IDLE_WAKE_BOUND_US)
+            {
+                us = IDLE_WAKE_BOUND_US;
+            }
+#endif
+            idle_platform_wait(us);
+            idleWakeups++;
+            nowUs = micros();
+        }
+
+        uint32_t sleptUs = nowUs - startUs;
+        idleSleptUs += sleptUs;
+        if (sleptUs > idleSleepMaxUs)
+        {
+            idleSleepMaxUs = sleptUs;
+        }
+        int32_t lateUs = (int32_t)(nowUs - dueUs);
+        if (sleptUs > 0 && lateUs > (int32_t)idleLateMaxUs)
+        {
+            idleLateMaxUs = (uint32_t)lateUs;
+        }
+    }
+#endif
+
+    idleWakeRequest = false;
+    idleBusy = false;
+    idleDueSet = false;
+
+    uint32_t windowUs = nowUs - idleWindowUs;
+    if (windowUs >= IDLE_STATS_MS * 1000U)
+    {
+        idleStats.loadPermille = (uint16_t)(1000U - (uint32_t)(((uint64_t)idleSleptUs * 1000U) / windowUs));
+        idleStats.loopsPerSec = (uint32_t)(((uint64_t)idleLoops * 1000000U) / windowUs);
+        idleStats.wakeupsPerSec = (uint32_t)(((uint64_t)idleWakeups * 1000000U) / windowUs);
+        idleStats.lateMaxUs = idleLateMaxUs;
+        idleStats.sleepMaxUs = idleSleepMaxUs;
+
+        idleWindowUs = nowUs;
+        idleSleptUs = 0;
+        idleLoops = 0;
+        idleWakeups = 0;
+        idleLateMaxUs = 0;
+        idleSleepMaxUs = 0;
+    }
+}
+
+/**
+ * @brief Get utilization and wake-ups of the last complete window.
+ * @param stats Filled with the values
+ */
+void idle_get_stats(struct idle_stats_s *stats)
+{
+    *stats = idleStats;
+    stats->enabled = idleEnabled;
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file InputCapture.ino
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Input capture of a session (InputCapture.h), started by the console command capture.
+ *        The received bytes are passed by the stream the MIDI parser reads (MidiTeleRx) with the reception time
+ *        of the receive callback, on cores without it with the time the loop reads them. Button events are passed
+ *        by getNextEvent() with the time of their detection. The capture is replayed on the host by tools/midi_replay.
+ *        On ESP32 the file is written by a task of its own at the priority of the loop like the recorder,
+ *        other cores write from the loop.
+ */
+
+
+#include <Arduino.h>
+
+#include <FS.h>
+#include <LittleFS.h>
+
+#include "InputCapture.h"
+#include "Log.h"
+#include "StaticAlloc.h"
+
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#define INPUT_CAPTURE_TASK
+#endif
+
+#define CAPTURE_FORMAT_IF_FAILED    true
+#define CAPTURE_DEFAULT_FILE        "/input.cap"
+#define CAPTURE_PATH_MAX            32
+#define CAPTURE_TASK_NAME           "input_cap"
+#define CAPTURE_TASK_STACK          3072U   /* bytes */
+#define CAPTURE_TASK_PRIO           1U      /* same as the loop, never above it */
+
+
+static bool captureFsReady = false;
+static char capturePath[CAPTURE_PATH_MAX] = CAPTURE_DEFAULT_FILE;
+static enum cap_state_e captureLastState = CAP_IDLE;
+
+#ifdef INPUT_CAPTURE_TASK
+static StaticTask_t captureTaskBuffer;
+static StackType_t captureTaskStack[CAPTURE_TASK_STACK];
+static TaskHandle_t captureTask = NULL;
+
+
+/**
+ * @brief Task writing the captured blocks, sleeps until the loop hands over a block.
+ * @param arg Unused
+ */
+static void input_capture_task(void *arg)
+{
+    (void)arg;
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        cap_process();
+    }
+}
+
+static void input_capture_wakeup(void)
+{
+    xTaskNotifyGive(captureTask);
+}
+#endif
+
+/**
+ * @brief Mount the file system and start the writer task.
+ */
+void input_capture_setup(void)
+{
+    captureFsReady = LittleFS.begin(CAPTURE_FORMAT_IF_FAILED);
+    if (!captureFsReady)
+    {
+        LOG_E("LittleFS Mount Failed, input capture not available");
+    }
+
+#ifdef INPUT_CAPTURE_TASK
+    captureTask = xTaskCreateStatic(input_capture_task, CAPTURE_TASK_NAME, CAPTURE_TASK_STACK, NULL, CAPTURE_TASK_PRIO, captureTaskStack, &captureTaskBuffer);
+    cap_init(input_capture_wakeup);
+#else
+    cap_init(NULL);
+#endif
+}
+
+/**
+ * @brief Report a finished capture, writes the file on cores without the writer task.
+ */
+void input_capture_loop(void)
+{
+#ifndef INPUT_CAPTURE_TASK
+    cap_process();
+#endif
+
+    enum cap_state_e state = cap_state();
+    if (state == CAP_IDLE && captureLastState != CAP_IDLE)
+    {
+        struct cap_stats_s stats;
+        cap_get_stats(&stats);
+        LOG_I("capture saved: %s, %lu bytes received, %lu button events, %lu bytes, %lu dropped", capturePath,
+              (unsigned long)stats.bytes, (unsigned long)stats.buttons, (unsigned long)stats.fileBytes, (unsigned long)stats.dropped);
+    }
+    captureLastState = state;
+}
+
+/**
+ * @brief Start capturing into a file, an existing file is replaced.
+ * @param path File path, empty for the default file
+ */
+static void input_capture_start(const char *path)
+{
+    if (!captureFsReady)
+    {
+        LOG_E("input capture not available");
+        return;
+    }
+    if (cap_state() != CAP_IDLE)
+    {
+        LOG_W("previous capture is still being written");
+        return;
+    }
+
+    if (path[0] != 0)
+    {
+        snprintf(capturePath, sizeof(capturePath), "%s%s", (path[0] == '/') ? "" : "/", path);
+    }
+
+    static_alloc_exempt_begin();
+    File file = LittleFS.open(capturePath, "w");
+    static_alloc_exempt_end();
+    if (!file)
+    {
+        LOG_E("cannot create %s", capturePath);
+        return;
+    }
+
+    cap_start(file, micros());
+    captureLastState = CAP_RUNNING;
+    LOG_I("capturing the input to %s", capturePath);
+}
+
+/**
+ * @brief Console command: capture [start [file.cap]|stop]
+ *        Starts or stops capturing the received bytes and button events and prints the statistics of the current or last capture.
+ * @param args Command arguments
+ */
+void Console_Capture(const char *args)
+{
+    if (strncmp(args, "start", 5) == 0)
+    {
+        const char *path = args + 5;
+        while (*path == ' ')
+        {
+            path++;
+        }
+        input_capture_start(path);
+        log_flush();
+    }
+    else if (strcmp(args, "stop") == 0)
+    {
+        if (cap_state() == CAP_RUNNING)
+        {
+            cap_stop();
+            LOG_I("capture stopped");
+        }
+        log_flush();
+    }
+
+    static const char *stateNames[] = {"idle", "capturing", "writing"};
+    struct cap_stats_s stats;
+    cap_get_stats(&stats);
+
+    SHOW_SERIAL.printf("capture %s, %s: %lu bytes received, %lu button events, %lu dropped, %lu.%03lu s, %lu bytes\n", stateNames[stats.state],
+                       capturePath, (unsigned long)stats.bytes, (unsigned long)stats.buttons, (unsigned long)stats.dropped,
+                       (unsigned long)(stats.lengthMs / 1000U), (unsigned long)(stats.lengthMs % 1000U), (unsigned long)stats.fileBytes);
+    SHOW_SERIAL.printf("  %lu records, buffer high-water %lu of %lu bytes, block write last %lu us, avg %lu us, max %lu us\n",
+                       (unsigned long)stats.records, (unsigned long)stats.highWater, (unsigned long)(CAP_BLOCK_SIZE * CAP_BLOCKS),
+                       (unsigned long)stats.flushLastUs, (unsigned long)stats.flushAvgUs, (unsigned long)stats.flushMaxUs);
+}
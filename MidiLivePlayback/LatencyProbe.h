@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file LatencyProbe.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Through latency of received MIDI messages, from the reception of a message to its output.
+ *        lat_probe_in() is called with the reception time of each received channel message,
+ *        the first message queued by MidiOut while it is dispatched belongs to it.
+ *        Two stages are measured: queued (handed to midi_out_write()) and sent (last byte on the TX line,
+ *        estimated from the bytes waiting in the UART when it has been passed on).
+ *        Each message type and stage has a histogram with 8 bins per power of two, min, mean, p99 and max are printed.
+ *        The probe is compiled in with LATENCY_PROBE and switched on at runtime, switched off it only tests a flag.
+ */
+
+
+#ifndef LATENCY_PROBE_H
+#define LATENCY_PROBE_H
+
+
+#include <Arduino.h>
+
+
+#define LATENCY_PROBE                   /* compiled in, enabled by the latency console command */
+
+#define LAT_PROBE_BYTE_US       320U    /* 10 bits at 31250 baud */
+#define LAT_PROBE_SUB_BITS      3U      /* 8 bins per power of two, p99 is exact to 12.5 % */
+#define LAT_PROBE_BINS          120U    /* up to 131 ms, longer values are counted in the last bin */
+#define LAT_PROBE_PENDING       32U     /* messages queued and not yet sent, power of 2 */
+
+
+enum lat_type_e
+{
+    LAT_TYPE_NOTE_ON,
+    LAT_TYPE_NOTE_OFF,
+    LAT_TYPE_CONTROL,
+    LAT_TYPE_OTHER,
+    LAT_TYPE_COUNT,
+};
+
+enum lat_stage_e
+{
+    LAT_STAGE_QUEUED,
+    LAT_STAGE_SENT,
+    LAT_STAGE_COUNT,
+};
+
+struct lat_summary_s
+{
+    uint32_t count;
+    uint32_t minUs;
+    uint32_t meanUs;
+    uint32_t p99Us; /* upper end of the bin */
+    uint32_t maxUs;
+};
+
+
+void lat_probe_set_enabled(bool enable);
+bool lat_probe_enabled(void);
+void lat_probe_reset(void);
+void lat_probe_in(const uint8_t *msg, uint32_t rxUs);
+void lat_probe_in_done(void);
+void lat_probe_queued(uint16_t seq);
+void lat_probe_sent(uint16_t seq, uint16_t bytesAhead);
+void lat_probe_get(uint8_t type, uint8_t stage, struct lat_summary_s *summary);
+uint32_t lat_probe_untracked(void);
+void lat_probe_print(Print *port);
+
+
+#endif /* LATENCY_PROBE_H */
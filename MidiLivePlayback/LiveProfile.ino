@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file LiveProfile.ino
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Profiles of the live note transform (LiveTransform.h) stored as text files on LittleFS.
+ *        Every line is a zone, see xf_parse_zone(), empty lines and lines starting with # are skipped.
+ *        The default profile is loaded at startup if it exists, the console command profile loads another one.
+ *        A profile with an error is not taken, the previous one stays active.
+ */
+
+
+#include <Arduino.h>
+
+#include <FS.h>
+#include <LittleFS.h>
+
+#include "LiveTransform.h"
+#include "Log.h"
+#include "MidiOut.h"
+#include "StaticAlloc.h"
+
+
+#define PROFILE_FORMAT_IF_FAILED    true
+#define PROFILE_DEFAULT_FILE        "/profile.txt"
+#define PROFILE_PATH_MAX            32
+#define PROFILE_LINE_MAX            96
+
+
+static bool profileFsReady = false;
+static char profilePath[PROFILE_PATH_MAX] = "";
+static struct xf_zone_s profileZones[XF_ZONES_MAX];
+
+
+static void live_profile_note_off(const struct xf_note_s *note)
+{
+    uint8_t msg[] = {(uint8_t)(0x80U | note->ch), note->note, 0U};
+    midi_out_write(MIDI_OUT_SRC_LIVE, msg, sizeof(msg));
+}
+
+/**
+ * @brief Release the held notes and replace the zones, then send the programs of the new zones.
+ * @param zones List of zones
+ * @param count Number of zones, 0 passes all channels through
+ * @return true if the zones have been taken
+ */
+static bool live_profile_apply(const struct xf_zone_s *zones, uint8_t count)
+{
+    xf_release_all(live_profile_note_off);
+    if (!xf_set_zones(zones, count))
+    {
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (zones[i].program != XF_PROGRAM_NONE)
+        {
+            uint8_t msg[] = {(uint8_t)(0xC0U | zones[i].outCh), zones[i].program};
+            midi_out_write(MIDI_OUT_SRC_LIVE, msg, sizeof(msg));
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Load a profile file.
+ * @param path File path
+ * @return true if the profile is active
+ */
+bool live_profile_load(const char *path)
+{
+    if (!profileFsReady)
+    {
+        LOG_E("profiles not available");
+        return false;
+    }
+
+    char fullPath[PROFILE_PATH_MAX];
+    snprintf(fullPath, sizeof(fullPath), "%s%s", (path[0] == '/') ? "" : "/", path);
+
+    static_alloc_exempt_begin();
+    File file = LittleFS.open(fullPath, "r");
+    static_alloc_exempt_end();
+    if (!file)
+    {
+        LOG_E("cannot open %s", fullPath);
+        return false;
+    }
+
+    char line[PROFILE_LINE_MAX];
+    uint16_t lineNo = 0;
+    uint8_t count = 0;
+    bool ok = true;
+    while (ok && file.available() > 0)
+    {
+        size_t len = file.readBytesUntil('\n', line, sizeof(line) - 1U);
+        line[len] = 0;
+        lineNo++;
+        while (len > 0 && (line[len - 1U] == '\r' || line[len - 1U] == ' '))
+        {
+            line[--len] = 0;
+        }
+        if (len == 0 || line[0] == '#')
+        {
+            continue;
+        }
+        if (count >= XF_ZONES_MAX)
+        {
+            LOG_E("%s:%u more than %u zones", fullPath, lineNo, XF_ZONES_MAX);
+            ok = false;
+        }
+        else if (!xf_parse_zone(line, &profileZones[count]))
+        {
+            LOG_E("%s:%u invalid zone: %s", fullPath, lineNo, line);
+            ok = false;
+        }
+        count++;
+    }
+    static_alloc_exempt_begin();
+    file.close();
+    static_alloc_exempt_end();
+
+    if (!ok)
+    {
+        return false;
+    }
+    if (!live_profile_apply(profileZones, count))
+    {
+        /* the tables are limited, the channels are passed through now */
+        LOG_E("%s does not fit: %u input channels and %u key ranges at most", fullPath, XF_IN_CHANNELS_MAX, XF_ROUTES_MAX);
+        profilePath[0] = 0;
+        return false;
+    }
+    snprintf(profilePath, sizeof(profilePath), "%s", fullPath);
+    LOG_I("profile %s: %u zones", profilePath, count);
+    return true;
+}
+
+/**
+ * @brief Pass all channels through unchanged.
+ */
+void live_profile_off(void)
+{
+    live_profile_apply(NULL, 0);
+    profilePath[0] = 0;
+}
+
+/**
+ * @brief Mount the file system and load the default profile if there is one.
+ */
+void live_profile_setup(void)
+{
+    profileFsReady = LittleFS.begin(PROFILE_FORMAT_IF_FAILED);
+    if (profileFsReady && LittleFS.exists(PROFILE_DEFAULT_FILE))
+    {
+        live_profile_load(PROFILE_DEFAULT_FILE);
+    }
+}
+
+/**
+ * @brief Console command: profile [load [file]|off]
+ *        Loads a profile or passes all channels through and prints the zones and the counters of the transform.
+ * @param args Command arguments
+ */
+void Console_Profile(const char *args)
+{
+    if (strncmp(args, "load", 4) == 0)
+    {
+        const char *path = args + 4;
+        while (*path == ' ')
+        {
+            path++;
+        }
+        live_profile_load((path[0] != 0) ? path : PROFILE_DEFAULT_FILE);
+        log_flush();
+    }
+    else if (strcmp(args, "off") == 0)
+    {
+        live_profile_off();
+    }
+
+    static const char *curveNames[] = {"linear", "soft", "hard", "fixed"};
+    struct xf_stats_s stats;
+    xf_get_stats(&stats);
+    SHOW_SERIAL.printf("profile %s, %u zones, %u routes, %u bytes of tables\n", (profilePath[0] != 0) ? profilePath : "off",
+                       stats.zones, stats.routes, stats.tableBytes);
+    if (stats.zones > 0)
+    {
+        SHOW_SERIAL.printf("%-4s %-8s %-4s %9s %-10s %5s\n", "in", "keys", "out", "transpose", "velocity", "prog");
+    }
+    for (uint8_t i = 0; i < xf_zone_count(); i++)
+    {
+        const struct xf_zone_s *z = xf_zone(i);
+        char vel[12];
+        if (z->curve == XF_CURVE_FIXED)
+        {
+            snprintf(vel, sizeof(vel), "%u", z->fixedVel);
+        }
+        else
+        {
+            snprintf(vel, sizeof(vel), "%s", curveNames[z->curve]);
+        }
+        char keys[10];
+        snprintf(keys, sizeof(keys), "%u-%u", z->lo, z->hi);
+        SHOW_SERIAL.printf("%-4u %-8s %-4u %9d %-10s ", z->inCh + 1U, keys, z->outCh + 1U, z->transpose, vel);
+        if (z->program != XF_PROGRAM_NONE)
+        {
+            SHOW_SERIAL.printf("%5u\n", z->program + 1U);
+        }
+        else
+        {
+            SHOW_SERIAL.printf("%5s\n", "-");
+        }
+    }
+    SHOW_SERIAL.printf("notes: %lu received, %lu sent, %lu muted\n", (unsigned long)stats.notes, (unsigned long)stats.outputs, (unsigned long)stats.muted);
+}
@@ -0,0 +1,539 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file LiveTransform.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Implementation of the live note transform.
+ *        A route is the set of zones playing a key, keys with the same set share the route.
+ *        Route 0 is the empty set. Held keys of the channels with zones are kept in a bit map,
+ *        so they can be released before the tables are replaced.
+ */
+
+
+#include "LiveTransform.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+#define XF_ROW_THRU     0U      /* input channel without zones, the others count from 1 */
+#define XF_NOTE_NONE    0xFFU   /* key transposed out of range */
+#define XF_ROUTE_MUTE   0U
+#define XF_CHANNELS     16U
+#define XF_KEYS         128U
+
+
+static struct xf_zone_s xfZones[XF_ZONES_MAX];
+static uint8_t xfZoneCount = 0;
+
+static uint8_t xfRow[XF_CHANNELS]; /* all 0 before the first profile, every channel is passed through */
+static uint8_t xfRowCh[XF_IN_CHANNELS_MAX];
+static uint8_t xfRows = 0;
+static uint8_t xfRoute[XF_IN_CHANNELS_MAX][XF_KEYS];
+static uint8_t xfRouteFirst[XF_ROUTES_MAX];
+static uint8_t xfRouteCount[XF_ROUTES_MAX];
+static uint8_t xfRouteZones[XF_ROUTES_MAX * XF_LAYERS_MAX];
+static uint8_t xfRoutes = 1;
+
+static uint8_t xfZoneCh[XF_ZONES_MAX];
+static uint8_t xfZoneNote[XF_ZONES_MAX][XF_KEYS];
+static uint8_t xfZoneVel[XF_ZONES_MAX][XF_KEYS];
+static uint16_t xfChannels[XF_CHANNELS]; /* 0 for channels which are passed through */
+static uint32_t xfHeld[XF_IN_CHANNELS_MAX][XF_KEYS / 32U];
+
+static struct xf_stats_s xfStats;
+
+
+static uint8_t xf_isqrt(uint16_t v)
+{
+    uint8_t r = 0;
+    while ((uint16_t)(r + 1U) * (r + 1U) <= v)
+    {
+        r++;
+    }
+    return r;
+}
+
+static uint8_t xf_curve_value(const struct xf_zone_s *z, uint8_t vel)
+{
+    uint8_t v;
+    switch (z->curve)
+    {
+    case XF_CURVE_SOFT:
+        v = xf_isqrt((uint16_t)vel * 127U);
+        break;
+    case XF_CURVE_HARD:
+        v = (uint8_t)(((uint16_t)vel * vel + 126U) / 127U);
+        break;
+    case XF_CURVE_FIXED:
+        v = z->fixedVel;
+        break;
+    default:
+        v = vel;
+        break;
+    }
+    /* velocity 0 would turn the note on into a note off */
+    return (v == 0) ? 1U : ((v > 127U) ? 127U : v);
+}
+
+static uint16_t xf_zone_mask(uint8_t ch, uint8_t key)
+{
+    uint16_t mask = 0;
+    for (uint8_t i = 0; i < xfZoneCount; i++)
+    {
+        const struct xf_zone_s *z = &xfZones[i];
+        if (z->inCh == ch && key >= z->lo && key <= z->hi)
+        {
+            mask |= 1U << i;
+        }
+    }
+    return mask;
+}
+
+/**
+ * @brief Build the routes of all keys, first only counted to check the limits.
+ * @param apply false to count only
+ * @return true if the profile fits into the tables
+ */
+static bool xf_compile(bool apply)
+{
+    uint16_t masks[XF_ROUTES_MAX];
+    uint8_t routes = 1;
+    uint8_t rows = 0;
+    uint8_t listLen = 0;
+
+    masks[XF_ROUTE_MUTE] = 0;
+    if (apply)
+    {
+        xfRouteFirst[XF_ROUTE_MUTE] = 0;
+        xfRouteCount[XF_ROUTE_MUTE] = 0;
+    }
+
+    for (uint8_t ch = 0; ch < XF_CHANNELS; ch++)
+    {
+        uint16_t channelMask = 0;
+        for (uint8_t i = 0; i < xfZoneCount; i++)
+        {
+            if (xfZones[i].inCh == ch)
+            {
+                channelMask |= 1U << xfZones[i].outCh;
+            }
+        }
+        if (channelMask == 0)
+        {
+            if (apply)
+            {
+                xfRow[ch] = XF_ROW_THRU;
+                xfChannels[ch] = 0;
+            }
+            continue;
+        }
+        if (rows >= XF_IN_CHANNELS_MAX)
+        {
+            return false;
+        }
+        if (apply)
+        {
+            xfRow[ch] = rows + 1U;
+            xfRowCh[rows] = ch;
+            xfChannels[ch] = channelMask;
+        }
+
+        for (uint8_t key = 0; key < XF_KEYS; key++)
+        {
+            uint16_t mask = xf_zone_mask(ch, key);
+            uint8_t r = 0;
+            while (r < routes && masks[r] != mask)
+            {
+                r++;
+            }
+            if (r == routes)
+            {
+                if (routes >= XF_ROUTES_MAX)
+                {
+                    return false;
+                }
+                masks[r] = mask;
+                routes++;
+                uint8_t count = 0;
+                for (uint8_t i = 0; i < xfZoneCount && count < XF_LAYERS_MAX; i++)
+                {
+                    if (mask & (1U << i))
+                    {
+                        if (apply)
+                        {
+                            xfRouteZones[listLen + count] = i;
+                        }
+                        count++;
+                    }
+                }
+                if (apply)
+                {
+                    xfRouteFirst[r] = listLen;
+                    xfRouteCount[r] = count;
+                }
+                listLen += count;
+            }
+            if (apply)
+            {
+                xfRoute[rows][key] = r;
+            }
+        }
+        rows++;
+    }
+
+    if (apply)
+    {
+        xfRows = rows;
+        xfRoutes = routes;
+    }
+    return true;
+}
+
+/**
+ * @brief Remove all zones, every channel is passed through unchanged.
+ *        Held notes are forgotten, see xf_release_all().
+ */
+void xf_clear(void)
+{
+    xfZoneCount = 0;
+    memset(xfRow, XF_ROW_THRU, sizeof(xfRow));
+    memset(xfChannels, 0, sizeof(xfChannels));
+    xfRows = 0;
+    xfRoutes = 1;
+    xfRouteCount[XF_ROUTE_MUTE] = 0;
+    memset(xfHeld, 0, sizeof(xfHeld));
+    memset(&xfStats, 0, sizeof(xfStats));
+}
+
+/**
+ * @brief Set the zones of a new profile and compile its tables.
+ *        Held notes are forgotten, they have to be released with xf_release_all() before.
+ * @param zones List of zones
+ * @param count Number of zones
+ * @return false if the zones are invalid or do not fit into the tables, all channels are passed through then
+ */
+bool xf_set_zones(const struct xf_zone_s *zones, uint8_t count)
+{
+    xf_clear();
+    if (count > XF_ZONES_MAX)
+    {
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const struct xf_zone_s *z = &zones[i];
+        if (z->inCh >= XF_CHANNELS || z->outCh >= XF_CHANNELS || z->lo > z->hi || z->hi >= XF_KEYS || z->curve > XF_CURVE_FIXED)
+        {
+            return false;
+        }
+    }
+
+    memcpy(xfZones, zones, count * sizeof(struct xf_zone_s));
+    xfZoneCount = count;
+    if (!xf_compile(false))
+    {
+        xf_clear();
+        return false;
+    }
+    xf_compile(true);
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const struct xf_zone_s *z = &xfZones[i];
+        xfZoneCh[i] = z->outCh;
+        for (uint16_t key = 0; key < XF_KEYS; key++)
+        {
+            int16_t out = (int16_t)key + z->transpose;
+            xfZoneNote[i][key] = (key >= z->lo && key <= z->hi && out >= 0 && out < (int16_t)XF_KEYS) ? (uint8_t)out : XF_NOTE_NONE;
+            xfZoneVel[i][key] = xf_curve_value(z, (uint8_t)key);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Parse a decimal number within a range.
+ * @return Text following the number, NULL if there is no number in the range
+ */
+static const char *xf_parse_num(const char *s, long lo, long hi, long *value)
+{
+    char *end;
+    *value = strtol(s, &end, 10);
+    return (end != s && *value >= lo && *value <= hi) ? end : NULL;
+}
+
+/**
+ * @brief Parse a zone line of a profile:
+ *        zone [in=1-16] [keys=lo-hi] [out=1-16] [transpose=-48..48] [vel=linear|soft|hard|1-127] [prog=1-128]
+ *        Channels and programs count from 1, keys from 0. Missing values play all keys of channel 1 unchanged,
+ *        the output channel defaults to the input channel.
+ * @param line Text of the line
+ * @param zone Filled with the zone
+ * @return true if the line is a valid zone
+ */
+bool xf_parse_zone(const char *line, struct xf_zone_s *zone)
+{
+    if (strncmp(line, "zone", 4) != 0 || (line[4] != ' ' && line[4] != 0))
+    {
+        return false;
+    }
+
+    long inCh = 1;
+    long outCh = 0;
+    long lo = 0;
+    long hi = XF_KEYS - 1;
+    long transpose = 0;
+    long program = 0;
+    uint8_t curve = XF_CURVE_LINEAR;
+    long fixedVel = 100;
+
+    const char *p = line + 4;
+    for (;;)
+    {
+        while (*p == ' ')
+        {
+            p++;
+        }
+        if (*p == 0)
+        {
+            break;
+        }
+        const char *value = strchr(p, '=');
+        if (value == NULL)
+        {
+            return false;
+        }
+        value++;
+        const char *end = NULL;
+        if (strncmp(p, "in=", 3) == 0)
+        {
+            end = xf_parse_num(value, 1, XF_CHANNELS, &inCh);
+        }
+        else if (strncmp(p, "out=", 4) == 0)
+        {
+            end = xf_parse_num(value, 1, XF_CHANNELS, &outCh);
+        }
+        else if (strncmp(p, "keys=", 5) == 0)
+        {
+            end = xf_parse_num(value, 0, XF_KEYS - 1, &lo);
+            hi = lo;
+            if (end != NULL && *end == '-')
+            {
+                end = xf_parse_num(end + 1, lo, XF_KEYS - 1, &hi);
+            }
+        }
+        else if (strncmp(p, "transpose=", 10) == 0)
+        {
+            end = xf_parse_num(value, -48, 48, &transpose);
+        }
+        else if (strncmp(p, "prog=", 5) == 0)
+        {
+            end = xf_parse_num(value, 1, 128, &program);
+        }
+        else if (strncmp(p, "vel=", 4) == 0)
+        {
+            static const char *curveNames[] = {"linear", "soft", "hard"};
+            for (curve = XF_CURVE_LINEAR; curve < XF_CURVE_FIXED; curve++)
+            {
+                size_t len = strlen(curveNames[curve]);
+                if (strncmp(value, curveNames[curve], len) == 0)
+                {
+                    end = value + len;
+                    break;
+                }
+            }
+            if (curve == XF_CURVE_FIXED)
+            {
+                end = xf_parse_num(value, 1, 127, &fixedVel);
+            }
+        }
+        if (end == NULL || (*end != ' ' && *end != 0))
+        {
+            return false;
+        }
+        p = end;
+    }
+
+    zone->inCh = (uint8_t)(inCh - 1);
+    zone->outCh = (uint8_t)((outCh > 0) ? outCh - 1 : inCh - 1);
+    zone->lo = (uint8_t)lo;
+    zone->hi = (uint8_t)hi;
+    zone->transpose = (int8_t)transpose;
+    zone->curve = curve;
+    zone->fixedVel = (uint8_t)fixedVel;
+    zone->program = (program > 0) ? (uint8_t)(program - 1) : XF_PROGRAM_NONE;
+    return true;
+}
+
+/**
+ * @brief Look up the outputs of a key.
+ * @param row Row of the input channel, counting from 1
+ * @param note Key
+ * @param vel Velocity, 0 for a note off
+ * @param out Filled with the outputs, room for XF_LAYERS_MAX entries
+ * @return Number of outputs
+ */
+static uint8_t xf_lookup(uint8_t row, uint8_t note, uint8_t vel, struct xf_note_s *out)
+{
+    uint8_t r = xfRoute[row - 1U][note];
+    const uint8_t *zones = &xfRouteZones[xfRouteFirst[r]];
+    uint8_t n = 0;
+    xfStats.lookups += xfRouteCount[r];
+    for (uint8_t i = 0; i < xfRouteCount[r]; i++)
+    {
+        uint8_t z = zones[i];
+        uint8_t key = xfZoneNote[z][note];
+        if (key == XF_NOTE_NONE)
+        {
+            continue;
+        }
+        out[n].ch = xfZoneCh[z];
+        out[n].note = key;
+        out[n].vel = (vel > 0) ? xfZoneVel[z][vel] : 0U;
+        n++;
+    }
+    return n;
+}
+
+/**
+ * @brief Transform a received note on.
+ * @param ch Input channel
+ * @param note Key
+ * @param vel Velocity
+ * @param out Filled with the notes to play, room for XF_LAYERS_MAX entries
+ * @return Number of notes to play
+ */
+uint8_t xf_note_on(uint8_t ch, uint8_t note, uint8_t vel, struct xf_note_s *out)
+{
+    uint8_t row = xfRow[ch & 0x0FU];
+    note &= 0x7FU;
+    vel &= 0x7FU;
+    xfStats.notes++;
+
+    if (row == XF_ROW_THRU)
+    {
+        out[0].ch = ch;
+        out[0].note = note;
+        out[0].vel = vel;
+        xfStats.outputs++;
+        return 1;
+    }
+
+    uint8_t n = xf_lookup(row, note, vel, out);
+    if (n == 0)
+    {
+        xfStats.muted++;
+        return 0;
+    }
+    xfHeld[row - 1U][note >> 5U] |= 1UL << (note & 31U);
+    xfStats.outputs += n;
+    return n;
+}
+
+/**
+ * @brief Transform a received note off, it takes the same route as its note on.
+ * @param ch Input channel
+ * @param note Key
+ * @param out Filled with the notes to release, room for XF_LAYERS_MAX entries
+ * @return Number of notes to release
+ */
+uint8_t xf_note_off(uint8_t ch, uint8_t note, struct xf_note_s *out)
+{
+    uint8_t row = xfRow[ch & 0x0FU];
+    note &= 0x7FU;
+
+    if (row == XF_ROW_THRU)
+    {
+        out[0].ch = ch;
+        out[0].note = note;
+        out[0].vel = 0;
+        return 1;
+    }
+
+    xfHeld[row - 1U][note >> 5U] &= ~(1UL << (note & 31U));
+    return xf_lookup(row, note, 0, out);
+}
+
+/**
+ * @brief Get the output channels of an input channel, for messages which apply to the whole channel like pitch bend.
+ * @param ch Input channel
+ * @return Bit mask of the output channels
+ */
+uint16_t xf_channels(uint8_t ch)
+{
+    ch &= 0x0FU;
+    return (xfChannels[ch] != 0) ? xfChannels[ch] : (uint16_t)(1U << ch);
+}
+
+/**
+ * @brief Release all held notes of the channels with zones, called before the profile is replaced.
+ * @param noteOff Called for every note to release
+ */
+void xf_release_all(void (*noteOff)(const struct xf_note_s *note))
+{
+    struct xf_note_s out[XF_LAYERS_MAX];
+    for (uint8_t row = 0; row < xfRows; row++)
+    {
+        for (uint8_t note = 0; note < XF_KEYS; note++)
+        {
+            if (xfHeld[row][note >> 5U] & (1UL << (note & 31U)))
+            {
+                uint8_t n = xf_note_off(xfRowCh[row], note, out);
+                for (uint8_t i = 0; i < n; i++)
+                {
+                    noteOff(&out[i]);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Get the number of zones of the current profile.
+ * @return Zones, 0 if all channels are passed through
+ */
+uint8_t xf_zone_count(void)
+{
+    return xfZoneCount;
+}
+
+/**
+ * @brief Get a zone of the current profile.
+ * @param idx Index below xf_zone_count()
+ * @return Zone
+ */
+const struct xf_zone_s *xf_zone(uint8_t idx)
+{
+    return &xfZones[idx];
+}
+
+/**
+ * @brief Get the counters and the size of the tables.
+ * @param stats Filled with the values
+ */
+void xf_get_stats(struct xf_stats_s *stats)
+{
+    *stats = xfStats;
+    stats->zones = xfZoneCount;
+    stats->routes = xfRoutes;
+    stats->tableBytes = sizeof(xfRow) + sizeof(xfRoute) + sizeof(xfRouteFirst) + sizeof(xfRouteCount) + sizeof(xfRouteZones)
+                        + sizeof(xfZoneCh) + sizeof(xfZoneNote) + sizeof(xfZoneVel) + sizeof(xfChannels) + sizeof(xfHeld);
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file LiveTransform.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Transform of received notes into splits, layers, transposition and velocity curves.
+ *        A profile is a list of zones. A zone takes a key range of an input channel and plays it on an output channel,
+ *        transposed and with a velocity curve. Zones may overlap, a key is then played by all of them (layer).
+ *        xf_set_zones() compiles the zones into lookup tables: a route per input channel and key which lists
+ *        the zones playing it, and a note and a velocity table of 128 entries per zone.
+ *        A note costs a route lookup and two table lookups per output, no matter how many zones the profile has.
+ *        Input channels without a zone are passed through unchanged, keys of a channel with zones which are
+ *        not covered by any of them are muted.
+ *        Nothing is allocated, all tables are static.
+ */
+
+
+#ifndef LIVE_TRANSFORM_H
+#define LIVE_TRANSFORM_H
+
+
+#include <stdint.h>
+
+
+#define XF_ZONES_MAX        8U      /* zones of a profile */
+#define XF_LAYERS_MAX       4U      /* outputs of a single note */
+#define XF_IN_CHANNELS_MAX  4U      /* input channels with zones */
+#define XF_ROUTES_MAX       32U     /* different sets of zones over all keys */
+#define XF_PROGRAM_NONE     0xFFU
+
+/* route, note and velocity tables and the held keys */
+#define XF_TABLE_SIZE       (XF_IN_CHANNELS_MAX * 128U + XF_ROUTES_MAX * (2U + XF_LAYERS_MAX) + XF_ZONES_MAX * 2U * 128U + XF_IN_CHANNELS_MAX * 16U)
+
+
+enum xf_curve_e
+{
+    XF_CURVE_LINEAR,
+    XF_CURVE_SOFT,  /* louder at low velocity */
+    XF_CURVE_HARD,  /* quieter at low velocity */
+    XF_CURVE_FIXED, /* every note with the fixed velocity of the zone */
+};
+
+struct xf_zone_s
+{
+    uint8_t inCh;       /* 0 - 15 */
+    uint8_t lo;         /* lowest key */
+    uint8_t hi;         /* highest key */
+    uint8_t outCh;      /* 0 - 15 */
+    int8_t transpose;   /* semitones */
+    uint8_t curve;      /* see xf_curve_e */
+    uint8_t fixedVel;   /* velocity of XF_CURVE_FIXED */
+    uint8_t program;    /* program change sent when the profile is set, XF_PROGRAM_NONE for none */
+};
+
+struct xf_note_s
+{
+    uint8_t ch;
+    uint8_t note;
+    uint8_t vel;
+};
+
+struct xf_stats_s
+{
+    uint8_t zones;
+    uint8_t routes;
+    uint32_t notes;     /* note on received */
+    uint32_t outputs;   /* note on sent */
+    uint32_t muted;     /* note on not covered by a zone or transposed out of range */
+    uint32_t lookups;   /* zones read by the table lookups of note on and off */
+    uint16_t tableBytes;
+};
+
+
+void xf_clear(void);
+bool xf_set_zones(const struct xf_zone_s *zones, uint8_t count);
+bool xf_parse_zone(const char *line, struct xf_zone_s *zone);
+uint8_t xf_note_on(uint8_t ch, uint8_t note, uint8_t vel, struct xf_note_s *out);
+uint8_t xf_note_off(uint8_t ch, uint8_t note, struct xf_note_s *out);
+uint16_t xf_channels(uint8_t ch);
+void xf_release_all(void (*noteOff)(const struct xf_note_s *note));
+uint8_t xf_zone_count(void);
+const struct xf_zone_s *xf_zone(uint8_t idx);
+void xf_get_stats(struct xf_stats_s *stats);
+
+
+#endif /* LIVE_TRANSFORM_H */
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file Log.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Implementation of the asynchronous log output.
+ *        The head index is only written by log_write(), the tail index only by log_loop(),
+ *        so a line is published with a single store and no lock is needed.
+ */
+
+
+#include "Log.h"
+
+#include <stdarg.h>
+
+
+#define LOG_BUFFER_MASK     (LOG_BUFFER_SIZE - 1U)
+#define LOG_TAG_LEN         3U  /* "E: " */
+
+
+static Print *logPort = NULL;
+static char logBuffer[LOG_BUFFER_SIZE];
+static volatile uint32_t logHead = 0;
+static volatile uint32_t logTail = 0;
+static uint32_t logLines = 0;
+static uint32_t logDropped = 0;
+static uint32_t logDroppedReported = 0;
+
+static const char logLevelTag[] = {'-', 'E', 'W', 'I', 'D'};
+
+
+/**
+ * @brief Set the port which receives the log, never the synth UART.
+ * @param port Port, usually the USB serial
+ */
+void log_init(Print *port)
+{
+    logPort = port;
+}
+
+/**
+ * @brief Format a log line into the buffer, use the LOG_x() macros instead of calling this directly.
+ * @param level Level of the line
+ * @param format printf format, without line end
+ */
+void log_write(uint8_t level, const char *format, ...)
+{
+    char line[LOG_LINE_MAX];
+    line[0] = logLevelTag[(level < sizeof(logLevelTag)) ? level : 0];
+    line[1] = ':';
+    line[2] = ' ';
+
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(&line[LOG_TAG_LEN], sizeof(line) - LOG_TAG_LEN - 1U, format, args);
+    va_end(args);
+    if (len < 0)
+    {
+        return;
+    }
+
+    uint32_t n = LOG_TAG_LEN + (((uint32_t)len < sizeof(line) - LOG_TAG_LEN - 1U) ? (uint32_t)len : (sizeof(line) - LOG_TAG_LEN - 2U));
+    line[n++] = '\n';
+
+    uint32_t head = logHead;
+    uint32_t tail = __atomic_load_n(&logTail, __ATOMIC_ACQUIRE);
+    if (n > LOG_BUFFER_SIZE - (head - tail))
+    {
+        logDropped++;
+        return;
+    }
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        logBuffer[(head + i) & LOG_BUFFER_MASK] = line[i];
+    }
+    __atomic_store_n(&logHead, head + n, __ATOMIC_RELEASE);
+    logLines++;
+}
+
+/**
+ * @brief Pass buffered lines to the port as far as it takes them without blocking, called from the loop.
+ */
+void log_loop(void)
+{
+    if (logPort == NULL)
+    {
+        return;
+    }
+
+    uint32_t head = __atomic_load_n(&logHead, __ATOMIC_ACQUIRE);
+    uint32_t tail = logTail;
+
+    while (tail != head)
+    {
+        int room = logPort->availableForWrite();
+        if (room <= 0)
+        {
+            break;
+        }
+        uint32_t chunk = head - tail;
+        uint32_t contiguous = LOG_BUFFER_SIZE - (tail & LOG_BUFFER_MASK);
+        if (chunk > contiguous)
+        {
+            chunk = contiguous;
+        }
+        if (chunk > (uint32_t)room)
+        {
+            chunk = (uint32_t)room;
+        }
+        logPort->write((const uint8_t *)&logBuffer[tail & LOG_BUFFER_MASK], chunk);
+        tail += chunk;
+    }
+    __atomic_store_n(&logTail, tail, __ATOMIC_RELEASE);
+
+    /* reported once the buffer is empty, so the report itself is not dropped */
+    if (tail == head && logDropped != logDroppedReported)
+    {
+        uint32_t dropped = logDropped - logDroppedReported;
+        logDroppedReported = logDropped;
+        log_write(LOG_LEVEL_WARN, "%lu log lines dropped", (unsigned long)dropped);
+    }
+}
+
+/**
+ * @brief Write all buffered lines, blocking, used at the end of setup() only.
+ */
+void log_flush(void)
+{
+    if (logPort == NULL)
+    {
+        return;
+    }
+
+    uint32_t head = __atomic_load_n(&logHead, __ATOMIC_ACQUIRE);
+    uint32_t tail = logTail;
+    while (tail != head)
+    {
+        logPort->write((uint8_t)logBuffer[tail & LOG_BUFFER_MASK]);
+        tail++;
+    }
+    __atomic_store_n(&logTail, tail, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Get the counters of the log.
+ * @param stats Filled with the current values
+ */
+void log_get_stats(struct log_stats_s *stats)
+{
+    stats->lines = logLines;
+    stats->dropped = logDropped;
+    stats->pending = (uint16_t)(logHead - logTail);
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file Log.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Asynchronous log output.
+ *        LOG_E(), LOG_W(), LOG_I() and LOG_D() format a line into a lock free ring buffer,
+ *        log_loop() passes it to the log port only as far as the port takes it without blocking.
+ *        So a USB serial which is not read by the host does not stall the MIDI processing.
+ *        Lines which do not fit into the buffer are dropped and counted.
+ *        Calls above LOG_LEVEL are removed when compiling, including the evaluation of their arguments.
+ *
+ * @note The buffer has one producer, log calls are made from the loop only.
+ */
+
+
+#ifndef LOG_H
+#define LOG_H
+
+
+#include <Arduino.h>
+
+
+#define LOG_LEVEL_NONE      0
+#define LOG_LEVEL_ERROR     1
+#define LOG_LEVEL_WARN      2
+#define LOG_LEVEL_INFO      3
+#define LOG_LEVEL_DEBUG     4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL           LOG_LEVEL_INFO  /* LOG_LEVEL_DEBUG adds the button and mode traces */
+#endif
+
+#define LOG_BUFFER_SIZE     1024U   /* power of 2 */
+#define LOG_LINE_MAX        96U     /* longer lines are cut */
+
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_E(...)  log_write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_E(...)  do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(...)  log_write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_W(...)  do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(...)  log_write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_I(...)  do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(...)  log_write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_D(...)  do {} while (0)
+#endif
+
+
+struct log_stats_s
+{
+    uint32_t lines;
+    uint32_t dropped;
+    uint16_t pending; /* bytes waiting for the port */
+};
+
+
+void log_init(Print *port);
+void log_write(uint8_t level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+void log_loop(void);
+void log_flush(void);
+void log_get_stats(struct log_stats_s *stats);
+
+
+#endif /* LOG_H */
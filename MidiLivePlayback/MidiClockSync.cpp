@@ -0,0 +1,376 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MidiClockSync.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Implementation of the MIDI clock slave.
+ *        Filter per received clock with the prediction error e = t_rx - t_pred:
+ *          phase  = t_pred + alpha * e
+ *          period = period + beta * e
+ *          t_pred = phase + period
+ *        High gains are used while acquiring, low gains once the period is known.
+ *        Times are integer microseconds plus 8 fraction bits, gains are Q16, so no float is used per clock.
+ *        The position counts clocks since start / song position, the transport starts running
+ *        so a clock source without transport messages can be followed as well.
+ */
+
+
+#include "MidiClockSync.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+
+#define SYNC_GAIN(g)            ((int32_t)((g) * 65536.0f + 0.5f))
+#define SYNC_ACQUIRE_ALPHA      SYNC_GAIN(0.5f)
+#define SYNC_ACQUIRE_BETA       SYNC_GAIN(0.25f)
+#define SYNC_TRACK_ALPHA        SYNC_GAIN(0.05f)
+#define SYNC_TRACK_BETA         SYNC_GAIN(0.00128f) /* alpha^2 / (2 - alpha), critically damped */
+
+#define SYNC_ACQUIRE_CLOCKS     CLOCK_SYNC_PPQN
+#define SYNC_LOCK_CLOCKS        CLOCK_SYNC_PPQN
+#define SYNC_LOCK_WINDOW_DIV        4 /* prediction error below period / 4 */
+#define SYNC_MAX_OUTLIERS       3
+#define SYNC_TIMEOUT_PERIODS    4
+
+#define SYNC_Q8(us)             ((int32_t)(us) << TEMPO_TICK_BITS)
+#define SYNC_FRAC_MASK          ((1L << TEMPO_TICK_BITS) - 1)
+#define SYNC_MIN_PERIOD_Q8      SYNC_Q8(60000000UL / (300UL * CLOCK_SYNC_PPQN))
+#define SYNC_MAX_PERIOD_Q8      SYNC_Q8(60000000UL / (20UL * CLOCK_SYNC_PPQN))
+#define SYNC_DEFAULT_PERIOD_Q8  SYNC_Q8(60000000UL / (120UL * CLOCK_SYNC_PPQN))
+
+
+static struct clock_sync_cb_s syncCb = {};
+static bool syncEnabled = true;
+
+static bool syncActive = false;
+static bool syncLocked = false;
+static bool syncRunning = true;
+static uint32_t syncClocks = 0; /* clocks since acquisition */
+static uint8_t syncInWindow = 0;
+static uint8_t syncOutliers = 0;
+
+static uint32_t syncPosition = 0;
+static uint32_t syncLastRxUs = 0;
+static uint32_t syncPhaseUs = 0;
+static uint32_t syncPredUs = 0;
+static int32_t syncPredFrac = 0; /* 1/256 us */
+static int32_t syncPhaseFrac = 0;
+static int32_t syncPeriodQ8 = SYNC_DEFAULT_PERIOD_Q8;
+
+static uint64_t statPhaseSq = 0;
+static uint32_t statPhaseCount = 0;
+static uint32_t statPhaseMax = 0;
+static uint32_t statJitterMax = 0;
+static uint32_t statClocks = 0;
+static uint32_t statRelocks = 0;
+
+
+static void sync_set_locked(bool locked)
+{
+    if (syncLocked != locked)
+    {
+        syncLocked = locked;
+        if (locked)
+        {
+            statRelocks++;
+        }
+        if (syncCb.lock != NULL)
+        {
+            syncCb.lock(locked);
+        }
+    }
+}
+
+static void sync_acquire(uint32_t rxUs)
+{
+    syncActive = true;
+    syncClocks = 1;
+    syncInWindow = 0;
+    syncOutliers = 0;
+    syncPhaseUs = rxUs;
+    syncPhaseFrac = 0;
+    syncPredUs = rxUs + (syncPeriodQ8 >> TEMPO_TICK_BITS);
+    syncPredFrac = syncPeriodQ8 & SYNC_FRAC_MASK;
+    sync_set_locked(false);
+}
+
+static inline int32_t sync_mul_gain(int32_t valueQ8, int32_t gain)
+{
+    return (int32_t)(((int64_t)valueQ8 * gain) >> 16);
+}
+
+static void sync_track(uint32_t rxUs)
+{
+    int32_t errQ8 = SYNC_Q8((int32_t)(rxUs - syncPredUs)) - syncPredFrac;
+    int32_t limitQ8 = syncPeriodQ8 / 2;
+
+    if (syncClocks == 1)
+    {
+        /* first interval gives the initial period */
+        syncPeriodQ8 = SYNC_Q8(rxUs - syncLastRxUs);
+        errQ8 = 0;
+    }
+    else if (abs(errQ8) > limitQ8)
+    {
+        if (++syncOutliers > SYNC_MAX_OUTLIERS)
+        {
+            sync_acquire(rxUs);
+            return;
+        }
+        /* single late or early clock, do not let it pull the filter */
+        errQ8 = (errQ8 > 0) ? limitQ8 / 2 : -limitQ8 / 2;
+    }
+    else
+    {
+        syncOutliers = 0;
+    }
+
+    bool acquiring = syncClocks < SYNC_ACQUIRE_CLOCKS;
+    int32_t alpha = acquiring ? SYNC_ACQUIRE_ALPHA : SYNC_TRACK_ALPHA;
+    int32_t beta = acquiring ? SYNC_ACQUIRE_BETA : SYNC_TRACK_BETA;
+
+    uint32_t jitter = (uint32_t)abs(SYNC_Q8(rxUs - syncLastRxUs) - syncPeriodQ8) >> TEMPO_TICK_BITS;
+
+    syncPeriodQ8 += sync_mul_gain(errQ8, beta);
+    if (syncPeriodQ8 < SYNC_MIN_PERIOD_Q8)
+    {
+        syncPeriodQ8 = SYNC_MIN_PERIOD_Q8;
+    }
+    if (syncPeriodQ8 > SYNC_MAX_PERIOD_Q8)
+    {
+        syncPeriodQ8 = SYNC_MAX_PERIOD_Q8;
+    }
+
+    /* times are kept as integer microseconds plus fraction, offsets are relative to the prediction */
+    int32_t phaseOffset = syncPredFrac + sync_mul_gain(errQ8, alpha);
+    syncPhaseUs = syncPredUs + (phaseOffset >> TEMPO_TICK_BITS);
+    syncPhaseFrac = phaseOffset & SYNC_FRAC_MASK;
+
+    int32_t predOffset = syncPhaseFrac + syncPeriodQ8;
+    syncPredUs = syncPhaseUs + (predOffset >> TEMPO_TICK_BITS);
+    syncPredFrac = predOffset & SYNC_FRAC_MASK;
+
+    syncClocks++;
+
+    if (!acquiring)
+    {
+        uint32_t phaseErr = (uint32_t)abs((int32_t)(rxUs - syncPhaseUs));
+        statPhaseSq += (uint64_t)phaseErr * phaseErr;
+        statPhaseCount++;
+        if (phaseErr > statPhaseMax)
+        {
+            statPhaseMax = phaseErr;
+        }
+        if (jitter > statJitterMax)
+        {
+            statJitterMax = jitter;
+        }
+
+        if (abs(errQ8) < syncPeriodQ8 / SYNC_LOCK_WINDOW_DIV)
+        {
+            if (syncInWindow < SYNC_LOCK_CLOCKS)
+            {
+                syncInWindow++;
+            }
+            if (syncInWindow == SYNC_LOCK_CLOCKS)
+            {
+                sync_set_locked(true);
+            }
+        }
+        else
+        {
+            syncInWindow = 0;
+        }
+    }
+}
+
+/**
+ * @brief Set the callbacks receiving the filtered clock and transport messages.
+ * @param cb Callbacks, entries may be NULL
+ */
+void clock_sync_init(const struct clock_sync_cb_s *cb)
+{
+    syncCb = *cb;
+}
+
+/**
+ * @brief Enable or disable following an external clock.
+ * @param enabled true to follow received clock and transport messages
+ */
+void clock_sync_set_enabled(bool enabled)
+{
+    syncEnabled = enabled;
+    if (!enabled && syncActive)
+    {
+        syncActive = false;
+        sync_set_locked(false);
+    }
+}
+
+/**
+ * @brief Check if an external clock is followed when received.
+ * @return true if enabled
+ */
+bool clock_sync_enabled(void)
+{
+    return syncEnabled;
+}
+
+/**
+ * @brief Process a received real time message.
+ * @param msg Message byte, 0xF8 clock, 0xFA start, 0xFB continue, 0xFC stop, others are ignored
+ * @param rxUs Reception time of the byte in microseconds
+ */
+void clock_sync_realtime(uint8_t msg, uint32_t rxUs)
+{
+    if (!syncEnabled)
+    {
+        return;
+    }
+
+    switch (msg)
+    {
+    case MIDI_RT_CLOCK:
+        if (!syncActive)
+        {
+            sync_acquire(rxUs);
+        }
+        else
+        {
+            sync_track(rxUs);
+        }
+        syncLastRxUs = rxUs;
+        statClocks++;
+
+        if (syncRunning)
+        {
+            if (syncCb.tick != NULL)
+            {
+                syncCb.tick(syncPosition, syncPhaseUs, (uint32_t)syncPeriodQ8);
+            }
+            if (syncLocked && syncCb.tempo != NULL && (syncPosition % CLOCK_SYNC_PPQN) == 0)
+            {
+                syncCb.tempo(tempo_from_tick_q8((uint32_t)syncPeriodQ8, CLOCK_SYNC_PPQN));
+            }
+            syncPosition++;
+        }
+        break;
+
+    case MIDI_RT_START:
+        syncPosition = 0;
+        syncRunning = true;
+        if (syncCb.transport != NULL)
+        {
+            syncCb.transport(msg, syncPosition);
+        }
+        break;
+
+    case MIDI_RT_CONTINUE:
+    case MIDI_RT_STOP:
+        syncRunning = (msg == MIDI_RT_CONTINUE);
+        if (syncCb.transport != NULL)
+        {
+            syncCb.transport(msg, syncPosition);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Process a received song position pointer.
+ * @param pos Position in sixteenth notes
+ */
+void clock_sync_song_position(uint16_t pos)
+{
+    if (!syncEnabled)
+    {
+        return;
+    }
+
+    syncPosition = (uint32_t)pos * CLOCK_SYNC_CLOCKS_PER_SPP;
+    if (syncCb.transport != NULL)
+    {
+        syncCb.transport(MIDI_SONG_POSITION, syncPosition);
+    }
+}
+
+/**
+ * @brief Detect a lost clock, must be called regularly.
+ * @param nowUs Current time in microseconds
+ */
+void clock_sync_loop(uint32_t nowUs)
+{
+    if (syncActive && (nowUs - syncLastRxUs) > (uint32_t)(syncPeriodQ8 >> TEMPO_TICK_BITS) * SYNC_TIMEOUT_PERIODS)
+    {
+        syncActive = false;
+        sync_set_locked(false);
+        if (syncCb.lost != NULL)
+        {
+            syncCb.lost();
+        }
+    }
+}
+
+/**
+ * @brief Check if an external clock is currently followed.
+ * @return true while clock is received
+ */
+bool clock_sync_active(void)
+{
+    return syncActive;
+}
+
+/**
+ * @brief Check if the filter is locked to the received clock.
+ * @return true if locked
+ */
+bool clock_sync_locked(void)
+{
+    return syncLocked;
+}
+
+/**
+ * @brief Get tempo and tracking statistics.
+ * @param stats Filled with the current values
+ * @param reset Restart the error statistics afterwards
+ */
+void clock_sync_get_stats(struct clock_sync_stats_s *stats, bool reset)
+{
+    stats->locked = syncLocked;
+    stats->tempo = syncActive ? tempo_from_tick_q8((uint32_t)syncPeriodQ8, CLOCK_SYNC_PPQN) : 0;
+    stats->clocks = statClocks;
+    stats->phaseErrorRmsUs = statPhaseCount ? (uint32_t)sqrtf((float)(statPhaseSq / statPhaseCount)) : 0;
+    stats->phaseErrorMaxUs = statPhaseMax;
+    stats->jitterMaxUs = statJitterMax;
+    stats->relocks = statRelocks;
+
+    if (reset)
+    {
+        statPhaseSq = 0;
+        statPhaseCount = 0;
+        statPhaseMax = 0;
+        statJitterMax = 0;
+    }
+}
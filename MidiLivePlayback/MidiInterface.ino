@@ -65,7 +65,31 @@
 #define MIDI_FMT_INT
 #include <midi_interface.h> /* requires ML_SynthTools library from https://github.com/marcel-licence/ML_SynthTools */
 
+#include "IdleLoop.h"
+#include "LatencyProbe.h"
+#include "LiveTransform.h"
+#include "MidiClockSync.h"
+#include "MidiOut.h"
+#include "MidiTelemetry.h"
+#include "MidiTransport.h"
+#include "MidiRecorder.h"
+
+
+#define MIDI_BYTE_US            320U /* 10 bits at 31250 baud */
+
+#if (MIDI_OUT_PORTS > 1 && !defined(COM_SERIAL_2)) || (MIDI_OUT_PORTS > 2 && !defined(COM_SERIAL_3)) || MIDI_OUT_PORTS > 3
+#error "MIDI_OUT_PORTS needs a serial port per synth in MidiTransport.h"
+#endif
+
+#if defined(CONFIG_IDF_TARGET_ESP32C3) || defined(CONFIG_IDF_TARGET_ESP32C6) || defined(CONFIG_IDF_TARGET_ESP32S3)
+#define MIDI_RX_TIMESTAMP_CALLBACK
+#endif
+
+static uint32_t midi_com_rx_time(void);
+
 static struct midi_port_s comPort;
+static MidiTeleRx comRx(COM_SERIAL, midi_com_rx_time); /* the parser reads through the traffic counters and the input capture */
+static volatile uint32_t comRxUs = 0;
 
 static uint8_t currentChannel = 0;
 
@@ -85,7 +109,7 @@ void sendRPN(uint8_t channel, uint16_t rpn, uint8_t value)
     uint8_t status = 0xB0U | (channel & 0x0FU); // Control Change on channel
     uint8_t msg[] = {status, MIDI_CC_RPN_MSB, (uint8_t)((rpn >> 8U) & 0xFFU), MIDI_CC_RPN_LSB, (uint8_t)(rpn & 0xFFU), 0x06U, value};
 
-    COM_SERIAL.write(msg, sizeof(msg));
+    midi_out_write(MIDI_OUT_SRC_LIVE, msg, sizeof(msg));
 }
 
 /**
@@ -104,7 +128,7 @@ void sendNRPN(uint8_t channel, uint16_t nrpn, uint8_t value)
     uint8_t status = 0xB0 | (channel & 0x0F); // Control Change on channel
     uint8_t msg[] = {status, MIDI_CC_NRPN_MSB, (uint8_t)((nrpn >> 8U) & 0xFF), MIDI_CC_NRPN_LSB, (uint8_t)(nrpn & 0xFFU), MIDI_CC_DATA_ENTRY_MSB, value};
 
-    COM_SERIAL.write(msg, sizeof(msg));
+    midi_out_write(MIDI_OUT_SRC_LIVE, msg, sizeof(msg));
 }
 
 /**
@@ -146,7 +170,7 @@ void send_data_set_gs_sysex(uint16_t parameterAddr, uint8_t value)
         SYSEX_END
     };
 
-    COM_SERIAL.write(sysex_msg, sizeof(sysex_msg));
+    midi_out_write(MIDI_OUT_SRC_LIVE, sysex_msg, sizeof(sysex_msg));
 }
 
 /**
@@ -170,11 +194,11 @@ void sendNRPN3707Volume(uint8_t channel, uint8_t value)
 void send_gm_reset_msg(void)
 {
     uint8_t gm_reset_msg[] = {0xF0, 0x7E, 0x7F, 0x09, 0x01, 0xF7};
-    COM_SERIAL.write(gm_reset_msg, sizeof(gm_reset_msg));
+    midi_out_write(MIDI_OUT_SRC_LIVE, gm_reset_msg, sizeof(gm_reset_msg));
 }
 
 /**
- * @brief Send MIDI Note On message.
+ * @brief Send MIDI Note On message, split, layered and transposed by the active profile (see LiveProfile.ino).
  * @param ch MIDI channel
  * @param note Note number
  * @param vel Velocity
@@ -182,30 +206,47 @@ void send_gm_reset_msg(void)
 void App_NoteOn(uint8_t ch, uint8_t note, uint8_t vel)
 {
     currentChannel = ch;
-    uint8_t midiMsg[] = {(uint8_t)(ch | 0x90U), note, vel};
-    COM_SERIAL.write(midiMsg, sizeof(midiMsg));
+    struct xf_note_s out[XF_LAYERS_MAX];
+    uint8_t count = xf_note_on(ch, note, vel, out);
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint8_t midiMsg[] = {(uint8_t)(out[i].ch | 0x90U), out[i].note, out[i].vel};
+        midi_out_write(MIDI_OUT_SRC_LIVE, midiMsg, sizeof(midiMsg));
+    }
 }
 
 /**
- * @brief Send MIDI Note Off message.
+ * @brief Send MIDI Note Off message to all notes played by the note on.
  * @param ch MIDI channel
  * @param note Note number
  */
 void App_NoteOff(uint8_t ch, uint8_t note)
 {
-    uint8_t midiMsg[] = {(uint8_t)(ch | 0x80U), note, 0U};
-    COM_SERIAL.write(midiMsg, sizeof(midiMsg));
+    struct xf_note_s out[XF_LAYERS_MAX];
+    uint8_t count = xf_note_off(ch, note, out);
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint8_t midiMsg[] = {(uint8_t)(out[i].ch | 0x80U), out[i].note, 0U};
+        midi_out_write(MIDI_OUT_SRC_LIVE, midiMsg, sizeof(midiMsg));
+    }
 }
 
 /**
- * @brief Send MIDI Pitch Bend message.
+ * @brief Send MIDI Pitch Bend message to all channels the input channel plays on.
  * @param ch MIDI channel
  * @param amount Pitch bend value (0-16383)
  */
 void App_PitchBend(uint8_t ch, uint16_t amount)
 {
-    uint8_t midiMsg[] = {(uint8_t)(ch | 0xE0U), (uint8_t)(amount & 0x7FU), (uint8_t)((amount >> 7) & 0x7FU)};
-    COM_SERIAL.write(midiMsg, sizeof(midiMsg));
+    uint16_t channels = xf_channels(ch);
+    for (uint8_t outCh = 0; channels != 0; outCh++, channels >>= 1U)
+    {
+        if (channels & 1U)
+        {
+            uint8_t midiMsg[] = {(uint8_t)(outCh | 0xE0U), (uint8_t)(amount & 0x7FU), (uint8_t)((amount >> 7) & 0x7FU)};
+            midi_out_write(MIDI_OUT_SRC_LIVE, midiMsg, sizeof(midiMsg));
+        }
+    }
 }
 
 /**
@@ -216,7 +257,7 @@ void App_PitchBend(uint8_t ch, uint16_t amount)
 void App_ProgramChange(uint8_t ch, uint8_t program)
 {
     uint8_t midiMsg[] = {(uint8_t)(ch | 0xC0U), program};
-    COM_SERIAL.write(midiMsg, sizeof(midiMsg));
+    midi_out_write(MIDI_OUT_SRC_LIVE, midiMsg, sizeof(midiMsg));
 }
 
 /**
@@ -228,7 +269,7 @@ void App_ProgramChange(uint8_t ch, uint8_t program)
 void midi_send_cc(uint8_t ch, uint8_t data0, uint8_t data1)
 {
     uint8_t midiMsg[] = {(uint8_t)(ch | 0xB0U), data0, data1};
-    COM_SERIAL.write(midiMsg, sizeof(midiMsg));
+    midi_out_write(MIDI_OUT_SRC_LIVE, midiMsg, sizeof(midiMsg));
 }
 
 /**
@@ -390,7 +431,7 @@ struct midiControllerMapping edirolMapping[] =
     { 0x8, 0x52, "back", NULL, NULL, 0},
     { 0xD, 0x52, "stop", NULL, NULL, 0},
     { 0xe, 0x52, "start", NULL, NULL, 0},
-    { 0xa, 0x52, "rec", NULL, NULL, 0},
+    { 0xa, 0x52, "rec", NULL, App_Record, 0},
 
     /* upper row of buttons */
     { 0x0, 0x50, "A1", NULL, NULL, 0},
@@ -445,16 +486,81 @@ struct midiControllerMapping edirolMapping[] =
     { 0x1, 0x12, "S9", NULL, SAM2695_Set_MasterKeyShift, 65},
 };
 
+#ifdef MIDI_RX_TIMESTAMP_CALLBACK
+/**
+ * @brief Called from the UART task for every received byte, keeps the reception time of the latest byte
+ *        and ends the wait of the loop.
+ */
+static void midi_com_rx_cb(void)
+{
+    comRxUs = micros();
+    idle_wake();
+}
+#endif
+
+/**
+ * @brief Estimate the reception time of the byte which has just been read from COM_SERIAL.
+ * @return Time in microseconds
+ */
+static uint32_t midi_com_rx_time(void)
+{
+#ifdef MIDI_RX_TIMESTAMP_CALLBACK
+    /* all bytes still waiting in the buffer have been received after the current one */
+    return comRxUs - (uint32_t)MidiCom::available(COM_SERIAL) * MIDI_BYTE_US;
+#else
+    return micros();
+#endif
+}
+
+/**
+ * @brief Handle received real time messages like clock, start, continue and stop.
+ * @param msg Message byte
+ */
+void App_RealTime(uint8_t msg)
+{
+    clock_sync_realtime(msg, midi_com_rx_time());
+}
+
+/**
+ * @brief Handle received song position pointer.
+ * @param pos Position in sixteenth notes
+ */
+void App_SongPosition(uint16_t pos)
+{
+    clock_sync_song_position(pos);
+}
+
+/**
+ * @brief Called for every received channel message before it is dispatched,
+ *        passes it to the recorder and starts the latency measurement.
+ * @param msg Message, status byte first
+ */
+void App_RawMsg(uint8_t *msg)
+{
+    bool recording = rec_state() == REC_RUNNING;
+    if ((!recording && !lat_probe_enabled()) || msg[0] < 0x80U || msg[0] >= 0xF0U)
+    {
+        return;
+    }
+    uint32_t rxUs = midi_com_rx_time();
+    if (recording)
+    {
+        uint8_t len = ((msg[0] & 0xE0U) == 0xC0U) ? 2U : 3U;
+        rec_event(msg, len, rxUs);
+    }
+    lat_probe_in(msg, rxUs);
+}
+
 struct midiMapping_s midiMapping =
 {
-    .rawMsg = NULL,
+    .rawMsg = App_RawMsg,
     .noteOn = App_NoteOn,
     .noteOff = App_NoteOff,
     .pitchBend = App_PitchBend,
     .modWheel = NULL,
     .programChange = App_ProgramChange,
-    .rttMsg = NULL,
-    .songPos = NULL,
+    .rttMsg = App_RealTime,
+    .songPos = App_SongPosition,
     .controlMapping = edirolMapping,
     .mapSize = sizeof(edirolMapping) / sizeof(edirolMapping[0]),
 };
@@ -464,7 +570,23 @@ struct midiMapping_s midiMapping =
  */
 void midi_com_setup(void)
 {
-    comPort.serial = &COM_SERIAL;
+    comPort.serial = &comRx;
+    midi_out_init(&COM_SERIAL, COM_SERIAL_TX_FIFO);
+#if MIDI_OUT_PORTS > 1
+    /* further synths only receive, see MidiOut.h */
+    COM_SERIAL_2.begin(MIDI_SERIAL_BAUD_RATE, SERIAL_8N1, -1, COM_SERIAL_2_TX_PIN);
+    midi_out_set_port(1, &COM_SERIAL_2, COM_SERIAL_TX_FIFO);
+#endif
+#if MIDI_OUT_PORTS > 2
+    COM_SERIAL_3.begin(MIDI_SERIAL_BAUD_RATE, SERIAL_8N1, -1, COM_SERIAL_3_TX_PIN);
+    midi_out_set_port(2, &COM_SERIAL_3, COM_SERIAL_TX_FIFO);
+#endif
+
+#ifdef MIDI_RX_TIMESTAMP_CALLBACK
+    /* one event per byte for precise clock timestamps */
+    COM_SERIAL.setRxFIFOFull(1);
+    COM_SERIAL.onReceive(midi_com_rx_cb);
+#endif
 }
 
 /**
@@ -472,5 +594,113 @@ void midi_com_setup(void)
  */
 void midi_com_loop(void)
 {
-    Midi_CheckMidiPort(&comPort, 0);
+    /* most loops find nothing received, that check is bound to the serial type instead of a virtual call */
+    int received = MidiCom::available(COM_SERIAL);
+    if (received > 0)
+    {
+        midi_tele_rx_waiting((uint16_t)received);
+        Midi_CheckMidiPort(&comPort, 0);
+    }
+    lat_probe_in_done();
+    uint32_t nowUs = micros();
+    clock_sync_loop(nowUs);
+    midi_tele_loop(nowUs);
+}
+
+/**
+ * @brief Console command: latency [on|off|reset]
+ *        Switches the through latency measurement and prints min, mean, p99 and max per message type in us.
+ * @param args Command arguments
+ */
+void Console_Latency(const char *args)
+{
+    if (strcmp(args, "on") == 0)
+    {
+        lat_probe_set_enabled(true);
+    }
+    else if (strcmp(args, "off") == 0)
+    {
+        lat_probe_set_enabled(false);
+    }
+    else if (strcmp(args, "reset") == 0)
+    {
+        lat_probe_reset();
+    }
+
+    SHOW_SERIAL.printf("through latency %s, reception to queued and to the last byte sent [us]\n", lat_probe_enabled() ? "on" : "off");
+    lat_probe_print(&SHOW_SERIAL);
+}
+
+/**
+ * @brief Console command: traffic [reset]
+ *        Prints bytes, rates against the line, messages, running status, SysEx, errors and queue high-water
+ *        of the received stream and of every synth port, then the channel messages per channel.
+ * @param args Command arguments
+ */
+void Console_Traffic(const char *args)
+{
+    if (strcmp(args, "reset") == 0)
+    {
+        midi_tele_reset();
+    }
+    midi_tele_print(&SHOW_SERIAL);
+}
+
+/**
+ * @brief Console command: merge [prio|fair|channel|voice|reset]
+ *        Selects the scheduling of the output merger and the spreading over the synths,
+ *        prints bytes, messages and waiting time per source, bytes and voices per synth
+ *        and the transmission time of SysEx messages with the pauses given to the synth.
+ * @param args Command arguments
+ */
+void Console_Merge(const char *args)
+{
+    if (strcmp(args, "prio") == 0)
+    {
+        midi_out_set_fair(false);
+    }
+    else if (strcmp(args, "fair") == 0)
+    {
+        midi_out_set_fair(true);
+    }
+    else if (strcmp(args, "channel") == 0)
+    {
+        midi_out_set_route(MIDI_OUT_ROUTE_CHANNEL);
+    }
+    else if (strcmp(args, "voice") == 0)
+    {
+        midi_out_set_route(MIDI_OUT_ROUTE_VOICE);
+    }
+    else if (strcmp(args, "reset") == 0)
+    {
+        midi_out_reset_stats();
+    }
+
+    static const char *srcNames[MIDI_OUT_SRC_COUNT] = {"live", "ui", "player"};
+    SHOW_SERIAL.printf("output merger %s, %u bytes queued\n", midi_out_fair() ? "round robin" : "priority", midi_out_pending());
+    SHOW_SERIAL.printf("%-7s %9s %9s %8s %10s %12s %12s %11s\n", "source", "messages", "bytes", "dropped", "high-water", "wait avg us", "wait max us", "blocked us");
+    for (uint8_t src = 0; src < MIDI_OUT_SRC_COUNT; src++)
+    {
+        struct midi_out_stats_s stats;
+        midi_out_get_stats(src, &stats);
+        SHOW_SERIAL.printf("%-7s %9lu %9lu %8lu %10u %12lu %12lu %11lu\n", srcNames[src], (unsigned long)stats.messages, (unsigned long)stats.bytes,
+                           (unsigned long)stats.dropped, stats.highWater, (unsigned long)stats.waitAvgUs, (unsigned long)stats.waitMaxUs,
+                           (unsigned long)stats.blockedUs);
+    }
+
+    SHOW_SERIAL.printf("%u synth ports, spread by %s\n", midi_out_ports(), (midi_out_route() == MIDI_OUT_ROUTE_VOICE) ? "voice" : "channel");
+    for (uint8_t port = 0; port < midi_out_ports(); port++)
+    {
+        struct midi_out_port_stats_s stats;
+        midi_out_get_port_stats(port, &stats);
+        SHOW_SERIAL.printf("  port %u: %lu messages, %lu bytes, %u queued, %u voices (peak %u)\n", port, (unsigned long)stats.messages,
+                           (unsigned long)stats.bytes, stats.pending, stats.voices, stats.voicesPeak);
+    }
+
+    struct midi_out_sysex_stats_s sysex;
+    midi_out_get_sysex_stats(&sysex);
+    SHOW_SERIAL.printf("sysex %lu messages, %lu bytes, %lu ms sending (max %lu, last %lu), %lu ms pause\n", (unsigned long)sysex.count,
+                       (unsigned long)sysex.bytes, (unsigned long)(sysex.totalUs / 1000U), (unsigned long)(sysex.maxUs / 1000U),
+                       (unsigned long)(sysex.lastUs / 1000U), (unsigned long)(sysex.pauseUs / 1000U));
+    SHOW_SERIAL.printf("system common during sysex: %lu deferred, %lu dropped\n", (unsigned long)sysex.deferred, (unsigned long)sysex.deferDropped);
 }
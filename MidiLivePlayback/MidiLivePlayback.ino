@@ -22,7 +22,7 @@
  * Mode 2:(Bpm Mode)
  *      The indicator blinks every 0.5 seconds, ON for 0.5s, OFF for 0.5s
  *      Button A: 
- *              Short press: None                
+ *              Short press: Tap tempo, the drum beat follows the last tap
  *              Long press: None
  *      Button B: 
  *              Short press: Decrease BPM         
@@ -57,6 +57,14 @@
 #include "BpmMode.h"
 #include "TrackMode.h"
 #include "ErrorState.h"
+#include "IdleLoop.h"
+#include "InputCapture.h"
+#include "Log.h"
+#include "MidiClockOut.h"
+#include "MidiClockSync.h"
+#include "MidiOut.h"
+#include "MidiTransport.h"
+#include "StaticAlloc.h"
 #include "music.h"
 
 //LED toggle events corresponding to different modes
@@ -64,48 +72,44 @@
 #define STATE_2_LED_TIME 500
 #define STATE_3_LED_TIME 100
 
+//the loop sleeps between its deadlines, see IdleLoop.h
+#define BUTTON_POLL_US      1000U   //poll interval while a button is down
+#define BUTTON_SETTLE_MS    100U    //polled as often after the last release, covers the debounce of the button library
+
+//USB serial per board, the serial port of the synth (COM_SERIAL) is selected in MidiTransport.h
 #ifdef __AVR__
     #include <SoftwareSerial.h>
     SoftwareSerial SSerial(2, 3); // RX, TX
-    #define COM_SERIAL SSerial
     #define SHOW_SERIAL Serial
-    SAM2695Synth<SoftwareSerial> synth = SAM2695Synth<SoftwareSerial>::getInstance();
 #endif
 
 #if defined(ARDUINO_ARCH_RP2040) || defined(ARDUINO_ARCH_RP2350) ||  defined(ARDUINO_XIAO_RA4M1) 
     #include <SoftwareSerial.h>
     SoftwareSerial SSerial(D7, D6); // RX, TX
-    #define COM_SERIAL SSerial
     #define SHOW_SERIAL Serial
-    SAM2695Synth<SoftwareSerial> synth = SAM2695Synth<SoftwareSerial>::getInstance();
 #endif
 
 #if  defined(CONFIG_IDF_TARGET_ESP32C3) || defined(CONFIG_IDF_TARGET_ESP32C6) || defined(CONFIG_IDF_TARGET_ESP32S3)
-    #define COM_SERIAL Serial0
     #define SHOW_SERIAL Serial
-    SAM2695Synth<HardwareSerial> synth = SAM2695Synth<HardwareSerial>::getInstance();
 #endif
 
 #if defined(NRF52840_XXAA)
     #ifdef USE_TINYUSB
     #include <Adafruit_TinyUSB.h>
     #endif
-    #define COM_SERIAL Serial1
     #define SHOW_SERIAL Serial
-
-    SAM2695Synth<Uart> synth = SAM2695Synth<Uart>::getInstance();
 #endif
 
 #ifdef SEEED_XIAO_M0
-    #define COM_SERIAL Serial1
     #define SHOW_SERIAL Serial
-    SAM2695Synth<Uart> synth = SAM2695Synth<Uart>::getInstance();
 #elif defined(ARDUINO_SAMD_VARIANT_COMPLIANCE)
-    #define COM_SERIAL Serial1
     #define SHOW_SERIAL SerialUSB
-    SAM2695Synth<Uart> synth = SAM2695Synth<Uart>::getInstance();
 #endif
 
+//the synth library writes through the output merger like all other sources, see MidiOut.h
+MidiOutPort synthPort(MIDI_OUT_SRC_UI);
+SAM2695Synth<MidiOutPort> synth = SAM2695Synth<MidiOutPort>::getInstance();
+
 #if defined(CONFIG_IDF_TARGET_ESP32S3)
     #define BUTTON_A_PIN 4
     #define BUTTON_B_PIN 3
@@ -153,23 +157,21 @@ ButtonFlags buttonFlags[] = {
 StateMachine stateMachine;
 StateManager* manager = StateManager::getInstance();
 
+//the states live in static memory, see StaticMemory.ino
+AuditionMode auditionMode;
+BpmMode bpmMode;
+TrackMode trackMode;
+ErrorState errorState;
+
 int beatCount = 0;                                  // Beat counter
-int noteType = QUATER_NOTE;                         // Note type selection: 0 (quarter note), 1 (eighth note), 2 (sixteenth note)
-int beatsPerBar = BEATS_BAR_DEFAULT;                // Beats per measure, can be 2, 3, or 4
-
-unsigned long preMillisCh_1 = 0;                    // Record the time of the last MIDI signal sent on track 1
-unsigned long preMillisCh_2 = 0;                    // Record the time of the last MIDI signal sent on track 2
-unsigned long preMillisCh_3 = 0;                    // Record the time of the last MIDI signal sent on track 3
-unsigned long preMillisCh_4 = 0;                    // Record the time of the last MIDI signal sent on track 4
-unsigned long preMillisCh_drup = 0;                 // Record the time of the last MIDI signal sent on track drup
-uint8_t drupCount = 0;                              // drup track count
-uint8_t countBytrack1 = 0;                          // music 1 count
-uint8_t countBytrack2 = 0;                          // music 2 count
+int noteType = QUATER_NOTE;                         // Note type selection: 0 (quarter note), 1 (eighth note), 2 (sixteenth note), sets the drum step length
+int beatsPerBar = BEATS_BAR_DEFAULT;                // Beats per measure, can be 2, 3, or 4, sets the drum pattern length
 
 //LED data
 uint8_t  modeID = AuditionMode::ID;                 // state mode id 
 int ledTime = STATE_1_LED_TIME;                     // LED toggle events TIME
 unsigned long previousMillisLED = 0;                // Record the time of  the last LED toggle               
+bool ledOn = false;                                 // LED state, not read back from the pin
 
 void setup()
 {
@@ -178,9 +180,14 @@ void setup()
 
     //  serial init to usb
     SHOW_SERIAL.begin(USB_SERIAL_BAUD_RATE);
-    // Synth initialization. Since a hardware serial port is used here, the software serial port is commented out.
-    synth.begin(COM_SERIAL, MIDI_SERIAL_BAUD_RATE);
+    // log lines are buffered and written by log_loop(), never to the synth serial
+    log_init(&SHOW_SERIAL);
+    // Synth serial and the output merger, the synth library writes through synthPort
+    COM_SERIAL.begin(MIDI_SERIAL_BAUD_RATE);
+    midi_com_setup();
+    synth.begin(synthPort, MIDI_SERIAL_BAUD_RATE);
     synth.setInstrument(0,CHANNEL_0,unit_synth_instrument_t::GrandPiano_1);
+    app_set_tempo(tempo_from_bpm(synth.getBpm()));
     // initialize the led
     pinMode(LED_PIN, OUTPUT);
     // Initialize the buttons you are using.
@@ -188,25 +195,118 @@ void setup()
     initButtons(BUTTON_B_PIN);
     initButtons(BUTTON_C_PIN);
     initButtons(BUTTON_D_PIN);
+    //a press ends the wait of the loop, received data is checked by app_idle_pending()
+    idle_init(app_idle_pending);
+    idle_wake_pin(BUTTON_A_PIN);
+    idle_wake_pin(BUTTON_B_PIN);
+    idle_wake_pin(BUTTON_C_PIN);
+    idle_wake_pin(BUTTON_D_PIN);
     delay(3000);
+    //sequencer tracks played by the modes
+    seq_init(seqPatternPool, sizeof(seqPatternPool) / sizeof(seqPatternPool[0]), app_seq_note_on, app_seq_note_off);
+    note_sched_init(app_seq_note_on, app_seq_note_off);
+    seq_track_setup(TRACK_CHORD_1, PATTERN_CHORD_1);
+    seq_track_setup(TRACK_CHORD_2, PATTERN_CHORD_2);
+    seq_track_setup(TRACK_MELODY_1, PATTERN_MELODY_1_A);
+    seq_track_setup(TRACK_MELODY_2, PATTERN_MELODY_2);
+    seq_track_setup(TRACK_DRUM, PATTERN_DRUM);
     //regist three mode state
-    manager->registerState(new AuditionMode());
-    manager->registerState(new BpmMode());
-    manager->registerState(new TrackMode());
+    manager->registerState(&auditionMode);
+    manager->registerState(&bpmMode);
+    manager->registerState(&trackMode);
     //regist error state
-    ErrorState* errorState = new ErrorState();
-    manager->registerState(errorState);
+    manager->registerState(&errorState);
     //init state machine
-    if(!(stateMachine.init(manager->getState(AuditionMode::ID), errorState)))
+    if(!(stateMachine.init(manager->getState(AuditionMode::ID), &errorState)))
     {
-        StateManager::releaseInstance();
+        //the states are static, the manager must not delete them
         return ;
     }
 
     /* prepare the MIDI input */
-    midi_com_setup();
+    midi_sync_setup();
+    midi_clock_out_setup();
+    midi_record_setup();
+    live_profile_setup();
+    input_capture_setup();
+
+    LOG_I("synth and state machine ready!");
+    log_flush();
+    static_memory_report();
+    static_alloc_lock();
+}
+
+/**
+ * @brief Received data waits on the synth serial or the console, ends the wait of the loop.
+ * @return true if data has been received
+ */
+bool app_idle_pending(void)
+{
+    return MidiCom::available(COM_SERIAL) > 0 || SHOW_SERIAL.available() > 0;
+}
+
+/**
+ * @brief Collect the deadlines of this pass and sleep until the earliest one.
+ */
+void app_idle(void)
+{
+    static uint32_t buttonDownMs = 0;
+    uint32_t nowUs = micros();
+    uint32_t nowMs = millis();
+    uint32_t dueUs;
+
+    if (seq_next_us(&dueUs))
+    {
+        idle_due_at(dueUs);
+    }
+    if (note_sched_next_us(&dueUs))
+    {
+        idle_due_at(dueUs);
+    }
+
+    int32_t ledMs = ledTime - (int32_t)(nowMs - previousMillisLED);
+    idle_due_at(nowUs + (uint32_t)((ledMs > 0) ? ledMs : 0) * 1000U);
+
+    //the button library debounces and times long presses with millis(), it is polled while a button is in use
+    if (digitalRead(BUTTON_A_PIN) == LOW || digitalRead(BUTTON_B_PIN) == LOW || digitalRead(BUTTON_C_PIN) == LOW || digitalRead(BUTTON_D_PIN) == LOW)
+    {
+        buttonDownMs = nowMs;
+    }
+    if (nowMs - buttonDownMs < BUTTON_SETTLE_MS)
+    {
+        idle_due_at(nowUs + BUTTON_POLL_US);
+    }
+
+    //the merger keeps only a few bytes in the UART, it has to run again before they are sent
+    if (midi_out_pending() > 0)
+    {
+        idle_due_at(nowUs + MIDI_OUT_BYTE_US);
+    }
+
+    idle_wait();
+}
+
+/**
+ * @brief Console command: idle [on|off]
+ *        Switches the sleep of the loop and prints utilization and wake-ups of the last second.
+ * @param args Command arguments
+ */
+void Console_Idle(const char *args)
+{
+    if (strcmp(args, "on") == 0)
+    {
+        idle_set_enabled(true);
+    }
+    else if (strcmp(args, "off") == 0)
+    {
+        idle_set_enabled(false);
+    }
 
-    SHOW_SERIAL.println("synth and state machine ready!");
+    struct idle_stats_s stats;
+    idle_get_stats(&stats);
+    SHOW_SERIAL.printf("idle %s, load %u.%u %%, %lu loops/s, %lu wake-ups/s\n", stats.enabled ? "on" : "off",
+                       stats.loadPermille / 10U, stats.loadPermille % 10U, (unsigned long)stats.loopsPerSec, (unsigned long)stats.wakeupsPerSec);
+    SHOW_SERIAL.printf("  longest wait %lu us, woken late by %lu us at most\n", (unsigned long)stats.sleepMaxUs, (unsigned long)stats.lateMaxUs);
 }
 
 void loop()
@@ -214,6 +314,8 @@ void loop()
     /* processing received MIDI data */
     midi_com_loop();
 
+    console_loop();
+
     Event* event = getNextEvent();
     if(event != nullptr)
     {
@@ -223,10 +325,24 @@ void loop()
     }
     multiTrackPlay();
     ledShow();
+
+    midi_clock_out_loop();
+
+    midi_record_loop();
+
+    input_capture_loop();
+
+    log_loop();
+
+    static_alloc_check(millis());
+
+    app_idle();
 }
 
 Event* getNextEvent()
 {
+    // taken before the detection, so the time of a press does not depend on how long the event handler runs
+    uint32_t detectUs = micros();
     // detectButtonEvents(BUTTON_A_PIN, btnA, act);
     detectButtonEvents(BUTTON_A_PIN, btnA, shortPressFlag_A, longPressFlag_A, releaseFlag_A);
     detectButtonEvents(BUTTON_B_PIN, btnB, shortPressFlag_B, longPressFlag_B, releaseFlag_B);
@@ -236,10 +352,14 @@ Event* getNextEvent()
     for (const auto& flags : buttonFlags) {
         if (flags.shortPress) {
             flags.shortPress = false;
+            btnEventUs = detectUs;
+            cap_button((uint8_t)(&flags - buttonFlags), CAP_BUTTON_PRESS, detectUs);
             return stateMachine.getEvent(flags.shortPressType);
         }
         if (flags.longPress) {
             flags.longPress = false;
+            btnEventUs = detectUs;
+            cap_button((uint8_t)(&flags - buttonFlags), CAP_BUTTON_LONG, detectUs);
             return stateMachine.getEvent(flags.longPressType);
         }
     }
@@ -249,6 +369,7 @@ Event* getNextEvent()
         if (flags.release) {
             anyReleased = true;
             flags.release = false;
+            cap_button((uint8_t)(&flags - buttonFlags), CAP_BUTTON_RELEASE, detectUs);
         }
     }
 
@@ -279,71 +400,42 @@ void ledShow()
     if(currentMillis - previousMillisLED >= ledTime)
     {
         previousMillisLED = millis();
-        digitalWrite(LED_PIN, !digitalRead(LED_PIN));
+        ledOn = !ledOn;
+        digitalWrite(LED_PIN, ledOn ? HIGH : LOW);
     }
 }
 
-//Multi-track chord play"
-void multiTrackPlay()
-{
-    unsigned long currentMillis = millis();
-    if(channel_1_on_off_flag)
-    {
-        if (currentMillis - preMillisCh_1 >= channel_1_chord.delay)
-        {
-            preMillisCh_1 = currentMillis;
-            synth.playChord(channel_1_chord);
-        }
-    }
-
-    if(channel_2_on_off_flag)
-    {
-        if(currentMillis - preMillisCh_2 >= channel_2_chord.delay)
-        {
-            preMillisCh_2 = currentMillis;
-            synth.playChord(channel_2_chord);
-        }
-    }
+static tempo_q16_t appTempo = TEMPO_DEFAULT;
 
-    if(channel_3_on_off_flag)
-    {
-        if(currentMillis - preMillisCh_3 >= track1[countBytrack1].delay)
-        {
-            preMillisCh_3 = currentMillis;
-            if(track1[countBytrack1].index == countBytrack1)
-            {
-                synth.playChord(track1[countBytrack1]);
-                countBytrack1 = (countBytrack1+1) % (sizeof(track1)/sizeof(track1[0]));
-            }
-        }
-    }
+void app_set_tempo(tempo_q16_t tempo)
+{
+    appTempo = tempo_clamp(tempo);
+    synth.setBpm(tempo_to_bpm(appTempo));
+    seq_set_tempo(appTempo);
+    clock_out_set_tempo(appTempo);
+}
 
-    if(channel_4_on_off_flag)
-    {
-        if(currentMillis - preMillisCh_4 >= track2[countBytrack2].delay)
-        {
-            preMillisCh_4 = currentMillis;
-            if(track2[countBytrack2].index == countBytrack2)
-            {
-                synth.playChord(track2[countBytrack2]);
-                countBytrack2 = (countBytrack2+1) % (sizeof(track2)/sizeof(track2[0]));
-            }
-        }
-    }
+tempo_q16_t app_get_tempo(void)
+{
+    return appTempo;
+}
 
-    unsigned long interval = (BASIC_TIME / synth.getBpm()) / (noteType + 1);
-    if (drum_on_off_flag)
-    {
-        if(currentMillis - preMillisCh_drup >= interval)
-        {
-            preMillisCh_drup = currentMillis;
-            if(track3[drupCount].index == drupCount )
-            {
-                synth.playChord(track3[drupCount]);
-            }
-            drupCount = (drupCount + 1) % (sizeof(track3)/sizeof(track3[0]));
-        }
-    }
+void app_seq_note_on(uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    synth.setNoteOn(channel, note, velocity);
 }
 
+void app_seq_note_off(uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    synth.setNoteOff(channel, note, velocity);
+}
 
+//Multi-track chord play, all tracks run on the clock of the step sequencer which may follow an external MIDI clock,
+//notes played with a length by the UI are released on time here as well
+void multiTrackPlay()
+{
+    seq_set_meter(beatsPerBar, noteType + 1);
+    uint32_t nowUs = micros();
+    seq_loop(nowUs);
+    note_sched_loop(nowUs);
+}
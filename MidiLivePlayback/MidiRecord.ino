@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MidiRecord.ino
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Record mode of the live playback.
+ *        Received channel messages are passed to the recorder (MidiRecorder.h) with their reception time,
+ *        the takes are written as MIDI files to LittleFS and can be played by the MidiFilePlayer sketch.
+ *        On ESP32 the file is written by a task of its own at the priority of the loop,
+ *        so the loop keeps forwarding MIDI while the flash is busy. Other cores write from the loop.
+ *        Started and stopped by the console command rec or the rec button of the controller.
+ */
+
+
+#include <Arduino.h>
+
+#include <FS.h>
+#include <LittleFS.h>
+
+#include "Log.h"
+#include "MidiRecorder.h"
+#include "StaticAlloc.h"
+
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#define MIDI_RECORD_TASK
+#endif
+
+#define RECORD_FORMAT_IF_FAILED true
+#define RECORD_DEFAULT_FILE     "/rec.mid"
+#define RECORD_PATH_MAX         32
+#define RECORD_TASK_NAME        "midi_rec"
+#define RECORD_TASK_STACK       4096U   /* bytes */
+#define RECORD_TASK_PRIO        1U      /* same as the loop, never above it */
+
+
+static bool recordFsReady = false;
+static char recordPath[RECORD_PATH_MAX] = RECORD_DEFAULT_FILE;
+static enum rec_state_e recordLastState = REC_IDLE;
+
+#ifdef MIDI_RECORD_TASK
+static StaticTask_t recordTaskBuffer;
+static StackType_t recordTaskStack[RECORD_TASK_STACK];
+static TaskHandle_t recordTask = NULL;
+
+
+/**
+ * @brief Task writing the recorded blocks, sleeps until the loop hands over a block.
+ * @param arg Unused
+ */
+static void midi_record_task(void *arg)
+{
+    (void)arg;
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        rec_process();
+    }
+}
+
+static void midi_record_wakeup(void)
+{
+    xTaskNotifyGive(recordTask);
+}
+#endif
+
+/**
+ * @brief Mount the file system and start the writer task.
+ */
+void midi_record_setup(void)
+{
+    recordFsReady = LittleFS.begin(RECORD_FORMAT_IF_FAILED);
+    if (!recordFsReady)
+    {
+        LOG_E("LittleFS Mount Failed, recording not available");
+    }
+
+#ifdef MIDI_RECORD_TASK
+    recordTask = xTaskCreateStatic(midi_record_task, RECORD_TASK_NAME, RECORD_TASK_STACK, NULL, RECORD_TASK_PRIO, recordTaskStack, &recordTaskBuffer);
+    rec_init(midi_record_wakeup);
+#else
+    rec_init(NULL);
+#endif
+}
+
+/**
+ * @brief Report a finished take, writes the file on cores without the writer task.
+ */
+void midi_record_loop(void)
+{
+#ifndef MIDI_RECORD_TASK
+    rec_process();
+#endif
+
+    enum rec_state_e state = rec_state();
+    if (state == REC_IDLE && recordLastState != REC_IDLE)
+    {
+        struct rec_stats_s stats;
+        rec_get_stats(&stats);
+        LOG_I("take saved: %s, %lu messages, %lu bytes, %lu dropped", recordPath,
+              (unsigned long)stats.events, (unsigned long)stats.bytes, (unsigned long)stats.dropped);
+    }
+    recordLastState = state;
+}
+
+/**
+ * @brief Start recording into a file, an existing file is replaced.
+ * @param path File path, NULL for the default file
+ */
+void midi_record_start(const char *path)
+{
+    if (!recordFsReady)
+    {
+        LOG_E("recording not available");
+        return;
+    }
+    if (rec_state() != REC_IDLE)
+    {
+        LOG_W("previous take is still being written");
+        return;
+    }
+
+    if (path != NULL && path[0] != 0)
+    {
+        snprintf(recordPath, sizeof(recordPath), "%s%s", (path[0] == '/') ? "" : "/", path);
+    }
+
+    static_alloc_exempt_begin();
+    File file = LittleFS.open(recordPath, "w");
+    static_alloc_exempt_end();
+    if (!file)
+    {
+        LOG_E("cannot create %s", recordPath);
+        return;
+    }
+
+    rec_start(file, app_get_tempo(), micros());
+    recordLastState = REC_RUNNING;
+    LOG_I("recording to %s", recordPath);
+}
+
+/**
+ * @brief Stop recording, the file is finished in the background.
+ */
+void midi_record_stop(void)
+{
+    if (rec_state() == REC_RUNNING)
+    {
+        rec_stop();
+        LOG_I("recording stopped");
+    }
+}
+
+/**
+ * @brief Start or stop recording into the default file, used by the rec button of the controller.
+ * @param param Unused
+ * @param value Button state, pressed when above 0
+ */
+void App_Record(uint8_t param, uint8_t value)
+{
+    (void)param;
+    if (value == 0)
+    {
+        return;
+    }
+    if (rec_state() == REC_RUNNING)
+    {
+        midi_record_stop();
+    }
+    else
+    {
+        midi_record_start(NULL);
+    }
+}
+
+/**
+ * @brief Console command: rec [start [file.mid]|stop]
+ *        Starts or stops a take and prints the statistics of the current or last take.
+ * @param args Command arguments
+ */
+void Console_Rec(const char *args)
+{
+    if (strncmp(args, "start", 5) == 0)
+    {
+        const char *path = args + 5;
+        while (*path == ' ')
+        {
+            path++;
+        }
+        midi_record_start(path);
+        log_flush();
+    }
+    else if (strcmp(args, "stop") == 0)
+    {
+        midi_record_stop();
+        log_flush();
+    }
+
+    static const char *stateNames[] = {"idle", "recording", "writing"};
+    struct rec_stats_s stats;
+    rec_get_stats(&stats);
+
+    SHOW_SERIAL.printf("rec %s, %s: %lu messages, %lu dropped, %lu.%03lu s, %lu bytes\n", stateNames[stats.state], recordPath,
+                       (unsigned long)stats.events, (unsigned long)stats.dropped,
+                       (unsigned long)(stats.lengthMs / 1000U), (unsigned long)(stats.lengthMs % 1000U), (unsigned long)stats.bytes);
+    SHOW_SERIAL.printf("  buffer high-water %lu of %lu messages, block write last %lu us, avg %lu us, max %lu us\n",
+                       (unsigned long)stats.highWater, (unsigned long)(REC_BLOCK_EVENTS * REC_BLOCKS),
+                       (unsigned long)stats.flushLastUs, (unsigned long)stats.flushAvgUs, (unsigned long)stats.flushMaxUs);
+
+    if (stats.flushMaxUs > 0)
+    {
+        /* a block has to be written while the other one fills up */
+        SHOW_SERIAL.printf("  flash keeps up with %lu messages/s at the slowest block write\n",
+                           (unsigned long)((uint64_t)REC_BLOCK_EVENTS * 1000000U / stats.flushMaxUs));
+    }
+    if (recordFsReady && stats.events > 0)
+    {
+        uint32_t freeBytes = LittleFS.totalBytes() - LittleFS.usedBytes();
+        SHOW_SERIAL.printf("  %lu bytes free in flash, about %lu more messages\n", (unsigned long)freeBytes,
+                           (unsigned long)((uint64_t)freeBytes * stats.events / (stats.bytes > 0 ? stats.bytes : 1U)));
+    }
+}
@@ -0,0 +1,386 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MidiRecorder.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Implementation of the MIDI recorder.
+ *        The loop fills the blocks, rec_process() empties them. The ready flag of a block passes it between both sides,
+ *        the state is only set to idle by rec_process() after the file has been closed.
+ *        The track length in the header is written with 0 first and patched when the take is finished.
+ */
+
+
+#include "MidiRecorder.h"
+
+#include <Arduino.h>
+
+
+#define REC_HEADER_SIZE     22U /* MThd chunk and MTrk chunk header */
+#define REC_TRACK_LEN_POS   18U
+#define REC_TICK_DIV        ((60000000ULL << TEMPO_FRAC_BITS) / REC_PPQN) /* us * tempo / REC_TICK_DIV = ticks */
+
+
+struct rec_block_s
+{
+    struct rec_event_s events[REC_BLOCK_EVENTS];
+    uint16_t count;
+    volatile bool ready; /* full, waiting for rec_process() */
+};
+
+
+static void (*recWakeup)(void) = NULL;
+
+static struct rec_block_s recBlocks[REC_BLOCKS];
+static uint8_t recFillIdx = 0; /* loop side */
+static uint8_t recFlushIdx = 0; /* rec_process() side */
+static volatile enum rec_state_e recState = REC_IDLE;
+
+static File recFile;
+static uint8_t recOut[REC_OUT_SIZE];
+static uint16_t recOutLen = 0;
+static tempo_q16_t recTempo = TEMPO_DEFAULT;
+static uint32_t recLastUs = 0;
+static uint64_t recElapsedUs = 0;
+static uint64_t recLastTick = 0;
+
+static uint32_t recEvents = 0;
+static uint32_t recDropped = 0;
+static uint32_t recHighWater = 0;
+static uint32_t recBlocksWritten = 0;
+static uint32_t recBytes = 0;
+static uint32_t recFlushLastUs = 0;
+static uint32_t recFlushMaxUs = 0;
+static uint64_t recFlushSumUs = 0;
+
+
+static void rec_out_flush(void)
+{
+    if (recOutLen > 0)
+    {
+        recFile.write(recOut, recOutLen);
+        recBytes += recOutLen;
+        recOutLen = 0;
+    }
+}
+
+static void rec_put(uint8_t b)
+{
+    if (recOutLen == REC_OUT_SIZE)
+    {
+        rec_out_flush();
+    }
+    recOut[recOutLen++] = b;
+}
+
+static void rec_put_u32(uint32_t value)
+{
+    rec_put((uint8_t)(value >> 24U));
+    rec_put((uint8_t)(value >> 16U));
+    rec_put((uint8_t)(value >> 8U));
+    rec_put((uint8_t)value);
+}
+
+static void rec_put_vlq(uint32_t value)
+{
+    uint8_t tmp[5];
+    int n = 0;
+    tmp[n++] = value & 0x7FU;
+    while ((value >>= 7U) != 0)
+    {
+        tmp[n++] = 0x80U | (value & 0x7FU);
+    }
+    while (n > 0)
+    {
+        rec_put(tmp[--n]);
+    }
+}
+
+static void rec_write_block(const struct rec_block_s *block)
+{
+    for (uint16_t i = 0; i < block->count; i++)
+    {
+        const struct rec_event_s *ev = &block->events[i];
+
+        /* bytes received right before rec_start() are placed at the start */
+        int32_t diffUs = (int32_t)(ev->us - recLastUs);
+        if (diffUs > 0)
+        {
+            recElapsedUs += (uint32_t)diffUs;
+            recLastUs = ev->us;
+        }
+
+        uint64_t tick = recElapsedUs * recTempo / REC_TICK_DIV;
+        rec_put_vlq((uint32_t)(tick - recLastTick));
+        recLastTick = tick;
+
+        for (uint8_t n = 0; n < ev->len; n++)
+        {
+            rec_put(ev->msg[n]);
+        }
+    }
+}
+
+static void rec_finish(void)
+{
+    /* end of track */
+    rec_put(0x00U);
+    rec_put(0xFFU);
+    rec_put(0x2FU);
+    rec_put(0x00U);
+    rec_out_flush();
+
+    uint32_t trackLen = recBytes - REC_HEADER_SIZE;
+    uint8_t len[4] = {(uint8_t)(trackLen >> 24U), (uint8_t)(trackLen >> 16U), (uint8_t)(trackLen >> 8U), (uint8_t)trackLen};
+    recFile.seek(REC_TRACK_LEN_POS);
+    recFile.write(len, sizeof(len));
+    recFile.close();
+
+    __atomic_store_n(&recState, REC_IDLE, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Set the function which lets rec_process() run soon, called when a block is ready.
+ * @param wakeup Function, NULL when rec_process() is polled
+ */
+void rec_init(void (*wakeup)(void))
+{
+    recWakeup = wakeup;
+}
+
+/**
+ * @brief Start a take, called from the loop.
+ *        Only the header is prepared, the file is written by rec_process().
+ * @param file File opened for writing, owned by the recorder until the take is finished
+ * @param tempo Tempo of the take
+ * @param nowUs Time of the start
+ * @return true if started, false if a take is still being written
+ */
+bool rec_start(File &file, tempo_q16_t tempo, uint32_t nowUs)
+{
+    if (recState != REC_IDLE || !file)
+    {
+        return false;
+    }
+
+    recFile = file;
+    recTempo = tempo;
+    recLastUs = nowUs;
+    recElapsedUs = 0;
+    recLastTick = 0;
+    recOutLen = 0;
+    recFillIdx = 0;
+    recFlushIdx = 0;
+    for (struct rec_block_s &block : recBlocks)
+    {
+        block.count = 0;
+        block.ready = false;
+    }
+
+    recEvents = 0;
+    recDropped = 0;
+    recHighWater = 0;
+    recBlocksWritten = 0;
+    recBytes = 0;
+    recFlushLastUs = 0;
+    recFlushMaxUs = 0;
+    recFlushSumUs = 0;
+
+    /* header chunk: format 0, one track */
+    rec_put('M');
+    rec_put('T');
+    rec_put('h');
+    rec_put('d');
+    rec_put_u32(6U);
+    rec_put(0x00U);
+    rec_put(0x00U);
+    rec_put(0x00U);
+    rec_put(0x01U);
+    rec_put((uint8_t)(REC_PPQN >> 8U));
+    rec_put((uint8_t)REC_PPQN);
+
+    /* track chunk, length is patched by rec_finish() */
+    rec_put('M');
+    rec_put('T');
+    rec_put('r');
+    rec_put('k');
+    rec_put_u32(0U);
+
+    uint32_t usPerQuarter = (uint32_t)((60000000ULL << TEMPO_FRAC_BITS) / tempo);
+    rec_put(0x00U);
+    rec_put(0xFFU);
+    rec_put(0x51U);
+    rec_put(0x03U);
+    rec_put((uint8_t)(usPerQuarter >> 16U));
+    rec_put((uint8_t)(usPerQuarter >> 8U));
+    rec_put((uint8_t)usPerQuarter);
+
+    __atomic_store_n(&recState, REC_RUNNING, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief Add a received message to the take, called from the loop.
+ * @param msg Channel message
+ * @param len Length, 1 to 3 bytes
+ * @param rxUs Reception time
+ */
+void rec_event(const uint8_t *msg, uint8_t len, uint32_t rxUs)
+{
+    if (recState != REC_RUNNING || len == 0 || len > sizeof(recBlocks[0].events[0].msg))
+    {
+        return;
+    }
+
+    struct rec_block_s *block = &recBlocks[recFillIdx];
+    if (__atomic_load_n(&block->ready, __ATOMIC_ACQUIRE))
+    {
+        /* both blocks are waiting for the flash */
+        recDropped++;
+        return;
+    }
+
+    struct rec_event_s *ev = &block->events[block->count];
+    ev->us = rxUs;
+    ev->len = len;
+    for (uint8_t n = 0; n < len; n++)
+    {
+        ev->msg[n] = msg[n];
+    }
+    block->count++;
+    recEvents++;
+
+    uint32_t waiting = block->count;
+    for (const struct rec_block_s &other : recBlocks)
+    {
+        if (&other != block && other.ready)
+        {
+            waiting += other.count;
+        }
+    }
+    if (waiting > recHighWater)
+    {
+        recHighWater = waiting;
+    }
+
+    if (block->count == REC_BLOCK_EVENTS)
+    {
+        __atomic_store_n(&block->ready, true, __ATOMIC_RELEASE);
+        recFillIdx = (recFillIdx + 1U) % REC_BLOCKS;
+        if (recWakeup != NULL)
+        {
+            recWakeup();
+        }
+    }
+}
+
+/**
+ * @brief Stop the take, called from the loop. The remaining messages are written and the file is closed by rec_process().
+ */
+void rec_stop(void)
+{
+    if (recState != REC_RUNNING)
+    {
+        return;
+    }
+
+    struct rec_block_s *block = &recBlocks[recFillIdx];
+    if (!block->ready && block->count > 0)
+    {
+        __atomic_store_n(&block->ready, true, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&recState, REC_STOPPING, __ATOMIC_RELEASE);
+    if (recWakeup != NULL)
+    {
+        recWakeup();
+    }
+}
+
+/**
+ * @brief Write ready blocks to the file and finish a stopped take.
+ *        Called from a context of its own which may wait for the flash, or polled from the loop.
+ * @return true if something has been written
+ */
+bool rec_process(void)
+{
+    /* read before the blocks, so the last block of a stopped take is seen as ready */
+    enum rec_state_e state = __atomic_load_n(&recState, __ATOMIC_ACQUIRE);
+    if (state == REC_IDLE)
+    {
+        return false;
+    }
+
+    bool written = false;
+    while (__atomic_load_n(&recBlocks[recFlushIdx].ready, __ATOMIC_ACQUIRE))
+    {
+        struct rec_block_s *block = &recBlocks[recFlushIdx];
+
+        uint32_t startUs = micros();
+        rec_write_block(block);
+        rec_out_flush();
+        uint32_t flushUs = micros() - startUs;
+
+        recFlushLastUs = flushUs;
+        recFlushSumUs += flushUs;
+        if (flushUs > recFlushMaxUs)
+        {
+            recFlushMaxUs = flushUs;
+        }
+        recBlocksWritten++;
+
+        block->count = 0;
+        __atomic_store_n(&block->ready, false, __ATOMIC_RELEASE);
+        recFlushIdx = (recFlushIdx + 1U) % REC_BLOCKS;
+        written = true;
+    }
+
+    if (state == REC_STOPPING)
+    {
+        rec_finish();
+        written = true;
+    }
+    return written;
+}
+
+/**
+ * @brief Get the state of the recorder.
+ * @return State
+ */
+enum rec_state_e rec_state(void)
+{
+    return __atomic_load_n(&recState, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Get the statistics of the current or last take.
+ * @param stats Filled with the current values
+ */
+void rec_get_stats(struct rec_stats_s *stats)
+{
+    stats->state = rec_state();
+    stats->events = recEvents;
+    stats->dropped = recDropped;
+    stats->highWater = recHighWater;
+    stats->blocks = recBlocksWritten;
+    stats->bytes = recBytes;
+    stats->flushLastUs = recFlushLastUs;
+    stats->flushMaxUs = recFlushMaxUs;
+    stats->flushAvgUs = (recBlocksWritten > 0) ? (uint32_t)(recFlushSumUs / recBlocksWritten) : 0U;
+    stats->lengthMs = (uint32_t)(recElapsedUs / 1000U);
+}
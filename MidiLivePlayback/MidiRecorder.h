@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MidiRecorder.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Recorder of received MIDI messages into a Standard MIDI File (format 0).
+ *        rec_event() is called from the loop with the reception time of each message and only copies it
+ *        into one of two RAM blocks. A full block is handed to rec_process(), which converts it to
+ *        track events and writes it to the file. rec_process() runs in a context of its own,
+ *        so flash writes do not delay the MIDI thru in the loop.
+ *        When both blocks are waiting for the flash, further messages are dropped and counted.
+ *        Delta times are ticks of REC_PPQN per quarter note at the tempo present at rec_start(),
+ *        the tempo is stored in the file so the take plays back at the recorded speed.
+ */
+
+
+#ifndef MIDI_RECORDER_H
+#define MIDI_RECORDER_H
+
+
+#include <stdint.h>
+
+#include <FS.h>
+
+#include "TempoFixed.h"
+
+
+#define REC_BLOCK_EVENTS    128U    /* messages per RAM block */
+#define REC_BLOCKS          2U
+#define REC_OUT_SIZE        512U    /* file write buffer of rec_process() */
+#define REC_PPQN            480U
+
+
+struct rec_event_s
+{
+    uint32_t us; /* reception time */
+    uint8_t msg[3];
+    uint8_t len;
+};
+
+enum rec_state_e
+{
+    REC_IDLE,
+    REC_RUNNING,
+    REC_STOPPING, /* remaining events are written, then the file is closed */
+};
+
+struct rec_stats_s
+{
+    enum rec_state_e state;
+    uint32_t events; /* messages recorded */
+    uint32_t dropped; /* messages lost because both blocks were waiting for the flash */
+    uint32_t highWater; /* most messages waiting in RAM at once */
+    uint32_t blocks; /* blocks written */
+    uint32_t bytes; /* file size */
+    uint32_t flushLastUs; /* time to write a block */
+    uint32_t flushMaxUs;
+    uint32_t flushAvgUs;
+    uint32_t lengthMs; /* time from start to the last message */
+};
+
+
+void rec_init(void (*wakeup)(void));
+bool rec_start(File &file, tempo_q16_t tempo, uint32_t nowUs);
+void rec_event(const uint8_t *msg, uint8_t len, uint32_t rxUs);
+void rec_stop(void);
+bool rec_process(void);
+enum rec_state_e rec_state(void);
+void rec_get_stats(struct rec_stats_s *stats);
+
+
+#endif /* MIDI_RECORDER_H */
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MidiSync.ino
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief MIDI clock slave and master.
+ *        The filtered clock from MidiClockSync drives the step sequencer phase and the application tempo.
+ *        Stop halts the sequencer, start and song position move it.
+ *        MidiClockOut sends clock and time code following the application tempo, it starts with the first sequencer track
+ *        and stops with the last one. On ESP32 it runs from an esp_timer so the loop timing does not reach the output.
+ */
+
+
+#include <Arduino.h>
+
+#include "IdleLoop.h"
+#include "Log.h"
+#include "MidiClockOut.h"
+#include "MidiClockSync.h"
+#include "MidiOut.h"
+#include "StepSequencer.h"
+
+
+#if defined(CONFIG_IDF_TARGET_ESP32C3) || defined(CONFIG_IDF_TARGET_ESP32C6) || defined(CONFIG_IDF_TARGET_ESP32S3)
+#include <esp_timer.h>
+#define MIDI_CLOCK_OUT_TIMER
+#endif
+
+
+#ifdef MIDI_CLOCK_OUT_TIMER
+static esp_timer_handle_t clockOutTimer = NULL;
+#else
+static uint32_t clockOutDueUs = 0;
+#endif
+
+
+static void midi_sync_tick(uint32_t position, uint32_t tickUs, uint32_t periodQ8)
+{
+    seq_clock_sync(position, tickUs, periodQ8);
+}
+
+static void midi_sync_tempo(tempo_q16_t tempo)
+{
+    app_set_tempo(tempo);
+}
+
+static void midi_sync_transport(uint8_t msg, uint32_t position)
+{
+    switch (msg)
+    {
+    case MIDI_RT_START:
+    case MIDI_SONG_POSITION:
+        seq_set_position(position);
+        break;
+
+    case MIDI_RT_STOP:
+        seq_clock_hold();
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void midi_sync_print_stats(void)
+{
+    struct clock_sync_stats_s stats;
+    clock_sync_get_stats(&stats, true);
+
+    uint32_t centiBpm = tempo_to_centi_bpm(stats.tempo);
+    SHOW_SERIAL.printf("MIDI clock %s, %lu.%02lu bpm, %lu clocks\n", stats.locked ? "locked" : (clock_sync_active() ? "acquiring" : "not received"),
+                       (unsigned long)(centiBpm / 100U), (unsigned long)(centiBpm % 100U), (unsigned long)stats.clocks);
+    SHOW_SERIAL.printf("  phase error rms %lu us, max %lu us, input jitter max %lu us, %lu locks\n",
+                       (unsigned long)stats.phaseErrorRmsUs, (unsigned long)stats.phaseErrorMaxUs,
+                       (unsigned long)stats.jitterMaxUs, (unsigned long)stats.relocks);
+}
+
+static void midi_sync_lock(bool locked)
+{
+    midi_sync_print_stats();
+}
+
+static void midi_sync_lost(void)
+{
+    /* back to the internal tempo */
+    seq_clock_resume();
+    LOG_W("MIDI clock lost");
+}
+
+/**
+ * @brief Register the slave mode callbacks, the clock is followed as soon as it is received.
+ */
+void midi_sync_setup(void)
+{
+    static const struct clock_sync_cb_s cb =
+    {
+        .tick = midi_sync_tick,
+        .tempo = midi_sync_tempo,
+        .transport = midi_sync_transport,
+        .lock = midi_sync_lock,
+        .lost = midi_sync_lost,
+    };
+    clock_sync_init(&cb);
+}
+
+/**
+ * @brief Console command: sync [on|off]
+ *        Enables or disables the slave mode and prints the tracking statistics since the last call.
+ * @param args Command arguments
+ */
+void Console_Sync(const char *args)
+{
+    if (strcmp(args, "on") == 0)
+    {
+        clock_sync_set_enabled(true);
+    }
+    else if (strcmp(args, "off") == 0)
+    {
+        clock_sync_set_enabled(false);
+        seq_clock_resume();
+    }
+
+    SHOW_SERIAL.printf("slave mode %s\n", clock_sync_enabled() ? "on" : "off");
+    midi_sync_print_stats();
+}
+
+#ifdef MIDI_CLOCK_OUT_TIMER
+/**
+ * @brief Runs in the esp_timer task, the next call is scheduled to the next due clock or quarter frame.
+ * @param arg Unused
+ */
+static void midi_clock_out_timer_cb(void *arg)
+{
+    esp_timer_start_once(clockOutTimer, clock_out_process(micros()));
+}
+#endif
+
+/**
+ * @brief Process a transport request right away instead of at the next clock.
+ */
+static void midi_clock_out_wakeup(void)
+{
+#ifdef MIDI_CLOCK_OUT_TIMER
+    esp_timer_stop(clockOutTimer);
+    esp_timer_start_once(clockOutTimer, 0);
+#else
+    clockOutDueUs = micros();
+#endif
+}
+
+/**
+ * @brief Start the clock output timer, the output itself stays disabled until enabled by the console.
+ */
+void midi_clock_out_setup(void)
+{
+    clock_out_init(midi_clock_out_wakeup);
+    clock_out_set_tempo(app_get_tempo());
+
+#ifdef MIDI_CLOCK_OUT_TIMER
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = midi_clock_out_timer_cb;
+    timerArgs.name = "midi_clock_out";
+    esp_timer_create(&timerArgs, &clockOutTimer);
+    esp_timer_start_once(clockOutTimer, CLOCK_OUT_IDLE_US);
+#endif
+}
+
+/**
+ * @brief Follow the sequencer transport, pass queued channel data to the UART.
+ */
+void midi_clock_out_loop(void)
+{
+    static bool seqActive = false;
+
+    bool active = false;
+    for (uint8_t track = 0; track < SEQ_MAX_TRACKS; track++)
+    {
+        active |= seq_track_active(track);
+    }
+    if (active != seqActive)
+    {
+        seqActive = active;
+        if (seqActive)
+        {
+            clock_out_play();
+        }
+        else
+        {
+            /* the patterns start over with the next track, so do the slaves */
+            clock_out_stop();
+            clock_out_rewind();
+        }
+    }
+
+#ifndef MIDI_CLOCK_OUT_TIMER
+    uint32_t nowUs = micros();
+    if ((int32_t)(nowUs - clockOutDueUs) >= 0)
+    {
+        clockOutDueUs = nowUs + clock_out_process(nowUs);
+    }
+    idle_due_at(clockOutDueUs);
+#endif
+
+    midi_out_loop();
+}
+
+/**
+ * @brief Console command: clockout [on|off] [mtc]
+ *        Enables or disables the clock and time code output and prints the statistics since the last call.
+ * @param args Command arguments
+ */
+void Console_ClockOut(const char *args)
+{
+    if (strncmp(args, "on", 2) == 0)
+    {
+        clock_out_set_enabled(true, strstr(args, "mtc") != NULL);
+    }
+    else if (strcmp(args, "off") == 0)
+    {
+        clock_out_set_enabled(false, false);
+    }
+
+    struct clock_out_stats_s stats;
+    clock_out_get_stats(&stats, true);
+
+    SHOW_SERIAL.printf("clock output %s, time code %s, %s at clock %lu\n", clock_out_clock_enabled() ? "on" : "off",
+                       clock_out_mtc_enabled() ? "on" : "off", clock_out_running() ? "running" : "stopped",
+                       (unsigned long)clock_out_position());
+    SHOW_SERIAL.printf("  %lu clocks, %lu quarter frames, late rms %lu us, max %lu us, %lu dropped, %u bytes queued\n",
+                       (unsigned long)stats.clocks, (unsigned long)stats.quarterFrames, (unsigned long)stats.lateRmsUs,
+                       (unsigned long)stats.lateMaxUs, (unsigned long)stats.dropped, midi_out_pending());
+}
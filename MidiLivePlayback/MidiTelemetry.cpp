@@ -0,0 +1,461 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MidiTelemetry.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Implementation of the MIDI traffic counters.
+ *        The parser of a stream only follows status, running status and the data bytes still expected.
+ *        Everything except the direct counters runs in the loop, those are only written by midi_out_direct().
+ */
+
+
+#include "MidiTelemetry.h"
+
+
+#define TELE_SECOND_US      1000000U
+
+
+struct tele_stream_s
+{
+    /* parser */
+    uint8_t status; /* message being received */
+    uint8_t running; /* running status, 0 after a system message */
+    uint8_t need; /* data bytes of the message */
+    uint8_t have;
+    bool sysex;
+    bool usedRunning;
+
+    uint32_t bytes;
+    uint32_t channelMsgs;
+    uint32_t runningUsed;
+    uint32_t runningRepeated;
+    uint32_t sysexMsgs;
+    uint32_t sysexBytes;
+    uint32_t realtime;
+    uint32_t common;
+    uint32_t stray;
+    uint32_t cut;
+    uint16_t queueHighWater;
+
+    /* written by midi_out_direct() only */
+    volatile uint32_t directBytes;
+    volatile uint32_t directRealtime;
+    volatile uint32_t directCommon;
+
+    /* rates */
+    uint32_t lastBytes;
+    uint16_t secondBps[MIDI_TELE_WINDOW_S];
+    uint16_t rateBps;
+    uint16_t peakBps;
+    uint16_t rateWindowBps;
+    uint16_t peakWindowBps;
+};
+
+
+static struct tele_stream_s teleStreams[MIDI_TELE_STREAMS];
+static uint32_t teleMsgs[MIDI_TELE_DIRS][MIDI_TELE_TYPES][16];
+
+static uint32_t teleSecondUs = 0;
+static uint8_t teleSecondPos = 0;
+static uint32_t teleSeconds = 0;
+static bool teleStarted = false;
+
+
+static uint32_t tele_total_bytes(const struct tele_stream_s *s)
+{
+    return s->bytes + s->directBytes;
+}
+
+/**
+ * @brief Count a byte of a stream.
+ * @param s Stream
+ * @param msgs Message counters of its direction
+ * @param b Byte
+ */
+static void tele_byte(struct tele_stream_s *s, uint32_t (*msgs)[16], uint8_t b)
+{
+    s->bytes++;
+    if (b >= 0xF8U)
+    {
+        /* real time may come anywhere, even inside of a message */
+        s->realtime++;
+        return;
+    }
+
+    if (b >= 0x80U)
+    {
+        if (s->sysex)
+        {
+            s->sysex = false;
+            if (b == 0xF7U)
+            {
+                s->sysexBytes++;
+                return;
+            }
+            s->cut++;
+        }
+        else if (s->have < s->need)
+        {
+            s->cut++;
+        }
+        s->have = 0;
+        s->need = 0;
+
+        if (b < 0xF0U)
+        {
+            if (b == s->running)
+            {
+                s->runningRepeated++;
+            }
+            s->status = b;
+            s->running = b;
+            s->need = ((b & 0xE0U) == 0xC0U) ? 1U : 2U;
+            s->usedRunning = false;
+            return;
+        }
+
+        s->status = b;
+        s->running = 0;
+        if (b == 0xF0U)
+        {
+            s->sysex = true;
+            s->sysexMsgs++;
+            s->sysexBytes++;
+        }
+        else if (b == 0xF7U)
+        {
+            s->stray++;
+        }
+        else
+        {
+            s->common++;
+            s->need = (b == 0xF2U) ? 2U : (b == 0xF1U || b == 0xF3U) ? 1U : 0U;
+        }
+        return;
+    }
+
+    if (s->sysex)
+    {
+        s->sysexBytes++;
+        return;
+    }
+    if (s->have >= s->need)
+    {
+        /* no message open, the data byte starts one with the running status */
+        if (s->running == 0)
+        {
+            s->stray++;
+            return;
+        }
+        s->status = s->running;
+        s->need = ((s->status & 0xE0U) == 0xC0U) ? 1U : 2U;
+        s->have = 0;
+        s->usedRunning = true;
+    }
+
+    s->have++;
+    if (s->have < s->need || s->status >= 0xF0U)
+    {
+        return;
+    }
+
+    s->channelMsgs++;
+    if (s->usedRunning)
+    {
+        s->runningUsed++;
+    }
+    uint8_t type = (uint8_t)((s->status >> 4U) - 8U);
+    if (type == MIDI_TELE_NOTE_ON && b == 0U)
+    {
+        type = MIDI_TELE_NOTE_OFF;
+    }
+    msgs[type][s->status & 0x0FU]++;
+}
+
+/**
+ * @brief Count a byte read from the received stream, called by MidiTeleRx.
+ * @param b Byte
+ */
+void midi_tele_rx(uint8_t b)
+{
+    tele_byte(&teleStreams[MIDI_TELE_STREAM_RX], teleMsgs[MIDI_TELE_RX], b);
+}
+
+/**
+ * @brief Note the bytes waiting in the UART when the loop starts to read them.
+ * @param bytes Bytes available
+ */
+void midi_tele_rx_waiting(uint16_t bytes)
+{
+    struct tele_stream_s *s = &teleStreams[MIDI_TELE_STREAM_RX];
+    if (bytes > s->queueHighWater)
+    {
+        s->queueHighWater = bytes;
+    }
+}
+
+/**
+ * @brief Count bytes passed to the UART of a synth port by the loop.
+ * @param port Index of the port
+ * @param data Bytes
+ * @param len Number of bytes
+ */
+void midi_tele_tx(uint8_t port, const uint8_t *data, uint16_t len)
+{
+    struct tele_stream_s *s = &teleStreams[1U + port];
+    for (uint16_t i = 0; i < len; i++)
+    {
+        tele_byte(s, teleMsgs[MIDI_TELE_TX], data[i]);
+    }
+}
+
+/**
+ * @brief Count a message written directly to the UART, may be called from a timer task.
+ * @param port Index of the port
+ * @param msg Real time or system common message
+ * @param len Length of message
+ */
+void midi_tele_tx_direct(uint8_t port, const uint8_t *msg, uint16_t len)
+{
+    struct tele_stream_s *s = &teleStreams[1U + port];
+    s->directBytes = s->directBytes + len;
+    if (msg[0] >= 0xF8U)
+    {
+        s->directRealtime = s->directRealtime + 1U;
+    }
+    else
+    {
+        s->directCommon = s->directCommon + 1U;
+    }
+}
+
+/**
+ * @brief Note the bytes waiting in the merger for a synth port after a message has been queued.
+ * @param port Index of the port
+ * @param bytes Bytes queued including the record headers
+ */
+void midi_tele_tx_queued(uint8_t port, uint16_t bytes)
+{
+    struct tele_stream_s *s = &teleStreams[1U + port];
+    if (bytes > s->queueHighWater)
+    {
+        s->queueHighWater = bytes;
+    }
+}
+
+/**
+ * @brief Update the rates once per second, called by the loop.
+ *        A loop which has been blocked for several seconds spreads the bytes evenly over them.
+ * @param nowUs Current time in microseconds
+ */
+void midi_tele_loop(uint32_t nowUs)
+{
+    if (!teleStarted)
+    {
+        teleSecondUs = nowUs;
+        teleStarted = true;
+        return;
+    }
+    uint32_t elapsedUs = nowUs - teleSecondUs;
+    if (elapsedUs < TELE_SECOND_US)
+    {
+        return;
+    }
+    uint32_t seconds = elapsedUs / TELE_SECOND_US;
+    teleSecondUs += seconds * TELE_SECOND_US;
+    teleSeconds += seconds;
+    uint32_t steps = (seconds < MIDI_TELE_WINDOW_S) ? seconds : MIDI_TELE_WINDOW_S;
+
+    for (uint8_t i = 0; i < MIDI_TELE_STREAMS; i++)
+    {
+        struct tele_stream_s *s = &teleStreams[i];
+        uint32_t total = tele_total_bytes(s);
+        uint32_t bps = (total - s->lastBytes) / seconds;
+        s->lastBytes = total;
+        s->rateBps = (bps > 0xFFFFU) ? 0xFFFFU : (uint16_t)bps;
+        if (s->rateBps > s->peakBps)
+        {
+            s->peakBps = s->rateBps;
+        }
+
+        uint8_t pos = teleSecondPos;
+        for (uint32_t j = 0; j < steps; j++)
+        {
+            s->secondBps[pos] = s->rateBps;
+            pos = (pos + 1U) % MIDI_TELE_WINDOW_S;
+        }
+        uint32_t sum = 0;
+        for (uint8_t j = 0; j < MIDI_TELE_WINDOW_S; j++)
+        {
+            sum += s->secondBps[j];
+        }
+        s->rateWindowBps = (uint16_t)(sum / MIDI_TELE_WINDOW_S);
+        if (s->rateWindowBps > s->peakWindowBps)
+        {
+            s->peakWindowBps = s->rateWindowBps;
+        }
+    }
+    teleSecondPos = (uint8_t)((teleSecondPos + steps) % MIDI_TELE_WINDOW_S);
+}
+
+/**
+ * @brief Get the counters of a stream.
+ * @param stream MIDI_TELE_STREAM_RX or 1 + index of the synth port
+ * @param stats Filled with the values
+ */
+void midi_tele_get(uint8_t stream, struct midi_tele_stats_s *stats)
+{
+    const struct tele_stream_s *s = &teleStreams[stream];
+    stats->bytes = tele_total_bytes(s);
+    stats->channelMsgs = s->channelMsgs;
+    stats->runningUsed = s->runningUsed;
+    stats->runningRepeated = s->runningRepeated;
+    stats->sysexMsgs = s->sysexMsgs;
+    stats->sysexBytes = s->sysexBytes;
+    stats->realtime = s->realtime + s->directRealtime;
+    stats->common = s->common + s->directCommon;
+    stats->stray = s->stray;
+    stats->cut = s->cut;
+    stats->rateBps = s->rateBps;
+    stats->peakBps = s->peakBps;
+    stats->rateWindowBps = s->rateWindowBps;
+    stats->peakWindowBps = s->peakWindowBps;
+    stats->queueHighWater = s->queueHighWater;
+}
+
+/**
+ * @brief Get the number of channel messages of a type.
+ * @param dir See midi_tele_dir_e
+ * @param type See midi_tele_type_e
+ * @param channel MIDI channel (0-15)
+ * @return Messages since the last reset
+ */
+uint32_t midi_tele_messages(uint8_t dir, uint8_t type, uint8_t channel)
+{
+    return teleMsgs[dir][type][channel & 0x0FU];
+}
+
+/**
+ * @brief Get the time counted since the last reset.
+ * @return Full seconds
+ */
+uint32_t midi_tele_seconds(void)
+{
+    return teleSeconds;
+}
+
+/**
+ * @brief Clear all counters, the state of the parsers is kept.
+ */
+void midi_tele_reset(void)
+{
+    for (uint8_t i = 0; i < MIDI_TELE_STREAMS; i++)
+    {
+        struct tele_stream_s *s = &teleStreams[i];
+        s->bytes = 0;
+        s->channelMsgs = 0;
+        s->runningUsed = 0;
+        s->runningRepeated = 0;
+        s->sysexMsgs = 0;
+        s->sysexBytes = 0;
+        s->realtime = 0;
+        s->common = 0;
+        s->stray = 0;
+        s->cut = 0;
+        s->queueHighWater = 0;
+        s->directBytes = 0;
+        s->directRealtime = 0;
+        s->directCommon = 0;
+        s->lastBytes = 0;
+        memset(s->secondBps, 0, sizeof(s->secondBps));
+        s->rateBps = 0;
+        s->peakBps = 0;
+        s->rateWindowBps = 0;
+        s->peakWindowBps = 0;
+    }
+    memset(teleMsgs, 0, sizeof(teleMsgs));
+    teleSeconds = 0;
+    teleStarted = false;
+}
+
+static uint32_t tele_percent(uint32_t count, uint32_t total)
+{
+    return total ? (uint32_t)((100ULL * count + total / 2U) / total) : 0U;
+}
+
+/**
+ * @brief Print the counters of all streams and the channel messages per channel.
+ * @param port Output
+ */
+void midi_tele_print(Print *port)
+{
+    static const char *typeNames[MIDI_TELE_TYPES] = {"off", "on", "poly", "cc", "pc", "at", "pb"};
+    char line[192];
+
+    snprintf(line, sizeof(line), "traffic of %lu s, bytes/s now/peak of the last second and of %u s, the line takes %u\n",
+             (unsigned long)teleSeconds, MIDI_TELE_WINDOW_S, MIDI_TELE_LINE_BPS);
+    port->print(line);
+    snprintf(line, sizeof(line), "%-4s %10s %11s %11s %8s %9s %13s %8s %7s %6s %5s %5s\n", "", "bytes", "1 s", "10 s", "msgs",
+             "running", "sysex", "rt", "common", "stray", "cut", "queue");
+    port->print(line);
+    for (uint8_t i = 0; i < MIDI_TELE_STREAMS; i++)
+    {
+        struct midi_tele_stats_s s;
+        midi_tele_get(i, &s);
+        char name[8];
+        snprintf(name, sizeof(name), (i == MIDI_TELE_STREAM_RX) ? "rx" : "tx%u", (unsigned)i);
+        char rate[2][16];
+        snprintf(rate[0], sizeof(rate[0]), "%u/%u", s.rateBps, s.peakBps);
+        snprintf(rate[1], sizeof(rate[1]), "%u/%u", s.rateWindowBps, s.peakWindowBps);
+        /* running status used / possible in % of the channel messages */
+        char running[24];
+        snprintf(running, sizeof(running), "%lu/%lu%%", (unsigned long)tele_percent(s.runningUsed, s.channelMsgs),
+                 (unsigned long)tele_percent(s.runningUsed + s.runningRepeated, s.channelMsgs));
+        char sysex[24];
+        snprintf(sysex, sizeof(sysex), "%lu/%lu", (unsigned long)s.sysexMsgs, (unsigned long)s.sysexBytes);
+        snprintf(line, sizeof(line), "%-4s %10lu %11s %11s %8lu %9s %13s %8lu %7lu %6lu %5lu %5u\n", name, (unsigned long)s.bytes,
+                 rate[0], rate[1], (unsigned long)s.channelMsgs, running, sysex, (unsigned long)s.realtime, (unsigned long)s.common,
+                 (unsigned long)s.stray, (unsigned long)s.cut, s.queueHighWater);
+        port->print(line);
+    }
+
+    for (uint8_t dir = 0; dir < MIDI_TELE_DIRS; dir++)
+    {
+        for (uint8_t ch = 0; ch < 16U; ch++)
+        {
+            int len = snprintf(line, sizeof(line), "%s ch %2u:", (dir == MIDI_TELE_RX) ? "rx" : "tx", (unsigned)(ch + 1U));
+            int start = len;
+            for (uint8_t type = 0; type < MIDI_TELE_TYPES; type++)
+            {
+                uint32_t n = teleMsgs[dir][type][ch];
+                if (n > 0 && len < (int)sizeof(line))
+                {
+                    len += snprintf(&line[len], sizeof(line) - len, " %s %lu", typeNames[type], (unsigned long)n);
+                }
+            }
+            if (len > start && len < (int)sizeof(line) - 1)
+            {
+                line[len] = '\n';
+                line[len + 1] = 0;
+                port->print(line);
+            }
+        }
+    }
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file SerialConsole.ino
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Minimal line based command console on SHOW_SERIAL.
+ *        Lines are collected without blocking, commands are looked up in consoleCommands.
+ */
+
+
+#include <Arduino.h>
+
+
+#define CONSOLE_LINE_LEN    96
+
+
+struct console_cmd_s
+{
+    const char *name;
+    void (*cmd)(const char *args);
+    const char *help;
+};
+
+static void Console_Help(const char *args);
+
+static struct console_cmd_s consoleCommands[] =
+{
+    { "help", Console_Help, "list all commands"},
+    { "sync", Console_Sync, "sync [on|off] - MIDI clock slave mode and statistics"},
+    { "clockout", Console_ClockOut, "clockout [on [mtc]|off] - MIDI clock and time code output and statistics"},
+    { "bench", Console_Bench, "bench tempo - cycles of the tempo math, float against fixed point"},
+    { "latency", Console_Latency, "latency [on|off|reset] - through latency of received MIDI per message type"},
+    { "traffic", Console_Traffic, "traffic [reset] - counters of the received and sent MIDI streams"},
+    { "merge", Console_Merge, "merge [prio|fair|channel|voice|reset] - output merger scheduling, spreading over the synths and statistics"},
+    { "mem", Console_Mem, "mem - static, heap and stack usage"},
+    { "idle", Console_Idle, "idle [on|off] - sleep of the loop between deadlines, utilization and wake-ups"},
+    { "profile", Console_Profile, "profile [load [file]|off] - split, layer and transpose the live input, print the zones"},
+    { "rec", Console_Rec, "rec [start [file.mid]|stop] - record received MIDI to a file and print the recorder statistics"},
+    { "capture", Console_Capture, "capture [start [file.cap]|stop] - capture received bytes and button events for a replay on the host"},
+};
+
+static char consoleLine[CONSOLE_LINE_LEN];
+static uint8_t consoleLineLen = 0;
+
+
+/**
+ * @brief Print all available commands.
+ * @param args Unused
+ */
+static void Console_Help(const char *args)
+{
+    for (const struct console_cmd_s &c : consoleCommands)
+    {
+        SHOW_SERIAL.printf("  %-8s %s\n", c.name, c.help);
+    }
+}
+
+/**
+ * @brief Look up and execute a complete command line.
+ * @param line Zero terminated command line
+ */
+static void console_execute(char *line)
+{
+    char *args = line;
+    while (*args != 0 && *args != ' ')
+    {
+        args++;
+    }
+    if (*args == ' ')
+    {
+        *args++ = 0;
+    }
+    while (*args == ' ')
+    {
+        args++;
+    }
+
+    if (line[0] == 0)
+    {
+        return;
+    }
+
+    for (const struct console_cmd_s &c : consoleCommands)
+    {
+        if (strcmp(line, c.name) == 0)
+        {
+            c.cmd(args);
+            return;
+        }
+    }
+
+    SHOW_SERIAL.printf("unknown command: %s\n", line);
+}
+
+/**
+ * @brief Collect received characters, executes a command when a line is complete.
+ */
+void console_loop(void)
+{
+    while (SHOW_SERIAL.available() > 0)
+    {
+        char c = SHOW_SERIAL.read();
+
+        if (c == '\r' || c == '\n')
+        {
+            consoleLine[consoleLineLen] = 0;
+            consoleLineLen = 0;
+            console_execute(consoleLine);
+        }
+        else if (consoleLineLen < CONSOLE_LINE_LEN - 1)
+        {
+            consoleLine[consoleLineLen++] = c;
+        }
+    }
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file StaticAlloc.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Static allocation mode.
+ *        States and path buffers of the sketch live in statically sized arenas which are listed in a table,
+ *        their sum is checked against STATIC_ALLOC_BUDGET when compiling.
+ *        With STATIC_ALLOC_MODE the song buffer becomes a static arena as well (see SongPool.h)
+ *        and static_alloc_lock() at the end of setup() arms a guard, every operator new after it
+ *        is counted or with STATIC_ALLOC_ASSERT stops the program. The ESP32 heap is polled as well,
+ *        so blocks kept by malloc() of C code or the core show up too.
+ *        Allocations which cannot be avoided, like LittleFS file handles on a song change,
+ *        are put between static_alloc_exempt_begin() and static_alloc_exempt_end().
+ *
+ * @note Replacing operator new is only done on ESP32, the other cores define it in a non weak object.
+ */
+
+
+#ifndef STATIC_ALLOC_H
+#define STATIC_ALLOC_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+//#define STATIC_ALLOC_MODE         /* all buffers static, heap use after setup() is counted */
+//#define STATIC_ALLOC_ASSERT       /* stop on a heap allocation after setup() instead of counting it */
+
+#define STATIC_ALLOC_BUDGET         (128U * 1024U)  /* sum of all arenas */
+#define STATIC_ALLOC_CHECK_MS       1000U           /* heap poll interval */
+
+
+struct static_arena_s
+{
+    const char *name;
+    uint32_t size;
+};
+
+struct static_alloc_stats_s
+{
+    bool locked;
+    uint32_t allocs; /* operator new calls after static_alloc_lock() */
+    uint32_t exempt; /* of them within an exempt section */
+    int32_t heapBlocks; /* heap blocks above the count at static_alloc_lock(), highest value seen */
+};
+
+struct static_alloc_heap_s
+{
+    uint32_t freeBytes; /* internal heap */
+    uint32_t largestBlock;
+    uint32_t minFree; /* lowest free value since boot */
+    uint32_t psramFree; /* 0 without PSRAM */
+    uint32_t psramLargest;
+};
+
+
+/**
+ * @brief Sum of a table of arenas, usable in static_assert().
+ * @param arenas Table of arenas
+ * @param i First entry to add
+ * @return Bytes
+ */
+template <size_t N>
+constexpr uint32_t static_arena_total(const struct static_arena_s (&arenas)[N], size_t i = 0)
+{
+    return (i < N) ? (arenas[i].size + static_arena_total(arenas, i + 1U)) : 0U;
+}
+
+
+void static_alloc_lock(void);
+void static_alloc_exempt_begin(void);
+void static_alloc_exempt_end(void);
+void static_alloc_check(uint32_t nowMs);
+void static_alloc_get_stats(struct static_alloc_stats_s *stats);
+void static_alloc_get_heap(struct static_alloc_heap_s *heap);
+int32_t static_alloc_stack_free(const char *task);
+
+
+#endif /* STATIC_ALLOC_H */
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file StaticMemory.ino
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Memory budget and runtime memory report of the sketch.
+ *        Lists the statically sized arenas, a build exceeding STATIC_ALLOC_BUDGET fails.
+ *        The arenas are printed at boot, the console command mem adds the log buffer, the free heap
+ *        and the stack high-water marks of the loop, the clock output timer task and the recorder task.
+ */
+
+
+#include <Arduino.h>
+
+#include "InputCapture.h"
+#include "LatencyProbe.h"
+#include "LiveTransform.h"
+#include "Log.h"
+#include "MidiTelemetry.h"
+#include "MidiRecorder.h"
+#include "NoteScheduler.h"
+#include "StaticAlloc.h"
+
+
+static constexpr struct static_arena_s staticArenas[] =
+{
+    { "states", sizeof(AuditionMode) + sizeof(BpmMode) + sizeof(TrackMode) + sizeof(ErrorState) },
+    { "midi out queues", MIDI_OUT_QUEUE_SIZE * MIDI_OUT_PORTS },
+    { "console line", CONSOLE_LINE_LEN },
+    { "log buffer", LOG_BUFFER_SIZE },
+#ifdef LATENCY_PROBE
+    { "latency probe", LAT_PROBE_BINS * LAT_TYPE_COUNT * LAT_STAGE_COUNT * 4U },
+#endif
+#ifdef MIDI_TELEMETRY
+    { "midi telemetry", MIDI_TELE_DIRS * MIDI_TELE_TYPES * 16U * 4U + MIDI_TELE_STREAMS * 96U },
+#endif
+    { "note scheduler", NOTE_SCHED_MAX * 8U },
+    { "live transform", XF_TABLE_SIZE + sizeof(struct xf_zone_s) * XF_ZONES_MAX * 2U },
+    { "recorder", sizeof(struct rec_event_s) * REC_BLOCK_EVENTS * REC_BLOCKS + REC_OUT_SIZE },
+#ifdef MIDI_RECORD_TASK
+    { "recorder stack", RECORD_TASK_STACK },
+#endif
+    { "input capture", CAP_BLOCK_SIZE * CAP_BLOCKS },
+#ifdef INPUT_CAPTURE_TASK
+    { "capture stack", CAPTURE_TASK_STACK },
+#endif
+};
+
+static_assert(static_arena_total(staticArenas) <= STATIC_ALLOC_BUDGET, "static arenas exceed STATIC_ALLOC_BUDGET");
+
+
+/**
+ * @brief Print the size of all arenas and the budget.
+ */
+void static_memory_report(void)
+{
+    for (const struct static_arena_s &a : staticArenas)
+    {
+        SHOW_SERIAL.printf("  %-16s %7lu\n", a.name, (unsigned long)a.size);
+    }
+    SHOW_SERIAL.printf("  %-16s %7lu of %lu bytes\n", "total", (unsigned long)static_arena_total(staticArenas), (unsigned long)STATIC_ALLOC_BUDGET);
+}
+
+static void static_memory_print_stack(const char *label, const char *task)
+{
+    int32_t stackFree = static_alloc_stack_free(task);
+    if (stackFree < 0)
+    {
+        SHOW_SERIAL.printf("  %-16s     n/a\n", label);
+    }
+    else
+    {
+        SHOW_SERIAL.printf("  %-16s %7ld bytes never used\n", label, (long)stackFree);
+    }
+}
+
+/**
+ * @brief Console command: mem
+ *        Prints static, heap and stack usage.
+ * @param args Unused
+ */
+void Console_Mem(const char *args)
+{
+    (void)args;
+
+    SHOW_SERIAL.println("static arenas:");
+    static_memory_report();
+
+    struct static_alloc_heap_s heap;
+    static_alloc_get_heap(&heap);
+    SHOW_SERIAL.printf("heap: %lu bytes free, largest block %lu, lowest free %lu\n",
+                       (unsigned long)heap.freeBytes, (unsigned long)heap.largestBlock, (unsigned long)heap.minFree);
+    if (heap.psramFree > 0)
+    {
+        SHOW_SERIAL.printf("psram: %lu bytes free, largest block %lu\n", (unsigned long)heap.psramFree, (unsigned long)heap.psramLargest);
+    }
+
+    SHOW_SERIAL.println("stack high-water marks:");
+    static_memory_print_stack("loop", NULL);
+    static_memory_print_stack("esp_timer", "esp_timer");
+    static_memory_print_stack("recorder", RECORD_TASK_NAME);
+
+    struct log_stats_s logStats;
+    log_get_stats(&logStats);
+    SHOW_SERIAL.printf("log: %u bytes pending, %lu lines, %lu dropped\n",
+                       (unsigned)logStats.pending, (unsigned long)logStats.lines, (unsigned long)logStats.dropped);
+
+#ifdef STATIC_ALLOC_MODE
+    struct static_alloc_stats_s stats;
+    static_alloc_get_stats(&stats);
+    SHOW_SERIAL.printf("heap after setup: %lu allocations (%lu exempt), %ld blocks kept%s\n",
+                       (unsigned long)stats.allocs, (unsigned long)stats.exempt, (long)stats.heapBlocks,
+                       stats.locked ? "" : ", guard not armed");
+#endif
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file TapTempo.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Rolling tap tempo estimator.
+ *        The last TAP_TEMPO_HISTORY intervals are kept in a ring buffer. A new interval far from their median is
+ *        rejected, the tempo is the mean of the intervals close to the median. An estimate is available from the second tap on
+ *        and refined with every further tap. A pause longer than TAP_TEMPO_TIMEOUT_US starts a new sequence.
+ */
+
+
+#ifndef TAP_TEMPO_H
+#define TAP_TEMPO_H
+
+
+#include <stdint.h>
+
+#include "TempoFixed.h"
+
+
+#define TAP_TEMPO_HISTORY       8U
+#define TAP_TEMPO_TIMEOUT_US    2000000UL   /* longest interval, 30 bpm */
+#define TAP_TEMPO_MIN_US        150000UL    /* shorter intervals are contact bounce or double taps, 400 bpm */
+#define TAP_TEMPO_TOLERANCE     8U          /* intervals off the median by more than 1/8 are outliers */
+#define TAP_TEMPO_RESTART       2U          /* consecutive matching outliers start a new tempo */
+
+
+void tap_tempo_reset(void);
+tempo_q16_t tap_tempo_tap(uint32_t tapUs);
+uint8_t tap_tempo_count(void);
+
+
+#endif /* TAP_TEMPO_H */
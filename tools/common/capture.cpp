@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file capture.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Reader of the input capture.
+ */
+
+
+#include "capture.h"
+
+#include <fstream>
+#include <iterator>
+#include <string.h>
+
+
+static bool get_vlq(const std::vector<uint8_t> &buf, size_t &pos, uint64_t &value)
+{
+    value = 0;
+    for (int i = 0; i < 9; i++)
+    {
+        if (pos >= buf.size())
+        {
+            return false;
+        }
+        uint8_t b = buf[pos++];
+        value = (value << 7U) | (b & 0x7FU);
+        if ((b & 0x80U) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool capture_load(const std::string &path, std::vector<capture_event_s> &events, std::string &error)
+{
+    std::ifstream f(path, std::ios::binary);
+    if (!f)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::vector<uint8_t> buf((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    if (buf.size() < 8 || memcmp(buf.data(), "MCAP", 4) != 0)
+    {
+        error = path + " is not a capture file";
+        return false;
+    }
+    if (buf[4] != CAPTURE_VERSION)
+    {
+        error = path + ": unsupported capture version " + std::to_string(buf[4]);
+        return false;
+    }
+
+    events.clear();
+    size_t pos = 8;
+    uint64_t us = 0;
+
+    while (pos < buf.size())
+    {
+        uint64_t delta;
+        if (!get_vlq(buf, pos, delta) || pos >= buf.size())
+        {
+            error = path + ": truncated record at offset " + std::to_string(pos);
+            return false;
+        }
+        us += delta;
+        uint8_t count = buf[pos++];
+        size_t len = (count == 0) ? 1U : count;
+        if (len > buf.size() - pos)
+        {
+            error = path + ": truncated record at offset " + std::to_string(pos);
+            return false;
+        }
+
+        if (count == 0)
+        {
+            events.push_back({us, CAPTURE_BUTTON, buf[pos]});
+        }
+        for (uint8_t i = 0; i < count; i++)
+        {
+            events.push_back({us + i * CAPTURE_BYTE_US, CAPTURE_RX, buf[pos + i]});
+        }
+        pos += len;
+    }
+
+    return true;
+}
+
+std::string capture_button_name(uint8_t value)
+{
+    static const char *kinds[] = {"press", "long", "release"};
+    uint8_t kind = value >> 4U;
+    std::string name(1, (char)('A' + (value & 0x0FU)));
+    name += ' ';
+    name += (kind < sizeof(kinds) / sizeof(kinds[0])) ? kinds[kind] : "?";
+    return name;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file capture.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Input capture as written by the capture console command of the sketches (InputCapture.h).
+ *
+ * File format (times are variable length quantities like in a MIDI file):
+ *   "MCAP" <version 1> <3 reserved bytes>
+ *   records: <time in us after the previous record> <count> <count received bytes, one byte time apart>
+ *            <time in us after the previous record> 0 <button event: kind << 4 | button>
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+#define CAPTURE_VERSION     1
+#define CAPTURE_BYTE_US     320U /* 10 bits at 31250 baud */
+
+
+enum capture_kind_e
+{
+    CAPTURE_RX,
+    CAPTURE_BUTTON,
+};
+
+struct capture_event_s
+{
+    uint64_t us; /* time after the start of the capture */
+    uint8_t kind;
+    uint8_t value; /* received byte or button event */
+};
+
+/**
+ * @brief Load a capture file, the records are split into one event per received byte.
+ * @param path File path
+ * @param events Events with absolute timestamps
+ * @param error Reason on failure
+ * @return true if successful, false otherwise
+ */
+bool capture_load(const std::string &path, std::vector<capture_event_s> &events, std::string &error);
+
+/**
+ * @brief Get a readable name of a button event, like "B long".
+ * @param value Button event of the capture
+ * @return Name
+ */
+std::string capture_button_name(uint8_t value);
+
+#endif /* CAPTURE_H */
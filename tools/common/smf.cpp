@@ -0,0 +1,451 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file smf.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Implementation of the host side Standard MIDI File reader / writer.
+ */
+
+
+#include "smf.h"
+
+#include <algorithm>
+#include <string.h>
+
+
+static uint32_t read_u32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24U) | ((uint32_t)p[1] << 16U) | ((uint32_t)p[2] << 8U) | (uint32_t)p[3];
+}
+
+static uint16_t read_u16(const uint8_t *p)
+{
+    return (uint16_t)(((uint16_t)p[0] << 8U) | p[1]);
+}
+
+/**
+ * @brief Read a variable length quantity.
+ * @param p Read position, advanced on success
+ * @param end End of the chunk
+ * @param value Decoded value
+ * @return true if valid, false on overflow or truncation
+ */
+static bool read_vlq(const uint8_t *&p, const uint8_t *end, uint32_t &value)
+{
+    value = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        if (p >= end)
+        {
+            return false;
+        }
+        uint8_t b = *p++;
+        value = (value << 7U) | (b & 0x7FU);
+        if ((b & 0x80U) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void write_vlq(std::vector<uint8_t> &out, uint32_t value)
+{
+    uint8_t tmp[4];
+    int n = 0;
+    tmp[n++] = value & 0x7FU;
+    while ((value >>= 7U) != 0)
+    {
+        tmp[n++] = 0x80U | (value & 0x7FU);
+    }
+    while (n > 0)
+    {
+        out.push_back(tmp[--n]);
+    }
+}
+
+static void write_u32(std::vector<uint8_t> &out, uint32_t value)
+{
+    out.push_back((value >> 24U) & 0xFFU);
+    out.push_back((value >> 16U) & 0xFFU);
+    out.push_back((value >> 8U) & 0xFFU);
+    out.push_back(value & 0xFFU);
+}
+
+/**
+ * @brief Parse the events of a single MTrk chunk.
+ * @param p Start of chunk data
+ * @param end End of chunk data
+ * @param track Parsed events
+ * @param error Reason on failure
+ * @return true if valid, false otherwise
+ */
+static bool parse_track(const uint8_t *p, const uint8_t *end, smf_track_s &track, std::string &error)
+{
+    uint32_t tick = 0;
+    uint8_t runningStatus = 0;
+    bool eot = false;
+
+    while (p < end)
+    {
+        if (eot)
+        {
+            error = "data after end of track";
+            return false;
+        }
+
+        uint32_t delta;
+        if (!read_vlq(p, end, delta))
+        {
+            error = "invalid delta time";
+            return false;
+        }
+        tick += delta;
+
+        if (p >= end)
+        {
+            error = "truncated event";
+            return false;
+        }
+
+        smf_event_s ev;
+        ev.tick = tick;
+        ev.meta = 0;
+
+        uint8_t status = *p;
+        if (status & 0x80U)
+        {
+            p++;
+        }
+        else
+        {
+            if (runningStatus == 0)
+            {
+                error = "data byte without status";
+                return false;
+            }
+            status = runningStatus;
+        }
+        ev.status = status;
+
+        if (status < 0xF0U)
+        {
+            size_t n = smf_channel_data_len(status);
+            if ((size_t)(end - p) < n)
+            {
+                error = "truncated channel message";
+                return false;
+            }
+            for (size_t i = 0; i < n; i++)
+            {
+                if (p[i] & 0x80U)
+                {
+                    error = "status byte inside channel message";
+                    return false;
+                }
+            }
+            ev.data.assign(p, p + n);
+            p += n;
+            runningStatus = status;
+        }
+        else if (status == 0xF0U || status == 0xF7U)
+        {
+            uint32_t len;
+            if (!read_vlq(p, end, len) || (uint32_t)(end - p) < len)
+            {
+                error = "truncated SysEx";
+                return false;
+            }
+            ev.data.assign(p, p + len);
+            p += len;
+        }
+        else if (status == SMF_META)
+        {
+            if (p >= end)
+            {
+                error = "truncated meta event";
+                return false;
+            }
+            ev.meta = *p++;
+            uint32_t len;
+            if (!read_vlq(p, end, len) || (uint32_t)(end - p) < len)
+            {
+                error = "truncated meta event";
+                return false;
+            }
+            if (ev.meta == SMF_META_TEMPO && len != 3)
+            {
+                error = "invalid tempo event";
+                return false;
+            }
+            ev.data.assign(p, p + len);
+            p += len;
+            if (ev.meta == SMF_META_EOT)
+            {
+                eot = true;
+            }
+        }
+        else
+        {
+            error = "system message not allowed in file";
+            return false;
+        }
+
+        track.events.push_back(std::move(ev));
+    }
+
+    if (!eot)
+    {
+        error = "missing end of track";
+        return false;
+    }
+    return true;
+}
+
+bool smf_parse(const uint8_t *buf, size_t len, smf_file_s &smf, std::string &error)
+{
+    const uint8_t *p = buf;
+    const uint8_t *end = buf + len;
+
+    if (len < 14 || memcmp(p, "MThd", 4) != 0)
+    {
+        error = "no MThd header";
+        return false;
+    }
+
+    uint32_t hdrLen = read_u32(p + 4);
+    if (hdrLen < 6 || hdrLen > len - 8)
+    {
+        error = "invalid header length";
+        return false;
+    }
+
+    smf.format = read_u16(p + 8);
+    uint16_t trackCount = read_u16(p + 10);
+    smf.division = read_u16(p + 12);
+    smf.tracks.clear();
+
+    if (smf.format > 2)
+    {
+        error = "unknown format";
+        return false;
+    }
+    if (smf.division & 0x8000U)
+    {
+        error = "SMPTE division not supported";
+        return false;
+    }
+    if (smf.division == 0)
+    {
+        error = "zero division";
+        return false;
+    }
+
+    p += 8 + hdrLen;
+
+    while ((size_t)(end - p) >= 8)
+    {
+        uint32_t chunkLen = read_u32(p + 4);
+        if (chunkLen > (uint32_t)(end - p - 8))
+        {
+            error = "truncated chunk";
+            return false;
+        }
+
+        if (memcmp(p, "MTrk", 4) == 0)
+        {
+            smf_track_s track;
+            if (!parse_track(p + 8, p + 8 + chunkLen, track, error))
+            {
+                error = "track " + std::to_string(smf.tracks.size()) + ": " + error;
+                return false;
+            }
+            smf.tracks.push_back(std::move(track));
+        }
+        /* unknown chunks are skipped as required by the spec */
+
+        p += 8 + chunkLen;
+    }
+
+    if (smf.tracks.size() != trackCount)
+    {
+        error = "header announces " + std::to_string(trackCount) + " tracks, found " + std::to_string(smf.tracks.size());
+        return false;
+    }
+    if (smf.format == 0 && trackCount != 1)
+    {
+        error = "format 0 with more than one track";
+        return false;
+    }
+
+    return true;
+}
+
+void smf_merge_tracks(const smf_file_s &smf, smf_track_s &merged)
+{
+    struct ref_s
+    {
+        uint32_t tick;
+        size_t track;
+        size_t index;
+    };
+
+    std::vector<ref_s> refs;
+    uint32_t endTick = 0;
+
+    for (size_t t = 0; t < smf.tracks.size(); t++)
+    {
+        const std::vector<smf_event_s> &events = smf.tracks[t].events;
+        for (size_t i = 0; i < events.size(); i++)
+        {
+            if (events[i].status == SMF_META && events[i].meta == SMF_META_EOT)
+            {
+                endTick = std::max(endTick, events[i].tick);
+                continue;
+            }
+            refs.push_back({events[i].tick, t, i});
+        }
+    }
+
+    std::stable_sort(refs.begin(), refs.end(), [](const ref_s &a, const ref_s &b)
+    {
+        return a.tick < b.tick;
+    });
+
+    merged.events.clear();
+    merged.events.reserve(refs.size() + 1);
+    for (const ref_s &r : refs)
+    {
+        merged.events.push_back(smf.tracks[r.track].events[r.index]);
+    }
+
+    smf_event_s eot;
+    eot.tick = std::max(endTick, merged.events.empty() ? 0U : merged.events.back().tick);
+    eot.status = SMF_META;
+    eot.meta = SMF_META_EOT;
+    merged.events.push_back(eot);
+}
+
+void smf_write_format0(uint16_t division, const smf_track_s &track, std::vector<uint8_t> &out)
+{
+    std::vector<uint8_t> trk;
+    uint32_t lastTick = 0;
+    uint8_t runningStatus = 0;
+    bool eot = false;
+
+    for (const smf_event_s &ev : track.events)
+    {
+        write_vlq(trk, ev.tick - lastTick);
+        lastTick = ev.tick;
+
+        if (ev.status < 0xF0U)
+        {
+            if (ev.status != runningStatus)
+            {
+                trk.push_back(ev.status);
+                runningStatus = ev.status;
+            }
+            trk.insert(trk.end(), ev.data.begin(), ev.data.end());
+        }
+        else
+        {
+            /* SysEx and meta events cancel running status */
+            runningStatus = 0;
+            trk.push_back(ev.status);
+            if (ev.status == SMF_META)
+            {
+                trk.push_back(ev.meta);
+                eot = (ev.meta == SMF_META_EOT);
+            }
+            write_vlq(trk, (uint32_t)ev.data.size());
+            trk.insert(trk.end(), ev.data.begin(), ev.data.end());
+        }
+    }
+
+    if (!eot)
+    {
+        trk.push_back(0x00);
+        trk.push_back(SMF_META);
+        trk.push_back(SMF_META_EOT);
+        trk.push_back(0x00);
+    }
+
+    out.clear();
+    out.insert(out.end(), {'M', 'T', 'h', 'd'});
+    write_u32(out, 6);
+    out.insert(out.end(), {0x00, 0x00, 0x00, 0x01});
+    out.push_back((division >> 8U) & 0xFFU);
+    out.push_back(division & 0xFFU);
+    out.insert(out.end(), {'M', 'T', 'r', 'k'});
+    write_u32(out, (uint32_t)trk.size());
+    out.insert(out.end(), trk.begin(), trk.end());
+}
+
+void smf_build_tempo_map(uint16_t division, const smf_track_s &track, std::vector<smf_tempo_point_s> &map)
+{
+    map.clear();
+    map.push_back({0, 0, SMF_DEFAULT_TEMPO});
+
+    for (const smf_event_s &ev : track.events)
+    {
+        if (ev.status != SMF_META || ev.meta != SMF_META_TEMPO || ev.data.size() != 3)
+        {
+            continue;
+        }
+        uint32_t tempo = ((uint32_t)ev.data[0] << 16U) | ((uint32_t)ev.data[1] << 8U) | ev.data[2];
+        const smf_tempo_point_s &last = map.back();
+        uint64_t us = last.us + (uint64_t)(ev.tick - last.tick) * last.tempo / division;
+        if (ev.tick == last.tick)
+        {
+            map.back().tempo = tempo;
+        }
+        else
+        {
+            map.push_back({ev.tick, us, tempo});
+        }
+    }
+}
+
+uint64_t smf_tick_to_us(uint16_t division, const std::vector<smf_tempo_point_s> &map, uint32_t tick)
+{
+    auto it = std::upper_bound(map.begin(), map.end(), tick, [](uint32_t t, const smf_tempo_point_s &pt)
+    {
+        return t < pt.tick;
+    });
+    const smf_tempo_point_s &pt = *(it - 1);
+    return pt.us + (uint64_t)(tick - pt.tick) * pt.tempo / division;
+}
+
+size_t smf_wire_bytes(const smf_event_s &ev)
+{
+    if (ev.status < 0xF0U)
+    {
+        return 1U + ev.data.size();
+    }
+    if (ev.status == 0xF0U)
+    {
+        return 1U + ev.data.size();
+    }
+    if (ev.status == 0xF7U)
+    {
+        return ev.data.size();
+    }
+    return 0;
+}
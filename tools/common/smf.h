@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file smf.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Host side Standard MIDI File reader / writer shared by the tools in this folder.
+ *        The reader is strict on purpose: everything the device would choke on is reported.
+ */
+
+#ifndef SMF_H
+#define SMF_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+#define SMF_META            0xFFU
+#define SMF_META_EOT        0x2FU
+#define SMF_META_TEMPO      0x51U
+#define SMF_META_TIME_SIG   0x58U
+#define SMF_META_KEY_SIG    0x59U
+
+#define SMF_DEFAULT_TEMPO   500000U /* us per quarter note, 120 BPM */
+
+/* bytes per second on a 31250 baud 8N1 link */
+#define SMF_LINK_BYTES_PER_SEC  3125U
+
+
+struct smf_event_s
+{
+    uint32_t tick; /* absolute tick */
+    uint8_t status; /* 0x80..0xEF channel message, 0xF0/0xF7 SysEx, 0xFF meta */
+    uint8_t meta; /* meta type, valid for status 0xFF only */
+    std::vector<uint8_t> data; /* data bytes, SysEx without the leading 0xF0 */
+};
+
+struct smf_track_s
+{
+    std::vector<smf_event_s> events;
+};
+
+struct smf_file_s
+{
+    uint16_t format;
+    uint16_t division; /* ticks per quarter note, SMPTE division is rejected */
+    std::vector<smf_track_s> tracks;
+};
+
+struct smf_tempo_point_s
+{
+    uint32_t tick;
+    uint64_t us; /* absolute time of tick */
+    uint32_t tempo; /* us per quarter note from this tick on */
+};
+
+/**
+ * @brief Parse a complete Standard MIDI File.
+ * @param buf File content
+ * @param len File length in bytes
+ * @param smf Parsed file
+ * @param error Human readable reason when parsing fails
+ * @return true if the file is valid, false otherwise
+ */
+bool smf_parse(const uint8_t *buf, size_t len, smf_file_s &smf, std::string &error);
+
+/**
+ * @brief Serialize a single track format 0 file, using running status.
+ * @param division Ticks per quarter note
+ * @param track Track with events sorted by tick, EOT is appended if missing
+ * @param out Serialized file
+ */
+void smf_write_format0(uint16_t division, const smf_track_s &track, std::vector<uint8_t> &out);
+
+/**
+ * @brief Merge all tracks into one, keeping the order of events with equal ticks stable.
+ *        The end of track events of the source tracks are replaced by a single one.
+ * @param smf Source file
+ * @param merged Resulting track
+ */
+void smf_merge_tracks(const smf_file_s &smf, smf_track_s &merged);
+
+/**
+ * @brief Build the tempo map of a merged track.
+ * @param division Ticks per quarter note
+ * @param track Merged track
+ * @param map Resulting tempo map, always contains at least one entry at tick 0
+ */
+void smf_build_tempo_map(uint16_t division, const smf_track_s &track, std::vector<smf_tempo_point_s> &map);
+
+/**
+ * @brief Convert a tick to microseconds using a tempo map.
+ * @param division Ticks per quarter note
+ * @param map Tempo map from smf_build_tempo_map
+ * @param tick Absolute tick
+ * @return Absolute time in microseconds
+ */
+uint64_t smf_tick_to_us(uint16_t division, const std::vector<smf_tempo_point_s> &map, uint32_t tick);
+
+/**
+ * @brief Number of bytes an event occupies on the serial link to the sound chip.
+ *        Meta events are not sent, channel messages are counted with their status byte.
+ * @param ev Event
+ * @return Byte count on the wire
+ */
+size_t smf_wire_bytes(const smf_event_s &ev);
+
+/**
+ * @brief Length of the data part of a channel message.
+ * @param status Status byte 0x80..0xEF
+ * @return 1 or 2
+ */
+static inline size_t smf_channel_data_len(uint8_t status)
+{
+    return ((status & 0xF0U) == 0xC0U || (status & 0xF0U) == 0xD0U) ? 1U : 2U;
+}
+
+#endif /* SMF_H */
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file trace.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Reader / writer of the timestamped MIDI output trace.
+ */
+
+
+#include "trace.h"
+
+#include <fstream>
+#include <iterator>
+#include <string.h>
+
+
+static bool get_vlq(const std::vector<uint8_t> &buf, size_t &pos, uint64_t &value)
+{
+    value = 0;
+    for (int i = 0; i < 9; i++)
+    {
+        if (pos >= buf.size())
+        {
+            return false;
+        }
+        uint8_t b = buf[pos++];
+        value = (value << 7U) | (b & 0x7FU);
+        if ((b & 0x80U) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void put_vlq(std::vector<uint8_t> &out, uint64_t value)
+{
+    uint8_t tmp[10];
+    int n = 0;
+    tmp[n++] = value & 0x7FU;
+    while ((value >>= 7U) != 0)
+    {
+        tmp[n++] = 0x80U | (value & 0x7FU);
+    }
+    while (n > 0)
+    {
+        out.push_back(tmp[--n]);
+    }
+}
+
+bool trace_load(const std::string &path, std::vector<trace_msg_s> &msgs, std::string &error)
+{
+    std::ifstream f(path, std::ios::binary);
+    if (!f)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::vector<uint8_t> buf((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    if (buf.size() < 8 || memcmp(buf.data(), "MTRC", 4) != 0)
+    {
+        error = path + " is not a trace file";
+        return false;
+    }
+    if (buf[4] != TRACE_VERSION)
+    {
+        error = path + ": unsupported trace version " + std::to_string(buf[4]);
+        return false;
+    }
+
+    msgs.clear();
+    size_t pos = 8;
+    uint64_t us = 0;
+
+    while (pos < buf.size())
+    {
+        uint64_t delta;
+        uint64_t len;
+        if (!get_vlq(buf, pos, delta) || !get_vlq(buf, pos, len) || len > buf.size() - pos)
+        {
+            error = path + ": truncated record at offset " + std::to_string(pos);
+            return false;
+        }
+        us += delta;
+        trace_msg_s msg;
+        msg.us = us;
+        msg.data.assign(buf.begin() + pos, buf.begin() + pos + len);
+        pos += len;
+        msgs.push_back(std::move(msg));
+    }
+
+    return true;
+}
+
+bool trace_save(const std::string &path, const std::vector<trace_msg_s> &msgs)
+{
+    std::vector<uint8_t> buf = {'M', 'T', 'R', 'C', TRACE_VERSION, 0, 0, 0};
+    uint64_t last = 0;
+
+    for (const trace_msg_s &msg : msgs)
+    {
+        put_vlq(buf, msg.us - last);
+        put_vlq(buf, msg.data.size());
+        buf.insert(buf.end(), msg.data.begin(), msg.data.end());
+        last = msg.us;
+    }
+
+    std::ofstream f(path, std::ios::binary);
+    f.write((const char *)buf.data(), (std::streamsize)buf.size());
+    return (bool)f;
+}
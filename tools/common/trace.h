@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file trace.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Timestamped MIDI output trace as written by MidiRender.ino of the MidiFilePlayer.
+ *
+ * File format (all values are variable length quantities like in a MIDI file):
+ *   "MTRC" <version 1> <3 reserved bytes>
+ *   records: <delta time in us> <length> <bytes>
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+#define TRACE_VERSION   1
+
+
+struct trace_msg_s
+{
+    uint64_t us; /* absolute time */
+    std::vector<uint8_t> data;
+};
+
+/**
+ * @brief Load a trace file.
+ * @param path File path
+ * @param msgs Messages with absolute timestamps
+ * @param error Reason on failure
+ * @return true if successful, false otherwise
+ */
+bool trace_load(const std::string &path, std::vector<trace_msg_s> &msgs, std::string &error);
+
+/**
+ * @brief Write a trace file.
+ * @param path File path
+ * @param msgs Messages sorted by time
+ * @return true if successful, false otherwise
+ */
+bool trace_save(const std::string &path, const std::vector<trace_msg_s> &msgs);
+
+#endif /* TRACE_H */
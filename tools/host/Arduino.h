@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file Arduino.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Minimal Arduino API for building sketch sources on a PC.
+ *        Only what the sketches in this repository use is provided.
+ *        Time can run in real time or on a virtual clock which is advanced by the host tool.
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+
+#define ARDUINO_HOST    /* no board, see MidiTransport.h */
+
+#define HIGH    1
+#define LOW     0
+#define INPUT   0
+#define OUTPUT  1
+#define INPUT_PULLUP 2
+
+#define IRAM_ATTR
+
+typedef uint8_t byte;
+
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield(void);
+
+/**
+ * @brief Switch between real time and a virtual clock.
+ * @param enable true to use the virtual clock, it starts at 0
+ */
+void host_clock_set_virtual(bool enable);
+
+/**
+ * @brief Advance the virtual clock.
+ * @param us Microseconds
+ */
+void host_clock_advance_us(uint64_t us);
+
+/**
+ * @brief Current time in microseconds, 64 bit version of micros().
+ * @return Time in microseconds
+ */
+uint64_t host_clock_us(void);
+
+/**
+ * @brief Set the time of the next interrupt of the modelled board, ends host_wait_for_interrupt() on the virtual clock.
+ * @param next Returns the time in microseconds (host_clock_us()), UINT64_MAX if none is expected. NULL for none
+ */
+void host_set_interrupt_source(uint64_t (*next)(void));
+
+/**
+ * @brief Halt like WFI: the virtual clock moves to the next interrupt or by the given time, the real clock sleeps.
+ * @param us Longest wait in microseconds
+ */
+void host_wait_for_interrupt(uint32_t us);
+
+
+class String
+{
+public:
+    String(const char *s = "") : str(s) {}
+    String(const std::string &s) : str(s) {}
+    String(int v) : str(std::to_string(v)) {}
+    String(unsigned v) : str(std::to_string(v)) {}
+    String(long v) : str(std::to_string(v)) {}
+    String(unsigned long v) : str(std::to_string(v)) {}
+    String operator+(const String &o) const { return String(str + o.str); }
+    String operator+(const char *o) const { return String(str + o); }
+    friend String operator+(const char *a, const String &b) { return String(std::string(a) + b.str); }
+    String &operator+=(const String &o) { str += o.str; return *this; }
+    const char *c_str() const { return str.c_str(); }
+    unsigned length() const { return (unsigned)str.size(); }
+
+private:
+    std::string str;
+};
+
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t *buf, size_t len)
+    {
+        size_t n = 0;
+        while (len--)
+        {
+            n += write(*buf++);
+        }
+        return n;
+    }
+    size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    virtual int availableForWrite(void) { return 0; }
+    virtual void flush(void) {}
+
+    size_t print(const char *s) { return write(s); }
+    size_t print(const String &s) { return write(s.c_str()); }
+    size_t print(int v) { return printf("%d", v); }
+    size_t print(unsigned v) { return printf("%u", v); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+    size_t println(void) { return write("\r\n"); }
+    template<typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+    size_t println(double v, int digits) { size_t n = print(v, digits); return n + println(); }
+
+    size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)))
+    {
+        char buf[256];
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(buf, sizeof(buf), fmt, args);
+        va_end(args);
+        if (n < 0)
+        {
+            return 0;
+        }
+        return write((const uint8_t *)buf, strlen(buf));
+    }
+};
+
+
+class Stream : public Print
+{
+public:
+    virtual int available(void) = 0;
+    virtual int read(void) = 0;
+    virtual int peek(void) = 0;
+    size_t readBytes(uint8_t *buf, size_t len)
+    {
+        size_t n = 0;
+        while (n < len && available() > 0)
+        {
+            buf[n++] = (uint8_t)read();
+        }
+        return n;
+    }
+};
+
+
+/**
+ * @brief Serial port of the host build.
+ *        Received data is injected by the host tool, transmitted data is counted and optionally kept or echoed.
+ */
+class HostSerial : public Stream
+{
+public:
+    HostSerial(bool echo = false) : echo(echo) {}
+
+    void begin(unsigned long baud, ...) { (void)baud; }
+    operator bool() const { return true; }
+
+    size_t write(uint8_t b) override
+    {
+        txCount++;
+        if (keepTx)
+        {
+            tx.push_back(b);
+        }
+        if (echo)
+        {
+            fputc(b, stdout);
+        }
+        return 1;
+    }
+    size_t write(const uint8_t *buf, size_t len) override
+    {
+        txCount += len;
+        if (keepTx)
+        {
+            tx.insert(tx.end(), buf, buf + len);
+        }
+        if (echo)
+        {
+            fwrite(buf, 1, len, stdout);
+        }
+        return len;
+    }
+    using Print::write;
+    int availableForWrite(void) override { return txFree; }
+
+    int available(void) override { return (int)(rx.size() - rxPos); }
+    int read(void) override { return rxPos < rx.size() ? rx[rxPos++] : -1; }
+    int peek(void) override { return rxPos < rx.size() ? rx[rxPos] : -1; }
+
+    /**
+     * @brief Inject bytes which will be returned by read().
+     * @param buf Data
+     * @param len Length
+     */
+    void inject(const uint8_t *buf, size_t len)
+    {
+        if (rxPos == rx.size())
+        {
+            rx.clear();
+            rxPos = 0;
+        }
+        rx.insert(rx.end(), buf, buf + len);
+    }
+
+    bool echo;
+    bool keepTx = false;
+    int txFree = 128;
+    uint64_t txCount = 0;
+    std::vector<uint8_t> tx;
+
+private:
+    std::vector<uint8_t> rx;
+    size_t rxPos = 0;
+};
+
+#endif /* HOST_ARDUINO_H */
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file FS.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief File system API of the host build, paths are mapped into a directory of the PC.
+ */
+
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+#include "Arduino.h"
+
+#include <memory>
+
+
+#define HOST_FS_BLOCK_SIZE  4096U   /* erase block of the flash */
+#define HOST_FS_PAGE_SIZE   256U
+
+
+namespace fs
+{
+
+enum SeekMode
+{
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+class File : public Stream
+{
+public:
+    File() {}
+
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t *buf, size_t len) override;
+    using Print::write;
+    int available(void) override;
+    int read(void) override;
+    int peek(void) override;
+    size_t read(uint8_t *buf, size_t len);
+    bool seek(uint32_t pos, SeekMode mode = SeekSet);
+    size_t position(void) const;
+    size_t size(void) const;
+    void flush(void) override;
+    void close(void);
+    operator bool() const { return impl != nullptr; }
+    const char *name(void) const;
+    const char *path(void) const;
+    bool isDirectory(void);
+    File openNextFile(const char *mode = "r");
+
+    struct impl_s;
+    std::shared_ptr<impl_s> impl;
+};
+
+class FS
+{
+public:
+    File open(const char *path, const char *mode = "r", bool create = false);
+    bool exists(const char *path);
+    bool remove(const char *path);
+    bool rename(const char *from, const char *to);
+    bool mkdir(const char *path);
+};
+
+}
+
+using fs::File;
+using fs::FS;
+
+/**
+ * @brief Set the directory of the PC which is used as root of the file system.
+ * @param dir Directory path
+ */
+void host_fs_set_root(const char *dir);
+
+/**
+ * @brief Let writes take time on the virtual clock like the flash: an erase for every block of HOST_FS_BLOCK_SIZE bytes
+ *        a file grows into and a program time per page of HOST_FS_PAGE_SIZE bytes. 0 for both writes without time.
+ * @param eraseUs Time of a block erase in microseconds
+ * @param pageUs Time of a page program in microseconds
+ */
+void host_fs_set_flash_timing(uint32_t eraseUs, uint32_t pageUs);
+
+#endif /* HOST_FS_H */
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file LittleFS.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief LittleFS of the host build, see host_fs_set_root().
+ */
+
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+#include "FS.h"
+
+
+class LittleFSFS : public fs::FS
+{
+public:
+    bool begin(bool formatOnFail = false, ...)
+    {
+        (void)formatOnFail;
+        return true;
+    }
+    size_t totalBytes(void) { return 1024U * 1024U; }
+    size_t usedBytes(void) { return 0; }
+};
+
+extern LittleFSFS LittleFS;
+
+#endif /* HOST_LITTLEFS_H */
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file host_arduino.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Time functions of the host Arduino API.
+ */
+
+
+#include "Arduino.h"
+
+#include <chrono>
+#include <thread>
+
+
+static bool clockVirtual = false;
+static uint64_t clockVirtualUs = 0;
+static const std::chrono::steady_clock::time_point clockStart = std::chrono::steady_clock::now();
+static uint64_t (*interruptNext)(void) = NULL;
+
+
+void host_clock_set_virtual(bool enable)
+{
+    clockVirtual = enable;
+    clockVirtualUs = 0;
+}
+
+void host_clock_advance_us(uint64_t us)
+{
+    clockVirtualUs += us;
+}
+
+uint64_t host_clock_us(void)
+{
+    if (clockVirtual)
+    {
+        return clockVirtualUs;
+    }
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - clockStart).count();
+}
+
+void host_set_interrupt_source(uint64_t (*next)(void))
+{
+    interruptNext = next;
+}
+
+void host_wait_for_interrupt(uint32_t us)
+{
+    if (!clockVirtual)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+        return;
+    }
+
+    uint64_t untilUs = clockVirtualUs + us;
+    if (interruptNext != NULL)
+    {
+        uint64_t irqUs = interruptNext();
+        if (irqUs < untilUs)
+        {
+            untilUs = (irqUs > clockVirtualUs) ? irqUs : clockVirtualUs;
+        }
+    }
+    clockVirtualUs = untilUs;
+}
+
+unsigned long millis(void)
+{
+    return (unsigned long)(uint32_t)(host_clock_us() / 1000U);
+}
+
+unsigned long micros(void)
+{
+    return (unsigned long)(uint32_t)host_clock_us();
+}
+
+void delay(unsigned long ms)
+{
+    if (clockVirtual)
+    {
+        clockVirtualUs += (uint64_t)ms * 1000U;
+    }
+    else
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    if (clockVirtual)
+    {
+        clockVirtualUs += us;
+    }
+    else
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+    }
+}
+
+void yield(void)
+{
+}
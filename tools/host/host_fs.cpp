@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file host_fs.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief File system of the host build on top of stdio.
+ */
+
+
+#include "FS.h"
+#include "LittleFS.h"
+
+#include <algorithm>
+#include <filesystem>
+
+
+namespace fsys = std::filesystem;
+
+LittleFSFS LittleFS;
+
+static std::string fsRoot = ".";
+static uint32_t fsEraseUs = 0;
+static uint32_t fsPageUs = 0;
+
+
+struct fs::File::impl_s
+{
+    FILE *f = nullptr;
+    bool dir = false;
+    std::string path; /* path inside the file system */
+    std::string name;
+    std::vector<std::string> entries;
+    size_t nextEntry = 0;
+
+    ~impl_s()
+    {
+        if (f != nullptr)
+        {
+            fclose(f);
+        }
+    }
+};
+
+void host_fs_set_root(const char *dir)
+{
+    fsRoot = dir;
+}
+
+void host_fs_set_flash_timing(uint32_t eraseUs, uint32_t pageUs)
+{
+    fsEraseUs = eraseUs;
+    fsPageUs = pageUs;
+}
+
+static std::string host_path(const char *path)
+{
+    return fsRoot + "/" + path;
+}
+
+fs::File fs::FS::open(const char *path, const char *mode, bool create)
+{
+    (void)create;
+    File file;
+    std::string hp = host_path(path);
+    std::error_code ec;
+
+    auto impl = std::make_shared<File::impl_s>();
+    impl->path = path;
+    impl->name = fsys::path(path).filename().string();
+
+    if (fsys::is_directory(hp, ec))
+    {
+        impl->dir = true;
+        for (const auto &e : fsys::directory_iterator(hp, ec))
+        {
+            impl->entries.push_back(e.path().filename().string());
+        }
+        std::sort(impl->entries.begin(), impl->entries.end());
+    }
+    else
+    {
+        std::string m = mode;
+        if (m == "r")
+        {
+            m = "rb";
+        }
+        else if (m == "w")
+        {
+            m = "wb+";
+        }
+        else if (m == "a")
+        {
+            m = "ab+";
+        }
+        else if (m == "r+")
+        {
+            m = "rb+";
+        }
+        impl->f = fopen(hp.c_str(), m.c_str());
+        if (impl->f == nullptr)
+        {
+            return file;
+        }
+    }
+
+    file.impl = impl;
+    return file;
+}
+
+bool fs::FS::exists(const char *path)
+{
+    std::error_code ec;
+    return fsys::exists(host_path(path), ec);
+}
+
+bool fs::FS::remove(const char *path)
+{
+    std::error_code ec;
+    return fsys::remove(host_path(path), ec);
+}
+
+bool fs::FS::rename(const char *from, const char *to)
+{
+    std::error_code ec;
+    fsys::rename(host_path(from), host_path(to), ec);
+    return !ec;
+}
+
+bool fs::FS::mkdir(const char *path)
+{
+    std::error_code ec;
+    return fsys::create_directories(host_path(path), ec) || fsys::is_directory(host_path(path), ec);
+}
+
+size_t fs::File::write(const uint8_t *buf, size_t len)
+{
+    if (!impl || !impl->f)
+    {
+        return 0;
+    }
+    if (len > 0 && (fsEraseUs > 0 || fsPageUs > 0))
+    {
+        size_t pos = position();
+        size_t erased = (size() + HOST_FS_BLOCK_SIZE - 1U) / HOST_FS_BLOCK_SIZE;
+        size_t needed = (pos + len + HOST_FS_BLOCK_SIZE - 1U) / HOST_FS_BLOCK_SIZE;
+        size_t pages = (pos + len + HOST_FS_PAGE_SIZE - 1U) / HOST_FS_PAGE_SIZE - pos / HOST_FS_PAGE_SIZE;
+        host_clock_advance_us((uint64_t)((needed > erased) ? needed - erased : 0U) * fsEraseUs + (uint64_t)pages * fsPageUs);
+    }
+    return fwrite(buf, 1, len, impl->f);
+}
+
+int fs::File::available(void)
+{
+    return (int)(size() - position());
+}
+
+int fs::File::read(void)
+{
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+int fs::File::peek(void)
+{
+    int c = read();
+    if (c >= 0)
+    {
+        fseek(impl->f, -1, SEEK_CUR);
+    }
+    return c;
+}
+
+size_t fs::File::read(uint8_t *buf, size_t len)
+{
+    return (impl && impl->f) ? fread(buf, 1, len, impl->f) : 0;
+}
+
+bool fs::File::seek(uint32_t pos, SeekMode mode)
+{
+    static const int whence[] = {SEEK_SET, SEEK_CUR, SEEK_END};
+    return impl && impl->f && fseek(impl->f, (long)pos, whence[mode]) == 0;
+}
+
+size_t fs::File::position(void) const
+{
+    return (impl && impl->f) ? (size_t)ftell(impl->f) : 0;
+}
+
+size_t fs::File::size(void) const
+{
+    if (!impl || !impl->f)
+    {
+        return 0;
+    }
+    long pos = ftell(impl->f);
+    fseek(impl->f, 0, SEEK_END);
+    long len = ftell(impl->f);
+    fseek(impl->f, pos, SEEK_SET);
+    return (size_t)len;
+}
+
+void fs::File::flush(void)
+{
+    if (impl && impl->f)
+    {
+        fflush(impl->f);
+    }
+}
+
+void fs::File::close(void)
+{
+    impl.reset();
+}
+
+const char *fs::File::name(void) const
+{
+    return impl ? impl->name.c_str() : "";
+}
+
+const char *fs::File::path(void) const
+{
+    return impl ? impl->path.c_str() : "";
+}
+
+bool fs::File::isDirectory(void)
+{
+    return impl && impl->dir;
+}
+
+fs::File fs::File::openNextFile(const char *mode)
+{
+    if (!impl || !impl->dir || impl->nextEntry >= impl->entries.size())
+    {
+        return File();
+    }
+    std::string p = impl->path;
+    if (p.empty() || p.back() != '/')
+    {
+        p += "/";
+    }
+    p += impl->entries[impl->nextEntry++];
+    FS fs;
+    return fs.open(p.c_str(), mode);
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file host_player.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Stand in for the MIDI player of ML_SynthTools_Lib in the host build.
+ *        It does not play anything, it only keeps the state set by the sketch.
+ */
+
+
+#include "ml_midi_player.h"
+
+
+float host_player_tempo = 120.0f;
+bool host_player_active = false;
+
+
+void ml_midi_player_setup(uint8_t *data, int len)
+{
+    (void)data;
+    (void)len;
+    host_player_active = true;
+}
+
+void ml_midi_player_loop(uint32_t elapsed_ms)
+{
+    (void)elapsed_ms;
+}
+
+void ml_midi_player_set_tempo(float bpm)
+{
+    host_player_tempo = bpm;
+}
+
+bool ml_midi_player_is_active(void)
+{
+    return host_player_active;
+}
+
+void ml_midi_player_stop(void)
+{
+    host_player_active = false;
+}
+
+void ml_midi_player_play(void)
+{
+    host_player_active = true;
+}
+
+void ml_midi_player_rewind(void)
+{
+}
+
+void ml_midi_player_toggle_track_mute(uint8_t track)
+{
+    (void)track;
+}
+
+void ml_midi_player_set_mt32_sound_variation(void)
+{
+}
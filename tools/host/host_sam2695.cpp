@@ -0,0 +1,545 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file host_sam2695.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Implementation of the SAM2695 model of the host build.
+ *        Parameter numbers are kept as written by the sketch: MSB in the high byte, LSB in the low byte (0x3707).
+ */
+
+
+#include "host_sam2695.h"
+
+#include <algorithm>
+
+
+#define CC_DATA_ENTRY_MSB   0x06U
+#define CC_SUSTAIN          0x40U
+#define CC_NRPN_LSB         0x62U
+#define CC_NRPN_MSB         0x63U
+#define CC_RPN_LSB          0x64U
+#define CC_RPN_MSB          0x65U
+#define CC_ALL_SOUND_OFF    0x78U
+#define CC_RESET_ALL        0x79U
+#define CC_ALL_NOTES_OFF    0x7BU
+
+#define GS_ADDR_RESET       0x40007FU
+
+
+struct sam_param_name_s
+{
+    uint32_t param;
+    const char *name;
+};
+
+static const struct sam_param_name_s samRpnNames[] =
+{
+    { 0x0000, "bend range" },
+    { 0x0001, "fine tune" },
+    { 0x0002, "coarse tune" },
+};
+
+static const struct sam_param_name_s samNrpnNames[] =
+{
+    { 0x0120, "tvf cutoff" },
+    { 0x3700, "eq low" },
+    { 0x3701, "eq mid low" },
+    { 0x3702, "eq mid high" },
+    { 0x3703, "eq high" },
+    { 0x3707, "volume" },
+    { 0x3720, "spatial effect" },
+    { 0x3734, "echo right volume" },
+};
+
+static const struct sam_param_name_s samGsNames[] =
+{
+    { 0x400004, "master volume" },
+    { 0x400005, "master key shift" },
+    { 0x400006, "master pan" },
+};
+
+
+template <size_t N>
+static const char *sam_param_name(const struct sam_param_name_s (&names)[N], uint32_t param)
+{
+    for (const struct sam_param_name_s &n : names)
+    {
+        if (n.param == param)
+        {
+            return n.name;
+        }
+    }
+    return "";
+}
+
+static uint16_t sam_message_len(uint8_t status)
+{
+    if (status < 0xF0U)
+    {
+        return ((status & 0xE0U) == 0xC0U) ? 2U : 3U;
+    }
+    switch (status)
+    {
+    case 0xF1U:
+    case 0xF3U:
+        return 2U;
+    case 0xF2U:
+        return 3U;
+    default:
+        return 1U;
+    }
+}
+
+
+HostSam2695::HostSam2695(int fifoSize, uint32_t polyphony) : fifoSize(fifoSize), polyphony(polyphony)
+{
+    for (struct sam_channel_s &c : channels)
+    {
+        c.used = false;
+    }
+    reset();
+}
+
+/**
+ * @brief Power on state, also set by a GM or GS reset.
+ */
+void HostSam2695::reset(void)
+{
+    for (struct sam_channel_s &c : channels)
+    {
+        c.program = 0;
+        memset(c.cc, 0, sizeof(c.cc));
+        c.cc[7] = 100;
+        c.cc[10] = 64;
+        c.cc[11] = 127;
+        c.bend = 0x2000U;
+        c.nrpnSelected = false;
+        c.rpn = SAM_PARAM_NONE;
+        c.nrpn = SAM_PARAM_NONE;
+        c.rpnValue.clear();
+        c.rpnValue[0x0000] = 2;
+        c.nrpnValue.clear();
+    }
+    voices.clear();
+    masterVolume = 0x3FFFU;
+    gsParam.clear();
+}
+
+int HostSam2695::availableForWrite(void)
+{
+    uint64_t nowUs = host_clock_us();
+    uint64_t pending = (lineFreeUs > nowUs) ? (lineFreeUs - nowUs + SAM_BYTE_US - 1U) / SAM_BYTE_US : 0U;
+    return (pending < (uint64_t)fifoSize) ? (int)(fifoSize - (int)pending) : 0;
+}
+
+size_t HostSam2695::write(uint8_t b)
+{
+    uint64_t nowUs = host_clock_us();
+    if (availableForWrite() <= 0)
+    {
+        st.overrun++;
+    }
+
+    if (st.bytes == 0)
+    {
+        st.firstUs = nowUs;
+    }
+    uint64_t startUs = std::max(lineFreeUs, nowUs);
+    lineFreeUs = startUs + SAM_BYTE_US;
+    st.bytes++;
+    st.lastUs = lineFreeUs;
+
+    size_t second = (size_t)((startUs - st.firstUs) / 1000000U);
+    if (second >= secondBytes.size())
+    {
+        secondBytes.resize(second + 1U, 0);
+    }
+    secondBytes[second]++;
+    st.peakBytesPerSec = std::max(st.peakBytesPerSec, secondBytes[second]);
+
+    byteOnWire(b, nowUs, lineFreeUs);
+    return 1;
+}
+
+size_t HostSam2695::write(const uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        write(buf[i]);
+    }
+    return len;
+}
+
+/**
+ * @brief Decode a byte which is completely received by the chip.
+ * @param b Byte
+ * @param writeUs Time it was written to the FIFO
+ * @param endUs Time its last bit is on the wire
+ */
+void HostSam2695::byteOnWire(uint8_t b, uint64_t writeUs, uint64_t endUs)
+{
+    if (b >= 0xF8U)
+    {
+        st.realtime++;
+        st.rtDelayMaxUs = std::max(st.rtDelayMaxUs, (uint32_t)(endUs - writeUs));
+        return;
+    }
+
+    bool inSysex = msgLen > 0 && rxMsg[0] == 0xF0U;
+    if (b & 0x80U)
+    {
+        if (inSysex)
+        {
+            if (b == 0xF7U)
+            {
+                if (msgLen < SAM_SYSEX_MAX)
+                {
+                    rxMsg[msgLen++] = b;
+                }
+                message(rxMsg, msgLen, endUs);
+                msgLen = 0;
+                return;
+            }
+            /* SysEx without end, the status starts the next message */
+            st.stray += msgLen;
+            msgLen = 0;
+        }
+        if (b == 0xF7U)
+        {
+            st.stray++;
+            return;
+        }
+
+        runningStatus = (b < 0xF0U) ? b : 0U;
+        rxMsg[0] = b;
+        msgLen = 1;
+        msgNeed = (b == 0xF0U) ? 0U : sam_message_len(b);
+        msgWriteUs = writeUs;
+    }
+    else if (inSysex)
+    {
+        if (msgLen < SAM_SYSEX_MAX)
+        {
+            rxMsg[msgLen++] = b;
+        }
+        return;
+    }
+    else
+    {
+        if (msgLen == 0)
+        {
+            if (runningStatus == 0)
+            {
+                st.stray++;
+                return;
+            }
+            rxMsg[0] = runningStatus;
+            msgLen = 1;
+            msgNeed = sam_message_len(runningStatus);
+            msgWriteUs = writeUs;
+        }
+        rxMsg[msgLen++] = b;
+    }
+
+    if (msgNeed > 0 && msgLen >= msgNeed)
+    {
+        message(rxMsg, msgLen, endUs);
+        msgLen = 0;
+    }
+}
+
+/**
+ * @brief Apply a complete message.
+ * @param msg Message, status byte first
+ * @param len Length of the message
+ * @param endUs Time its last byte is on the wire
+ */
+void HostSam2695::message(const uint8_t *msg, uint16_t len, uint64_t endUs)
+{
+    uint32_t delayUs = (uint32_t)(endUs - msgWriteUs);
+    st.messages++;
+    st.delaySumUs += delayUs;
+    st.delayMaxUs = std::max(st.delayMaxUs, delayUs);
+    if (onMessage != NULL)
+    {
+        onMessage(msg, len, endUs);
+    }
+
+    if (endUs < busyUntilUs)
+    {
+        st.ignoredBusy++;
+        return;
+    }
+
+    if (msg[0] == 0xF0U)
+    {
+        sysex(msg, len, endUs);
+        return;
+    }
+    if (msg[0] >= 0xF0U)
+    {
+        return;
+    }
+
+    uint8_t ch = msg[0] & 0x0FU;
+    struct sam_channel_s &c = channels[ch];
+    c.used = true;
+    switch (msg[0] & 0xF0U)
+    {
+    case 0x90U:
+        if (msg[2] > 0)
+        {
+            noteOn(ch, msg[1], endUs);
+        }
+        else
+        {
+            noteOff(ch, msg[1]);
+        }
+        break;
+    case 0x80U:
+        noteOff(ch, msg[1]);
+        break;
+    case 0xB0U:
+        controlChange(c, ch, msg[1], msg[2]);
+        break;
+    case 0xC0U:
+        c.program = msg[1];
+        break;
+    case 0xE0U:
+        c.bend = (uint16_t)(msg[1] | (msg[2] << 7));
+        break;
+    default:
+        break;
+    }
+}
+
+void HostSam2695::controlChange(struct sam_channel_s &c, uint8_t ch, uint8_t num, uint8_t value)
+{
+    c.cc[num] = value;
+    switch (num)
+    {
+    case CC_RPN_MSB:
+        c.rpn = (uint16_t)((value << 8) | (c.rpn & 0xFFU));
+        c.nrpnSelected = false;
+        break;
+    case CC_RPN_LSB:
+        c.rpn = (uint16_t)((c.rpn & 0xFF00U) | value);
+        c.nrpnSelected = false;
+        break;
+    case CC_NRPN_MSB:
+        c.nrpn = (uint16_t)((value << 8) | (c.nrpn & 0xFFU));
+        c.nrpnSelected = true;
+        break;
+    case CC_NRPN_LSB:
+        c.nrpn = (uint16_t)((c.nrpn & 0xFF00U) | value);
+        c.nrpnSelected = true;
+        break;
+    case CC_DATA_ENTRY_MSB:
+        if (c.nrpnSelected && c.nrpn != SAM_PARAM_NONE)
+        {
+            c.nrpnValue[c.nrpn] = value;
+        }
+        else if (!c.nrpnSelected && c.rpn != SAM_PARAM_NONE)
+        {
+            c.rpnValue[c.rpn] = value;
+        }
+        break;
+    case CC_SUSTAIN:
+        if (value < 64U)
+        {
+            releaseSustained(ch);
+        }
+        break;
+    case CC_ALL_SOUND_OFF:
+        allNotesOff(ch, true);
+        break;
+    case CC_ALL_NOTES_OFF:
+        allNotesOff(ch, false);
+        break;
+    case CC_RESET_ALL:
+        c.cc[1] = 0;
+        c.cc[11] = 127;
+        c.cc[CC_SUSTAIN] = 0;
+        c.bend = 0x2000U;
+        c.rpn = SAM_PARAM_NONE;
+        c.nrpn = SAM_PARAM_NONE;
+        releaseSustained(ch);
+        break;
+    default:
+        break;
+    }
+}
+
+void HostSam2695::sysex(const uint8_t *msg, uint16_t len, uint64_t endUs)
+{
+    st.sysex++;
+
+    /* GM system on: F0 7E <dev> 09 01 F7 */
+    if (len >= 6U && msg[1] == 0x7EU && msg[3] == 0x09U && msg[4] == 0x01U)
+    {
+        st.gmResets++;
+        reset();
+        busyUntilUs = endUs + resetBusyUs;
+        return;
+    }
+
+    /* master volume: F0 7F <dev> 04 01 <lsb> <msb> F7 */
+    if (len >= 8U && msg[1] == 0x7FU && msg[3] == 0x04U && msg[4] == 0x01U)
+    {
+        masterVolume = (uint16_t)(msg[5] | (msg[6] << 7));
+        return;
+    }
+
+    /* GS data set: F0 41 <dev> 42 12 <addr 3> <data ...> <checksum> F7 */
+    if (len >= 11U && msg[1] == 0x41U && msg[3] == 0x42U && msg[4] == 0x12U)
+    {
+        uint32_t sum = 0;
+        for (uint16_t i = 5; i < len - 1U; i++)
+        {
+            sum += msg[i];
+        }
+        if ((sum & 0x7FU) != 0)
+        {
+            st.checksumErrors++;
+            return;
+        }
+        st.gsDataSets++;
+
+        uint32_t addr = ((uint32_t)msg[5] << 16) | ((uint32_t)msg[6] << 8) | msg[7];
+        if (addr == GS_ADDR_RESET && msg[8] == 0x00U)
+        {
+            st.gsResets++;
+            reset();
+            busyUntilUs = endUs + resetBusyUs;
+            return;
+        }
+        for (uint16_t i = 8; i < len - 2U; i++)
+        {
+            gsParam[addr + (i - 8U)] = msg[i];
+        }
+    }
+}
+
+void HostSam2695::noteOn(uint8_t ch, uint8_t note, uint64_t endUs)
+{
+    st.notes++;
+    if (voices.size() >= polyphony)
+    {
+        /* the chip takes the oldest voice */
+        st.voiceOverflow++;
+        voices.erase(voices.begin());
+    }
+    voices.push_back({ch, note, false, endUs});
+    st.voicesPeak = std::max(st.voicesPeak, (uint32_t)voices.size());
+}
+
+void HostSam2695::noteOff(uint8_t ch, uint8_t note)
+{
+    bool sustain = channels[ch].cc[CC_SUSTAIN] >= 64U;
+    for (size_t i = 0; i < voices.size();)
+    {
+        struct sam_voice_s &v = voices[i];
+        if (v.channel == ch && v.note == note && !v.sustained)
+        {
+            if (sustain)
+            {
+                v.sustained = true;
+            }
+            else
+            {
+                voices.erase(voices.begin() + i);
+                continue;
+            }
+        }
+        i++;
+    }
+}
+
+void HostSam2695::releaseSustained(uint8_t ch)
+{
+    voices.erase(std::remove_if(voices.begin(), voices.end(), [ch](const struct sam_voice_s &v)
+    {
+        return v.channel == ch && v.sustained;
+    }), voices.end());
+}
+
+void HostSam2695::allNotesOff(uint8_t ch, bool sound)
+{
+    if (sound || channels[ch].cc[CC_SUSTAIN] < 64U)
+    {
+        voices.erase(std::remove_if(voices.begin(), voices.end(), [ch](const struct sam_voice_s &v)
+        {
+            return v.channel == ch;
+        }), voices.end());
+        return;
+    }
+    for (struct sam_voice_s &v : voices)
+    {
+        if (v.channel == ch)
+        {
+            v.sustained = true;
+        }
+    }
+}
+
+void HostSam2695::report(FILE *out) const
+{
+    double seconds = (st.bytes > 0) ? (st.lastUs - st.firstUs) / 1e6 : 0.0;
+    double linkBytes = seconds * 1e6 / SAM_BYTE_US;
+    fprintf(out, "link:      %llu bytes in %.1f s, %.1f %% used, peak second %.1f %%, %llu bytes written into a full FIFO\n",
+            (unsigned long long)st.bytes, seconds, (linkBytes > 0) ? 100.0 * st.bytes / linkBytes : 0.0,
+            100.0 * st.peakBytesPerSec * SAM_BYTE_US / 1e6, (unsigned long long)st.overrun);
+    fprintf(out, "latency:   %llu messages, write to last byte on the wire mean %.0f us, max %u us, %llu real time bytes, max %u us\n",
+            (unsigned long long)st.messages, st.messages ? (double)st.delaySumUs / st.messages : 0.0, st.delayMaxUs,
+            (unsigned long long)st.realtime, st.rtDelayMaxUs);
+    fprintf(out, "voices:    %llu notes, peak %u of %u, %llu voices stolen, %u still sounding\n",
+            (unsigned long long)st.notes, st.voicesPeak, polyphony, (unsigned long long)st.voiceOverflow, (uint32_t)voices.size());
+    fprintf(out, "system:    %u GM resets, %u GS resets, %llu messages ignored while busy, %u SysEx, %u GS data sets, %u checksum errors, %llu stray bytes\n",
+            st.gmResets, st.gsResets, (unsigned long long)st.ignoredBusy, st.sysex, st.gsDataSets, st.checksumErrors,
+            (unsigned long long)st.stray);
+
+    fprintf(out, "master volume %u", masterVolume);
+    for (const auto &p : gsParam)
+    {
+        fprintf(out, ", GS %06X %s = %u", p.first, sam_param_name(samGsNames, p.first), p.second);
+    }
+    fprintf(out, "\n");
+
+    fprintf(out, "%-3s %5s %5s %4s %4s %5s %4s %6s  %s\n", "ch", "prog", "bank", "vol", "pan", "expr", "sus", "bend", "parameters");
+    for (uint8_t ch = 0; ch < 16; ch++)
+    {
+        const struct sam_channel_s &c = channels[ch];
+        if (!c.used)
+        {
+            continue;
+        }
+        fprintf(out, "%-3u %5u %5u %4u %4u %5u %4u %6d ", ch + 1U, c.program + 1U, c.cc[0], c.cc[7], c.cc[10], c.cc[11],
+                c.cc[CC_SUSTAIN], (int)c.bend - 0x2000);
+        for (const auto &p : c.rpnValue)
+        {
+            fprintf(out, " RPN %04X %s = %u", p.first, sam_param_name(samRpnNames, p.first), p.second);
+        }
+        for (const auto &p : c.nrpnValue)
+        {
+            fprintf(out, " NRPN %04X %s = %u", p.first, sam_param_name(samNrpnNames, p.first), p.second);
+        }
+        fprintf(out, "\n");
+    }
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file host_sam2695.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Model of the SAM2695 behind the serial port of the synth for the host build.
+ *        It is passed as COM_SERIAL / to midi_out_init() like the port of a board.
+ *        Written bytes go through a TX FIFO and leave it back to back at 31250 baud on the host clock,
+ *        every byte is decoded at the time its last bit is on the wire.
+ *        The decoder follows running status and real time bytes in between, it keeps the state of the chip:
+ *        controllers, RPN / NRPN parameters (e.g. 0x3700 - 0x3734, 0x3707, 0x0120) per channel,
+ *        GS parameters set by SysEx data set, master volume and the GM / GS reset.
+ *        Sounding voices are counted against the polyphony of the chip, a note beyond it steals the oldest voice.
+ *        After a reset the chip is busy for a while, messages arriving then are counted and ignored.
+ */
+
+#ifndef HOST_SAM2695_H
+#define HOST_SAM2695_H
+
+#include "Arduino.h"
+
+#include <map>
+#include <vector>
+
+
+#define SAM_POLYPHONY           64U     /* voices of the chip */
+#define SAM_FIFO_SIZE           128     /* TX FIFO of the UART */
+#define SAM_BYTE_US             320U    /* 10 bits at 31250 baud */
+#define SAM_RESET_BUSY_US       50000U  /* time the chip needs after a GM or GS reset */
+#define SAM_SYSEX_MAX           256U
+
+#define SAM_PARAM_NONE          0x7F7FU /* RPN null, no parameter selected */
+
+
+struct sam_channel_s
+{
+    bool used;
+    uint8_t program;
+    uint8_t cc[128];
+    uint16_t bend;
+    bool nrpnSelected; /* data entry goes to an NRPN, otherwise to an RPN */
+    uint16_t rpn;
+    uint16_t nrpn;
+    std::map<uint16_t, uint8_t> rpnValue;
+    std::map<uint16_t, uint8_t> nrpnValue;
+};
+
+struct sam_voice_s
+{
+    uint8_t channel;
+    uint8_t note;
+    bool sustained; /* released while the sustain pedal is down */
+    uint64_t startUs;
+};
+
+struct host_sam_stats_s
+{
+    uint64_t bytes;
+    uint64_t firstUs;
+    uint64_t lastUs; /* last byte off the wire */
+    uint32_t peakBytesPerSec; /* most bytes within one second of wire time */
+    uint64_t overrun; /* bytes written while the FIFO was full */
+
+    uint64_t messages; /* channel and system messages, real time bytes excluded */
+    uint64_t realtime;
+    uint64_t delaySumUs; /* first byte written to last byte on the wire, per message */
+    uint32_t delayMaxUs;
+    uint32_t rtDelayMaxUs;
+
+    uint64_t notes;
+    uint32_t voicesPeak;
+    uint64_t voiceOverflow; /* notes which stole a voice */
+
+    uint32_t gmResets;
+    uint32_t gsResets;
+    uint32_t sysex;
+    uint32_t gsDataSets;
+    uint32_t checksumErrors;
+    uint64_t ignoredBusy; /* messages received while the chip was busy with a reset */
+    uint64_t stray; /* data bytes without a status */
+};
+
+
+/**
+ * @brief Serial port with the SAM2695 behind it.
+ */
+class HostSam2695 : public Stream
+{
+public:
+    HostSam2695(int fifoSize = SAM_FIFO_SIZE, uint32_t polyphony = SAM_POLYPHONY);
+
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t *buf, size_t len) override;
+    using Print::write;
+    int availableForWrite(void) override;
+
+    int available(void) override { return 0; }
+    int read(void) override { return -1; }
+    int peek(void) override { return -1; }
+
+    void setRxFIFOFull(uint8_t bytes) { (void)bytes; }
+    void onReceive(void (*cb)(void)) { (void)cb; }
+
+    /**
+     * @brief Time the last written byte is off the wire.
+     * @return Time in microseconds
+     */
+    uint64_t idleUs(void) const { return lineFreeUs; }
+
+    uint32_t activeVoices(void) const { return (uint32_t)voices.size(); }
+    const struct sam_channel_s &channel(uint8_t ch) const { return channels[ch & 0x0FU]; }
+    const struct host_sam_stats_s &stats(void) const { return st; }
+
+    /**
+     * @brief Print link, latency, polyphony and the parameter state of the chip.
+     * @param out Output stream
+     */
+    void report(FILE *out) const;
+
+    int fifoSize;
+    uint32_t polyphony;
+    uint32_t resetBusyUs = SAM_RESET_BUSY_US;
+    /* called for every decoded message with the time its last byte is on the wire, e.g. to measure onsets */
+    void (*onMessage)(const uint8_t *msg, uint16_t len, uint64_t endUs) = NULL;
+
+    uint16_t masterVolume;
+    std::map<uint32_t, uint8_t> gsParam; /* GS address (3 x 7 bit) to value */
+
+private:
+    void reset(void);
+    void byteOnWire(uint8_t b, uint64_t writeUs, uint64_t endUs);
+    void message(const uint8_t *msg, uint16_t len, uint64_t endUs);
+    void controlChange(struct sam_channel_s &c, uint8_t ch, uint8_t num, uint8_t value);
+    void sysex(const uint8_t *msg, uint16_t len, uint64_t endUs);
+    void noteOn(uint8_t ch, uint8_t note, uint64_t endUs);
+    void noteOff(uint8_t ch, uint8_t note);
+    void releaseSustained(uint8_t ch);
+    void allNotesOff(uint8_t ch, bool sound);
+
+    struct sam_channel_s channels[16];
+    std::vector<struct sam_voice_s> voices;
+
+    uint64_t lineFreeUs = 0;
+    uint64_t busyUntilUs = 0;
+    std::vector<uint32_t> secondBytes;
+
+    uint8_t rxMsg[SAM_SYSEX_MAX];
+    uint16_t msgLen = 0;
+    uint16_t msgNeed = 0; /* complete length, 0 for SysEx */
+    uint8_t runningStatus = 0;
+    uint64_t msgWriteUs = 0;
+
+    struct host_sam_stats_s st = {};
+};
+
+#endif /* HOST_SAM2695_H */
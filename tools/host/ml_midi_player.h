@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file ml_midi_player.h
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Player API of ML_SynthTools_Lib for the host build.
+ *        The library is only available for the targets, host_player.cpp provides a stand in
+ *        which records the calls so the sketch glue code can be exercised on a PC.
+ */
+
+#ifndef HOST_ML_MIDI_PLAYER_H
+#define HOST_ML_MIDI_PLAYER_H
+
+#include <stdint.h>
+
+
+void ml_midi_player_setup(uint8_t *data, int len);
+void ml_midi_player_loop(uint32_t elapsed_ms);
+void ml_midi_player_set_tempo(float bpm);
+bool ml_midi_player_is_active(void);
+void ml_midi_player_stop(void);
+void ml_midi_player_play(void);
+void ml_midi_player_rewind(void);
+void ml_midi_player_toggle_track_mute(uint8_t track);
+void ml_midi_player_set_mt32_sound_variation(void);
+
+/* stand in state, only available in the host build */
+extern float host_player_tempo;
+extern bool host_player_active;
+
+#endif /* HOST_ML_MIDI_PLAYER_H */
@@ -0,0 +1,440 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file midi_batch_convert.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Host tool preparing a MIDI song library for the data/ folder of the MidiFilePlayer.
+ *        Every file is validated, merged into a single track format 0 file, stripped from
+ *        meta events the player does not use and from redundant controller / program repeats.
+ *        The files are processed in parallel on a small thread pool.
+ *
+ * Build:
+ *   g++ -O2 -std=c++17 -pthread -I../common midi_batch_convert.cpp ../common/smf.cpp -o midi_batch_convert
+ *
+ * Usage:
+ *   midi_batch_convert [-j threads] [-n] <input dir> <output dir>
+ */
+
+
+#include "smf.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+
+namespace fsys = std::filesystem;
+
+
+struct job_result_s
+{
+    bool ok;
+    bool keptOriginal;
+    std::string error;
+    size_t sizeIn;
+    size_t sizeOut;
+    size_t tracksIn;
+    size_t eventsIn;
+    size_t eventsOut;
+    size_t droppedMeta;
+    size_t droppedRepeats;
+    uint32_t peakBytesPerSec;
+    uint64_t durationUs;
+};
+
+struct job_s
+{
+    fsys::path in;
+    fsys::path out;
+    job_result_s result;
+};
+
+
+/**
+ * @brief Check if a meta event is used by the player.
+ *        Only the tempo is relevant for playback, time and key signature are tiny and kept for other tools.
+ * @param meta Meta event type
+ * @return true if the event should be kept
+ */
+static bool meta_is_used(uint8_t meta)
+{
+    return meta == SMF_META_TEMPO || meta == SMF_META_TIME_SIG || meta == SMF_META_KEY_SIG || meta == SMF_META_EOT;
+}
+
+/**
+ * @brief Check if a controller keeps a state that can be repeated without effect.
+ *        Data entry, (N)RPN selection and channel mode messages are actions and never dropped.
+ * @param cc Controller number
+ * @return true if repeated values of this controller are redundant
+ */
+static bool cc_is_state(uint8_t cc)
+{
+    if (cc == 6 || cc == 38 || (cc >= 96 && cc <= 101) || cc >= 120)
+    {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Remove unused meta events and redundant controller and program change repeats.
+ * @param track Merged track, modified in place
+ * @param droppedMeta Number of removed meta events
+ * @param droppedRepeats Number of removed channel messages
+ */
+static void optimize_track(smf_track_s &track, size_t &droppedMeta, size_t &droppedRepeats)
+{
+    /* 0xFF marks an unknown value */
+    uint8_t ccState[16][128];
+    uint8_t programState[16];
+    memset(ccState, 0xFF, sizeof(ccState));
+    memset(programState, 0xFF, sizeof(programState));
+
+    std::vector<smf_event_s> out;
+    out.reserve(track.events.size());
+
+    for (smf_event_s &ev : track.events)
+    {
+        if (ev.status == SMF_META)
+        {
+            if (!meta_is_used(ev.meta))
+            {
+                droppedMeta++;
+                continue;
+            }
+        }
+        else if (ev.status == 0xF0U || ev.status == 0xF7U)
+        {
+            /* a SysEx may reset the device (GM / GS reset), forget everything we know */
+            memset(ccState, 0xFF, sizeof(ccState));
+            memset(programState, 0xFF, sizeof(programState));
+        }
+        else
+        {
+            uint8_t ch = ev.status & 0x0FU;
+            uint8_t type = ev.status & 0xF0U;
+
+            if (type == 0xB0U)
+            {
+                uint8_t cc = ev.data[0];
+                uint8_t value = ev.data[1];
+
+                if (cc == 121)
+                {
+                    /* reset all controllers */
+                    memset(ccState[ch], 0xFF, sizeof(ccState[ch]));
+                }
+                else if (cc_is_state(cc))
+                {
+                    if (ccState[ch][cc] == value)
+                    {
+                        droppedRepeats++;
+                        continue;
+                    }
+                    ccState[ch][cc] = value;
+                    if (cc == 0 || cc == 32)
+                    {
+                        /* a new bank makes the next program change relevant again */
+                        programState[ch] = 0xFF;
+                    }
+                }
+            }
+            else if (type == 0xC0U)
+            {
+                if (programState[ch] == ev.data[0])
+                {
+                    droppedRepeats++;
+                    continue;
+                }
+                programState[ch] = ev.data[0];
+            }
+        }
+
+        out.push_back(std::move(ev));
+    }
+
+    track.events.swap(out);
+}
+
+/**
+ * @brief Estimate the peak load on the serial link to the sound chip.
+ * @param division Ticks per quarter note
+ * @param track Merged track
+ * @param durationUs Song duration in microseconds
+ * @return Maximum number of bytes sent within any one second window
+ */
+static uint32_t estimate_peak_load(uint16_t division, const smf_track_s &track, uint64_t &durationUs)
+{
+    std::vector<smf_tempo_point_s> tempoMap;
+    smf_build_tempo_map(division, track, tempoMap);
+
+    std::deque<std::pair<uint64_t, size_t>> window;
+    size_t windowBytes = 0;
+    size_t peak = 0;
+
+    for (const smf_event_s &ev : track.events)
+    {
+        size_t bytes = smf_wire_bytes(ev);
+        if (bytes == 0)
+        {
+            continue;
+        }
+        uint64_t us = smf_tick_to_us(division, tempoMap, ev.tick);
+        window.push_back({us, bytes});
+        windowBytes += bytes;
+        while (window.front().first + 1000000U <= us)
+        {
+            windowBytes -= window.front().second;
+            window.pop_front();
+        }
+        peak = std::max(peak, windowBytes);
+    }
+
+    durationUs = track.events.empty() ? 0 : smf_tick_to_us(division, tempoMap, track.events.back().tick);
+    return (uint32_t)peak;
+}
+
+static bool read_file(const fsys::path &path, std::vector<uint8_t> &data)
+{
+    std::ifstream f(path, std::ios::binary);
+    if (!f)
+    {
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    return true;
+}
+
+static bool write_file(const fsys::path &path, const std::vector<uint8_t> &data)
+{
+    std::error_code ec;
+    fsys::create_directories(path.parent_path(), ec);
+    std::ofstream f(path, std::ios::binary);
+    if (!f)
+    {
+        return false;
+    }
+    f.write((const char *)data.data(), (std::streamsize)data.size());
+    return (bool)f;
+}
+
+/**
+ * @brief Convert a single file.
+ * @param job Job with input / output path, the result is stored inside
+ * @param dryRun Do not write any output if set
+ */
+static void process_job(job_s &job, bool dryRun)
+{
+    job_result_s &r = job.result;
+    r = {};
+
+    std::vector<uint8_t> raw;
+    if (!read_file(job.in, raw))
+    {
+        r.error = "cannot read file";
+        return;
+    }
+    r.sizeIn = raw.size();
+
+    smf_file_s smf;
+    if (!smf_parse(raw.data(), raw.size(), smf, r.error))
+    {
+        return;
+    }
+    if (smf.format == 2)
+    {
+        r.error = "format 2 is not supported by the player";
+        return;
+    }
+
+    r.tracksIn = smf.tracks.size();
+    for (const smf_track_s &t : smf.tracks)
+    {
+        r.eventsIn += t.events.size();
+    }
+
+    smf_track_s merged;
+    smf_merge_tracks(smf, merged);
+    optimize_track(merged, r.droppedMeta, r.droppedRepeats);
+    r.eventsOut = merged.events.size();
+    r.peakBytesPerSec = estimate_peak_load(smf.division, merged, r.durationUs);
+
+    std::vector<uint8_t> converted;
+    smf_write_format0(smf.division, merged, converted);
+
+    /* round trip check, what we write must parse as well */
+    smf_file_s check;
+    std::string checkError;
+    if (!smf_parse(converted.data(), converted.size(), check, checkError) || check.tracks[0].events.size() != merged.events.size())
+    {
+        r.error = "internal error, converted file does not parse: " + checkError;
+        return;
+    }
+
+    const std::vector<uint8_t> *result = &converted;
+    if (smf.format == 0 && smf.tracks.size() == 1 && converted.size() >= raw.size())
+    {
+        /* already a single track format 0 file and optimal, never make such a file bigger */
+        result = &raw;
+        r.keptOriginal = true;
+    }
+    r.sizeOut = result->size();
+
+    if (!dryRun && !write_file(job.out, *result))
+    {
+        r.error = "cannot write " + job.out.string();
+        return;
+    }
+
+    r.ok = true;
+}
+
+static bool has_mid_extension(const fsys::path &p)
+{
+    std::string ext = p.extension().string();
+    return strcasecmp(ext.c_str(), ".mid") == 0 || strcasecmp(ext.c_str(), ".midi") == 0;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-j threads] [-n] <input dir> <output dir>\n", name);
+    fprintf(stderr, "  -j threads  number of worker threads (default: all cores)\n");
+    fprintf(stderr, "  -n          dry run, only validate and report\n");
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned threadCount = std::max(1U, std::thread::hardware_concurrency());
+    bool dryRun = false;
+    const char *inDir = nullptr;
+    const char *outDir = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            threadCount = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "-n") == 0)
+        {
+            dryRun = true;
+        }
+        else if (inDir == nullptr)
+        {
+            inDir = argv[i];
+        }
+        else if (outDir == nullptr)
+        {
+            outDir = argv[i];
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (inDir == nullptr || (outDir == nullptr && !dryRun))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<job_s> jobs;
+    std::error_code ec;
+    for (fsys::recursive_directory_iterator it(inDir, ec), end; !ec && it != end; it.increment(ec))
+    {
+        if (it->is_regular_file() && has_mid_extension(it->path()))
+        {
+            job_s job;
+            job.in = it->path();
+            /* the device only looks for .mid files */
+            job.out = fsys::path(outDir ? outDir : ".") / fsys::relative(it->path(), inDir);
+            job.out.replace_extension(".mid");
+            jobs.push_back(job);
+        }
+    }
+    if (ec)
+    {
+        fprintf(stderr, "cannot read %s: %s\n", inDir, ec.message().c_str());
+        return 2;
+    }
+
+    std::sort(jobs.begin(), jobs.end(), [](const job_s &a, const job_s &b)
+    {
+        return a.in < b.in;
+    });
+
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < std::min<size_t>(threadCount, jobs.size()); t++)
+    {
+        pool.emplace_back([&]()
+        {
+            size_t i;
+            while ((i = next.fetch_add(1)) < jobs.size())
+            {
+                process_job(jobs[i], dryRun);
+            }
+        });
+    }
+    for (std::thread &t : pool)
+    {
+        t.join();
+    }
+
+    size_t failed = 0;
+    size_t totalIn = 0;
+    size_t totalOut = 0;
+    uint32_t worstPeak = 0;
+
+    for (const job_s &job : jobs)
+    {
+        const job_result_s &r = job.result;
+        if (!r.ok)
+        {
+            printf("FAIL %s: %s\n", job.in.c_str(), r.error.c_str());
+            failed++;
+            continue;
+        }
+
+        totalIn += r.sizeIn;
+        totalOut += r.sizeOut;
+        worstPeak = std::max(worstPeak, r.peakBytesPerSec);
+
+        printf("OK   %s: %zu -> %zu bytes (%+.1f%%)%s, tracks %zu -> 1, events %zu -> %zu, meta -%zu, repeats -%zu, %.1f s, peak %u B/s (%.0f%% of link)\n",
+               job.in.c_str(), r.sizeIn, r.sizeOut, 100.0 * ((double)r.sizeOut - (double)r.sizeIn) / (double)r.sizeIn,
+               r.keptOriginal ? " kept original" : "",
+               r.tracksIn, r.eventsIn, r.eventsOut, r.droppedMeta, r.droppedRepeats,
+               (double)r.durationUs / 1e6, r.peakBytesPerSec, 100.0 * r.peakBytesPerSec / SMF_LINK_BYTES_PER_SEC);
+    }
+
+    printf("%zu files, %zu failed, %zu -> %zu bytes, worst peak %u B/s (%.0f%% of link)\n",
+           jobs.size(), failed, totalIn, totalOut, worstPeak, 100.0 * worstPeak / SMF_LINK_BYTES_PER_SEC);
+
+    return failed ? 1 : 0;
+}
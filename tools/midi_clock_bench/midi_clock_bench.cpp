@@ -0,0 +1,357 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file midi_clock_bench.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Jitter benchmark of the MIDI clock output.
+ *        MidiOut.cpp and MidiClockOut.cpp of the sketch run on a virtual time line against a simulated UART
+ *        (31250 baud, 128 byte TX FIFO). The timer calls clock_out_process() with a random dispatch latency,
+ *        the loop writes bursts of channel data on every sixteenth note. Like the file player it holds back
+ *        while midi_out_hold() asks for it, the hold time counts as channel data delay.
+ *        With -x the player also sends a SysEx of the given size on every bar, like the setup dumps embedded in some files.
+ *        The time each clock byte starts on the wire is compared against the ideal clock grid,
+ *        once with channel data going through the output queue and once written straight to the UART.
+ *        The host clock runs virtually, so the pauses MidiOut gives the synth after a SysEx follow the simulation.
+ *
+ * Build:
+ *   g++ -O2 -std=c++17 -I../host -I../../MidiFilePlayer midi_clock_bench.cpp ../../MidiFilePlayer/LatencyProbe.cpp ../../MidiFilePlayer/MidiOut.cpp ../../MidiFilePlayer/MidiTelemetry.cpp ../../MidiFilePlayer/MidiClockOut.cpp ../../MidiFilePlayer/TempoFixed.cpp ../host/host_arduino.cpp -o midi_clock_bench
+ *
+ * Usage:
+ *   midi_clock_bench [-t bpm] [-d load %] [-l timer latency us] [-s seconds] [-j max p99 us] [-x sysex bytes per bar]
+ */
+
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "MidiClockOut.h"
+#include "MidiOut.h"
+
+
+#define UART_BYTE_US    320U /* 10 bits at 31250 baud */
+#define UART_FIFO_SIZE  128
+#define LOOP_MIN_US     200U
+#define LOOP_MAX_US     1000U
+
+
+static uint64_t simBaseUs = 0;
+
+
+/**
+ * @brief Time since the start of the run on the virtual host clock.
+ * @return Time in microseconds
+ */
+static uint32_t sim_now(void)
+{
+    return (uint32_t)(host_clock_us() - simBaseUs);
+}
+
+/**
+ * @brief Advance the virtual host clock, a blocking write may already have passed the time.
+ * @param us Time since the start of the run
+ */
+static void sim_advance_to(uint32_t us)
+{
+    uint32_t nowUs = sim_now();
+    if ((int32_t)(us - nowUs) > 0)
+    {
+        host_clock_advance_us(us - nowUs);
+    }
+}
+
+
+/**
+ * @brief UART transmitter on the virtual time line.
+ *        Bytes leave the FIFO back to back, the start time of every clock byte is recorded.
+ *        SysEx bytes are not counted as channel data.
+ *        Nothing is received, the output merger takes a Stream like the serial of the synth.
+ */
+class SimUart : public Stream
+{
+public:
+    size_t write(uint8_t b) override
+    {
+        return write(&b, 1);
+    }
+
+    size_t write(const uint8_t *buf, size_t len) override
+    {
+        uint32_t nowUs = sim_now();
+        for (size_t i = 0; i < len; i++)
+        {
+            uint32_t startUs = (lineFreeUs > nowUs) ? lineFreeUs : nowUs;
+            lineFreeUs = startUs + UART_BYTE_US;
+            if (buf[i] == MIDI_RT_CLOCK)
+            {
+                clockStartUs.push_back(startUs);
+            }
+            else if (buf[i] == 0xF0U || inSysex)
+            {
+                inSysex = buf[i] != 0xF7U;
+                sysexBytes++;
+            }
+            else
+            {
+                /* all channel messages have 3 bytes, delay counts from the write by the loop */
+                uint32_t delayUs = startUs - msgWriteUs[channelBytes / 3U];
+                channelBytes++;
+                channelDelaySumUs += delayUs;
+                channelDelayMaxUs = std::max(channelDelayMaxUs, delayUs);
+            }
+        }
+        return len;
+    }
+
+    int availableForWrite(void) override
+    {
+        uint32_t nowUs = sim_now();
+        uint32_t pending = (lineFreeUs > nowUs) ? (lineFreeUs - nowUs + UART_BYTE_US - 1U) / UART_BYTE_US : 0U;
+        return (pending < UART_FIFO_SIZE) ? (int)(UART_FIFO_SIZE - pending) : 0;
+    }
+
+    int available(void) override { return 0; }
+    int read(void) override { return -1; }
+    int peek(void) override { return -1; }
+
+    uint32_t lineFreeUs = 0;
+    std::vector<uint32_t> msgWriteUs;
+    std::vector<uint32_t> clockStartUs;
+    uint64_t channelBytes = 0;
+    uint64_t channelDelaySumUs = 0;
+    uint32_t channelDelayMaxUs = 0;
+    uint64_t sysexBytes = 0;
+    bool inSysex = false;
+};
+
+struct result_s
+{
+    double meanUs;
+    double rmsUs;
+    uint32_t p99Us;
+    uint32_t maxUs;
+    uint32_t clocks;
+    double channelDelayMs;
+    double channelDelayMaxMs;
+    double channelRate;
+    uint64_t sysexBytes;
+};
+
+
+/**
+ * @brief Run the simulation.
+ * @param useQueue true to write channel data through midi_out_write()
+ * @param bpm Clock tempo
+ * @param load Offered channel data in percent of the line rate
+ * @param latencyUs Maximum timer dispatch latency
+ * @param seconds Simulated time
+ * @param sysexLen Length of the SysEx sent on every bar, 0 for none
+ * @return Result of the run
+ */
+static struct result_s bench_run(bool useQueue, float bpm, float load, uint32_t latencyUs, uint32_t seconds, uint16_t sysexLen)
+{
+    SimUart uart;
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<uint32_t> latency(0, latencyUs);
+    std::uniform_int_distribution<uint32_t> loopTime(LOOP_MIN_US, LOOP_MAX_US);
+
+    simBaseUs = host_clock_us();
+    midi_out_init(&uart, UART_FIFO_SIZE);
+    clock_out_init(NULL);
+    const tempo_q16_t tempo = (tempo_q16_t)(bpm * 65536.0f + 0.5f);
+    clock_out_set_tempo(tempo);
+    clock_out_set_enabled(true, false);
+
+    const uint32_t endUs = seconds * 1000000U;
+    const uint32_t sixteenthUs = (uint32_t)(15000000.0f / bpm);
+    const uint32_t burstMessages = (uint32_t)(load / 100.0f * 3125.0f * sixteenthUs / 1000000.0f / 3.0f);
+
+    /* universal non-commercial SysEx, not taken for a reset */
+    std::vector<uint8_t> sysex(sysexLen);
+    for (uint16_t i = 0; i < sysexLen; i++)
+    {
+        sysex[i] = (uint8_t)(i & 0x7FU);
+    }
+    if (sysexLen >= 2U)
+    {
+        sysex[0] = 0xF0U;
+        sysex[1] = 0x7DU;
+        sysex[sysexLen - 1U] = 0xF7U;
+    }
+
+    /* the first call arms the grid at 0, so the ideal clock k is due at k * period */
+    uint32_t timerDueUs = clock_out_process(0);
+    uint32_t timerRunUs = timerDueUs + latency(rng);
+    uint32_t loopRunUs = loopTime(rng);
+    uint32_t nextBurstUs = 0;
+    uint32_t burst = 0;
+    uint32_t note = 0;
+    std::deque<std::vector<uint8_t>> held;
+    uint64_t offered = 0;
+
+    while (sim_now() < endUs)
+    {
+        if ((int32_t)(timerRunUs - loopRunUs) <= 0)
+        {
+            sim_advance_to(timerRunUs);
+            uint32_t nowUs = sim_now();
+            timerDueUs = nowUs + clock_out_process(nowUs);
+            timerRunUs = timerDueUs + latency(rng);
+        }
+        else
+        {
+            sim_advance_to(loopRunUs);
+            if ((int32_t)(sim_now() - nextBurstUs) >= 0)
+            {
+                nextBurstUs += sixteenthUs;
+                if (sysexLen >= 2U && (burst++ % 16U) == 0)
+                {
+                    if (useQueue)
+                    {
+                        held.push_back(sysex);
+                    }
+                    else
+                    {
+                        uart.write(sysex.data(), sysexLen);
+                    }
+                }
+                for (uint32_t i = 0; i < burstMessages; i++, note++)
+                {
+                    uart.msgWriteUs.push_back(sim_now());
+                    uint8_t msg[] = {(uint8_t)(((note & 1U) ? 0x80U : 0x90U) | ((note >> 1U) & 0x0FU)), (uint8_t)(36U + (note >> 1U) % 48U), 100};
+                    if (useQueue)
+                    {
+                        held.push_back(std::vector<uint8_t>(msg, msg + sizeof(msg)));
+                    }
+                    else
+                    {
+                        uart.write(msg, sizeof(msg));
+                    }
+                    offered += sizeof(msg);
+                }
+            }
+            while (!held.empty() && !midi_out_hold(MIDI_OUT_SRC_PLAYER))
+            {
+                midi_out_write(MIDI_OUT_SRC_PLAYER, held.front().data(), (uint16_t)held.front().size());
+                held.pop_front();
+            }
+            midi_out_loop();
+            loopRunUs = sim_now() + loopTime(rng);
+        }
+    }
+
+    /* the ideal grid uses the same 1/256 us steps as the generator */
+    const uint64_t periodQ8 = tempo_tick_q8(tempo_clamp(tempo), CLOCK_SYNC_PPQN);
+    std::vector<uint32_t> dev;
+    double sum = 0.0;
+    double sumSq = 0.0;
+    for (size_t k = 0; k < uart.clockStartUs.size(); k++)
+    {
+        uint32_t idealUs = (uint32_t)((k * periodQ8) >> 8U);
+        uint32_t d = uart.clockStartUs[k] - idealUs;
+        dev.push_back(d);
+        sum += d;
+        sumSq += (double)d * d;
+    }
+    std::sort(dev.begin(), dev.end());
+
+    struct result_s r = {};
+    r.clocks = (uint32_t)dev.size();
+    if (!dev.empty())
+    {
+        r.meanUs = sum / dev.size();
+        r.rmsUs = sqrt(sumSq / dev.size());
+        r.p99Us = dev[(dev.size() * 99) / 100];
+        r.maxUs = dev.back();
+    }
+    r.channelDelayMs = uart.channelBytes ? uart.channelDelaySumUs / 1000.0 / uart.channelBytes : 0.0;
+    r.channelDelayMaxMs = uart.channelDelayMaxUs / 1000.0;
+    r.channelRate = offered ? 100.0 * uart.channelBytes / offered : 0.0;
+    r.sysexBytes = uart.sysexBytes;
+    return r;
+}
+
+static void print_result(const char *name, const struct result_s &r)
+{
+    printf("%-9s %8u %8.0f %8.0f %8u %8u %10.2f %10.2f %8.1f%% %10llu\n", name, r.clocks, r.meanUs, r.rmsUs, r.p99Us, r.maxUs,
+           r.channelDelayMs, r.channelDelayMaxMs, r.channelRate, (unsigned long long)r.sysexBytes);
+}
+
+int main(int argc, char *argv[])
+{
+    float bpm = 120.0f;
+    float load = 60.0f;
+    uint32_t latencyUs = 50;
+    uint32_t seconds = 60;
+    uint32_t maxP99Us = 2500;
+    uint16_t sysexLen = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            bpm = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+        {
+            load = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+        {
+            latencyUs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            seconds = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            maxP99Us = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-x") == 0 && i + 1 < argc)
+        {
+            sysexLen = atoi(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-t bpm] [-d load %%] [-l timer latency us] [-s seconds] [-j max p99 us] [-x sysex bytes per bar]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    host_clock_set_virtual(true);
+
+    printf("%.0f bpm, channel data %.0f %% of line rate in bursts per sixteenth, timer latency 0..%u us, loop every %u..%u us, %u s, sysex %u bytes per bar\n",
+           bpm, load, latencyUs, LOOP_MIN_US, LOOP_MAX_US, seconds, sysexLen);
+    printf("clock byte on the wire against the ideal grid [us], channel data delay [ms]\n");
+    printf("%-9s %8s %8s %8s %8s %8s %10s %10s %9s %10s\n", "mode", "clocks", "mean", "rms", "p99", "max", "ch delay", "ch max", "ch sent", "sysex");
+
+    struct result_s fifo = bench_run(false, bpm, load, latencyUs, seconds, sysexLen);
+    print_result("fifo", fifo);
+    struct result_s prio = bench_run(true, bpm, load, latencyUs, seconds, sysexLen);
+    print_result("priority", prio);
+
+    bool fail = prio.p99Us > maxP99Us;
+    printf("%s (priority p99 below %u us)\n", fail ? "FAIL" : "PASS", maxP99Us);
+    return fail ? 1 : 0;
+}
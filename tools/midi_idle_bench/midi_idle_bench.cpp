@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file midi_idle_bench.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Utilization, wake-ups and input latency of the loop with and without the tickless idle (IdleLoop.h).
+ *        IdleLoop.cpp, StepSequencer.cpp, NoteScheduler.cpp and MidiOut.cpp of the sketch run unchanged on the virtual clock,
+ *        the synth is the SAM2695 model (host_sam2695.h). Every pass of the modelled loop costs a fixed time,
+ *        it handles received notes, runs the sequencer, the note offs, the LED and the merger and reports the deadlines
+ *        like app_idle() of the sketches. Received notes arrive at random times, their interrupt ends a wait
+ *        through host_wait_for_interrupt(). In the no_irq scenario that interrupt is lost, only the bound of a wait ends it.
+ *        Each scenario runs once with the loop spinning (idle off) and once sleeping (idle on),
+ *        both have to send the same number of messages and received notes have to be handled within IDLE_WAKE_BOUND_US plus one pass.
+ *
+ * Build:
+ *   g++ -O2 -std=c++17 -I../host -I../../MidiFilePlayer midi_idle_bench.cpp ../../MidiFilePlayer/IdleLoop.cpp ../../MidiFilePlayer/LatencyProbe.cpp ../../MidiFilePlayer/MidiOut.cpp ../../MidiFilePlayer/MidiTelemetry.cpp ../../MidiFilePlayer/NoteScheduler.cpp ../../MidiFilePlayer/StepSequencer.cpp ../../MidiFilePlayer/TempoFixed.cpp ../host/host_arduino.cpp ../host/host_sam2695.cpp -o midi_idle_bench
+ *
+ * Usage:
+ *   midi_idle_bench [-s seconds] [-c pass us] [-r received notes per second]
+ */
+
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "IdleLoop.h"
+#include "MidiOut.h"
+#include "NoteScheduler.h"
+#include "StepSequencer.h"
+#include "host_sam2695.h"
+
+
+#define BENCH_LED_US        500000U /* LED toggle of the BPM mode */
+#define BENCH_NOTE_MS       100U    /* length of a received note, released by the note scheduler */
+#define BENCH_BPM           120U
+
+
+enum bench_scenario_e
+{
+    SCENARIO_IDLE,      /* nothing playing, nothing received */
+    SCENARIO_SEQUENCER, /* one track of sixteenth notes */
+    SCENARIO_LIVE,      /* sequencer and received notes */
+    SCENARIO_NO_IRQ,    /* like live, the interrupt of the reception is lost */
+    SCENARIO_COUNT,
+};
+
+static const char *scenarioNames[SCENARIO_COUNT] = {"idle", "sequencer", "live", "live_no_irq"};
+
+struct bench_result_s
+{
+    struct idle_stats_s idle;
+    uint64_t messages;
+    uint32_t received;
+    uint32_t inputMeanUs;
+    uint32_t inputMaxUs;
+};
+
+
+static const struct seq_step_s benchSteps[] =
+{
+    {{60, 64, 67, SEQ_NOTE_NONE}, 100, 3},
+    {{SEQ_NOTE_NONE}, 0, 0},
+    {{62, 65, 69, SEQ_NOTE_NONE}, 90, 3},
+    {{SEQ_NOTE_NONE}, 0, 0},
+};
+
+static const struct seq_pattern_s benchPool[] =
+{
+    {0, sizeof(benchSteps) / sizeof(benchSteps[0]), SEQ_PPQN / 4U, SEQ_CHAIN_LOOP, benchSteps},
+};
+
+static std::vector<uint64_t> benchInputUs;
+static size_t benchInputNext = 0;
+static bool benchInputIrq = true;
+
+
+static void bench_note_on(uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    uint8_t msg[3] = {(uint8_t)(0x90U | channel), note, velocity};
+    midi_out_write(MIDI_OUT_SRC_LIVE, msg, sizeof(msg));
+}
+
+static void bench_note_off(uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    uint8_t msg[3] = {(uint8_t)(0x80U | channel), note, velocity};
+    midi_out_write(MIDI_OUT_SRC_LIVE, msg, sizeof(msg));
+}
+
+/* the UART interrupt of the next received note */
+static uint64_t bench_next_interrupt(void)
+{
+    if (!benchInputIrq || benchInputNext >= benchInputUs.size())
+    {
+        return UINT64_MAX;
+    }
+    return benchInputUs[benchInputNext];
+}
+
+/* app_idle_pending() of the sketches */
+static bool bench_pending(void)
+{
+    return benchInputNext < benchInputUs.size() && benchInputUs[benchInputNext] <= host_clock_us();
+}
+
+static struct bench_result_s bench_run(enum bench_scenario_e scenario, bool idle, uint32_t seconds, uint32_t passUs, double rate)
+{
+    struct bench_result_s result = {};
+    /* the clock keeps running between the runs, the sequencer never sees time going back */
+    uint64_t startUs = host_clock_us();
+    uint64_t endUs = startUs + (uint64_t)seconds * 1000000U;
+
+    /* same arrivals for both runs of a scenario */
+    benchInputUs.clear();
+    benchInputNext = 0;
+    benchInputIrq = (scenario != SCENARIO_NO_IRQ);
+    if (scenario == SCENARIO_LIVE || scenario == SCENARIO_NO_IRQ)
+    {
+        std::mt19937 rng(1234);
+        std::exponential_distribution<double> gap(rate / 1e6);
+        for (double t = startUs + gap(rng); t < endUs; t += gap(rng))
+        {
+            benchInputUs.push_back((uint64_t)t);
+        }
+    }
+
+    host_set_interrupt_source(bench_next_interrupt);
+    HostSam2695 sam;
+    midi_out_init(&sam, SAM_FIFO_SIZE);
+    note_sched_init(bench_note_on, bench_note_off);
+    seq_init(benchPool, 1, bench_note_on, bench_note_off);
+    seq_set_tempo(tempo_from_bpm(BENCH_BPM));
+    /* the clock starts with the first pass at tick 0, both runs play the same steps */
+    seq_clock_resume();
+    seq_set_position(0);
+    seq_track_setup(0, 0);
+    if (scenario != SCENARIO_IDLE)
+    {
+        seq_track_start(0);
+    }
+    idle_init(bench_pending);
+    idle_set_enabled(idle);
+
+    uint64_t ledDueUs = startUs + BENCH_LED_US;
+    uint64_t inputSumUs = 0;
+    while (host_clock_us() < endUs)
+    {
+        uint64_t passStartUs = host_clock_us();
+        uint32_t nowUs = (uint32_t)passStartUs;
+
+        /* midi_com_loop() */
+        while (bench_pending())
+        {
+            uint64_t latencyUs = passStartUs - benchInputUs[benchInputNext];
+            inputSumUs += latencyUs;
+            result.inputMaxUs = std::max(result.inputMaxUs, (uint32_t)latencyUs);
+            result.received++;
+            note_sched_play(1, (uint8_t)(48U + benchInputNext % 24U), 100, BENCH_NOTE_MS, nowUs);
+            benchInputNext++;
+        }
+
+        /* multiTrackPlay(), ledShow(), midi_clock_out_loop() */
+        seq_loop(nowUs);
+        note_sched_loop(nowUs);
+        if (passStartUs >= ledDueUs)
+        {
+            ledDueUs += BENCH_LED_US;
+        }
+        midi_out_loop();
+
+        host_clock_advance_us(passUs);
+
+        /* app_idle() */
+        nowUs = micros();
+        uint32_t dueUs;
+        if (seq_next_us(&dueUs))
+        {
+            idle_due_at(dueUs);
+        }
+        if (note_sched_next_us(&dueUs))
+        {
+            idle_due_at(dueUs);
+        }
+        idle_due_at((uint32_t)ledDueUs);
+        if (midi_out_pending() > 0)
+        {
+            idle_due_at(nowUs + MIDI_OUT_BYTE_US);
+        }
+        idle_wait();
+    }
+
+    /* statistics of the last complete window, the end is not measured */
+    idle_get_stats(&result.idle);
+    host_set_interrupt_source(NULL);
+
+    /* sounding notes are released and everything queued goes out */
+    seq_track_stop(0);
+    note_sched_release(1, 0, micros());
+    note_sched_loop(micros());
+    while (midi_out_pending() > 0 || sam.idleUs() > host_clock_us())
+    {
+        host_clock_advance_us(MIDI_OUT_BYTE_US);
+        midi_out_loop();
+    }
+    result.messages = sam.stats().messages;
+    result.inputMeanUs = result.received ? (uint32_t)(inputSumUs / result.received) : 0;
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t seconds = 10;
+    uint32_t passUs = 50;
+    double rate = 20.0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            seconds = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            passUs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            rate = atof(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-s seconds] [-c pass us] [-r received notes per second]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (seconds < 2 || passUs == 0 || rate <= 0.0)
+    {
+        fprintf(stderr, "at least 2 seconds, a pass and received notes are required\n");
+        return 2;
+    }
+
+    host_clock_set_virtual(true);
+    uint32_t boundUs = IDLE_WAKE_BOUND_US + passUs;
+    printf("%u s per run, %u us per pass, %.0f received notes/s, input bound %u us\n", seconds, passUs, rate, boundUs);
+    printf("%-12s %-5s %7s %9s %11s %9s %10s %10s %9s\n", "scenario", "idle", "load %", "loops/s", "wake-ups/s", "late us",
+           "in mean us", "in max us", "messages");
+
+    bool fail = false;
+    for (int s = 0; s < SCENARIO_COUNT; s++)
+    {
+        struct bench_result_s runs[2];
+        for (int idle = 0; idle < 2; idle++)
+        {
+            struct bench_result_s &r = runs[idle];
+            r = bench_run((enum bench_scenario_e)s, idle != 0, seconds, passUs, rate);
+            printf("%-12s %-5s %5u.%u %9u %11u %9u %10u %10u %9llu\n", scenarioNames[s], idle ? "on" : "off",
+                   r.idle.loadPermille / 10U, r.idle.loadPermille % 10U, r.idle.loopsPerSec, r.idle.wakeupsPerSec,
+                   r.idle.lateMaxUs, r.inputMeanUs, r.inputMaxUs, (unsigned long long)r.messages);
+        }
+        if (runs[0].messages != runs[1].messages || runs[0].received != runs[1].received)
+        {
+            printf("FAIL (%s: different output)\n", scenarioNames[s]);
+            fail = true;
+        }
+        if (runs[1].inputMaxUs > boundUs)
+        {
+            printf("FAIL (%s: received note handled after %u us)\n", scenarioNames[s], runs[1].inputMaxUs);
+            fail = true;
+        }
+    }
+
+    printf("%s (same output, received notes handled within %u us)\n", fail ? "FAIL" : "PASS", boundUs);
+    return fail ? 1 : 0;
+}
@@ -0,0 +1,341 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file midi_input_bench.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Throughput benchmark of the MIDI input path of the sketches.
+ *        MidiInterface.ino of the sketch is compiled unchanged, synthetic byte streams are fed into
+ *        comPort / Midi_CheckMidiPort() and dispatched through the real midiMapping and edirolMapping tables.
+ *        The synth UART is a sink, so only parsing and dispatch are measured.
+ *
+ * Build (ML_SynthTools provides midi_interface.h and ml_utils.h):
+ *   g++ -O2 -std=c++17 -I../host -I<path to ML_SynthTools>/src midi_input_bench.cpp ../../MidiFilePlayer/IdleLoop.cpp ../../MidiFilePlayer/InputCapture.cpp ../../MidiFilePlayer/LatencyProbe.cpp ../../MidiFilePlayer/Log.cpp ../../MidiFilePlayer/MidiClockSync.cpp ../../MidiFilePlayer/MidiClockOut.cpp ../../MidiFilePlayer/MidiOut.cpp ../../MidiFilePlayer/MidiTelemetry.cpp ../../MidiFilePlayer/PlayerLookahead.cpp ../../MidiFilePlayer/SongPool.cpp ../../MidiFilePlayer/StaticAlloc.cpp ../../MidiFilePlayer/TempoFixed.cpp ../../MidiLivePlayback/LiveTransform.cpp ../../MidiLivePlayback/MidiRecorder.cpp ../host/host_arduino.cpp ../host/host_fs.cpp ../host/host_player.cpp -o midi_input_bench
+ *   add -DBENCH_LIVE_PLAYBACK to benchmark the MidiLivePlayback sketch instead of the MidiFilePlayer
+ *
+ * Usage:
+ *   midi_input_bench [-o results.txt] [-b baseline.txt] [-t max regression %]
+ */
+
+
+#include <Arduino.h>
+
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+
+static HostSerial comSerial;
+static HostSerial showSerial;
+
+#define COM_SERIAL  comSerial
+#define SHOW_SERIAL showSerial
+
+
+#ifdef BENCH_LIVE_PLAYBACK
+/* the recorder stays idle, rec_event() returns right away */
+void App_Record(uint8_t param, uint8_t value) { (void)param; (void)value; }
+#include "../../MidiLivePlayback/MidiInterface.ino"
+#else
+/* functions of the other sketch files used by MidiInterface.ino */
+void app_play_next_song(void) {}
+void app_play_prev_song(void) {}
+bool midi_render_active(void) { return false; }
+void midi_render_data(const uint8_t *msg, int len) { (void)msg; (void)len; }
+void sendNRPN3707Volume(uint8_t channel, uint8_t value);
+void send_gm_reset_msg(void);
+#include "../../MidiFilePlayer/TempoFixed.h"
+/* App_SetTempo keeps the application tempo in sync */
+static tempo_q16_t benchTempo = TEMPO_DEFAULT;
+void app_set_tempo(tempo_q16_t tempo) { benchTempo = tempo; }
+tempo_q16_t app_get_tempo(void) { return benchTempo; }
+#include "../../MidiFilePlayer/MidiInterface.ino"
+#endif
+
+
+#define LINE_RATE_BYTES_PER_SEC 3125.0 /* 31250 baud, 10 bits per byte */
+#define TARGET_LINE_RATE_FACTOR 10.0
+#define STREAM_SIZE             (256 * 1024)
+#define MIN_BENCH_TIME_SEC      0.5
+
+
+struct mix_s
+{
+    const char *name;
+    void (*generate)(std::vector<uint8_t> &s);
+};
+
+/* controllers with a function in edirolMapping, channel / CC number */
+static const uint8_t mappedControls[][2] =
+{
+    {0x0, 0x10}, {0x1, 0x10}, {0x2, 0x10}, {0x3, 0x10}, {0x4, 0x10}, {0x5, 0x10}, {0x6, 0x10}, {0x7, 0x10}, {0x8, 0x10},
+    {0x0, 0x11}, {0x1, 0x11}, {0x2, 0x11}, {0x3, 0x11}, {0x4, 0x11}, {0x5, 0x11}, {0x6, 0x11}, {0x7, 0x11},
+    {0x1, 0x12},
+};
+
+
+static void gen_notes(std::vector<uint8_t> &s)
+{
+    for (uint32_t i = 0; s.size() < STREAM_SIZE; i++)
+    {
+        uint8_t ch = i & 0x0FU;
+        uint8_t note = 36 + (i % 48);
+        s.insert(s.end(), {(uint8_t)(0x90U | ch), note, (uint8_t)(1 + (i % 127))});
+        s.insert(s.end(), {(uint8_t)(0x80U | ch), note, 0});
+    }
+}
+
+static void gen_running_status(std::vector<uint8_t> &s)
+{
+    for (uint32_t i = 0; s.size() < STREAM_SIZE; i++)
+    {
+        if ((i % 64) == 0)
+        {
+            s.push_back(0x90U | ((i / 64) & 0x0FU));
+        }
+        uint8_t note = 36 + (i % 48);
+        s.insert(s.end(), {note, (uint8_t)(1 + (i % 127)), note, 0});
+    }
+}
+
+static void gen_cc_sweep(std::vector<uint8_t> &s)
+{
+    const size_t count = sizeof(mappedControls) / sizeof(mappedControls[0]);
+    for (uint32_t i = 0; s.size() < STREAM_SIZE; i++)
+    {
+        const uint8_t *c = mappedControls[(i / 128) % count];
+        s.insert(s.end(), {(uint8_t)(0xB0U | c[0]), c[1], (uint8_t)(i & 0x7FU)});
+    }
+}
+
+static void gen_sysex(std::vector<uint8_t> &s)
+{
+    for (uint32_t i = 0; s.size() < STREAM_SIZE; i++)
+    {
+        if (i & 1U)
+        {
+            s.insert(s.end(), {0xF0, 0x7E, 0x7F, 0x09, 0x01, 0xF7});
+        }
+        else
+        {
+            s.insert(s.end(), {0xF0, 0x41, 0x10, 0x42, 0x12, 0x40, 0x00, 0x7F});
+            for (int n = 0; n < 120; n++)
+            {
+                s.push_back(n & 0x7FU);
+            }
+            s.insert(s.end(), {0x41, 0xF7});
+        }
+    }
+}
+
+static void gen_realtime(std::vector<uint8_t> &s)
+{
+    std::vector<uint8_t> notes;
+    gen_notes(notes);
+    for (size_t i = 0; s.size() < STREAM_SIZE; i++)
+    {
+        s.push_back(notes[i % notes.size()]);
+        if ((i % 2) == 1)
+        {
+            /* clock inside and between messages, active sensing now and then */
+            s.push_back((i % 32) == 1 ? 0xFE : 0xF8);
+        }
+    }
+}
+
+static void gen_mixed(std::vector<uint8_t> &s)
+{
+    const size_t count = sizeof(mappedControls) / sizeof(mappedControls[0]);
+
+    for (uint32_t i = 0; s.size() < STREAM_SIZE; i++)
+    {
+        uint8_t ch = i & 0x0FU;
+        uint8_t note = 36 + (i % 48);
+        const uint8_t *c = mappedControls[i % count];
+
+        switch (i % 5)
+        {
+        case 0:
+            s.insert(s.end(), {(uint8_t)(0x90U | ch), note, 100, (uint8_t)(0x80U | ch), note, 0});
+            break;
+        case 1:
+            s.push_back(0x90U | ch);
+            for (int n = 0; n < 8; n++)
+            {
+                s.insert(s.end(), {(uint8_t)(note + n), 100, (uint8_t)(note + n), 0});
+            }
+            break;
+        case 2:
+            s.insert(s.end(), {(uint8_t)(0xB0U | c[0]), c[1], (uint8_t)(i & 0x7FU)});
+            break;
+        case 3:
+            if ((i % 80) == 3)
+            {
+                s.insert(s.end(), {0xF0, 0x41, 0x10, 0x42, 0x12, 0x40, 0x00, 0x7F, 0x00, 0x41, 0xF7});
+            }
+            else
+            {
+                s.insert(s.end(), {(uint8_t)(0xE0U | ch), 0x00, (uint8_t)(i & 0x7FU)});
+            }
+            break;
+        default:
+            s.insert(s.end(), {(uint8_t)(0x90U | ch), 0xF8, note, 0xF8, 100, 0xF8});
+            break;
+        }
+    }
+}
+
+static const mix_s mixes[] =
+{
+    {"notes", gen_notes},
+    {"running_status", gen_running_status},
+    {"cc_sweep_mapped", gen_cc_sweep},
+    {"sysex", gen_sysex},
+    {"realtime_interleaved", gen_realtime},
+    {"mixed", gen_mixed},
+};
+
+
+/**
+ * @brief Feed a stream through the input path until the minimum bench time is reached.
+ * @param stream Byte stream
+ * @return Parsed bytes per second
+ */
+static double run_mix(const std::vector<uint8_t> &stream)
+{
+    uint64_t bytes = 0;
+    double elapsed = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    while (elapsed < MIN_BENCH_TIME_SEC)
+    {
+        comSerial.inject(stream.data(), stream.size());
+        while (comSerial.available() > 0)
+        {
+            midi_com_loop();
+        }
+        bytes += stream.size();
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    return (double)bytes / elapsed;
+}
+
+static std::map<std::string, double> load_results(const char *path)
+{
+    std::map<std::string, double> results;
+    std::ifstream f(path);
+    std::string line;
+    while (std::getline(f, line))
+    {
+        std::istringstream ls(line);
+        std::string name;
+        double value;
+        if (ls >> name >> value)
+        {
+            results[name] = value;
+        }
+    }
+    return results;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *outPath = nullptr;
+    const char *baselinePath = nullptr;
+    double maxRegression = 20.0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            outPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+        {
+            baselinePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            maxRegression = atof(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-o results.txt] [-b baseline.txt] [-t max regression %%]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    /* the sink takes every byte at once, the pauses MidiOut gives the synth after a SysEx must not sleep */
+    host_clock_set_virtual(true);
+    midi_com_setup();
+
+    std::map<std::string, double> baseline;
+    if (baselinePath != nullptr)
+    {
+        baseline = load_results(baselinePath);
+    }
+
+    std::ofstream out;
+    if (outPath != nullptr)
+    {
+        out.open(outPath);
+    }
+
+    bool fail = false;
+
+    printf("%-22s %14s %12s %10s\n", "mix", "bytes/s", "line rate", "baseline");
+    for (const mix_s &mix : mixes)
+    {
+        std::vector<uint8_t> stream;
+        mix.generate(stream);
+
+        double rate = run_mix(stream);
+        double factor = rate / LINE_RATE_BYTES_PER_SEC;
+
+        char cmp[32] = "";
+        auto it = baseline.find(mix.name);
+        if (it != baseline.end())
+        {
+            double change = 100.0 * (rate - it->second) / it->second;
+            snprintf(cmp, sizeof(cmp), "%+.1f%%", change);
+            if (change < -maxRegression)
+            {
+                fail = true;
+            }
+        }
+
+        if (factor < TARGET_LINE_RATE_FACTOR)
+        {
+            fail = true;
+        }
+
+        printf("%-22s %14.0f %11.0fx %10s\n", mix.name, rate, factor, cmp);
+        if (out)
+        {
+            out << mix.name << " " << (uint64_t)rate << "\n";
+        }
+    }
+
+    printf("%s (target %.0fx line rate%s)\n", fail ? "FAIL" : "PASS", TARGET_LINE_RATE_FACTOR,
+           baselinePath ? ", max regression against baseline" : "");
+
+    return fail ? 1 : 0;
+}
@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file midi_latency_bench.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Through latency benchmark of the MidiLivePlayback sketch.
+ *        MidiInterface.ino of the sketch is compiled unchanged against a simulated UART on a virtual time line (31250 baud, 128 byte TX FIFO).
+ *        Received bytes arrive back to back within a message, the receive callback is called for each of them like on the ESP32-C3.
+ *        The loop runs every 200 to 1000 us and a sequencer writes a burst of notes on another channel every sixteenth note
+ *        as the player source of the output merger, the forwarded notes are the live source.
+ *        The latency probe of the sketch measures the through latency, the simulated UART measures the exact time
+ *        from the last received byte of a note to the last sent byte of the forwarded note for comparison.
+ *        With -o the received input is written by the input capture of the sketch (InputCapture.h) for tools/midi_replay.
+ *
+ * Build (ML_SynthTools provides midi_interface.h and ml_utils.h):
+ *   g++ -O2 -std=c++17 -I../host -I<path to ML_SynthTools>/src midi_latency_bench.cpp ../../MidiLivePlayback/IdleLoop.cpp ../../MidiLivePlayback/InputCapture.cpp ../../MidiLivePlayback/LatencyProbe.cpp ../../MidiLivePlayback/MidiClockSync.cpp ../../MidiLivePlayback/MidiOut.cpp ../../MidiLivePlayback/MidiTelemetry.cpp ../../MidiLivePlayback/LiveTransform.cpp ../../MidiLivePlayback/MidiRecorder.cpp ../../MidiLivePlayback/TempoFixed.cpp ../host/host_arduino.cpp ../host/host_fs.cpp -o midi_latency_bench
+ *
+ * Usage:
+ *   midi_latency_bench [-r input % of line rate] [-d sequencer load %] [-s seconds] [-j max note on p99 us] [-f] [-o capture.cap]
+ */
+
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <vector>
+
+
+#define UART_BYTE_US    320U /* 10 bits at 31250 baud */
+#define UART_FIFO_SIZE  128
+#define LOOP_MIN_US     200U
+#define LOOP_MAX_US     1000U
+#define SEQ_CHANNEL     15U /* channel of the sequencer notes, not matched with received notes */
+#define SEQ_BPM         120U
+
+
+/**
+ * @brief Serial port of the synth on the virtual time line.
+ *        The received bytes are injected by the simulation, sent bytes leave the TX FIFO back to back.
+ *        Forwarded notes are matched in order with the received notes to get their exact latency.
+ */
+class SimSerial : public Stream
+{
+public:
+    void setRxFIFOFull(uint8_t bytes)
+    {
+        (void)bytes;
+    }
+
+    void onReceive(void (*cb)(void))
+    {
+        rxCb = cb;
+    }
+
+    /**
+     * @brief A byte has been received completely.
+     * @param b Byte
+     * @param lastOfNote true if the byte completes a note message, its time is kept to match the forwarded note
+     */
+    void receive(uint8_t b, bool lastOfNote)
+    {
+        rx.push_back(b);
+        if (lastOfNote)
+        {
+            noteInUs.push_back((uint32_t)host_clock_us());
+        }
+        if (rxCb != NULL)
+        {
+            rxCb();
+        }
+    }
+
+    int available(void) override
+    {
+        return (int)(rx.size() - rxPos);
+    }
+
+    int read(void) override
+    {
+        return (rxPos < rx.size()) ? rx[rxPos++] : -1;
+    }
+
+    int peek(void) override
+    {
+        return (rxPos < rx.size()) ? rx[rxPos] : -1;
+    }
+
+    size_t write(uint8_t b) override
+    {
+        return write(&b, 1);
+    }
+
+    size_t write(const uint8_t *buf, size_t len) override
+    {
+        uint32_t nowUs = (uint32_t)host_clock_us();
+        for (size_t i = 0; i < len; i++)
+        {
+            uint32_t startUs = (lineFreeUs > nowUs) ? lineFreeUs : nowUs;
+            lineFreeUs = startUs + UART_BYTE_US;
+            tx_parse(buf[i]);
+        }
+        return len;
+    }
+
+    int availableForWrite(void) override
+    {
+        uint32_t nowUs = (uint32_t)host_clock_us();
+        uint32_t pending = (lineFreeUs > nowUs) ? (lineFreeUs - nowUs + UART_BYTE_US - 1U) / UART_BYTE_US : 0U;
+        return (pending < UART_FIFO_SIZE) ? (int)(UART_FIFO_SIZE - pending) : 0;
+    }
+
+    std::deque<uint32_t> noteInUs;
+    std::vector<uint32_t> noteLatencyUs;
+
+private:
+    void tx_parse(uint8_t b)
+    {
+        if (b >= 0xF8U)
+        {
+            return;
+        }
+        if (b & 0x80U)
+        {
+            txStatus = b;
+            txCount = 0;
+            return;
+        }
+        txCount++;
+        uint8_t need = ((txStatus & 0xE0U) == 0xC0U) ? 1U : 2U;
+        if (txCount < need)
+        {
+            return;
+        }
+        txCount = 0;
+        bool note = (txStatus & 0xE0U) == 0x80U;
+        if (note && (txStatus & 0x0FU) != SEQ_CHANNEL && !noteInUs.empty())
+        {
+            noteLatencyUs.push_back(lineFreeUs - noteInUs.front());
+            noteInUs.pop_front();
+        }
+    }
+
+    void (*rxCb)(void) = NULL;
+    std::vector<uint8_t> rx;
+    size_t rxPos = 0;
+    uint32_t lineFreeUs = 0;
+    uint8_t txStatus = 0;
+    uint8_t txCount = 0;
+};
+
+
+static SimSerial comSerial;
+static HostSerial showSerial(true);
+
+#define COM_SERIAL  comSerial
+#define SHOW_SERIAL showSerial
+
+/* the receive callback is simulated, so the reception time is taken like on the ESP32-C3 */
+#define MIDI_RX_TIMESTAMP_CALLBACK
+
+/* functions of the other sketch files used by MidiInterface.ino, the recorder stays idle */
+void App_Record(uint8_t param, uint8_t value) { (void)param; (void)value; }
+
+#include "../../MidiLivePlayback/MidiInterface.ino"
+
+
+struct input_s
+{
+    uint8_t msg[3];
+    bool note;
+};
+
+
+static uint32_t percentile(std::vector<uint32_t> v, uint32_t p)
+{
+    if (v.empty())
+    {
+        return 0;
+    }
+    std::sort(v.begin(), v.end());
+    return v[(v.size() * p) / 100U];
+}
+
+int main(int argc, char *argv[])
+{
+    float rate = 30.0f;
+    float load = 30.0f;
+    uint32_t seconds = 60;
+    uint32_t maxP99Us = 10000;
+    bool fair = false;
+    const char *capturePath = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            rate = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+        {
+            load = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            seconds = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            maxP99Us = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-f") == 0)
+        {
+            fair = true;
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            capturePath = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-r input %% of line rate] [-d sequencer load %%] [-s seconds] [-j max note on p99 us] [-f] [-o capture.cap]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    printf("input %.0f %% of line rate, sequencer %.0f %% of line rate in bursts per sixteenth, loop every %u..%u us, %u s, %s\n",
+           rate, load, LOOP_MIN_US, LOOP_MAX_US, seconds, fair ? "round robin" : "priority");
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<uint32_t> loopTime(LOOP_MIN_US, LOOP_MAX_US);
+    std::exponential_distribution<double> gap(1.0);
+    std::uniform_int_distribution<uint32_t> kind(0, 9);
+
+    host_clock_set_virtual(true);
+    midi_com_setup();
+    lat_probe_set_enabled(true);
+    midi_out_set_fair(fair);
+
+    if (capturePath != NULL)
+    {
+        /* the host file system puts its root in front of the path */
+        host_fs_set_root((capturePath[0] == '/') ? "" : ".");
+        File file = LittleFS.open(capturePath, "w");
+        if (!file)
+        {
+            fprintf(stderr, "cannot create %s\n", capturePath);
+            return 2;
+        }
+        cap_init(NULL);
+        cap_start(file, micros());
+    }
+
+    const uint64_t endUs = (uint64_t)seconds * 1000000U;
+    const double meanGapUs = 3.0 * UART_BYTE_US * 100.0 / rate;
+    const uint32_t sixteenthUs = 15000000U / SEQ_BPM;
+    const uint32_t burstMessages = (uint32_t)(load / 100.0f * 3125.0f * sixteenthUs / 1000000.0f / 3.0f);
+
+    struct input_s in = {};
+    uint8_t inPos = 3;
+    uint32_t note = 0;
+    uint64_t nextByteUs = UART_BYTE_US;
+    uint64_t nextLoopUs = loopTime(rng);
+    uint64_t nextBurstUs = 0;
+    uint32_t seqNote = 0;
+
+    while (host_clock_us() < endUs)
+    {
+        if (nextByteUs <= nextLoopUs)
+        {
+            host_clock_advance_us(nextByteUs - host_clock_us());
+            if (inPos == 3)
+            {
+                /* 8 of 10 messages are notes, the rest hits a mapped rotary */
+                if (kind(rng) < 8)
+                {
+                    uint8_t ch = note % 8U;
+                    in = {{(uint8_t)(((note & 1U) ? 0x80U : 0x90U) | ch), (uint8_t)(36U + (note >> 1U) % 48U), 100}, true};
+                    note++;
+                }
+                else
+                {
+                    in = {{0xB0U, 0x10U, (uint8_t)(note % 128U)}, false};
+                }
+                inPos = 0;
+            }
+            comSerial.receive(in.msg[inPos], in.note && inPos == 2);
+            inPos++;
+            if (inPos == 3)
+            {
+                uint64_t idleUs = (uint64_t)(gap(rng) * (meanGapUs - 3.0 * UART_BYTE_US));
+                nextByteUs += UART_BYTE_US + idleUs;
+            }
+            else
+            {
+                nextByteUs += UART_BYTE_US;
+            }
+        }
+        else
+        {
+            host_clock_advance_us(nextLoopUs - host_clock_us());
+            midi_com_loop();
+            if (host_clock_us() >= nextBurstUs)
+            {
+                nextBurstUs += sixteenthUs;
+                for (uint32_t i = 0; i < burstMessages; i++, seqNote++)
+                {
+                    uint8_t msg[] = {(uint8_t)(((seqNote & 1U) ? 0x80U : 0x90U) | SEQ_CHANNEL), (uint8_t)(36U + (seqNote >> 1U) % 48U), 100};
+                    midi_out_write(MIDI_OUT_SRC_PLAYER, msg, sizeof(msg));
+                }
+            }
+            midi_out_loop();
+            cap_process();
+            nextLoopUs = host_clock_us() + loopTime(rng);
+        }
+    }
+
+    if (capturePath != NULL)
+    {
+        cap_stop();
+        while (cap_process())
+        {
+        }
+        struct cap_stats_s stats;
+        cap_get_stats(&stats);
+        printf("capture %s: %lu bytes received, %lu records, %lu dropped, %lu bytes\n", capturePath, (unsigned long)stats.bytes,
+               (unsigned long)stats.records, (unsigned long)stats.dropped, (unsigned long)stats.fileBytes);
+    }
+
+    printf("latency probe [us]\n");
+    lat_probe_print(&showSerial);
+    Console_Merge("");
+
+    struct lat_summary_s noteOn;
+    lat_probe_get(LAT_TYPE_NOTE_ON, LAT_STAGE_SENT, &noteOn);
+    std::vector<uint32_t> &exact = comSerial.noteLatencyUs;
+    uint32_t exactP99 = percentile(exact, 99);
+    uint32_t exactMax = exact.empty() ? 0 : *std::max_element(exact.begin(), exact.end());
+    printf("exact note latency on the wire [us]: %zu notes, p50 %u, p99 %u, max %u\n", exact.size(), percentile(exact, 50), exactP99, exactMax);
+
+    /* the probe estimates the end of the transmission from the FIFO level and reports p99 as the end of a bin */
+    uint32_t tolerance = exactP99 / 8U + UART_BYTE_US;
+    bool probeOk = noteOn.count > 0 && noteOn.p99Us + tolerance >= exactP99 && noteOn.p99Us <= exactP99 + tolerance;
+    bool fail = !probeOk || noteOn.p99Us > maxP99Us;
+    printf("%s (note on p99 below %u us, probe within %u us of the exact p99)\n", fail ? "FAIL" : "PASS", maxP99Us, tolerance);
+    return fail ? 1 : 0;
+}
@@ -0,0 +1,501 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file midi_replay.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Replay of an input capture (capture console command, InputCapture.h) through the host build of the sketches.
+ *        MidiInterface.ino of the sketch is compiled unchanged against a simulated UART on a virtual time line (31250 baud, 128 byte TX FIFO)
+ *        like in midi_latency_bench. Every captured byte is received at its time divided by the speed, the receive callback is called for each.
+ *        Above a speed of 1 bytes may follow closer than a byte time, more than the line could carry, for a load beyond the captured one.
+ *        The loop runs every 200 to 1000 us. A backing song is played as the player source of the output merger: in the MidiFilePlayer
+ *        through midi_player_send_data() and the lookahead of the sketch, in the MidiLivePlayback as a stand in for the sequencer of the modes.
+ *        Button events are counted and listed, the modes need the button library and are not part of the host build.
+ *        The latency probe, the traffic counters and the merger statistics of the sketch are printed, together with the exact latency
+ *        from the last received byte of a note to the last sent byte of the forwarded note, for the channels the song does not use.
+ *
+ * Build (ML_SynthTools provides midi_interface.h and ml_utils.h):
+ *   g++ -O2 -std=c++17 -I../host -I../common -I<path to ML_SynthTools>/src midi_replay.cpp ../common/capture.cpp ../common/smf.cpp ../../MidiLivePlayback/IdleLoop.cpp ../../MidiLivePlayback/InputCapture.cpp ../../MidiLivePlayback/LatencyProbe.cpp ../../MidiLivePlayback/MidiClockSync.cpp ../../MidiLivePlayback/MidiOut.cpp ../../MidiLivePlayback/MidiTelemetry.cpp ../../MidiLivePlayback/LiveTransform.cpp ../../MidiLivePlayback/MidiRecorder.cpp ../../MidiLivePlayback/TempoFixed.cpp ../host/host_arduino.cpp ../host/host_fs.cpp -o midi_replay
+ *
+ *   for the MidiFilePlayer sketch:
+ *   g++ -O2 -std=c++17 -DREPLAY_FILE_PLAYER -I../host -I../common -I<path to ML_SynthTools>/src midi_replay.cpp ../common/capture.cpp ../common/smf.cpp ../../MidiFilePlayer/IdleLoop.cpp ../../MidiFilePlayer/InputCapture.cpp ../../MidiFilePlayer/LatencyProbe.cpp ../../MidiFilePlayer/Log.cpp ../../MidiFilePlayer/MidiClockSync.cpp ../../MidiFilePlayer/MidiClockOut.cpp ../../MidiFilePlayer/MidiOut.cpp ../../MidiFilePlayer/MidiTelemetry.cpp ../../MidiFilePlayer/PlayerLookahead.cpp ../../MidiFilePlayer/SongPool.cpp ../../MidiFilePlayer/StaticAlloc.cpp ../../MidiFilePlayer/TempoFixed.cpp ../host/host_arduino.cpp ../host/host_fs.cpp ../host/host_player.cpp -o midi_replay_player
+ *
+ * Usage:
+ *   midi_replay [-x speed] [-m song.mid] [-j max note on p99 us] [-f] [-v] <capture.cap>
+ */
+
+
+#include <Arduino.h>
+
+#include "capture.h"
+#include "smf.h"
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+
+#define UART_BYTE_US    320U /* 10 bits at 31250 baud */
+#define UART_FIFO_SIZE  128
+#define LOOP_MIN_US     200U
+#define LOOP_MAX_US     1000U
+#define REPLAY_DRAIN_US 1000000U /* time after the last captured byte, the output is sent completely */
+
+
+/**
+ * @brief Serial port of the synth on the virtual time line.
+ *        The received bytes are injected by the replay, sent bytes leave the TX FIFO back to back.
+ *        Forwarded notes are matched in order with the received notes to get their exact latency.
+ */
+class SimSerial : public Stream
+{
+public:
+    void setRxFIFOFull(uint8_t bytes)
+    {
+        (void)bytes;
+    }
+
+    void onReceive(void (*cb)(void))
+    {
+        rxCb = cb;
+    }
+
+    /**
+     * @brief A byte has been received completely.
+     * @param b Byte
+     * @param lastOfNote true if the byte completes a note message, its time is kept to match the forwarded note
+     */
+    void receive(uint8_t b, bool lastOfNote)
+    {
+        rx.push_back(b);
+        if (lastOfNote)
+        {
+            noteInUs.push_back((uint32_t)host_clock_us());
+        }
+        if (rxCb != NULL)
+        {
+            rxCb();
+        }
+    }
+
+    int available(void) override
+    {
+        return (int)(rx.size() - rxPos);
+    }
+
+    int read(void) override
+    {
+        return (rxPos < rx.size()) ? rx[rxPos++] : -1;
+    }
+
+    int peek(void) override
+    {
+        return (rxPos < rx.size()) ? rx[rxPos] : -1;
+    }
+
+    size_t write(uint8_t b) override
+    {
+        return write(&b, 1);
+    }
+
+    size_t write(const uint8_t *buf, size_t len) override
+    {
+        uint32_t nowUs = (uint32_t)host_clock_us();
+        for (size_t i = 0; i < len; i++)
+        {
+            uint32_t startUs = (lineFreeUs > nowUs) ? lineFreeUs : nowUs;
+            lineFreeUs = startUs + UART_BYTE_US;
+            tx_parse(buf[i]);
+        }
+        return len;
+    }
+
+    int availableForWrite(void) override
+    {
+        uint32_t nowUs = (uint32_t)host_clock_us();
+        uint32_t pending = (lineFreeUs > nowUs) ? (lineFreeUs - nowUs + UART_BYTE_US - 1U) / UART_BYTE_US : 0U;
+        return (pending < UART_FIFO_SIZE) ? (int)(UART_FIFO_SIZE - pending) : 0;
+    }
+
+    std::deque<uint32_t> noteInUs;
+    std::vector<uint32_t> noteLatencyUs;
+    uint16_t songChannels = 0; /* notes on these channels are not matched */
+
+private:
+    void tx_parse(uint8_t b)
+    {
+        if (b >= 0xF8U)
+        {
+            return;
+        }
+        if (b & 0x80U)
+        {
+            txStatus = b;
+            txCount = 0;
+            return;
+        }
+        txCount++;
+        uint8_t need = ((txStatus & 0xE0U) == 0xC0U) ? 1U : 2U;
+        if (txCount < need)
+        {
+            return;
+        }
+        txCount = 0;
+        bool note = (txStatus & 0xE0U) == 0x80U;
+        if (note && (songChannels & (1U << (txStatus & 0x0FU))) == 0 && !noteInUs.empty())
+        {
+            noteLatencyUs.push_back(lineFreeUs - noteInUs.front());
+            noteInUs.pop_front();
+        }
+    }
+
+    void (*rxCb)(void) = NULL;
+    std::vector<uint8_t> rx;
+    size_t rxPos = 0;
+    uint32_t lineFreeUs = 0;
+    uint8_t txStatus = 0;
+    uint8_t txCount = 0;
+};
+
+
+static SimSerial comSerial;
+static HostSerial showSerial(true);
+
+#define COM_SERIAL  comSerial
+#define SHOW_SERIAL showSerial
+
+/* the receive callback is simulated, so the reception time is taken like on the ESP32-C3 */
+#define MIDI_RX_TIMESTAMP_CALLBACK
+
+#ifdef REPLAY_FILE_PLAYER
+/* functions of the other sketch files used by MidiInterface.ino */
+void app_play_next_song(void) {}
+void app_play_prev_song(void) {}
+bool midi_render_active(void) { return false; }
+void midi_render_data(const uint8_t *msg, int len) { (void)msg; (void)len; }
+void sendNRPN3707Volume(uint8_t channel, uint8_t value);
+void send_gm_reset_msg(void);
+#include "../../MidiFilePlayer/TempoFixed.h"
+static tempo_q16_t replayTempo = TEMPO_DEFAULT;
+void app_set_tempo(tempo_q16_t tempo) { replayTempo = tempo; }
+tempo_q16_t app_get_tempo(void) { return replayTempo; }
+#include "../../MidiFilePlayer/MidiInterface.ino"
+#else
+/* functions of the other sketch files used by MidiInterface.ino, the recorder stays idle */
+void App_Record(uint8_t param, uint8_t value) { (void)param; (void)value; }
+#include "../../MidiLivePlayback/MidiInterface.ino"
+#endif
+
+
+struct song_event_s
+{
+    uint64_t us;
+    std::vector<uint8_t> msg;
+};
+
+static std::vector<song_event_s> songEvents;
+static size_t songNext = 0;
+static uint64_t songUs = 0;
+
+
+#ifdef REPLAY_FILE_PLAYER
+/**
+ * @brief Stand in for ml_midi_player_loop(), passes the events reached by the song time to the player path of the sketch.
+ */
+static void replay_advance(uint32_t elapsedMs)
+{
+    songUs += (uint64_t)elapsedMs * 1000U;
+    while (songNext < songEvents.size() && songEvents[songNext].us <= songUs)
+    {
+        std::vector<uint8_t> &msg = songEvents[songNext++].msg;
+        midi_player_send_data(msg.data(), (int)msg.size());
+    }
+}
+#endif
+
+/**
+ * @brief Play the backing song up to the current time, called by the loop.
+ */
+static void replay_song_loop(void)
+{
+#ifdef REPLAY_FILE_PLAYER
+    lookahead_loop(micros(), midi_out_hold(MIDI_OUT_SRC_PLAYER));
+#else
+    songUs = host_clock_us();
+    while (songNext < songEvents.size() && songEvents[songNext].us <= songUs && !midi_out_hold(MIDI_OUT_SRC_PLAYER))
+    {
+        const std::vector<uint8_t> &msg = songEvents[songNext++].msg;
+        midi_out_write(MIDI_OUT_SRC_PLAYER, msg.data(), (uint16_t)msg.size());
+    }
+#endif
+}
+
+/**
+ * @brief Convert the song into its messages with their song time.
+ * @return Channels with notes
+ */
+static uint16_t replay_load_song(const smf_file_s &smf)
+{
+    smf_track_s merged;
+    smf_merge_tracks(smf, merged);
+    std::vector<smf_tempo_point_s> map;
+    smf_build_tempo_map(smf.division, merged, map);
+
+    uint16_t channels = 0;
+    for (const smf_event_s &ev : merged.events)
+    {
+        if (ev.status == SMF_META)
+        {
+            continue;
+        }
+        song_event_s e;
+        e.us = smf_tick_to_us(smf.division, map, ev.tick);
+        if (ev.status != 0xF7U)
+        {
+            e.msg.push_back(ev.status);
+        }
+        e.msg.insert(e.msg.end(), ev.data.begin(), ev.data.end());
+        songEvents.push_back(e);
+        if ((ev.status & 0xE0U) == 0x80U)
+        {
+            channels |= 1U << (ev.status & 0x0FU);
+        }
+    }
+    return channels;
+}
+
+/**
+ * @brief Follow the received stream to find the last byte of a note message.
+ * @param b Received byte
+ * @param ignore Channels whose notes are not matched
+ * @return true if the byte completes a note on or off
+ */
+static bool replay_note_end(uint8_t b, uint16_t ignore)
+{
+    static uint8_t running = 0;
+    static uint8_t count = 0;
+
+    if (b >= 0xF8U)
+    {
+        return false;
+    }
+    if (b & 0x80U)
+    {
+        running = (b < 0xF0U) ? b : 0U;
+        count = 0;
+        return false;
+    }
+    if (running == 0)
+    {
+        return false;
+    }
+    count++;
+    uint8_t need = ((running & 0xE0U) == 0xC0U) ? 1U : 2U;
+    if (count < need)
+    {
+        return false;
+    }
+    count = 0;
+    return (running & 0xE0U) == 0x80U && (ignore & (1U << (running & 0x0FU))) == 0;
+}
+
+static uint32_t percentile(std::vector<uint32_t> v, uint32_t p)
+{
+    if (v.empty())
+    {
+        return 0;
+    }
+    std::sort(v.begin(), v.end());
+    return v[(v.size() * p) / 100U];
+}
+
+int main(int argc, char *argv[])
+{
+    double speed = 1.0;
+    const char *songPath = NULL;
+    const char *path = NULL;
+    uint32_t maxP99Us = 10000;
+    bool fair = false;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-x") == 0 && i + 1 < argc)
+        {
+            speed = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+        {
+            songPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            maxP99Us = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-f") == 0)
+        {
+            fair = true;
+        }
+        else if (strcmp(argv[i], "-v") == 0)
+        {
+            verbose = true;
+        }
+        else if (argv[i][0] != '-' && path == NULL)
+        {
+            path = argv[i];
+        }
+        else
+        {
+            path = NULL;
+            break;
+        }
+    }
+    if (path == NULL || speed <= 0.0)
+    {
+        fprintf(stderr, "usage: %s [-x speed] [-m song.mid] [-j max note on p99 us] [-f] [-v] <capture.cap>\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<capture_event_s> events;
+    std::string error;
+    if (!capture_load(path, events, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 2;
+    }
+    if (songPath != NULL)
+    {
+        std::ifstream file(songPath, std::ios::binary);
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        smf_file_s smf;
+        if (data.empty() || !smf_parse(data.data(), data.size(), smf, error))
+        {
+            fprintf(stderr, "%s: %s\n", songPath, data.empty() ? "cannot read" : error.c_str());
+            return 2;
+        }
+        comSerial.songChannels = replay_load_song(smf);
+    }
+
+    /* input per second of the replay, the captured times are divided by the speed */
+    size_t received = 0;
+    std::map<std::string, uint32_t> buttons;
+    std::map<uint64_t, uint32_t> perSecond;
+    for (const capture_event_s &ev : events)
+    {
+        if (ev.kind == CAPTURE_RX)
+        {
+            received++;
+            perSecond[(uint64_t)(ev.us / speed) / 1000000U]++;
+        }
+        else
+        {
+            buttons[capture_button_name(ev.value)]++;
+        }
+    }
+    uint32_t peakBps = 0;
+    for (const auto &s : perSecond)
+    {
+        peakBps = std::max(peakBps, s.second);
+    }
+    uint64_t lengthUs = events.empty() ? 0 : (uint64_t)(events.back().us / speed);
+
+    printf("%s: %zu bytes received, %zu button events, %.1f s, replayed at %.2f x, peak %u bytes/s (the line takes %u)\n", path, received,
+           events.size() - received, lengthUs / 1e6, speed, peakBps, MIDI_TELE_LINE_BPS);
+    printf("backing song %s, %zu events, loop every %u..%u us, %s\n", songPath ? songPath : "none", songEvents.size(),
+           LOOP_MIN_US, LOOP_MAX_US, fair ? "round robin" : "priority");
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<uint32_t> loopTime(LOOP_MIN_US, LOOP_MAX_US);
+
+    host_clock_set_virtual(true);
+    midi_com_setup();
+    lat_probe_set_enabled(true);
+    midi_out_set_fair(fair);
+#ifdef REPLAY_FILE_PLAYER
+    lookahead_init(replay_advance);
+#endif
+
+    const uint64_t endUs = lengthUs + REPLAY_DRAIN_US;
+    uint64_t lastInUs = 0;
+    uint64_t nextLoopUs = loopTime(rng);
+    size_t next = 0;
+
+    while (host_clock_us() < endUs)
+    {
+        uint64_t inUs = UINT64_MAX;
+        if (next < events.size())
+        {
+            /* a record is never earlier than the bytes before it */
+            inUs = std::max(lastInUs, (uint64_t)(events[next].us / speed));
+        }
+
+        if (inUs <= nextLoopUs)
+        {
+            host_clock_advance_us(inUs - host_clock_us());
+            lastInUs = inUs;
+            const capture_event_s &ev = events[next++];
+            if (ev.kind == CAPTURE_RX)
+            {
+                comSerial.receive(ev.value, replay_note_end(ev.value, comSerial.songChannels));
+            }
+            else if (verbose)
+            {
+                printf("%10.3f s  button %s\n", inUs / 1e6, capture_button_name(ev.value).c_str());
+            }
+        }
+        else
+        {
+            host_clock_advance_us(nextLoopUs - host_clock_us());
+            midi_com_loop();
+            replay_song_loop();
+            midi_out_loop();
+            nextLoopUs = host_clock_us() + loopTime(rng);
+        }
+    }
+
+    if (!buttons.empty())
+    {
+        printf("button events (not replayed):");
+        for (const auto &b : buttons)
+        {
+            printf(" %s %u", b.first.c_str(), b.second);
+        }
+        printf("\n");
+    }
+
+    printf("latency probe [us]\n");
+    lat_probe_print(&showSerial);
+    Console_Traffic("");
+    Console_Merge("");
+
+    struct lat_summary_s noteOn;
+    lat_probe_get(LAT_TYPE_NOTE_ON, LAT_STAGE_SENT, &noteOn);
+    std::vector<uint32_t> &exact = comSerial.noteLatencyUs;
+    uint32_t exactMax = exact.empty() ? 0 : *std::max_element(exact.begin(), exact.end());
+    printf("exact note latency on the wire [us]: %zu notes, p50 %u, p99 %u, max %u\n", exact.size(), percentile(exact, 50),
+           percentile(exact, 99), exactMax);
+
+    bool fail = noteOn.p99Us > maxP99Us;
+    printf("%s (note on p99 below %u us)\n", fail ? "FAIL" : "PASS", maxP99Us);
+    return fail ? 1 : 0;
+}
@@ -0,0 +1,562 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file midi_synth_sim.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Plays a MIDI file through the output merger of the sketches into the SAM2695 model (host_sam2695.h).
+ *        MidiOut.cpp and PlayerLookahead.cpp of the sketch are compiled unchanged and run on the virtual clock,
+ *        the lookahead advances a stand in of the player which passes the events of the song reached by its time.
+ *        The loop runs again at its deadlines like app_idle() of the file player: the merger, the next burst of the lookahead
+ *        and at the latest after the loop period.
+ *        The model reports link use, the delay from write to wire, voices against the polyphony of the chip
+ *        and the parameter state at the end, so a change of the output path can be measured without hardware.
+ *        The onset error is the time the last byte of a note on is on the wire minus its time in the song.
+ *        The traffic counters of the merger (MidiTelemetry.cpp) are printed per chip and checked against the bytes and messages of the model.
+ *        With -n the merger spreads the song over several models on ports of their own (MIDI_OUT_PORTS),
+ *        by channel or by voice, each chip is reported on its own.
+ *        Instead of a file a dense song of chords can be generated.
+ *        With -u a file is uploaded while the song plays (SongUpload.cpp of the sketch): a sender keeps a window of frames
+ *        in the serial buffer, the blocks are written when the loop would wait, with the quiet time of app_quiet_until_us().
+ *        A write stops the clock for the erase and program time of the flash (host_fs_set_flash_timing()),
+ *        -x writes without waiting for a quiet time, to compare.
+ *        The run is deterministic, the same file and options always give the same report.
+ *
+ * Build:
+ *   g++ -O2 -std=c++17 -I../host -I../common -I../../MidiFilePlayer -DMIDI_OUT_PORTS=4 midi_synth_sim.cpp ../common/smf.cpp ../../MidiFilePlayer/LatencyProbe.cpp ../../MidiFilePlayer/MidiOut.cpp ../../MidiFilePlayer/MidiTelemetry.cpp ../../MidiFilePlayer/PlayerLookahead.cpp ../../MidiFilePlayer/SongUpload.cpp ../host/host_arduino.cpp ../host/host_fs.cpp ../host/host_sam2695.cpp -o midi_synth_sim
+ *
+ * Usage:
+ *   midi_synth_sim [-p polyphony] [-f fifo bytes] [-l loop us] [-b reset busy ms] [-a lookahead ms] [-e] [-n chips] [-v] [-u kbytes [-w erase ms] [-x]]
+ *                  <song.mid | -g notes per chord [-d note ms]>
+ */
+
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+
+#include "MidiOut.h"
+#include "MidiTelemetry.h"
+#include "PlayerLookahead.h"
+#include "SongUpload.h"
+#include "host_sam2695.h"
+#include "LittleFS.h"
+#include "smf.h"
+
+
+#define SIM_LOOP_US         1000U   /* default loop period of the sketch */
+#define SIM_PASS_US         10U     /* shortest time between two passes of the loop */
+#define SIM_TAIL_US         2000000U /* time after the last event, the merger and the wire run empty */
+#define SIM_GEN_SECONDS     20U     /* length of the generated song */
+#define SIM_GEN_STEP_US     125000U /* sixteenth notes at 120 BPM */
+#define SIM_GEN_NOTE_MS     100U
+#define SIM_UPLOAD_WINDOW   8U      /* frames the sender has on their way */
+#define SIM_UPLOAD_START_US 1000000U
+#define SIM_ERASE_MS        45U     /* typical sector erase of a SPI flash */
+#define SIM_PAGE_US         500U    /* page program of 256 bytes */
+#define SIM_UPLOAD_FILE     "/upload.tmp"
+
+
+struct sim_event_s
+{
+    uint64_t us;
+    std::vector<uint8_t> msg;
+};
+
+
+static std::vector<sim_event_s> simEvents;
+static size_t simNext = 0;
+static uint64_t simSongUs = 0;
+static std::map<uint16_t, std::deque<uint32_t>> simDueUs; /* time in the song of the note ons on their way per channel and note */
+static std::vector<int32_t> simErrorUs;
+
+/* sender of the upload, it gets the replies and sends the frames on the serial of the sketch */
+static std::vector<uint8_t> simUploadData;
+static HostSerial simUploadIn;
+static HostSerial simUploadReply;
+static size_t simReplyPos = 0;
+static uint32_t simFrameBase = 0; /* oldest frame without ack */
+static uint32_t simFrameNext = 0;
+static bool simUploading = false;
+
+
+/**
+ * @brief Stand in for ml_midi_player_loop(), passes the events reached by the song time to the lookahead.
+ */
+static void sim_advance(uint32_t elapsedMs)
+{
+    simSongUs += (uint64_t)elapsedMs * 1000U;
+    uint32_t stepUs = lookahead_due_us();
+    while (simNext < simEvents.size() && simEvents[simNext].us <= simSongUs)
+    {
+        const sim_event_s &e = simEvents[simNext++];
+        if (e.msg.empty())
+        {
+            continue;
+        }
+        if ((e.msg[0] & 0xF0U) == 0x90U && e.msg.size() >= 3U && e.msg[2] > 0U)
+        {
+            /* the player passes events late by up to one step, the error is taken against the exact time */
+            simDueUs[(uint16_t)((e.msg[0] << 8U) | e.msg[1])].push_back(stepUs - (uint32_t)(simSongUs - e.us));
+        }
+        lookahead_write(e.msg.data(), (uint16_t)e.msg.size());
+    }
+}
+
+static void sim_on_message(const uint8_t *msg, uint16_t len, uint64_t endUs)
+{
+    if ((msg[0] & 0xF0U) != 0x90U || len < 3U || msg[2] == 0U)
+    {
+        return;
+    }
+    std::deque<uint32_t> &due = simDueUs[(uint16_t)((msg[0] << 8U) | msg[1])];
+    if (!due.empty())
+    {
+        simErrorUs.push_back((int32_t)((uint32_t)endUs - due.front()));
+        due.pop_front();
+    }
+}
+
+static uint32_t sim_frames(void)
+{
+    return (uint32_t)((simUploadData.size() + UPLOAD_FRAME_MAX - 1U) / UPLOAD_FRAME_MAX);
+}
+
+/**
+ * @brief Sender of the upload: take the replies and keep SIM_UPLOAD_WINDOW frames on their way, a nak goes back to the frame expected.
+ */
+static void sim_upload_send(void)
+{
+    std::vector<uint8_t> &tx = simUploadReply.tx;
+    for (size_t end; (end = std::find(tx.begin() + simReplyPos, tx.end(), '\n') - tx.begin()) < tx.size(); simReplyPos = end + 1U)
+    {
+        std::string line(tx.begin() + simReplyPos, tx.begin() + end);
+        unsigned seq;
+        if (sscanf(line.c_str(), "ack %u", &seq) == 1 && seq == (simFrameBase & 0xFFU))
+        {
+            simFrameBase++;
+        }
+        else if (sscanf(line.c_str(), "nak %u", &seq) == 1)
+        {
+            simFrameNext = simFrameBase;
+        }
+    }
+
+    while (simFrameNext < sim_frames() && simFrameNext < simFrameBase + SIM_UPLOAD_WINDOW)
+    {
+        size_t off = (size_t)simFrameNext * UPLOAD_FRAME_MAX;
+        uint16_t len = (uint16_t)std::min<size_t>(UPLOAD_FRAME_MAX, simUploadData.size() - off);
+        std::vector<uint8_t> frame = {(uint8_t)UPLOAD_SYNC, (uint8_t)simFrameNext, (uint8_t)len, (uint8_t)(len >> 8U)};
+        frame.insert(frame.end(), simUploadData.begin() + off, simUploadData.begin() + off + len);
+        uint16_t crc = upload_crc16(0xFFFFU, &frame[1], (uint32_t)frame.size() - 1U);
+        frame.push_back((uint8_t)crc);
+        frame.push_back((uint8_t)(crc >> 8U));
+        simUploadIn.inject(frame.data(), frame.size());
+        simFrameNext++;
+    }
+}
+
+/**
+ * @brief Time up to which nothing is due, like app_quiet_until_us() of the file player.
+ */
+static uint32_t sim_quiet_until_us(uint32_t nowUs)
+{
+    uint32_t quietUs = nowUs + 1000000U;
+    uint32_t dueUs;
+    if (lookahead_next_us(&dueUs) && (int32_t)(dueUs - quietUs) < 0)
+    {
+        quietUs = dueUs;
+    }
+    if (simNext < simEvents.size() && (int32_t)(lookahead_horizon_us() - quietUs) < 0)
+    {
+        quietUs = lookahead_horizon_us();
+    }
+    if (midi_out_pending() > 0)
+    {
+        quietUs = nowUs;
+    }
+    return quietUs;
+}
+
+/**
+ * @brief Generate a dense song: a chord on separate channels every sixteenth note, every note on its own channel.
+ */
+static void sim_generate(uint32_t notes, uint32_t noteMs, std::vector<sim_event_s> &events)
+{
+    for (uint32_t ch = 0; ch < notes; ch++)
+    {
+        events.push_back({0, {(uint8_t)(0xC0U | (ch & 0x0FU)), (uint8_t)(ch * 8U)}});
+    }
+    for (uint64_t us = SIM_GEN_STEP_US; us < SIM_GEN_SECONDS * 1000000ULL; us += SIM_GEN_STEP_US)
+    {
+        uint8_t root = (uint8_t)(48U + (us / SIM_GEN_STEP_US) % 12U);
+        for (uint32_t i = 0; i < notes; i++)
+        {
+            events.push_back({us, {(uint8_t)(0x90U | (i & 0x0FU)), (uint8_t)(root + i * 4U), 100}});
+        }
+        for (uint32_t i = 0; i < notes; i++)
+        {
+            events.push_back({us + noteMs * 1000U, {(uint8_t)(0x80U | (i & 0x0FU)), (uint8_t)(root + i * 4U), 0}});
+        }
+    }
+    std::stable_sort(events.begin(), events.end(), [](const sim_event_s &a, const sim_event_s &b) { return a.us < b.us; });
+}
+
+/**
+ * @brief Convert the song into the messages sent to the synth with their song time.
+ */
+static void sim_load(const smf_file_s &smf, std::vector<sim_event_s> &events)
+{
+    smf_track_s merged;
+    smf_merge_tracks(smf, merged);
+    std::vector<smf_tempo_point_s> map;
+    smf_build_tempo_map(smf.division, merged, map);
+
+    for (const smf_event_s &ev : merged.events)
+    {
+        if (ev.status == SMF_META)
+        {
+            continue;
+        }
+        sim_event_s e;
+        e.us = smf_tick_to_us(smf.division, map, ev.tick);
+        if (ev.status != 0xF7U)
+        {
+            e.msg.push_back(ev.status);
+        }
+        e.msg.insert(e.msg.end(), ev.data.begin(), ev.data.end());
+        events.push_back(e);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t polyphony = SAM_POLYPHONY;
+    int fifoSize = SAM_FIFO_SIZE;
+    uint32_t loopUs = SIM_LOOP_US;
+    uint32_t busyUs = SAM_RESET_BUSY_US;
+    uint32_t windowMs = LOOKAHEAD_MS;
+    uint8_t align = LOOKAHEAD_ALIGN_MEAN;
+    uint32_t chordNotes = 0;
+    uint32_t noteMs = SIM_GEN_NOTE_MS;
+    uint32_t chips = 1;
+    uint8_t route = MIDI_OUT_ROUTE_CHANNEL;
+    uint32_t uploadKb = 0;
+    uint32_t eraseMs = SIM_ERASE_MS;
+    bool uploadGate = true;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+        {
+            polyphony = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+        {
+            fifoSize = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+        {
+            loopUs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+        {
+            busyUs = atoi(argv[++i]) * 1000U;
+        }
+        else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc)
+        {
+            windowMs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-e") == 0)
+        {
+            align = LOOKAHEAD_ALIGN_END;
+        }
+        else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc)
+        {
+            chordNotes = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+        {
+            noteMs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            chips = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-v") == 0)
+        {
+            route = MIDI_OUT_ROUTE_VOICE;
+        }
+        else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc)
+        {
+            uploadKb = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+        {
+            eraseMs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-x") == 0)
+        {
+            uploadGate = false;
+        }
+        else if (argv[i][0] != '-' && path == NULL)
+        {
+            path = argv[i];
+        }
+        else
+        {
+            path = NULL;
+            break;
+        }
+    }
+    if ((path == NULL) == (chordNotes == 0) || chordNotes > 16U || loopUs == 0 || fifoSize <= 0 || windowMs > LOOKAHEAD_MS_MAX
+            || chips == 0 || chips > MIDI_OUT_PORTS)
+    {
+        fprintf(stderr, "usage: %s [-p polyphony] [-f fifo bytes] [-l loop us] [-b reset busy ms] [-a lookahead ms] [-e] [-n chips] [-v] "
+                "[-u kbytes [-w erase ms] [-x]] <song.mid | -g notes per chord [-d note ms]>\n", argv[0]);
+        return 2;
+    }
+
+    if (path != NULL)
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        smf_file_s smf;
+        std::string error;
+        if (data.empty() || !smf_parse(data.data(), data.size(), smf, error))
+        {
+            fprintf(stderr, "%s: %s\n", path, data.empty() ? "cannot read" : error.c_str());
+            return 1;
+        }
+        sim_load(smf, simEvents);
+    }
+    else
+    {
+        sim_generate(chordNotes, noteMs, simEvents);
+    }
+    if (simEvents.empty())
+    {
+        fprintf(stderr, "no events\n");
+        return 1;
+    }
+
+    host_clock_set_virtual(true);
+    std::vector<std::unique_ptr<HostSam2695>> sams;
+    for (uint32_t i = 0; i < chips; i++)
+    {
+        sams.emplace_back(new HostSam2695(fifoSize, polyphony));
+        sams[i]->resetBusyUs = busyUs;
+        sams[i]->onMessage = sim_on_message;
+        if (i == 0)
+        {
+            midi_out_init(sams[i].get(), fifoSize);
+        }
+        else
+        {
+            midi_out_set_port((uint8_t)i, sams[i].get(), fifoSize);
+        }
+    }
+    midi_out_set_route(route);
+    lookahead_init(sim_advance);
+    lookahead_set((uint16_t)windowMs, align);
+
+    std::string fsDir;
+    File uploadFile;
+    if (uploadKb > 0)
+    {
+        char dir[] = "/tmp/midi_synth_sim.XXXXXX";
+        if (mkdtemp(dir) == NULL)
+        {
+            fprintf(stderr, "cannot create a directory for the upload\n");
+            return 1;
+        }
+        fsDir = dir;
+        host_fs_set_root(dir);
+        host_fs_set_flash_timing(eraseMs * 1000U, SIM_PAGE_US);
+        srand(1);
+        simUploadData.resize((size_t)uploadKb * 1024U);
+        for (uint8_t &b : simUploadData)
+        {
+            b = (uint8_t)rand();
+        }
+        simUploadReply.keepTx = true;
+        upload_init(NULL);
+    }
+
+    /* the loop of the sketch: song time runs with the clock unless the merger holds the player */
+    uint64_t endUs = 0;
+    uint32_t dueUs;
+    while (simNext < simEvents.size() || midi_out_pending() > 0 || lookahead_next_us(&dueUs)
+            || (uploadKb > 0 && (!simUploading || upload_state() == UPLOAD_RECEIVING || upload_state() == UPLOAD_WRITING)))
+    {
+        lookahead_loop(micros(), midi_out_hold(MIDI_OUT_SRC_PLAYER));
+        midi_out_loop();
+        midi_tele_loop(micros());
+
+        if (uploadKb > 0 && !simUploading && host_clock_us() >= SIM_UPLOAD_START_US)
+        {
+            /* the console command of the sketch */
+            uploadFile = LittleFS.open(SIM_UPLOAD_FILE, "w");
+            upload_start(uploadFile, (uint32_t)simUploadData.size(), upload_crc32(0, simUploadData.data(), (uint32_t)simUploadData.size()), micros());
+            lookahead_set((uint16_t)std::max<uint32_t>(windowMs, UPLOAD_LOOKAHEAD_MS), align);
+            lookahead_reset_stats();
+            simErrorUs.clear();
+            simUploading = true;
+        }
+        if (simUploading && upload_state() == UPLOAD_RECEIVING)
+        {
+            sim_upload_send();
+            upload_receive(simUploadIn, simUploadReply, micros());
+        }
+
+        /* next pass at the earliest deadline, like app_idle() */
+        uint32_t nowUs = micros();
+        if (simUploading && upload_write_pending())
+        {
+            /* the writer runs before the loop waits, a write stops the clock */
+            while (upload_process(uploadGate ? sim_quiet_until_us(nowUs) : nowUs + 1000000U))
+            {
+            }
+            nowUs = micros();
+        }
+        uint32_t nextUs = nowUs + loopUs;
+        if (lookahead_next_us(&dueUs) && (int32_t)(dueUs - nextUs) < 0)
+        {
+            nextUs = dueUs;
+        }
+        if (midi_out_pending() > 0 && (int32_t)(nowUs + MIDI_OUT_BYTE_US - nextUs) < 0)
+        {
+            nextUs = nowUs + MIDI_OUT_BYTE_US;
+        }
+        host_clock_advance_us(std::max((int32_t)(nextUs - nowUs), (int32_t)SIM_PASS_US));
+
+        if (simNext >= simEvents.size() && endUs == 0)
+        {
+            endUs = host_clock_us();
+        }
+        if (endUs != 0 && (upload_state() == UPLOAD_RECEIVING || upload_state() == UPLOAD_WRITING))
+        {
+            endUs = host_clock_us();
+        }
+        if (endUs != 0 && host_clock_us() > endUs + SIM_TAIL_US && upload_state() != UPLOAD_RECEIVING && upload_state() != UPLOAD_WRITING)
+        {
+            fprintf(stderr, "merger did not run empty\n");
+            return 1;
+        }
+    }
+    uint64_t idleUs = 0;
+    for (const auto &sam : sams)
+    {
+        idleUs = std::max(idleUs, sam->idleUs());
+    }
+    while (idleUs > host_clock_us())
+    {
+        host_clock_advance_us(MIDI_OUT_BYTE_US);
+    }
+
+    struct midi_out_stats_s out;
+    midi_out_get_stats(MIDI_OUT_SRC_PLAYER, &out);
+    struct lookahead_stats_s la;
+    lookahead_get_stats(&la);
+    double songS = simEvents.back().us / 1e6;
+    double runS = host_clock_us() / 1e6;
+    printf("%s: %zu messages, song %.1f s, played in %.1f s, loop %u us, FIFO %d bytes\n", path ? path : "generated", simEvents.size(), songS,
+           runS, loopUs, fifoSize);
+    if (chips > 1)
+    {
+        printf("chips:     %u, spread by %s\n", chips, (route == MIDI_OUT_ROUTE_VOICE) ? "voice" : "channel");
+    }
+    printf("merger:    player queue high-water %u bytes, wait mean %u us, max %u us, blocked %u us\n",
+           out.highWater, out.waitAvgUs, out.waitMaxUs, out.blockedUs);
+
+    /* onset error on the wire against the estimate of the lookahead */
+    std::vector<int32_t> absUs;
+    int64_t sumUs = 0;
+    for (int32_t e : simErrorUs)
+    {
+        sumUs += e;
+        absUs.push_back(std::abs(e));
+    }
+    std::sort(absUs.begin(), absUs.end());
+    auto minmax = std::minmax_element(simErrorUs.begin(), simErrorUs.end());
+    size_t n = simErrorUs.size();
+    if (n > 0)
+    {
+        int64_t absSumUs = 0;
+        for (int32_t a : absUs)
+        {
+            absSumUs += a;
+        }
+        printf("onset:     lookahead %u ms (%s), %zu notes, error mean %lld us, mean absolute %lld us, p99 %d us, late %d us, early %d us at most\n",
+               la.windowMs, (la.align == LOOKAHEAD_ALIGN_END) ? "end" : "mean", n, (long long)(sumUs / (int64_t)n), (long long)(absSumUs / (int64_t)n),
+               absUs[(n * 99U) / 100U], std::max(*minmax.second, 0), std::max(-*minmax.first, 0));
+        printf("           estimate of the sketch: mean %d us, mean absolute %u us, %u bytes waiting at most, %u bursts sent early\n",
+               la.errorMeanUs, la.errorAbsUs, la.highWater, la.overflows);
+    }
+    for (uint32_t i = 0; i < chips; i++)
+    {
+        if (chips > 1)
+        {
+            printf("--- chip %u\n", i + 1U);
+        }
+        struct midi_tele_stats_s tele;
+        midi_tele_get((uint8_t)(1U + i), &tele);
+        const struct host_sam_stats_s &st = sams[i]->stats();
+        printf("traffic:   %u bytes, %u messages, running status possible for %u, peak %u bytes/s, over 10 s %u bytes/s, %u bytes queued at most\n",
+               tele.bytes, tele.channelMsgs + tele.sysexMsgs + tele.common, tele.runningRepeated, tele.peakBps, tele.peakWindowBps, tele.queueHighWater);
+        if (tele.bytes != st.bytes || tele.channelMsgs + tele.sysexMsgs + tele.common != st.messages || tele.stray != st.stray || tele.cut > 0)
+        {
+            fprintf(stderr, "traffic counters differ from the synth: %u bytes, %llu received\n", tele.bytes, (unsigned long long)st.bytes);
+            return 1;
+        }
+        sams[i]->report(stdout);
+    }
+
+    if (uploadKb > 0)
+    {
+        struct upload_stats_s up;
+        upload_get_stats(&up);
+        bool verified = false;
+        if (up.state == UPLOAD_DONE)
+        {
+            File check = LittleFS.open(SIM_UPLOAD_FILE, "r");
+            std::vector<uint8_t> data(simUploadData.size() + 1U);
+            verified = check && check.read(data.data(), data.size()) == simUploadData.size()
+                       && std::equal(simUploadData.begin(), simUploadData.end(), data.begin());
+        }
+        printf("upload:    %u bytes %s in %u.%03u s, %u bytes/s, %u frames, %u rejected%s\n", up.size,
+               verified ? "verified" : (up.state == UPLOAD_DONE) ? "differ" : upload_error_name(up.error),
+               up.elapsedMs / 1000U, up.elapsedMs % 1000U, up.bytesPerSec, up.frames, up.naks, uploadGate ? "" : ", written without a quiet time");
+        printf("           %u block writes of %u us at most, waited %u ms for a quiet time, %u forced\n",
+               up.blocks, up.writeMaxUs, up.deferredMs, up.forced);
+        std::filesystem::remove_all(fsDir);
+        if (!verified)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,300 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file midi_trace.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Host tool for timestamped MIDI output traces.
+ *        Traces are recorded on the device with the "render" console command of the MidiFilePlayer.
+ *
+ * Build:
+ *   g++ -O2 -std=c++17 -I../common midi_trace.cpp ../common/smf.cpp ../common/trace.cpp -o midi_trace
+ *
+ * Usage:
+ *   midi_trace render <song.mid> <out.trc> [step ms]  reference render of a MIDI file on a virtual clock
+ *   midi_trace diff <a.trc> <b.trc> [tolerance us]    compare two traces, exit code 1 if they differ
+ *   midi_trace dump <a.trc>                           print a trace in readable form
+ *   midi_trace unhex <log.txt> <out.trc>              extract a file printed by the "dump" console command
+ */
+
+
+#include "smf.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define DIFF_DEFAULT_TOLERANCE_US   1000U
+#define DIFF_MAX_REPORTED           20
+
+
+static int trace_render(const char *songPath, const char *tracePath, uint32_t stepMs)
+{
+    std::ifstream f(songPath, std::ios::binary);
+    std::vector<uint8_t> raw((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    auto start = std::chrono::steady_clock::now();
+
+    smf_file_s smf;
+    std::string error;
+    if (!smf_parse(raw.data(), raw.size(), smf, error))
+    {
+        fprintf(stderr, "%s: %s\n", songPath, error.c_str());
+        return 2;
+    }
+
+    smf_track_s merged;
+    smf_merge_tracks(smf, merged);
+
+    std::vector<smf_tempo_point_s> tempoMap;
+    smf_build_tempo_map(smf.division, merged, tempoMap);
+
+    std::vector<trace_msg_s> msgs;
+    uint64_t stepUs = (uint64_t)stepMs * 1000U;
+    uint64_t songUs = 0;
+
+    for (const smf_event_s &ev : merged.events)
+    {
+        uint64_t us = smf_tick_to_us(smf.division, tempoMap, ev.tick);
+        songUs = us;
+
+        if (ev.status == SMF_META)
+        {
+            continue;
+        }
+
+        if (stepUs > 0)
+        {
+            /* events are emitted by the first loop at or after their due time */
+            us = (us + stepUs - 1U) / stepUs * stepUs;
+        }
+
+        trace_msg_s msg;
+        msg.us = us;
+        if (ev.status != 0xF7U)
+        {
+            msg.data.push_back(ev.status);
+        }
+        msg.data.insert(msg.data.end(), ev.data.begin(), ev.data.end());
+        msgs.push_back(std::move(msg));
+    }
+
+    double cpuSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!trace_save(tracePath, msgs))
+    {
+        fprintf(stderr, "cannot write %s\n", tracePath);
+        return 2;
+    }
+
+    printf("rendered %s to %s: %zu messages, song time %.3f s, %.0f song seconds per cpu second\n",
+           songPath, tracePath, msgs.size(), (double)songUs / 1e6, ((double)songUs / 1e6) / std::max(cpuSec, 1e-9));
+    return 0;
+}
+
+static void print_msg(const char *prefix, const trace_msg_s &msg)
+{
+    printf("%s %10.3f ms:", prefix, (double)msg.us / 1000.0);
+    for (size_t i = 0; i < msg.data.size() && i < 16; i++)
+    {
+        printf(" %02x", msg.data[i]);
+    }
+    if (msg.data.size() > 16)
+    {
+        printf(" ... (%zu bytes)", msg.data.size());
+    }
+    printf("\n");
+}
+
+static int trace_diff(const char *pathA, const char *pathB, uint64_t toleranceUs)
+{
+    std::vector<trace_msg_s> a;
+    std::vector<trace_msg_s> b;
+    std::string error;
+
+    if (!trace_load(pathA, a, error) || !trace_load(pathB, b, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 2;
+    }
+
+    /*
+     * Messages are matched in order, a message of a may match any unmatched
+     * message of b with equal bytes within the tolerance window.
+     * This accepts reordering of messages which are due at the same time.
+     */
+    std::vector<bool> usedB(b.size(), false);
+    size_t firstB = 0;
+    size_t matched = 0;
+    size_t reported = 0;
+    uint64_t maxDev = 0;
+    double sumDev = 0;
+    std::vector<size_t> onlyA;
+
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        while (firstB < b.size() && (usedB[firstB] || b[firstB].us + toleranceUs < a[i].us))
+        {
+            firstB++;
+        }
+
+        size_t found = b.size();
+        for (size_t j = firstB; j < b.size() && b[j].us <= a[i].us + toleranceUs; j++)
+        {
+            if (!usedB[j] && b[j].data == a[i].data)
+            {
+                found = j;
+                break;
+            }
+        }
+
+        if (found == b.size())
+        {
+            onlyA.push_back(i);
+            continue;
+        }
+
+        usedB[found] = true;
+        matched++;
+        uint64_t dev = a[i].us > b[found].us ? a[i].us - b[found].us : b[found].us - a[i].us;
+        maxDev = std::max(maxDev, dev);
+        sumDev += (double)dev;
+    }
+
+    for (size_t i : onlyA)
+    {
+        if (reported++ < DIFF_MAX_REPORTED)
+        {
+            print_msg("-", a[i]);
+        }
+    }
+    size_t onlyB = 0;
+    for (size_t j = 0; j < b.size(); j++)
+    {
+        if (!usedB[j])
+        {
+            onlyB++;
+            if (reported++ < DIFF_MAX_REPORTED)
+            {
+                print_msg("+", b[j]);
+            }
+        }
+    }
+
+    printf("%zu / %zu messages matched, %zu only in %s, %zu only in %s, max deviation %.3f ms, mean deviation %.3f ms\n",
+           matched, std::max(a.size(), b.size()), onlyA.size(), pathA, onlyB, pathB,
+           (double)maxDev / 1000.0, matched ? sumDev / (double)matched / 1000.0 : 0.0);
+
+    return (onlyA.empty() && onlyB == 0) ? 0 : 1;
+}
+
+static int trace_dump(const char *path)
+{
+    std::vector<trace_msg_s> msgs;
+    std::string error;
+
+    if (!trace_load(path, msgs, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 2;
+    }
+    for (const trace_msg_s &msg : msgs)
+    {
+        print_msg("", msg);
+    }
+    return 0;
+}
+
+static int trace_unhex(const char *logPath, const char *outPath)
+{
+    std::ifstream in(logPath);
+    std::vector<uint8_t> out;
+    std::string line;
+    bool end = false;
+
+    while (!end && std::getline(in, line))
+    {
+        size_t pos = line.find("HEX ");
+        if (pos == std::string::npos)
+        {
+            continue;
+        }
+        const char *p = line.c_str() + pos + 4;
+        if (strncmp(p, "END", 3) == 0)
+        {
+            end = true;
+            break;
+        }
+        while (isxdigit((unsigned char)p[0]) && isxdigit((unsigned char)p[1]))
+        {
+            char hex[3] = {p[0], p[1], 0};
+            out.push_back((uint8_t)strtoul(hex, nullptr, 16));
+            p += 2;
+        }
+    }
+
+    if (!end)
+    {
+        fprintf(stderr, "%s: no complete dump found\n", logPath);
+        return 2;
+    }
+
+    std::ofstream f(outPath, std::ios::binary);
+    f.write((const char *)out.data(), (std::streamsize)out.size());
+    printf("%zu bytes written to %s\n", out.size(), outPath);
+    return f ? 0 : 2;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage:\n");
+    fprintf(stderr, "  %s render <song.mid> <out.trc> [step ms]\n", name);
+    fprintf(stderr, "  %s diff <a.trc> <b.trc> [tolerance us]\n", name);
+    fprintf(stderr, "  %s dump <a.trc>\n", name);
+    fprintf(stderr, "  %s unhex <log.txt> <out.trc>\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 4 && strcmp(argv[1], "render") == 0)
+    {
+        return trace_render(argv[2], argv[3], argc > 4 ? (uint32_t)atoi(argv[4]) : 1U);
+    }
+    if (argc >= 4 && strcmp(argv[1], "diff") == 0)
+    {
+        return trace_diff(argv[2], argv[3], argc > 4 ? (uint64_t)atoll(argv[4]) : DIFF_DEFAULT_TOLERANCE_US);
+    }
+    if (argc >= 3 && strcmp(argv[1], "dump") == 0)
+    {
+        return trace_dump(argv[2]);
+    }
+    if (argc >= 4 && strcmp(argv[1], "unhex") == 0)
+    {
+        return trace_unhex(argv[2], argv[3]);
+    }
+
+    usage(argv[0]);
+    return 2;
+}
@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file midi_transform_bench.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Cost per note of the live note transform of the MidiLivePlayback sketch.
+ *        LiveTransform.cpp of the sketch is compiled unchanged. Profiles with 1 to XF_ZONES_MAX zones split the keyboard
+ *        of channel 1, further profiles layer zones over all keys. Random notes are played through the tables
+ *        and through a reference which scans the zones and calculates the velocity curve for every note.
+ *        Both have to give the same notes. The zones read by the table lookups are counted (xf_stats_s), their number per note
+ *        must not grow with the number of zones of a split. The time per note is printed as well, it depends on the host.
+ *
+ * Build:
+ *   g++ -O2 -std=c++17 -I../../MidiLivePlayback midi_transform_bench.cpp ../../MidiLivePlayback/LiveTransform.cpp -o midi_transform_bench
+ *
+ * Usage:
+ *   midi_transform_bench [-n notes] [-g max growth %]
+ */
+
+
+#include "LiveTransform.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+
+#define BENCH_REPEAT    5U  /* runs per profile, the fastest counts */
+
+
+static const uint8_t benchCurves[] = {XF_CURVE_LINEAR, XF_CURVE_SOFT, XF_CURVE_HARD, XF_CURVE_FIXED};
+
+static volatile uint32_t benchSink = 0;
+
+
+/**
+ * @brief Transform of a note on without tables, every zone is checked and the curve is calculated.
+ */
+static uint8_t ref_note_on(const std::vector<xf_zone_s> &zones, uint8_t ch, uint8_t note, uint8_t vel, xf_note_s *out)
+{
+    bool covered = false;
+    uint8_t layers = 0;
+    uint8_t n = 0;
+    for (const xf_zone_s &z : zones)
+    {
+        if (z.inCh != ch)
+        {
+            continue;
+        }
+        covered = true;
+        if (note < z.lo || note > z.hi || layers >= XF_LAYERS_MAX)
+        {
+            continue;
+        }
+        layers++;
+        int key = note + z.transpose;
+        if (key < 0 || key > 127)
+        {
+            continue;
+        }
+        int v = vel;
+        switch (z.curve)
+        {
+        case XF_CURVE_SOFT:
+            v = (int)sqrt((double)vel * 127.0);
+            break;
+        case XF_CURVE_HARD:
+            v = (vel * vel + 126) / 127;
+            break;
+        case XF_CURVE_FIXED:
+            v = z.fixedVel;
+            break;
+        default:
+            break;
+        }
+        out[n].ch = z.outCh;
+        out[n].note = (uint8_t)key;
+        out[n].vel = (uint8_t)((v < 1) ? 1 : ((v > 127) ? 127 : v));
+        n++;
+    }
+    if (!covered)
+    {
+        out[0] = {ch, note, vel};
+        return 1;
+    }
+    return n;
+}
+
+static std::vector<xf_zone_s> make_split(uint8_t count)
+{
+    std::vector<xf_zone_s> zones;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        xf_zone_s z = {};
+        z.inCh = 0;
+        z.lo = (uint8_t)(128U * i / count);
+        z.hi = (uint8_t)(128U * (i + 1U) / count - 1U);
+        z.outCh = i;
+        z.transpose = (int8_t)((i % 3U) * 12 - 12);
+        z.curve = benchCurves[i % 4U];
+        z.fixedVel = 100;
+        z.program = XF_PROGRAM_NONE;
+        zones.push_back(z);
+    }
+    return zones;
+}
+
+static std::vector<xf_zone_s> make_layer(uint8_t count)
+{
+    std::vector<xf_zone_s> zones = make_split(count);
+    for (xf_zone_s &z : zones)
+    {
+        z.lo = 0;
+        z.hi = 127;
+    }
+    return zones;
+}
+
+/**
+ * @brief Compare the tables against the reference for every key and velocity.
+ * @return true if all notes are the same
+ */
+static bool check(const std::vector<xf_zone_s> &zones)
+{
+    for (uint16_t note = 0; note < 128; note++)
+    {
+        for (uint16_t vel = 1; vel < 128; vel++)
+        {
+            xf_note_s a[XF_LAYERS_MAX];
+            xf_note_s b[XF_LAYERS_MAX];
+            memset(b, 0, sizeof(b));
+            uint8_t na = xf_note_on(0, (uint8_t)note, (uint8_t)vel, a);
+            uint8_t nb = ref_note_on(zones, 0, (uint8_t)note, (uint8_t)vel, b);
+            xf_note_s off[XF_LAYERS_MAX];
+            xf_note_off(0, (uint8_t)note, off);
+            if (na != nb || memcmp(a, b, na * sizeof(xf_note_s)) != 0)
+            {
+                printf("mismatch at key %u velocity %u: %u notes against %u\n", note, vel, na, nb);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <typename F>
+static double time_ns(const std::vector<uint8_t> &notes, F play)
+{
+    double best = 1e30;
+    for (uint32_t r = 0; r < BENCH_REPEAT; r++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i + 1 < notes.size(); i += 2)
+        {
+            play(notes[i], notes[i + 1]);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, ns / (notes.size() / 2U));
+    }
+    return best;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t noteCount = 1000000;
+    double maxGrowth = 50.0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            noteCount = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc)
+        {
+            maxGrowth = atof(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-n notes] [-g max growth %%]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<uint32_t> key(0, 127);
+    std::uniform_int_distribution<uint32_t> velocity(1, 127);
+    std::vector<uint8_t> notes;
+    for (uint32_t i = 0; i < noteCount; i++)
+    {
+        notes.push_back((uint8_t)key(rng));
+        notes.push_back((uint8_t)velocity(rng));
+    }
+
+    struct xf_stats_s stats;
+    xf_get_stats(&stats);
+    printf("%u random notes on and off on channel 1, %u bytes of tables\n", noteCount, stats.tableBytes);
+    printf("%-9s %6s %8s %12s %12s %12s %12s\n", "profile", "zones", "outputs", "table reads", "scan reads", "table ns", "scan ns");
+
+    struct profile_s
+    {
+        const char *name;
+        std::vector<xf_zone_s> zones;
+    };
+    std::vector<profile_s> profiles;
+    for (uint8_t n = 1; n <= XF_ZONES_MAX; n *= 2U)
+    {
+        profiles.push_back({"split", make_split(n)});
+    }
+    for (uint8_t n = 2; n <= XF_LAYERS_MAX; n *= 2U)
+    {
+        profiles.push_back({"layer", make_layer(n)});
+    }
+
+    bool fail = false;
+    double splitFirst = 0.0;
+    double splitLast = 0.0;
+    struct xf_stats_s before;
+    for (const profile_s &p : profiles)
+    {
+        if (!xf_set_zones(p.zones.data(), (uint8_t)p.zones.size()) || !check(p.zones))
+        {
+            printf("FAIL (%s with %zu zones)\n", p.name, p.zones.size());
+            return 1;
+        }
+
+        /* zones read per note on and off, the same on every run */
+        xf_get_stats(&before);
+        for (size_t i = 0; i + 1 < notes.size(); i += 2)
+        {
+            xf_note_s out[XF_LAYERS_MAX];
+            xf_note_on(0, notes[i], notes[i + 1], out);
+            xf_note_off(0, notes[i], out);
+        }
+        xf_get_stats(&stats);
+        double tableReads = (double)(stats.lookups - before.lookups) / (stats.notes - before.notes);
+        double scanReads = 2.0 * p.zones.size();
+
+        double tableNs = time_ns(notes, [](uint8_t note, uint8_t vel)
+        {
+            xf_note_s out[XF_LAYERS_MAX];
+            uint8_t n = xf_note_on(0, note, vel, out);
+            n += xf_note_off(0, note, out);
+            benchSink += n + out[0].note;
+        });
+        double scanNs = time_ns(notes, [&p](uint8_t note, uint8_t vel)
+        {
+            xf_note_s out[XF_LAYERS_MAX];
+            uint8_t n = ref_note_on(p.zones, 0, note, vel, out);
+            n += ref_note_on(p.zones, 0, note, 0, out);
+            benchSink += n + out[0].note;
+        });
+
+        xf_get_stats(&stats);
+        printf("%-9s %6zu %8.2f %12.2f %12.2f %12.1f %12.1f\n", p.name, p.zones.size(), (double)stats.outputs / stats.notes, tableReads,
+               scanReads, tableNs, scanNs);
+
+        if (strcmp(p.name, "split") == 0)
+        {
+            if (splitFirst == 0.0)
+            {
+                splitFirst = tableReads;
+            }
+            splitLast = tableReads;
+        }
+    }
+
+    double growth = 100.0 * (splitLast - splitFirst) / splitFirst;
+    fail = growth > maxGrowth;
+    printf("%s (zones read per note of a split grow by %.0f %% from 1 to %u zones, limit %.0f %%)\n", fail ? "FAIL" : "PASS", growth, XF_ZONES_MAX, maxGrowth);
+    return fail ? 1 : 0;
+}
@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file midi_transport_bench.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Cost per byte of the serial access of the sketches, through Stream against the port type bound at compile time.
+ *        MidiTransport.h of the sketch is used unchanged. MidiTransport<Stream> is the access of the host build and
+ *        of the sketches before, every call goes through the virtual functions. MidiTransport<FifoSerial> is what
+ *        a board gets, FifoSerial models the TX and RX FIFO of a UART with its functions visible to the compiler
+ *        like the register access of a core.
+ *        Three patterns are measured: single bytes written (real time bytes), 3 byte messages written after a check of the
+ *        free FIFO space (output merger) and bytes read while available (input).
+ *        Both variants have to produce the same bytes.
+ *
+ * Build:
+ *   g++ -O2 -std=c++17 -I../host -I../../MidiFilePlayer midi_transport_bench.cpp ../host/host_arduino.cpp -o midi_transport_bench
+ *
+ * Usage:
+ *   midi_transport_bench [-n bytes] [-s max slowdown %]
+ */
+
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES
+#endif
+
+#include "MidiTransport.h"
+
+
+#define BENCH_FIFO_SIZE     128U
+#define BENCH_REPEAT        5U  /* runs per pattern, the fastest counts */
+
+
+/**
+ * @brief UART with a TX and an RX FIFO, transmitted bytes are summed up when the FIFO is drained.
+ */
+class FifoSerial : public Stream
+{
+public:
+    size_t write(uint8_t b) override
+    {
+        if (txUsed >= BENCH_FIFO_SIZE)
+        {
+            return 0;
+        }
+        tx[txUsed++] = b;
+        return 1;
+    }
+
+    size_t write(const uint8_t *buf, size_t len) override
+    {
+        size_t n = 0;
+        while (n < len && txUsed < BENCH_FIFO_SIZE)
+        {
+            tx[txUsed++] = buf[n++];
+        }
+        return n;
+    }
+
+    int availableForWrite(void) override
+    {
+        return (int)(BENCH_FIFO_SIZE - txUsed);
+    }
+
+    int available(void) override
+    {
+        return (int)(rxUsed - rxPos);
+    }
+
+    int read(void) override
+    {
+        return (rxPos < rxUsed) ? rx[rxPos++] : -1;
+    }
+
+    int peek(void) override
+    {
+        return (rxPos < rxUsed) ? rx[rxPos] : -1;
+    }
+
+    /* the line took all bytes of the TX FIFO */
+    void drain(void)
+    {
+        for (uint32_t i = 0; i < txUsed; i++)
+        {
+            txSum = txSum * 31U + tx[i];
+        }
+        txUsed = 0;
+    }
+
+    /* the RX FIFO is full again */
+    void fill(uint32_t seed)
+    {
+        for (uint32_t i = 0; i < BENCH_FIFO_SIZE; i++)
+        {
+            rx[i] = (uint8_t)(seed + i * 7U);
+        }
+        rxUsed = BENCH_FIFO_SIZE;
+        rxPos = 0;
+    }
+
+    uint8_t tx[BENCH_FIFO_SIZE];
+    uint32_t txUsed = 0;
+    uint64_t txSum = 0;
+    uint8_t rx[BENCH_FIFO_SIZE];
+    uint32_t rxUsed = 0;
+    uint32_t rxPos = 0;
+};
+
+
+struct result_s
+{
+    double ns;
+    double cycles;
+    uint64_t sum;
+};
+
+
+/* the port is passed through a volatile pointer, so the compiler can not see its type in the Stream variant */
+static FifoSerial benchPort;
+static FifoSerial *volatile benchPortPtr = &benchPort;
+
+
+template <class Port>
+static uint64_t run_tx_byte(Port &port, FifoSerial &fifo, uint32_t bytes)
+{
+    const uint8_t clock = 0xF8U;
+    for (uint32_t i = 0; i < bytes; i++)
+    {
+        if (MidiTransport<Port>::write(port, &clock, 1) == 0)
+        {
+            fifo.drain();
+            MidiTransport<Port>::write(port, &clock, 1);
+        }
+    }
+    fifo.drain();
+    return fifo.txSum;
+}
+
+template <class Port>
+static uint64_t run_tx_msg(Port &port, FifoSerial &fifo, uint32_t bytes)
+{
+    for (uint32_t i = 0; i < bytes / 3U; i++)
+    {
+        uint8_t msg[3] = {(uint8_t)(0x90U | (i & 0x0FU)), (uint8_t)(i & 0x7FU), 100U};
+        if (MidiTransport<Port>::availableForWrite(port) < 3)
+        {
+            fifo.drain();
+        }
+        MidiTransport<Port>::write(port, msg, sizeof(msg));
+    }
+    fifo.drain();
+    return fifo.txSum;
+}
+
+template <class Port>
+static uint64_t run_rx(Port &port, FifoSerial &fifo, uint32_t bytes)
+{
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < bytes / BENCH_FIFO_SIZE; i++)
+    {
+        fifo.fill(i);
+        while (MidiTransport<Port>::available(port) > 0)
+        {
+            sum = sum * 31U + (uint32_t)MidiTransport<Port>::read(port);
+        }
+    }
+    return sum;
+}
+
+template <typename F>
+static struct result_s measure(uint32_t bytes, F run)
+{
+    struct result_s best = {1e30, 1e30, 0};
+    for (uint32_t r = 0; r < BENCH_REPEAT; r++)
+    {
+        benchPort = FifoSerial();
+#ifdef BENCH_CYCLES
+        uint64_t c0 = __rdtsc();
+#endif
+        auto start = std::chrono::steady_clock::now();
+        best.sum = run();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+#ifdef BENCH_CYCLES
+        best.cycles = std::min(best.cycles, (double)(__rdtsc() - c0) / bytes);
+#endif
+        best.ns = std::min(best.ns, ns / bytes);
+    }
+    return best;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t byteCount = 30000000;
+    double maxSlowdown = 10.0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            byteCount = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            maxSlowdown = atof(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-n bytes] [-s max slowdown %%]\n", argv[0]);
+            return 2;
+        }
+    }
+    byteCount = std::max(byteCount / (3U * BENCH_FIFO_SIZE), 1U) * 3U * BENCH_FIFO_SIZE;
+
+    struct pattern_s
+    {
+        const char *name;
+        struct result_s dynamic;
+        struct result_s bound;
+    };
+    struct pattern_s patterns[] =
+    {
+        {
+            "tx byte",
+            measure(byteCount, [byteCount]() { return run_tx_byte<Stream>(*benchPortPtr, benchPort, byteCount); }),
+            measure(byteCount, [byteCount]() { return run_tx_byte<FifoSerial>(*benchPortPtr, benchPort, byteCount); }),
+        },
+        {
+            "tx message",
+            measure(byteCount, [byteCount]() { return run_tx_msg<Stream>(*benchPortPtr, benchPort, byteCount); }),
+            measure(byteCount, [byteCount]() { return run_tx_msg<FifoSerial>(*benchPortPtr, benchPort, byteCount); }),
+        },
+        {
+            "rx",
+            measure(byteCount, [byteCount]() { return run_rx<Stream>(*benchPortPtr, benchPort, byteCount); }),
+            measure(byteCount, [byteCount]() { return run_rx<FifoSerial>(*benchPortPtr, benchPort, byteCount); }),
+        },
+    };
+
+    printf("%u bytes per pattern, FIFO of %u bytes\n", byteCount, BENCH_FIFO_SIZE);
+#ifdef BENCH_CYCLES
+    printf("%-12s %14s %14s %14s %14s\n", "pattern", "Stream ns", "bound ns", "Stream cycles", "bound cycles");
+#else
+    printf("%-12s %14s %14s\n", "pattern", "Stream ns", "bound ns");
+#endif
+
+    bool fail = false;
+    for (const struct pattern_s &p : patterns)
+    {
+#ifdef BENCH_CYCLES
+        printf("%-12s %14.2f %14.2f %14.2f %14.2f\n", p.name, p.dynamic.ns, p.bound.ns, p.dynamic.cycles, p.bound.cycles);
+#else
+        printf("%-12s %14.2f %14.2f\n", p.name, p.dynamic.ns, p.bound.ns);
+#endif
+        if (p.dynamic.sum != p.bound.sum)
+        {
+            printf("FAIL (%s: different bytes)\n", p.name);
+            return 1;
+        }
+        if (p.bound.ns > p.dynamic.ns * (1.0 + maxSlowdown / 100.0))
+        {
+            fail = true;
+        }
+    }
+
+    printf("%s (bound access not slower than Stream by more than %.0f %%)\n", fail ? "FAIL" : "PASS", maxSlowdown);
+    return fail ? 1 : 0;
+}
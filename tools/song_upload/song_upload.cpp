@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2026 Marcel Licence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file song_upload.cpp
+ * @author Marcel Licence
+ * @date 18.10.2026
+ *
+ * @brief Host tool sending a file to the MidiFilePlayer over its USB serial while it plays (SongUpload.h of the sketch).
+ *        The frames and the CRCs are built by SongUpload.cpp of the sketch. Up to a window of frames is on its way,
+ *        a nak or a second without ack continues from the oldest frame without ack. Lines of the sketch which are no reply
+ *        (log output) are skipped. Throughput and resent frames are printed at the end.
+ *
+ * Build:
+ *   g++ -O2 -std=c++17 -I../host -I../../MidiFilePlayer song_upload.cpp ../../MidiFilePlayer/SongUpload.cpp ../host/host_arduino.cpp ../host/host_fs.cpp -o song_upload
+ *
+ * Usage:
+ *   song_upload [-w window frames] <serial device> <file> [name on the device]
+ */
+
+
+#include <Arduino.h>
+
+#include <chrono>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <poll.h>
+#include <string>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+#include "SongUpload.h"
+
+
+#define SEND_WINDOW         8U      /* default frames on their way, the sketch keeps two blocks of 16 frames */
+#define SEND_ACK_MS         1000U   /* no reply, the frames are sent again */
+#define SEND_RETRIES        5U
+#define SEND_DONE_MS        10000U  /* the sketch writes the last blocks after the last ack */
+
+
+static std::string rxBuf;
+
+
+static int serial_open(const char *dev)
+{
+    int fd = open(dev, O_RDWR | O_NOCTTY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0)
+    {
+        /* USB CDC ignores the baud rate */
+        cfmakeraw(&tio);
+        cfsetspeed(&tio, B115200);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+static bool serial_write(int fd, const void *buf, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+    while (len > 0)
+    {
+        ssize_t n = write(fd, p, len);
+        if (n <= 0)
+        {
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/**
+ * @brief Read a line of the sketch.
+ * @param line Filled without the line end
+ * @param timeoutMs Time to wait for it
+ * @return false on timeout
+ */
+static bool serial_read_line(int fd, std::string &line, uint32_t timeoutMs)
+{
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    for (;;)
+    {
+        size_t pos = rxBuf.find('\n');
+        if (pos != std::string::npos)
+        {
+            line = rxBuf.substr(0, pos);
+            rxBuf.erase(0, pos + 1U);
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.pop_back();
+            }
+            return true;
+        }
+        int leftMs = (int)std::chrono::duration_cast<std::chrono::milliseconds>(end - std::chrono::steady_clock::now()).count();
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (leftMs <= 0 || poll(&pfd, 1, leftMs) <= 0)
+        {
+            return false;
+        }
+        char buf[256];
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0)
+        {
+            return false;
+        }
+        rxBuf.append(buf, (size_t)n);
+    }
+}
+
+static bool send_frame(int fd, const std::vector<uint8_t> &data, uint32_t index, uint32_t frameMax)
+{
+    size_t off = (size_t)index * frameMax;
+    uint16_t len = (uint16_t)std::min<size_t>(frameMax, data.size() - off);
+    std::vector<uint8_t> frame = {(uint8_t)UPLOAD_SYNC, (uint8_t)index, (uint8_t)len, (uint8_t)(len >> 8U)};
+    frame.insert(frame.end(), data.begin() + off, data.begin() + off + len);
+    uint16_t crc = upload_crc16(0xFFFFU, &frame[1], (uint32_t)frame.size() - 1U);
+    frame.push_back((uint8_t)crc);
+    frame.push_back((uint8_t)(crc >> 8U));
+    return serial_write(fd, frame.data(), frame.size());
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-w window frames] <serial device> <file> [name on the device]\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t window = SEND_WINDOW;
+    const char *dev = NULL;
+    const char *path = NULL;
+    const char *name = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+        {
+            window = std::max(1, atoi(argv[++i]));
+        }
+        else if (dev == NULL)
+        {
+            dev = argv[i];
+        }
+        else if (path == NULL)
+        {
+            path = argv[i];
+        }
+        else if (name == NULL)
+        {
+            name = argv[i];
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (path == NULL || window > 128U)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    if (name == NULL)
+    {
+        name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.empty())
+    {
+        fprintf(stderr, "%s: cannot read\n", path);
+        return 1;
+    }
+    int fd = serial_open(dev);
+    if (fd < 0)
+    {
+        fprintf(stderr, "%s: cannot open\n", dev);
+        return 1;
+    }
+
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "upload %s %zu %08x\n", name, data.size(), upload_crc32(0, data.data(), (uint32_t)data.size()));
+    serial_write(fd, cmd, strlen(cmd));
+
+    std::string line;
+    unsigned frameMax = 0;
+    while (frameMax == 0)
+    {
+        if (!serial_read_line(fd, line, SEND_ACK_MS * 3U))
+        {
+            fprintf(stderr, "no reply from %s\n", dev);
+            return 1;
+        }
+        if (line.rfind("upload failed", 0) == 0)
+        {
+            fprintf(stderr, "%s\n", line.c_str());
+            return 1;
+        }
+        sscanf(line.c_str(), "upload ready %u", &frameMax);
+    }
+
+    /* go back n: frames from base up to next are on their way */
+    auto start = std::chrono::steady_clock::now();
+    uint32_t frames = (uint32_t)((data.size() + frameMax - 1U) / frameMax);
+    uint32_t base = 0;
+    uint32_t next = 0;
+    uint32_t resent = 0;
+    uint32_t retries = 0;
+    bool rewound = false;
+    for (;;)
+    {
+        while (next < frames && next < base + window)
+        {
+            if (!send_frame(fd, data, next, frameMax))
+            {
+                fprintf(stderr, "%s: write failed\n", dev);
+                return 1;
+            }
+            next++;
+        }
+
+        if (!serial_read_line(fd, line, (base < frames) ? SEND_ACK_MS : SEND_DONE_MS))
+        {
+            if (base >= frames || ++retries > SEND_RETRIES)
+            {
+                fprintf(stderr, "no reply from %s\n", dev);
+                return 1;
+            }
+            resent += next - base;
+            next = base;
+            continue;
+        }
+        unsigned seq;
+        if (sscanf(line.c_str(), "ack %u", &seq) == 1)
+        {
+            if (seq == (base & 0xFFU) && base < next)
+            {
+                base++;
+                retries = 0;
+                rewound = false;
+            }
+        }
+        else if (sscanf(line.c_str(), "nak %u", &seq) == 1)
+        {
+            /* the frames after a rejected one are rejected as well, go back once */
+            if (!rewound)
+            {
+                resent += next - base;
+                next = base;
+                rewound = true;
+            }
+        }
+        else if (line.rfind("upload done", 0) == 0)
+        {
+            break;
+        }
+        else if (line.rfind("upload failed", 0) == 0)
+        {
+            fprintf(stderr, "%s\n", line.c_str());
+            return 1;
+        }
+    }
+
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%s -> /%s: %zu bytes in %.1f s, %.0f bytes/s, %u frames, %u sent again\n", path, name, data.size(), s, data.size() / s, frames, resent);
+    close(fd);
+    return 0;
+}